@@ -0,0 +1,813 @@
+/*
+ * Copyright 2016 The MathWorks, Inc.
+ *
+ * File: rt_posix_main.c
+ *
+ * Abstract:
+ *
+ *   A real-time main that runs generated Simulink Coder code on Linux with
+ *   POSIX threads.  It is rt_main.c with the free-running loop replaced by
+ *   periodic threads:
+ *
+ *     o The base rate runs in a SCHED_FIFO thread released every base step
+ *       by clock_nanosleep on CLOCK_MONOTONIC, at absolute times so that
+ *       the releases do not drift.
+ *     o With MULTITASKING, each subrate runs in its own SCHED_FIFO thread,
+ *       released by the base rate through a semaphore.  Priorities are rate
+ *       monotonic: the base rate has RT_POSIX_PRIORITY and each slower rate
+ *       one less than the rate before it.
+ *     o All memory is locked with mlockall and the rate threads can be
+ *       pinned to one CPU.  With MULTITASKING they always are: rate
+ *       transitions and eventFlags assume that a faster rate preempts a
+ *       slower one, as on a single-core target, and do not hold up when
+ *       rates run in parallel on several CPUs.
+ *
+ *   OverrunFlags and eventFlags keep their meaning from rt_main.c.  They
+ *   are guarded by a priority inheritance mutex, so that a slow rate
+ *   holding it cannot be kept from releasing it by a rate of middle
+ *   priority while the base rate waits for it.  The
+ *   base rate overruns when its step is not complete by the next release,
+ *   and subrate i overruns when it is released again before its previous
+ *   step is complete.  As in rt_main.c the first overrun stops the model
+ *   with the error status "Overrun", unless RT_POSIX_MAX_OVERRUNS allows
+ *   more, in which case a late release is skipped.
+ *
+ *   For each rate, the number of releases and overruns and a histogram of
+ *   the release jitter (the delay from the release time to the start of
+ *   the step) are printed when the model terminates.
+ *
+ *   Real-time priorities and mlockall need CAP_SYS_NICE and CAP_IPC_LOCK
+ *   (or root).  Without them the model runs with a warning at normal
+ *   priority.
+ *
+ * Required Defines:
+ *
+ *   MODEL - Model name
+ *   NUMST - Number of sample times
+ *
+ * Optional Defines:
+ *
+ *   MULTITASKING          - One thread per rate (use MT for a synonym)
+ *   TID01EQ=1             - Sample time task ids 0 and 1 have equal rates
+ *   RT_POSIX_BASE_PERIOD  - Base step in seconds, if the model has no
+ *                           rtmGetStepSize
+ *   RT_POSIX_PRIORITY     - SCHED_FIFO priority of the base rate, default 80
+ *   RT_POSIX_CPU          - CPU to pin the rate threads to.  Default -1:
+ *                           no pinning, or with MULTITASKING the first CPU
+ *                           the process may run on
+ *   RT_POSIX_MAX_OVERRUNS - Overruns per rate tolerated before stopping,
+ *                           default 0
+ *   RT_POSIX_HIST_BINS    - Bins of the jitter histograms, default 16
+ *
+ */
+
+/*==================*
+ * Required defines *
+ *==================*/
+
+#ifndef MODEL
+# error Must specify a model name.  Define MODEL=name.
+#else
+/* create generic macros that work with any model */
+# define EXPAND_CONCAT(name1,name2) name1 ## name2
+# define CONCAT(name1,name2) EXPAND_CONCAT(name1,name2)
+# define MODEL_INITIALIZE CONCAT(MODEL,_initialize)
+# define MODEL_STEP       CONCAT(MODEL,_step)
+# define MODEL_TERMINATE  CONCAT(MODEL,_terminate)
+# define RT_MDL           CONCAT(MODEL,_M)
+#endif
+
+#ifndef NUMST
+# error Must specify the number of sample times.  Define NUMST=number.
+#endif
+
+#if CLASSIC_INTERFACE == 1
+# error "Classic call interface is not supported by rt_posix_main.c."
+#endif
+
+#if ONESTEPFCN==0
+#error Separate output and update functions are not supported by rt_posix_main.c. \
+You must update rt_posix_main.c to suit your application needs, or select \
+the 'Single output/update function' option.
+#endif
+
+#if TERMFCN==0
+#error The terminate function is required by rt_posix_main.c. \
+You must update rt_posix_main.c to suit your application needs, or select \
+the 'Terminate function required' option.
+#endif
+
+#if MULTI_INSTANCE_CODE==1
+#error rt_posix_main.c does not support reusable code generation.  Either \
+deselect ERT option 'Generate reusable code' or modify rt_posix_main.c for \
+your application needs.
+#endif
+
+#define QUOTE1(name) #name
+#define QUOTE(name) QUOTE1(name)    /* need to expand name    */
+
+#ifndef SAVEFILE
+# define MATFILE2(file) #file ".mat"
+# define MATFILE1(file) MATFILE2(file)
+# define MATFILE MATFILE1(MODEL)
+#else
+# define MATFILE QUOTE(SAVEFILE)
+#endif
+
+#ifndef RT_POSIX_PRIORITY
+# define RT_POSIX_PRIORITY 80
+#endif
+
+#ifndef RT_POSIX_CPU
+# define RT_POSIX_CPU -1
+#endif
+
+#ifndef RT_POSIX_MAX_OVERRUNS
+# define RT_POSIX_MAX_OVERRUNS 0
+#endif
+
+#ifndef RT_POSIX_HIST_BINS
+# define RT_POSIX_HIST_BINS 16
+#endif
+
+/*==========*
+ * Includes *
+ *==========*/
+
+#ifndef _GNU_SOURCE
+# define _GNU_SOURCE  /* needed for pthread_setaffinity_np */
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sys/mman.h>
+
+#include "rtwtypes.h"
+#include "rtmodel.h" /* optional for automated builds */
+
+#include "rt_logging.h"
+#ifdef UseMMIDataLogging
+#include "rt_logging_mmi.h"
+#endif
+
+#include "ext_work.h"
+
+#ifdef MODEL_STEP_FCN_CONTROL_USED
+#error rt_posix_main.c does not support model step function prototype control.
+#endif
+
+#ifndef RT_POSIX_BASE_PERIOD
+# ifdef rtmGetStepSize
+#  define RT_POSIX_BASE_PERIOD rtmGetStepSize(RT_MDL)
+# else
+#  error The model has no step size.  Define RT_POSIX_BASE_PERIOD=seconds.
+# endif
+#endif
+
+/*========================*
+ * Setup for multitasking *
+ *========================*/
+
+/*
+ * Let MT be synonym for MULTITASKING (to shorten command line for DOS)
+ */
+#if defined(MT)
+# if MT == 0
+# undef MT
+# else
+# define MULTITASKING 1
+# endif
+#endif
+
+#if defined(TID01EQ) && TID01EQ == 1
+#define FIRST_TID 1
+#else
+#define FIRST_TID 0
+#endif
+
+#ifndef MULTITASKING
+# define NUMRATES 1
+#else
+# define NUMRATES NUMST
+#endif
+
+/*====================*
+ * External functions *
+ *====================*/
+
+extern void MODEL_INITIALIZE(void);
+extern void MODEL_TERMINATE(void);
+
+#if !defined(MULTITASKING)
+ extern void MODEL_STEP(void);       /* single-rate step function */
+#else
+ extern void MODEL_STEP(int_T tid);  /* multirate step function */
+#endif
+
+
+/*==================================*
+ * Global data local to this module *
+ *==================================*/
+
+/* Timing of one rate thread */
+typedef struct RateInfo_tag {
+    pthread_t       thread;
+    boolean_T       started;
+    sem_t           release;        /* posted by the base rate (subrates) */
+    struct timespec releaseTime;    /* time of the pending release */
+    unsigned long   nReleases;
+    unsigned long   nOverruns;
+    real_T          maxJitter;      /* seconds */
+    unsigned long   hist[RT_POSIX_HIST_BINS];
+} RateInfo;
+
+static boolean_T OverrunFlags[NUMRATES];  /* overrun flags */
+static boolean_T eventFlags[NUMRATES];    /* pending subrate releases */
+
+/* OverrunFlags and eventFlags are shared by the rate threads */
+static pthread_mutex_t flagsMutex;
+
+static RateInfo  rateInfo[NUMRATES];
+static volatile  boolean_T rateQuit = false;  /* the rate threads stop */
+static boolean_T realTime = true;  /* real-time scheduling was granted */
+static int_T     rateCPU  = RT_POSIX_CPU;  /* CPU of the rate threads */
+
+/*==================*
+ * Local functions  *
+ *==================*/
+
+/* t += ns nanoseconds */
+static void rt_TimespecAdd(struct timespec *t, long ns)
+{
+    t->tv_nsec += ns;
+    while (t->tv_nsec >= 1000000000L) {
+        t->tv_nsec -= 1000000000L;
+        t->tv_sec++;
+    }
+}
+
+/* a - b in seconds */
+static real_T rt_TimespecDiff(const struct timespec *a,
+                              const struct timespec *b)
+{
+    return((real_T)(a->tv_sec - b->tv_sec) +
+           1e-9*(real_T)(a->tv_nsec - b->tv_nsec));
+}
+
+/* Function: rt_RecordRelease =================================================
+ *
+ * Abstract:
+ *   Count a release of ri at the time in release and add the delay to now
+ *   to its jitter histogram.  Bin 0 counts delays under 1 us, bin k those
+ *   from 2^(k-1) to 2^k us and the last bin all longer ones.
+ */
+static void rt_RecordRelease(RateInfo *ri, const struct timespec *release)
+{
+    struct timespec now;
+    real_T          jitter;
+    real_T          us;
+    int_T           k = 0;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    jitter = rt_TimespecDiff(&now, release);
+    if (jitter < 0.0) jitter = 0.0;
+    if (jitter > ri->maxJitter) ri->maxJitter = jitter;
+
+    for (us = jitter*1e6; us >= 1.0 && k < RT_POSIX_HIST_BINS-1; us *= 0.5) {
+        k++;
+    }
+    ri->hist[k]++;
+    ri->nReleases++;
+}
+
+/* Function: rt_Overrun =======================================================
+ *
+ * Abstract:
+ *   Count an overrun of the rate tid and stop the model once there are more
+ *   than RT_POSIX_MAX_OVERRUNS.  Returns true if the model stops.  Called
+ *   with flagsMutex held.
+ */
+static boolean_T rt_Overrun(int_T tid)
+{
+    if (++rateInfo[tid].nOverruns > RT_POSIX_MAX_OVERRUNS) {
+        OverrunFlags[tid]++;
+        rtmSetErrorStatus(RT_MDL, "Overrun");
+        return(true);
+    }
+    return(false);
+}
+
+/* true when the rate threads should stop */
+static boolean_T rt_Done(void)
+{
+    return(rateQuit ||
+           rtmGetErrorStatus(RT_MDL) != NULL ||
+           rtmGetStopRequested(RT_MDL));
+}
+
+#if !defined(MULTITASKING) /* single task */
+
+/* Function: rtOneStep ========================================================
+ *
+ * Abstract:
+ *   Perform one step of the model, released at the time in release.
+ */
+static void rt_OneStep(const struct timespec *release)
+{
+    (void)pthread_mutex_lock(&flagsMutex);
+    OverrunFlags[0]++;
+    (void)pthread_mutex_unlock(&flagsMutex);
+
+    rt_RecordRelease(&rateInfo[0], release);
+
+    /* Set model inputs here */
+
+    /**************
+     * Step model *
+     **************/
+    MODEL_STEP();
+
+    /* Get model outputs here */
+
+    /**************************
+     * Decrement overrun flag *
+     **************************/
+    (void)pthread_mutex_lock(&flagsMutex);
+    OverrunFlags[0]--;
+    (void)pthread_mutex_unlock(&flagsMutex);
+
+    rtExtModeCheckEndTrigger();
+
+} /* end rtOneStep */
+
+#else /* multitask */
+
+/* Function: rtOneStep ========================================================
+ *
+ * Abstract:
+ *   Perform one step of the base rate, released at the time in release, and
+ *   release the subrates that have a hit.  This is the rt_OneStep of
+ *   rt_main.c with the subrates run by their threads instead of inline.
+ */
+static void rt_OneStep(const struct timespec *release)
+{
+    boolean_T hit[NUMST];
+    boolean_T subratesIdle = true;
+    int_T     i;
+
+    (void)pthread_mutex_lock(&flagsMutex);
+    OverrunFlags[0]++;
+
+    /* Only this thread releases subrates, so they stay idle until below */
+    for (i = FIRST_TID+1; i < NUMST; i++) {
+        if (eventFlags[i]) subratesIdle = false;
+    }
+
+    /*************************************************
+     * Update EventFlags and check subrate overrun   *
+     *************************************************/
+    for (i = FIRST_TID+1; i < NUMST; i++) {
+        hit[i] = (boolean_T)(rtmStepTask(RT_MDL,i) != 0);
+        if (hit[i] && eventFlags[i]++) {
+            /* Sampling too fast: skip this release or stop */
+            eventFlags[i]--;
+            hit[i] = false;
+            if (rt_Overrun(i)) {
+                OverrunFlags[0]--;
+                (void)pthread_mutex_unlock(&flagsMutex);
+                return;
+            }
+        }
+        if (++rtmTaskCounter(RT_MDL,i) == rtmCounterLimit(RT_MDL,i))
+            rtmTaskCounter(RT_MDL, i) = 0;
+    }
+    (void)pthread_mutex_unlock(&flagsMutex);
+
+    rt_RecordRelease(&rateInfo[0], release);
+
+    /*
+     * Install the parameters staged by external mode while no rate is
+     * mid-step.  With harmonic rates and no overruns this happens at least
+     * once per period of the slowest rate.
+     */
+    if (subratesIdle) {
+        rtExtModeCommitParams();
+    }
+
+    /* Set model inputs associated with base rate here */
+
+    /*******************************************
+     * Step the model for the base sample time *
+     *******************************************/
+    MODEL_STEP(0);
+
+    /* Get model outputs associated with base rate here */
+
+    (void)pthread_mutex_lock(&flagsMutex);
+    OverrunFlags[0]--;
+    (void)pthread_mutex_unlock(&flagsMutex);
+
+    /*****************************************************
+     * Release the threads of the subrates with a hit    *
+     *****************************************************/
+    for (i = FIRST_TID+1; i < NUMST; i++) {
+        if (hit[i]) {
+            rateInfo[i].releaseTime = *release;
+            (void)sem_post(&rateInfo[i].release);
+        }
+    }
+
+    rtExtModeCheckEndTrigger();
+
+} /* end rtOneStep */
+
+/* Function: rt_SubrateThread =================================================
+ *
+ * Abstract:
+ *   Thread of subrate tid: step the model for sample time tid each time the
+ *   base rate releases it.
+ */
+static void *rt_SubrateThread(void *arg)
+{
+    int_T    tid = (int_T)(size_t)arg;
+    RateInfo *ri = &rateInfo[tid];
+
+    for (;;) {
+        while (sem_wait(&ri->release) != 0 && errno == EINTR) {
+            /* retry */
+        }
+        if (rateQuit) break;
+
+        rt_RecordRelease(ri, &ri->releaseTime);
+
+        (void)pthread_mutex_lock(&flagsMutex);
+        OverrunFlags[tid]++;
+        (void)pthread_mutex_unlock(&flagsMutex);
+
+        /* Set model inputs associated with subrate here */
+
+        /******************************************
+         * Step the model for sample time "tid"   *
+         ******************************************/
+        MODEL_STEP(tid);
+
+        /* Get model outputs associated with subrate here */
+
+        /************************************************
+         * Indicate task complete for sample time "tid" *
+         ************************************************/
+        (void)pthread_mutex_lock(&flagsMutex);
+        OverrunFlags[tid]--;
+        eventFlags[tid]--;
+        (void)pthread_mutex_unlock(&flagsMutex);
+    }
+    return(NULL);
+
+} /* end rt_SubrateThread */
+
+#endif /* MULTITASKING */
+
+/* Function: rt_BaseRateThread ================================================
+ *
+ * Abstract:
+ *   Thread of the base rate: release a step every base period until the
+ *   model stops.  The external mode work of the main loop of rt_main.c is
+ *   done here, before each step.
+ */
+static void *rt_BaseRateThread(void *arg)
+{
+    const long      period = (long)(RT_POSIX_BASE_PERIOD*1e9 + 0.5);
+    struct timespec release;
+    struct timespec now;
+
+    (void)arg;
+    (void)clock_gettime(CLOCK_MONOTONIC, &release);
+
+    while (!rt_Done()) {
+        rt_TimespecAdd(&release, period);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+                               &release, NULL) == EINTR) {
+            /* retry */
+        }
+
+        rtExtModePauseIfNeeded(rtmGetRTWExtModeInfo(RT_MDL),
+                               NUMST,
+                               (boolean_T *)&rtmGetStopRequested(RT_MDL));
+
+        if (rtmGetStopRequested(RT_MDL)) break;
+
+        /* external mode */
+        rtExtModeOneStep(rtmGetRTWExtModeInfo(RT_MDL),
+                         NUMST,
+                         (boolean_T *)&rtmGetStopRequested(RT_MDL));
+
+        rt_OneStep(&release);
+
+        /***********************************************
+         * Check and see if base step time is too fast *
+         ***********************************************/
+        (void)clock_gettime(CLOCK_MONOTONIC, &now);
+        if (rt_TimespecDiff(&now, &release) > RT_POSIX_BASE_PERIOD) {
+            boolean_T stop;
+            (void)pthread_mutex_lock(&flagsMutex);
+            stop = rt_Overrun(0);
+            (void)pthread_mutex_unlock(&flagsMutex);
+            if (stop) break;
+
+            /* Skip the releases that were missed */
+            release = now;
+        }
+    }
+
+    /* Release the subrates one last time so that they see rateQuit */
+    rateQuit = true;
+#if defined(MULTITASKING)
+    {
+        int_T i;
+        for (i = FIRST_TID+1; i < NUMST; i++) {
+            (void)sem_post(&rateInfo[i].release);
+        }
+    }
+#endif
+    return(NULL);
+
+} /* end rt_BaseRateThread */
+
+/* Function: rt_StartRateThread ===============================================
+ *
+ * Abstract:
+ *   Start the thread of rate tid with the SCHED_FIFO priority prio, pinned
+ *   to rateCPU.  When the process may not use real-time scheduling the
+ *   thread is started at normal priority.  Returns 0 on success.  With
+ *   MULTITASKING, a thread that cannot be pinned is an error.
+ */
+static int_T rt_StartRateThread(int_T tid, int_T prio, void *(*fcn)(void *))
+{
+    RateInfo           *ri = &rateInfo[tid];
+    pthread_attr_t     attr;
+    struct sched_param param;
+    int                status;
+
+    (void)pthread_attr_init(&attr);
+    if (realTime) {
+        int minPrio = sched_get_priority_min(SCHED_FIFO);
+        param.sched_priority = (prio < minPrio) ? minPrio : prio;
+        (void)pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        (void)pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        (void)pthread_attr_setschedparam(&attr, &param);
+    }
+    status = pthread_create(&ri->thread, &attr, fcn, (void *)(size_t)tid);
+    if (status == EPERM && realTime) {
+        (void)printf("warning: no permission for real-time scheduling; "
+                     "the rates run at normal priority\n");
+        realTime = false;
+        (void)pthread_attr_destroy(&attr);
+        (void)pthread_attr_init(&attr);
+        status = pthread_create(&ri->thread, &attr, fcn, (void *)(size_t)tid);
+    }
+    (void)pthread_attr_destroy(&attr);
+    if (status != 0) return(1);
+    ri->started = true;
+
+    if (rateCPU >= 0) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(rateCPU, &cpus);
+        if (pthread_setaffinity_np(ri->thread, sizeof(cpus), &cpus) != 0) {
+            (void)printf("%s: could not pin sample time index %d to "
+                         "CPU %d\n", (NUMRATES > 1) ? "error" : "warning",
+                         (int)tid, (int)rateCPU);
+            if (NUMRATES > 1) return(1);
+        }
+    }
+    return(0);
+
+} /* end rt_StartRateThread */
+
+/* Function: rt_RunRateThreads ================================================
+ *
+ * Abstract:
+ *   Run the model in the rate threads until it stops.  The subrates are
+ *   started first, so that they wait for the base rate.
+ */
+static void rt_RunRateThreads(void)
+{
+    pthread_mutexattr_t mattr;
+    int_T               i;
+
+    (void)pthread_mutexattr_init(&mattr);
+    (void)pthread_mutexattr_setprotocol(&mattr, PTHREAD_PRIO_INHERIT);
+    (void)pthread_mutex_init(&flagsMutex, &mattr);
+    (void)pthread_mutexattr_destroy(&mattr);
+
+#if defined(MULTITASKING)
+    /* The rates must share one CPU, see the abstract at the top */
+    if (rateCPU < 0) {
+        cpu_set_t cpus;
+        if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0) {
+            for (rateCPU = 0; rateCPU < CPU_SETSIZE; rateCPU++) {
+                if (CPU_ISSET(rateCPU, &cpus)) break;
+            }
+        }
+        if (rateCPU < 0 || rateCPU >= CPU_SETSIZE) rateCPU = 0;
+    }
+#endif
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        (void)printf("warning: could not lock memory (%s)\n",
+                     strerror(errno));
+    }
+
+#if defined(MULTITASKING)
+    for (i = FIRST_TID+1; i < NUMST; i++) {
+        (void)sem_init(&rateInfo[i].release, 0, 0);
+        if (rt_StartRateThread(i, RT_POSIX_PRIORITY-(i-FIRST_TID),
+                               rt_SubrateThread)) {
+            rtmSetErrorStatus(RT_MDL, "Could not start the rate threads");
+            break;
+        }
+    }
+#endif
+
+    if (rtmGetErrorStatus(RT_MDL) == NULL &&
+        rt_StartRateThread(0, RT_POSIX_PRIORITY, rt_BaseRateThread)) {
+        rtmSetErrorStatus(RT_MDL, "Could not start the rate threads");
+    }
+
+    if (rateInfo[0].started) {
+        (void)pthread_join(rateInfo[0].thread, NULL);
+    }
+
+    rateQuit = true;
+    for (i = 1; i < NUMRATES; i++) {
+        if (rateInfo[i].started) {
+            (void)sem_post(&rateInfo[i].release);
+            (void)pthread_join(rateInfo[i].thread, NULL);
+        }
+    }
+#if defined(MULTITASKING)
+    for (i = FIRST_TID+1; i < NUMST; i++) {
+        (void)sem_destroy(&rateInfo[i].release);
+    }
+#endif
+
+    (void)munlockall();
+    (void)pthread_mutex_destroy(&flagsMutex);
+
+} /* end rt_RunRateThreads */
+
+/* Function: rt_PrintRateStatistics ===========================================
+ *
+ * Abstract:
+ *   Print the releases, overruns and jitter histogram of each rate.
+ */
+static void rt_PrintRateStatistics(void)
+{
+    int_T i, k;
+
+    for (i = 0; i < NUMRATES; i++) {
+        const RateInfo *ri = &rateInfo[i];
+
+        if (i > 0 && i <= FIRST_TID) continue;
+
+        (void)printf("sample time index %d: %lu releases, %lu overruns, "
+                     "max jitter %.1f us\n", (int)i, ri->nReleases,
+                     ri->nOverruns, ri->maxJitter*1e6);
+        for (k = 0; k < RT_POSIX_HIST_BINS; k++) {
+            if (ri->hist[k] == 0) continue;
+            if (k == 0) {
+                (void)printf("    jitter < 1 us: %lu\n", ri->hist[k]);
+            } else if (k < RT_POSIX_HIST_BINS-1) {
+                (void)printf("    jitter < %lu us: %lu\n",
+                             1UL << k, ri->hist[k]);
+            } else {
+                (void)printf("    jitter >= %lu us: %lu\n",
+                             1UL << (k-1), ri->hist[k]);
+            }
+        }
+    }
+    fflush(stdout);
+
+} /* end rt_PrintRateStatistics */
+
+/* Function: rt_InitModel ====================================================
+ *
+ * Abstract:
+ *   Initialized the model and the overrun flags
+ *
+ */
+static void rt_InitModel(void)
+{
+    int i;
+    for(i=0; i < NUMRATES; i++) {
+        OverrunFlags[i] = 0;
+        eventFlags[i] = 0;
+    }
+
+    /************************
+     * Initialize the model *
+     ************************/
+    MODEL_INITIALIZE();
+}
+
+/* Function: rt_TermModel ====================================================
+ *
+ * Abstract:
+ *   Terminates the model and prints the error status
+ *
+ */
+static int_T rt_TermModel(void)
+{
+    MODEL_TERMINATE();
+
+    {
+        const char_T *errStatus = (const char_T *) (rtmGetErrorStatus(RT_MDL));
+        int_T i = 0;
+
+        if (errStatus != NULL && strcmp(errStatus, "Simulation finished")) {
+            (void)printf("%s\n", errStatus);
+#if defined(MULTITASKING)
+            for (i = 0; i < NUMST; i++) {
+                if (OverrunFlags[i]) {
+                    (void)printf("ISR overrun - sampling rate too"
+                                 "fast for sample time index %d.\n", i);
+                }
+            }
+#else
+           if (OverrunFlags[i]) {
+               (void)printf("ISR overrun - base sampling rate too fast.\n");
+           }
+#endif
+            return(1);
+        }
+    }
+
+    return(0);
+}
+
+/* Function: main =============================================================
+ *
+ * Abstract:
+ *   Execute model in real time on Linux.
+ */
+int_T main(int_T argc, const char *argv[])
+{
+    /* External mode */
+    rtParseArgsForExtMode(argc, argv);
+
+    /*******************************************
+     * warn if the model will run indefinitely *
+     *******************************************/
+#if MAT_FILE==0 && EXT_MODE==0
+    printf("warning: the simulation will run with no stop time; "
+           "to change this behavior select the 'MAT-file logging' option\n");
+    fflush(NULL);
+#endif
+
+    (void)printf("\n** starting the model **\n");
+
+    /************************
+     * Initialize the model *
+     ************************/
+    rt_InitModel();
+
+    /* External mode */
+    rtSetTFinalForExtMode(&rtmGetTFinal(RT_MDL));
+    rtExtModeCheckInit(NUMST);
+    rtExtModeWaitForStartPkt(rtmGetRTWExtModeInfo(RT_MDL),
+                             NUMST,
+                             (boolean_T *)&rtmGetStopRequested(RT_MDL));
+#if defined(MULTITASKING)
+    /* From now on parameters are installed by rt_OneStep, not external mode */
+    rtExtModeCommitParams();
+#endif
+
+    /*******************************************************************
+     * Execute (step) the model in the rate threads.  Note that the    *
+     * generated code sets error status to "Simulation finished" when  *
+     * MatFileLogging is specified in TLC.                             *
+     *******************************************************************/
+    rt_RunRateThreads();
+
+    /*******************************
+     * Cleanup and exit (optional) *
+     *******************************/
+
+#ifdef UseMMIDataLogging
+    rt_CleanUpForStateLogWithMMI(rtmGetRTWLogInfo(RT_MDL));
+#endif
+    rt_StopDataLogging(MATFILE,rtmGetRTWLogInfo(RT_MDL));
+
+    rtExtModeShutdown(NUMST);
+
+    rt_PrintRateStatistics();
+
+    return rt_TermModel();
+}
+
+/* [EOF] rt_posix_main.c */
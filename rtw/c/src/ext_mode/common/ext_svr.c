@@ -103,6 +103,22 @@ PRIVATE ExtUserData *extUD          = NULL;
 PRIVATE int_T pktBufSize = 0;
 PRIVATE char  *pktBuf    = NULL;
 
+/*
+ * Packets with at most this many data bytes are sent to the host together
+ * with their header in one call to the transport (see SendPktToHost).
+ */
+#define SMALL_PKT_DATA_SIZE (64)
+
+/*
+ * With EXTMODE_ZERO_COPY_UPLOAD the upload buffers are allocated by the
+ * transport and their contents are sent by reference instead of copied.
+ */
+#ifdef EXTMODE_ZERO_COPY_UPLOAD
+#define SEND_UPLOAD_DATA_TO_HOST SendPktDataRefToHost
+#else
+#define SEND_UPLOAD_DATA_TO_HOST SendPktDataToHost
+#endif
+
 
 #ifndef EXTMODE_DISABLESIGNALMONITORING
 #ifndef EXTMODE_DISABLEPRINTF 
@@ -268,6 +284,11 @@ EXIT_POINT:
 #ifndef EXTMODE_DISABLESIGNALMONITORING
 /* Forward declaration */
 void UploadServerWork(int32_T, int_T numSampTimes);
+#ifdef EXTMODE_ZERO_COPY_UPLOAD
+PRIVATE boolean_T ReleaseUploadBufs(int32_T   upInfoIdx,
+                                    boolean_T waitForHost,
+                                    boolean_T *released);
+#endif
 #endif
 
 /* Function: DisconnectFromHost ================================================
@@ -299,6 +320,10 @@ PRIVATE void DisconnectFromHost(int_T numSampTimes)
 #else
 #ifndef EXTMODE_DISABLESIGNALMONITORING
         if (host_upstatus_is_uploading) {
+#ifdef EXTMODE_ZERO_COPY_UPLOAD
+            boolean_T released;
+            (void)ReleaseUploadBufs(i, true, &released);
+#endif
             UploadServerWork(i, numSampTimes);
         }
 #endif
@@ -514,6 +539,95 @@ EXIT_POINT:
 } /* end SendPktDataToHost */
 
 
+/* Function: FlushPktsToHost ===================================================
+ * Abstract:
+ *  Ask the transport to send anything it has held back.  A transport that
+ *  coalesces small sends (e.g. rtiostream_tcpip with -send_coalesce_bytes)
+ *  treats a request to set 0 bytes as the point where the data must leave;
+ *  for the others it is a no-op.
+ */
+PRIVATE boolean_T FlushPktsToHost(void)
+{
+    int_T     nSet;
+    boolean_T error = EXT_NO_ERROR;
+
+    error = ExtSetHostPkt(extUD,0,NULL,&nSet);
+    if (error != EXT_NO_ERROR) {
+#ifndef EXTMODE_DISABLEPRINTF            
+        fprintf(stderr,"ExtSetHostPkt() failed.\n");
+#endif
+    }
+    return(error);
+} /* end FlushPktsToHost */
+
+
+#if !defined(EXTMODE_DISABLESIGNALMONITORING) && defined(EXTMODE_ZERO_COPY_UPLOAD)
+/* Function: SendPktDataRefToHost ==============================================
+ * Abstract:
+ *  Send packet data out of an upload buffer by reference: the transport
+ *  reads it from the buffer when the host asks for it, so the buffer space
+ *  must not be reused until ReleaseUploadBufs says so.
+ */
+PRIVATE boolean_T SendPktDataRefToHost(const char *data, const int size)
+{
+    int_T     nSet;
+    boolean_T error = EXT_NO_ERROR;
+
+    error = ExtSetHostPktRef(extUD,size,data,&nSet);
+    if (error || (nSet != size)) {
+        error = EXT_ERROR;
+#ifndef EXTMODE_DISABLEPRINTF            
+        fprintf(stderr,"ExtSetHostPktRef() failed.\n");
+#endif
+    }
+    return(error);
+} /* end SendPktDataRefToHost */
+
+
+/* Function: ReleaseUploadBufs =================================================
+ * Abstract:
+ *  Give the upload buffer space sent by reference in the last call to
+ *  UploadServerWork back to the model, once the host has read it.
+ *  'released' is false while the host has not.  With 'waitForHost', block
+ *  until it has.
+ */
+PRIVATE boolean_T ReleaseUploadBufs(int32_T   upInfoIdx,
+                                    boolean_T waitForHost,
+                                    boolean_T *released)
+{
+    boolean_T error = ExtHostPktRefsDone(extUD, waitForHost, released);
+
+    if ((error == EXT_NO_ERROR) && *released) {
+        UploadBufAllDataSent(upInfoIdx);
+    }
+    return(error);
+} /* end ReleaseUploadBufs */
+#endif
+
+
+#ifdef EXTMODE_ZERO_COPY_UPLOAD
+/* Function: AllocUploadBuf ====================================================
+ * Abstract:
+ *  Allocate an upload buffer (called by updown.c).  The buffer comes from
+ *  the transport so that its contents can be sent without being copied.
+ */
+PUBLIC char_T *AllocUploadBuf(const int_T size)
+{
+    return(ExtAllocUploadBuf(extUD, size));
+} /* end AllocUploadBuf */
+
+
+/* Function: FreeUploadBuf =====================================================
+ * Abstract:
+ *  Free a buffer from AllocUploadBuf.
+ */
+PUBLIC void FreeUploadBuf(char_T *buf)
+{
+    ExtFreeUploadBuf(extUD, buf);
+} /* end FreeUploadBuf */
+#endif
+
+
 /* Function: SendPktToHost =====================================================
  * Abstract:
  *  Send a packet to the host.  Packets can be of two forms:
@@ -521,6 +635,9 @@ EXIT_POINT:
  *          the type is used as a flag to notify Simulink of an event
  *          that has taken place on the target (event == action == type)
  *      o pkt header, followed by data
+ *
+ *  The header and up to SMALL_PKT_DATA_SIZE bytes of data are sent in one
+ *  call to the transport.
  */
 PUBLIC boolean_T SendPktToHost(
     const ExtModeAction action,
@@ -533,6 +650,19 @@ PUBLIC boolean_T SendPktToHost(
     semTake(pktSem, WAIT_FOREVER);
 #endif
 
+    if ((data != NULL) && (size > 0) && (size <= SMALL_PKT_DATA_SIZE)) {
+        PktHeader pktHdr;
+        char_T    pkt[sizeof(PktHeader) + SMALL_PKT_DATA_SIZE];
+
+        pktHdr.type = (uint32_T)action;
+        pktHdr.size = size;
+        (void)memcpy(pkt, &pktHdr, sizeof(PktHeader));
+        (void)memcpy(pkt + sizeof(PktHeader), data, (size_t)size);
+
+        error = SendPktDataToHost(pkt, (int)sizeof(PktHeader) + size);
+        goto EXIT_POINT;
+    }
+
     error = SendPktHdrToHost(action,size);
     if (error != EXT_NO_ERROR) goto EXIT_POINT;
 
@@ -582,7 +712,7 @@ PRIVATE boolean_T ProcessSetParamPkt(RTWExtModeInfo *ei,
     boolean_T  error = EXT_NO_ERROR;
 
     /*
-     * Receive packet and set parameters.
+     * Receive packet and stage the parameters.
      */
     pkt = GetPkt(pktSize);
     if (pkt == NULL) {
@@ -591,9 +721,23 @@ PRIVATE boolean_T ProcessSetParamPkt(RTWExtModeInfo *ei,
         error = EXT_ERROR; 
         goto EXIT_POINT;
     }
-    SetParam(ei, pkt);
 
-    msg = (int32_T)STATUS_OK;
+    if (SetParam(ei, pkt, pktSize) != EXT_NO_ERROR) {
+        /*
+         * Malformed packet or no room to stage it.  Nothing was installed;
+         * NOT_ENOUGH_MEMORY is the only failure status the host knows.
+         */
+        msg = (int32_T)NOT_ENOUGH_MEMORY;
+    } else {
+        /*
+         * The staged values are normally installed by the model at its next
+         * step boundary.  If the model is not stepping, install them now.
+         */
+        if (modelStatus != TARGET_STATUS_RUNNING) {
+            SetParamCommit();
+        }
+        msg = (int32_T)STATUS_OK;
+    }
     error = SendPktToHost(EXT_SETPARAM_RESPONSE,sizeof(int32_T),(char_T *)&msg);
     if (error != EXT_NO_ERROR) goto EXIT_POINT;
 
@@ -874,6 +1018,7 @@ void UploadServerWork(int32_T upInfoIdx, int_T numSampTimes)
     int_T         i;
     ExtBufMemList upList;
     boolean_T     error = EXT_NO_ERROR;
+    boolean_T     sentData = false;
 
 #ifdef VXWORKS
     /*
@@ -887,6 +1032,20 @@ taskSafe();
 #endif
 
     if (!connected) goto EXIT_POINT;
+
+#ifdef EXTMODE_ZERO_COPY_UPLOAD
+    /*
+     * The data of the last call went out by reference and its space can
+     * only be reused once the host has read it.  Until then there is
+     * nothing new to send either: it is queued behind that data.
+     */
+    {
+        boolean_T released;
+
+        error = ReleaseUploadBufs(upInfoIdx, false, &released);
+        if ((error != EXT_NO_ERROR) || !released) goto EXIT_POINT;
+    }
+#endif
     
     UploadBufGetData(&upList, upInfoIdx, numSampTimes);
     while(upList.nActiveBufs > 0) {
@@ -899,7 +1058,7 @@ taskSafe();
              * to avoid the overhead of making two calls for each upload
              * packet - one for the head and one for the payload.
              */
-            error = SendPktDataToHost(
+            error = SEND_UPLOAD_DATA_TO_HOST(
                 bufMem->section1,
                 bufMem->nBytes1);
             if (error != EXT_NO_ERROR) {
@@ -911,7 +1070,7 @@ taskSafe();
             
             if (bufMem->nBytes2 > 0) {
 
-                error = SendPktDataToHost(
+                error = SEND_UPLOAD_DATA_TO_HOST(
                     bufMem->section2,
                     bufMem->nBytes2);
                 if (error != EXT_NO_ERROR) {
@@ -921,10 +1080,23 @@ taskSafe();
                     goto EXIT_POINT;
                 }
             }
+#ifndef EXTMODE_ZERO_COPY_UPLOAD
             /* confirm that the data was sent */
             UploadBufDataSent(upList.tids[i], upInfoIdx);
+#endif
+            sentData = true;
         }
+#ifdef EXTMODE_ZERO_COPY_UPLOAD
+        /* confirmed by ReleaseUploadBufs once the host has read it */
+        break;
+#else
         UploadBufGetData(&upList, upInfoIdx, numSampTimes);
+#endif
+    }
+
+    /* all packets of this step are queued: let them go */
+    if (sentData) {
+        error = FlushPktsToHost();
     }
     
 EXIT_POINT:
@@ -1261,6 +1433,12 @@ PUBLIC void rt_PktServerWork(RTWExtModeInfo *ei,
         break;
     } /* end switch */
 
+    /* send the responses to the packet */
+    error = FlushPktsToHost();
+    if (error != EXT_NO_ERROR) {
+        disconnectOnError = true;
+    }
+
 EXIT_POINT:
     if (error != EXT_NO_ERROR) {
         if (disconnectOnError) {
@@ -1343,6 +1521,12 @@ PRIVATE void ExtModeShutdown(int32_T upInfoIdx, int_T numSampTimes)
      */
     UploadPrepareForFinalFlush(upInfoIdx);
 #ifndef EXTMODE_DISABLESIGNALMONITORING
+#ifdef EXTMODE_ZERO_COPY_UPLOAD
+    if (connected) {
+        boolean_T released;
+        (void)ReleaseUploadBufs(upInfoIdx, true, &released);
+    }
+#endif
     UploadServerWork(upInfoIdx, numSampTimes);
 #endif
 
@@ -1369,6 +1553,10 @@ PUBLIC boolean_T rt_ExtModeShutdown(int_T numSampTimes)
         ExtModeShutdown(i, numSampTimes);
     }
 
+#ifndef EXTMODE_DISABLEPARAMETERTUNING
+    SetParamTerm();
+#endif
+
     if (commInitialized) {
         error = SendPktToHost(EXT_MODEL_SHUTDOWN, 0, NULL);
         if (error != EXT_NO_ERROR) {
@@ -1392,6 +1580,18 @@ PUBLIC boolean_T rt_ExtModeShutdown(int_T numSampTimes)
     return(error);
 } /* end rt_ExtModeShutdown */
 
+#ifndef EXTMODE_DISABLEPARAMETERTUNING
+/* Function: rt_SetParamCommit =================================================
+ * Abstract:
+ *  Install parameters staged by EXT_SETPARAM packets.  Called by the model
+ *  task at a step boundary.
+ */
+PUBLIC void rt_SetParamCommit(void)
+{
+    SetParamCommit();
+} /* end rt_SetParamCommit */
+#endif /* ifndef EXTMODE_DISABLEPARAMETERTUNING */
+
 #ifndef EXTMODE_DISABLESIGNALMONITORING
 /* Function: rt_UploadCheckTrigger =============================================
  * Abstract:
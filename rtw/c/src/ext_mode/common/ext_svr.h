@@ -25,6 +25,12 @@ extern boolean_T SendPktToHost(const ExtModeAction action,
 
 extern boolean_T rt_ExtModeInit(void);
 
+#ifdef EXTMODE_ZERO_COPY_UPLOAD
+extern char_T    *AllocUploadBuf(const int_T size);
+
+extern void      FreeUploadBuf(char_T *buf);
+#endif
+
 extern void      rt_PktServerWork(RTWExtModeInfo *ei,
                                   int_T          numSampTimes,
                                   boolean_T      *stopReq);
@@ -40,6 +46,8 @@ extern void      rt_UploadCheckEndTrigger(void);
 extern void      rt_UploadBufAddTimePoint(int_T tid,
                                           real_T taskTime);
 
+extern void      rt_SetParamCommit(void);
+
 #ifndef VXWORKS
 extern void      rt_ExtModeSleep(long sec,   /* number of seconds to wait      */
                                  long usec); /* number of micro seconds to wait*/
@@ -72,3 +72,34 @@ extern void ExtModeSleep(
 
 extern void ExtForceDisconnect(ExtUserData *UD);
 
+/*
+ * Optional: only needed by transports built with EXTMODE_ZERO_COPY_UPLOAD.
+ * The upload buffers are allocated by the transport, and upload data is
+ * passed to it by reference: the transport may read it after
+ * ExtSetHostPktRef returns, until ExtHostPktRefsDone reports that the host
+ * has it.  rtiostream_interface.c provides them for every rtIOStream
+ * driver; only rtiostream_shm actually avoids the copy, the others send by
+ * copy from heap buffers.  The serial and custom transport templates do
+ * not provide them.
+ */
+#ifdef EXTMODE_ZERO_COPY_UPLOAD
+extern char *ExtAllocUploadBuf(
+    const ExtUserData *UD,
+    const int         nBytes);
+
+extern void ExtFreeUploadBuf(
+    const ExtUserData *UD,
+    char              *buf);
+
+extern boolean_T ExtSetHostPktRef(
+    const ExtUserData *UD,
+    const int         nBytesToSet,
+    const char        *src,
+    int               *nBytesSet);
+
+extern boolean_T ExtHostPktRefsDone(
+    const ExtUserData *UD,
+    const boolean_T   waitForHost,
+    boolean_T         *done);
+#endif
+
@@ -37,6 +37,11 @@
 int_T           volatile startModel  = false;
 TargetSimStatus volatile modelStatus = TARGET_STATUS_WAITING_TO_START;
 
+#ifndef EXTMODE_DISABLEPARAMETERTUNING
+/* the main installs staged parameters itself (rtExtModeCommitParams) */
+static boolean_T mainCommitsParams = false;
+#endif
+
 #ifdef VXWORKS
 SEM_ID volatile uploadSem = NULL;
 SEM_ID volatile commSem   = NULL;
@@ -181,6 +186,32 @@ void rtExtModeOneStep(RTWExtModeInfo *ei,
         rt_UploadServerWork(numSampTimes);
 #endif
     }
+
+#ifndef EXTMODE_DISABLEPARAMETERTUNING
+    /*
+     * We are between steps of the base rate, so install any parameters
+     * staged by the packet server.  Subrates running in their own tasks may
+     * be mid-step here; a main that runs them that way installs the
+     * parameters with rtExtModeCommitParams instead.
+     */
+    if (!mainCommitsParams) {
+        rt_SetParamCommit();
+    }
+#endif
+}
+
+/* Function: rtExtModeCommitParams ============================================
+ * Abstract:
+ *  Install the parameters staged by the packet server.  For mains that run
+ *  the rates in separate tasks: call it when no task is mid-step.  Once it
+ *  has been called, rtExtModeOneStep no longer installs them.
+ */
+void rtExtModeCommitParams(void)
+{
+#ifndef EXTMODE_DISABLEPARAMETERTUNING
+    mainCommitsParams = true;
+    rt_SetParamCommit();
+#endif
 }
 
 void rtExtModeUpload(int_T tid, real_T taskTime)
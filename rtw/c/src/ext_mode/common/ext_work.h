@@ -63,6 +63,8 @@ extern void rtExtModeOneStep(RTWExtModeInfo *ei,
                              int_T          numSampTimes,
                              boolean_T      *stopReqPtr);
 
+extern void rtExtModeCommitParams(void);
+
 extern void rtExtModeCheckEndTrigger(void);
 
 extern void rtExtModeUploadCheckTrigger(int_T numSampTimes);
@@ -106,6 +108,7 @@ extern void rtERTExtModeStartMsg(void);
 #endif /* #ifdef VXWORKS */
 
 #define rtExtModeOneStep(ei,st,sr) /* do nothing */
+#define rtExtModeCommitParams() /* do nothing */
 #define rtExtModeCheckEndTrigger() /* do nothing */
 #define rtExtModeUploadCheckTrigger(numSampTimes) /* do nothing */
 #define rtExtModeUpload(t,ttime) /* do nothing */
@@ -185,6 +185,8 @@ PUBLIC boolean_T ExtInit(ExtUserData *UD)
  *
  * NOTES:
  *  o it is always o.k. for this function to block if no room is available
+ *  o setting 0 bytes passes a 0 byte send to the rtIOStream driver, which
+ *    drivers that coalesce sends take as a request to send what they hold
  */
 PUBLIC boolean_T ExtSetHostPkt(
     const ExtUserData *UD,
@@ -200,10 +202,15 @@ PUBLIC boolean_T ExtSetHostPkt(
         semTake(commSem, WAIT_FOREVER);
     #endif
 
-    /* Blocks until all requested outgoing data is sent */
-    rtIOStreamErrorStatus = rtIOStreamBlockingSend(UD->streamID,
-                                                   (const void * const) src,
-                                                   (uint32_T) nBytesToSet);
+    if (nBytesToSet == 0) {
+        size_t sizeSent;
+        rtIOStreamErrorStatus = rtIOStreamSend(UD->streamID, src, 0, &sizeSent);
+    } else {
+        /* Blocks until all requested outgoing data is sent */
+        rtIOStreamErrorStatus = rtIOStreamBlockingSend(UD->streamID,
+                                                       (const void * const) src,
+                                                       (uint32_T) nBytesToSet);
+    }
     
     if (rtIOStreamErrorStatus == RTIOSTREAM_ERROR) {
         errorCode = EXT_ERROR;
@@ -219,6 +226,108 @@ PUBLIC boolean_T ExtSetHostPkt(
 
 } /* end ExtSetHostPkt */
 
+#ifdef EXTMODE_ZERO_COPY_UPLOAD
+/* Function: ExtAllocUploadBuf =================================================
+ * Abstract:
+ *  Allocate an upload buffer out of memory that the rtIOStream driver can
+ *  send without copying (e.g. the region of rtiostream_shm started with
+ *  -send_region_bytes).  If the driver has none left, fall back to the heap;
+ *  such a buffer is simply sent by copy.
+ */
+PUBLIC char *ExtAllocUploadBuf(
+    const ExtUserData *UD,
+    const int         nBytes)
+{
+    char *buf = (char *)rtIOStreamRegionAlloc(UD->streamID, (size_t)nBytes);
+
+    if (buf == NULL) {
+        buf = (char *)malloc(nBytes);
+    }
+    return(buf);
+} /* end ExtAllocUploadBuf */
+
+
+/* Function: ExtFreeUploadBuf ==================================================
+ * Abstract:
+ *  Free a buffer from ExtAllocUploadBuf.
+ */
+PUBLIC void ExtFreeUploadBuf(
+    const ExtUserData *UD,
+    char              *buf)
+{
+    if ((buf != NULL) &&
+        (rtIOStreamRegionFree(UD->streamID, buf) == RTIOSTREAM_ERROR)) {
+        free(buf);
+    }
+} /* end ExtFreeUploadBuf */
+
+
+/* Function: ExtSetHostPktRef ==================================================
+ * Abstract:
+ *  As ExtSetHostPkt, for data in a buffer from ExtAllocUploadBuf.  The data
+ *  must not change until ExtHostPktRefsDone reports that the host has it.
+ */
+PUBLIC boolean_T ExtSetHostPktRef(
+    const ExtUserData *UD,
+    const int         nBytesToSet,
+    const char        *src,
+    int               *nBytesSet)
+{
+    boolean_T errorCode = EXT_NO_ERROR;
+    size_t    sizeSent;
+
+    *nBytesSet = 0; /* assume */
+
+    #ifdef VXWORKS
+        semTake(commSem, WAIT_FOREVER);
+    #endif
+
+    if (rtIOStreamSendRef(UD->streamID, src, (size_t)nBytesToSet,
+                          &sizeSent) == RTIOSTREAM_ERROR) {
+        errorCode = EXT_ERROR;
+    } else if ((sizeSent < (size_t)nBytesToSet) &&
+               (rtIOStreamBlockingSend(UD->streamID,
+                                       (const void * const) (src + sizeSent),
+                                       (uint32_T) (nBytesToSet - (int)sizeSent))
+                == RTIOSTREAM_ERROR)) {
+        /* the driver sent (part of) it by copy; send the rest the same way */
+        errorCode = EXT_ERROR;
+    } else {
+        *nBytesSet = nBytesToSet;
+    }
+
+    #ifdef VXWORKS
+        semGive(commSem);
+    #endif
+
+    return errorCode;
+} /* end ExtSetHostPktRef */
+
+
+/* Function: ExtHostPktRefsDone ================================================
+ * Abstract:
+ *  Set 'done' once the host has received all data sent with
+ *  ExtSetHostPktRef.  With 'waitForHost', block until it has.
+ */
+PUBLIC boolean_T ExtHostPktRefsDone(
+    const ExtUserData *UD,
+    const boolean_T   waitForHost,
+    boolean_T         *done)
+{
+    boolean_T errorCode = EXT_NO_ERROR;
+    int       isDone;
+
+    if (rtIOStreamSendRefDone(UD->streamID, waitForHost ? -1 : 0,
+                              &isDone) == RTIOSTREAM_ERROR) {
+        errorCode = EXT_ERROR;
+    }
+    *done = (boolean_T)(isDone != 0);
+
+    return errorCode;
+} /* end ExtHostPktRefsDone */
+#endif /* EXTMODE_ZERO_COPY_UPLOAD */
+
+
 /* Function: ExtGetHostPkt =====================================================
  * Abstract:
  *  Attempts to get the specified number of bytes from the comm line.  The
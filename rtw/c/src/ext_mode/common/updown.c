@@ -3,6 +3,7 @@
  */
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 
 /*Real Time Workshop headers*/
 #include "rtwtypes.h"
@@ -127,8 +128,51 @@ PRIVATE double DType2Double(
 #endif
 
 
+#ifndef EXTMODE_DISABLEPARAMETERTUNING
+/*
+ * Parameter staging.
+ *
+ * SetParam does not write into the live parameter vector.  It decodes and
+ * validates the packet into one of two staging buffers and then publishes
+ * that buffer with a single index flip.  The model task installs the
+ * published buffer at a step boundary (SetParamCommit) so that a step
+ * never sees a partially updated parameter.  A staging buffer is a list of
+ * records, each of which looks like:
+ *
+ *   [DST NBYTES DATA]
+ *
+ *  where,
+ *      DST   : address in the parameter vector (char_T *)
+ *      NBYTES: number of bytes of DATA (int_T)
+ *      DATA  : the param values (in target format)
+ *
+ * Records are not aligned, so the header is always accessed with memcpy.
+ *
+ * If the packet server runs in its own task (e.g. VxWorks) the flip and the
+ * install must be protected with EXTMODE_PROTECT_CRITICAL_REGIONS, just like
+ * the upload circular buffers.  rtExtModeOneStep installs at step
+ * boundaries of the base rate only; a main that runs the subrates in their
+ * own tasks must call rtExtModeCommitParams when none of them is mid-step
+ * (rt_posix_main.c does), or a subrate can see a partial update.
+ */
+typedef struct ParamStageRec_tag {
+    char_T *dst;
+    int_T  nBytes;
+} ParamStageRec;
+
+typedef struct ParamStageBuf_tag {
+    char_T *buf;
+    int_T  bufSize;
+    int_T  nBytesUsed;
+} ParamStageBuf;
+
+PRIVATE ParamStageBuf      paramStage[2]     = {{NULL, 0, 0}, {NULL, 0, 0}};
+PRIVATE int_T     volatile paramStagePending = -1;
+
+
 /* Function: SetParam ==========================================================
- * Install new parameters.
+ * Stage new parameters.  Returns EXT_ERROR if the packet is malformed or the
+ * staging buffer could not be allocated, in which case nothing is staged.
  *
  * NOTE: pbuf looks like:
  *  [NPARAMS
@@ -152,100 +196,235 @@ PRIVATE double DType2Double(
  *  and,
  *      All values, excluding DATA, are int32_T.
  */
-#ifndef EXTMODE_DISABLEPARAMETERTUNING
-PUBLIC void SetParam(RTWExtModeInfo  *ei, const char *pbuf)
+PUBLIC boolean_T SetParam(RTWExtModeInfo  *ei,
+                          const char      *pbuf,
+                          const int       pktSize)
 {
-    int        i;
-    int32_T    nParams;
-    const char *bufPtr    = pbuf;
-    const int  B          = 0; /* index into dtype tran table (base address)  */
-    const int  SI         = 1; /* starting index - wrt to base address        */
-    const int  W          = 2; /* width of section (number of elements)       */
-    const int  DI         = 3; /* index into data type tables                 */
-    const int  tmpBufSize = sizeof(int32_T) * 4;
-    int32_T    tmpBuf[4];
+    int           i;
+    int           pass;
+    int32_T       nParams;
+    int_T         pending;
+    int_T         nBytesNeeded = 0;
+    ParamStageBuf *stage;
+    char_T        *stagePtr    = NULL;
+    const char    *bufPtr;
+    const char    *bufEnd      = pbuf + pktSize;
+    const int     B            = 0; /* index into dtype tran table (base address)  */
+    const int     SI           = 1; /* starting index - wrt to base address        */
+    const int     W            = 2; /* width of section (number of elements)       */
+    const int     DI           = 3; /* index into data type tables                 */
+    const int     tmpBufSize   = sizeof(int32_T) * 4;
+    int32_T       tmpBuf[4];
 
     const DataTypeTransInfo *dtInfo = rteiGetModelMappingInfo(ei);
     const DataTypeTransitionTable *dtTable = dtGetParamDataTypeTrans(dtInfo);
     const uint_T *dtSizes = dtGetDataTypeSizes(dtInfo);
 
+    if (pktSize < (int)sizeof(int32_T)) return(EXT_ERROR);
+
     /* unpack NPARAMS */
-    (void)memcpy(&nParams, bufPtr, sizeof(int32_T));
-    bufPtr += sizeof(int32_T);
-    
+    (void)memcpy(&nParams, pbuf, sizeof(int32_T));
+    if (nParams < 0 || (nParams > 0 && dtTable == NULL)) return(EXT_ERROR);
+
+    /*
+     * Stage into the buffer that is not currently published.  Only this
+     * function publishes a buffer, so the one that is not pending cannot
+     * be in use by SetParamCommit.  Anything still pending is carried over
+     * ahead of the new values so that it is not lost by the flip.
+     */
+    pending = paramStagePending;
+    stage   = &paramStage[(pending == 0) ? 1 : 0];
+    if (pending >= 0) {
+        nBytesNeeded = paramStage[pending].nBytesUsed;
+    }
+
 #ifdef VERBOSE
     printf("\nUpdating %d parameters....\n", nParams);
 #endif
 
     /*
-     * Unpack the data and install the new parameters.
+     * Pass 0 validates the packet and sizes the staging buffer; pass 1
+     * unpacks the data into it.
      */
-    for (i=0; i<nParams; i++) {
-        int_T   elSize;
-        int_T   nBytes;
-        char_T  *start;
-        char_T  *tranAddress;
-        int_T   tranIsComplex;
-
-        /* unpack B SI W DI */
-        (void)memcpy(tmpBuf, bufPtr, tmpBufSize);
-        bufPtr += tmpBufSize;
-
-        /* 
-         * Find starting address and size (nBytes) for this parameters 
-         * section of memory.
-         */
-        tranAddress   = dtTransGetAddress(dtTable, tmpBuf[B]);
-        tranIsComplex = dtTransGetComplexFlag(dtTable, tmpBuf[B]);
+    for (pass=0; pass<2; pass++) {
+        bufPtr = pbuf + sizeof(int32_T);
+
+        for (i=0; i<nParams; i++) {
+            ParamStageRec rec;
+            int_T         elSize;
+            int_T         tranIsComplex;
+            size_t        nElsAvail;
+
+            /* unpack B SI W DI */
+            if (bufEnd - bufPtr < tmpBufSize) return(EXT_ERROR);
+            (void)memcpy(tmpBuf, bufPtr, tmpBufSize);
+            bufPtr += tmpBufSize;
+
+            if (tmpBuf[B] < 0 ||
+                (uint_T)tmpBuf[B] >= dtGetNumTransitions(dtTable) ||
+                tmpBuf[DI] < 0 ||
+                (uint_T)tmpBuf[DI] >= dtGetNumDataTypes(dtInfo) ||
+                tmpBuf[SI] < 0 || tmpBuf[W] < 0) {
+                return(EXT_ERROR);
+            }
 
-        elSize = dtSizes[tmpBuf[DI]] * (tranIsComplex ? 2 : 1);
-        nBytes = tmpBuf[W] * elSize;
-        start = tranAddress + (tmpBuf[SI] * elSize);
+            /* 
+             * Find starting address and size (nBytes) for this parameters 
+             * section of memory.
+             */
+            tranIsComplex = dtTransGetComplexFlag(dtTable, tmpBuf[B]);
+            elSize        = dtSizes[tmpBuf[DI]] * (tranIsComplex ? 2 : 1);
 
-        /* Install the params. */
-        (void)memcpy(start, bufPtr, nBytes);
-        bufPtr += nBytes;
+            /*
+             * Bounds check in elements of this section, computed unsigned so
+             * that no SI/W pair can wrap around it (complexity accounted for
+             * in trans tbl num of els).
+             */
+            if (elSize <= 0) return(EXT_ERROR);
+            nElsAvail = ((size_t)dtTransNEls(dtTable, tmpBuf[B]) *
+                         dtSizes[dtTransGetDataType(dtTable, tmpBuf[B])]) /
+                        (size_t)elSize;
+            if ((size_t)tmpBuf[SI] > nElsAvail ||
+                (size_t)tmpBuf[W] > nElsAvail - (size_t)tmpBuf[SI] ||
+                (size_t)tmpBuf[W] > (size_t)(bufEnd - bufPtr) / (size_t)elSize) {
+                return(EXT_ERROR);
+            }
 
-#ifdef VERBOSE
-        /*
-         * It is safe to assume that once the params are installed into
-         * the param vector that they are properly aligned.  So we
-         * do our verbosity print-out here.
-         */
-        {
-            double     val;
-            const char *dTypeName;
-            const char *vPtr = (const char *)start;
-
-            val = DType2Double(start, tmpBuf[DI], dtInfo, &dTypeName);
-            printf("\n\tParam| "
-                   "DT_Trans: %d, index: %d, nEls: %d, data type: [%s, %d]\n",
-                   tmpBuf[B], tmpBuf[SI], tmpBuf[W],
-                   (dTypeName != NULL) ? dTypeName : "",tmpBuf[DI]);
-
-            if (!tranIsComplex) {
-                int j;
-                for (j=0; j<tmpBuf[W]; j++) {
-                    val = DType2Double(vPtr, tmpBuf[DI], dtInfo, &dTypeName);
-                    printf("\t\t%f\n", val);
-                    vPtr += dtSizes[tmpBuf[DI]];
+            rec.dst    = dtTransGetAddress(dtTable, tmpBuf[B]) +
+                         ((size_t)tmpBuf[SI] * (size_t)elSize);
+            rec.nBytes = tmpBuf[W] * elSize; /* <= bytes left in the packet */
+
+            if (pass == 0) {
+                if (rec.nBytes > INT_MAX - (int_T)sizeof(ParamStageRec) -
+                                 nBytesNeeded) {
+                    return(EXT_ERROR);
                 }
+                nBytesNeeded += (int_T)sizeof(ParamStageRec) + rec.nBytes;
             } else {
-                int j;
-                for (j=0; j<tmpBuf[W]; j++) {
-                    val = DType2Double(vPtr, tmpBuf[DI], dtInfo, &dTypeName);
-                    printf("\t\t%f + ", val);
-                    vPtr += dtSizes[tmpBuf[DI]];
-
-                    val = DType2Double(vPtr, tmpBuf[DI], dtInfo, &dTypeName);
-                    printf("\t\t%fi\n", val);
-                    vPtr += dtSizes[tmpBuf[DI]];
+                (void)memcpy(stagePtr, &rec, sizeof(ParamStageRec));
+                stagePtr += sizeof(ParamStageRec);
+                (void)memcpy(stagePtr, bufPtr, rec.nBytes);
+
+#ifdef VERBOSE
+                {
+                    int        j;
+                    int_T      dtSize = dtSizes[tmpBuf[DI]];
+                    int_T      nVals  = tmpBuf[W] * (tranIsComplex ? 2 : 1);
+                    const char *vPtr  = (const char *)stagePtr;
+                    const char *dTypeName =
+                        ((char * const *)dtGetDataTypeNames(dtInfo))[tmpBuf[DI]];
+                    real_T     aligned; /* aligned copy of one element */
+
+                    printf("\n\tParam| "
+                           "DT_Trans: %d, index: %d, nEls: %d, data type: [%s, %d]\n",
+                           tmpBuf[B], tmpBuf[SI], tmpBuf[W], dTypeName, tmpBuf[DI]);
+
+                    if (dtSize > (int_T)sizeof(real_T)) nVals = 0;
+                    for (j=0; j<nVals; j++) {
+                        double val;
+
+                        (void)memcpy(&aligned, vPtr, dtSize);
+                        val = DType2Double((const char *)&aligned, tmpBuf[DI],
+                                           dtInfo, &dTypeName);
+                        if (!tranIsComplex) {
+                            printf("\t\t%f\n", val);
+                        } else if (!(j & 1)) {
+                            printf("\t\t%f + ", val);
+                        } else {
+                            printf("\t\t%fi\n", val);
+                        }
+                        vPtr += dtSize;
+                    }
                 }
+#endif
+                stagePtr += rec.nBytes;
+            }
+            bufPtr += rec.nBytes;
+        }
+
+        if (pass == 0) {
+            /* Grow the staging buffer if needed. */
+            if (nBytesNeeded > stage->bufSize) {
+                char_T *newBuf = (char_T *)malloc(nBytesNeeded);
+                if (newBuf == NULL) return(EXT_ERROR);
+                free(stage->buf);
+                stage->buf     = newBuf;
+                stage->bufSize = nBytesNeeded;
+            }
+            stagePtr = stage->buf;
+            if (pending >= 0) {
+                (void)memcpy(stagePtr, paramStage[pending].buf,
+                             paramStage[pending].nBytesUsed);
+                stagePtr += paramStage[pending].nBytesUsed;
             }
         }
-#endif
     }
+    stage->nBytesUsed = nBytesNeeded;
+
+    /*
+     * Publish.  If SetParamCommit installed the old pending buffer while we
+     * were staging, the carried over records simply write the same values
+     * again.
+     */
+#ifdef EXTMODE_PROTECT_CRITICAL_REGIONS
+    EXTMODE_DISABLE_INTERRUPTS;
+#endif
+    paramStagePending = (int_T)(stage - paramStage);
+#ifdef EXTMODE_PROTECT_CRITICAL_REGIONS
+    EXTMODE_ENABLE_INTERRUPTS;
+#endif
+
+    return(EXT_NO_ERROR);
 } /* end SetParam */
+
+
+/* Function: SetParamCommit ====================================================
+ * Install the staged parameters, if any.  Must be called from the model task
+ * at a step boundary.  The cost is a copy of the changed bytes only.
+ */
+PUBLIC void SetParamCommit(void)
+{
+    if (paramStagePending < 0) return;
+
+#ifdef EXTMODE_PROTECT_CRITICAL_REGIONS
+    EXTMODE_DISABLE_INTERRUPTS;
+#endif
+    if (paramStagePending >= 0) {
+        const ParamStageBuf *stage  = &paramStage[paramStagePending];
+        const char_T        *recPtr = stage->buf;
+        const char_T        *recEnd = stage->buf + stage->nBytesUsed;
+
+        while (recPtr < recEnd) {
+            ParamStageRec rec;
+
+            (void)memcpy(&rec, recPtr, sizeof(ParamStageRec));
+            recPtr += sizeof(ParamStageRec);
+            (void)memcpy(rec.dst, recPtr, rec.nBytes);
+            recPtr += rec.nBytes;
+        }
+        paramStagePending = -1;
+    }
+#ifdef EXTMODE_PROTECT_CRITICAL_REGIONS
+    EXTMODE_ENABLE_INTERRUPTS;
+#endif
+} /* end SetParamCommit */
+
+
+/* Function: SetParamTerm ======================================================
+ * Install anything still staged and free the staging buffers.
+ */
+PUBLIC void SetParamTerm(void)
+{
+    int i;
+
+    SetParamCommit();
+    for (i=0; i<2; i++) {
+        free(paramStage[i].buf);
+        paramStage[i].buf        = NULL;
+        paramStage[i].bufSize    = 0;
+        paramStage[i].nBytesUsed = 0;
+    }
+} /* end SetParamTerm */
 #endif /* ifndef EXTMODE_DISABLEPARAMETERTUNING */
 
 
@@ -828,7 +1007,12 @@ PRIVATE boolean_T UploadBufInit(CircularBuf *circBuf, int_T size)
     circBuf->empty = true;
     if (size > 0) {
         assert(circBuf->buf == NULL);
+#ifdef EXTMODE_ZERO_COPY_UPLOAD
+        /* memory the transport can send without copying */
+        circBuf->buf = AllocUploadBuf(size);
+#else
         circBuf->buf = (char_T *)malloc(size);
+#endif
         if (circBuf->buf == NULL) {
             error = EXT_ERROR; goto EXIT_POINT;
         }
@@ -920,8 +1104,9 @@ PUBLIC void UploadLogInfoReset(int32_T upInfoIdx)
 
     uploadInfo->circBufs = NULL;
 
-    uploadInfo->bufMemList.bufs = NULL;
-    uploadInfo->bufMemList.tids = NULL;
+    uploadInfo->bufMemList.nActiveBufs = 0;
+    uploadInfo->bufMemList.bufs        = NULL;
+    uploadInfo->bufMemList.tids        = NULL;
 
     /* Reset trigger info */
     UploadDestroyTrigger(upInfoIdx);
@@ -965,7 +1150,11 @@ PUBLIC void UploadLogInfoTerm(int32_T upInfoIdx, int_T numSampTimes)
     /* Free circular buf fields and bufMemLists. */
     if (uploadInfo->circBufs) {
         for (i=0; i<numSampTimes; i++) {
+#ifdef EXTMODE_ZERO_COPY_UPLOAD
+            FreeUploadBuf(uploadInfo->circBufs[i].buf);
+#else
             free(uploadInfo->circBufs[i].buf);
+#endif
         }
         free(uploadInfo->circBufs);
     }
@@ -1387,6 +1576,26 @@ PUBLIC void UploadBufDataSent(const int_T tid, int32_T upInfoIdx)
 } /* end UploadBufDataSent */
 #endif /* ifndef EXTMODE_DISABLESIGNALMONITORING */
 
+
+/* Function ====================================================================
+ * Called by ext_svr once the data returned by the last UploadBufGetData call
+ * has reached the host, when it was sent by reference to the upload buffers
+ * (EXTMODE_ZERO_COPY_UPLOAD) rather than copied by the transport.  Does the
+ * UploadBufDataSent calls that were put off until then.
+ */
+#if !defined(EXTMODE_DISABLESIGNALMONITORING) && defined(EXTMODE_ZERO_COPY_UPLOAD)
+PUBLIC void UploadBufAllDataSent(int32_T upInfoIdx)
+{
+    int_T      i;
+    BufMemList *bufList = &uploadInfoArray[upInfoIdx].bufMemList;
+
+    for (i=0; i<bufList->nActiveBufs; i++) {
+        UploadBufDataSent(bufList->tids[i], upInfoIdx);
+    }
+    bufList->nActiveBufs = 0;
+} /* end UploadBufAllDataSent */
+#endif
+
 /*
  * Macro =======================================================================
  * Move the tail of a circular buffer forward by one time step - accounting for
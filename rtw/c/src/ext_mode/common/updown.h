@@ -14,8 +14,13 @@ extern "C" {
 
 #endif
 
-extern void      SetParam(RTWExtModeInfo  *ei,
-                          const char      *pbuf);
+extern boolean_T SetParam(RTWExtModeInfo  *ei,
+                          const char      *pbuf,
+                          const int       pktSize);
+
+extern void      SetParamCommit(void);
+
+extern void      SetParamTerm(void);
 
 extern void      UploadLogInfoReset(int32_T upInfoIdx);
 
@@ -44,6 +49,8 @@ extern void      UploadCancelLogging(int32_T upInfoIdx);
 extern void      UploadBufDataSent(const int_T tid,
                                    int32_T     upInfoIdx);
 
+extern void      UploadBufAllDataSent(int32_T upInfoIdx);
+
 extern void      UploadBufAddTimePoint(int_T   tid,
                                        real_T  taskTime,
                                        int32_T upInfoIdx);
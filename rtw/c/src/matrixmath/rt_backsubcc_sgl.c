@@ -12,6 +12,18 @@
 #include <math.h>
 #include "rt_matrixlib.h"
 
+#ifdef CREAL_T
+#define RT_SB_FCN      rt_BackwardSubstitutionBlockedCC_Sgl
+#define RT_SB_REAL     real32_T
+#define RT_SB_CREAL    creal32_T
+#define RT_SB_CTIMES   rt_ComplexTimes_Sgl
+#define RT_SB_CRDIVIDE rt_ComplexRDivide_Sgl
+#define RT_SB_T_CPLX   1
+#define RT_SB_B_CPLX   1
+#define RT_SB_UPPER    1
+#include "rt_substblk.h"
+#endif
+
 /* Function: rt_BackwardSubstitutionCC_Sgl =====================================
  * Abstract: Backward substitution: Solving Ux=b 
  *           U: complex, single
@@ -31,6 +43,18 @@ void rt_BackwardSubstitutionCC_Sgl(creal32_T         *pU,
                                    boolean_T          unit_upper)
 {
   int_T i, k;
+
+#ifdef RT_MATRIXLIB_USE_BLAS
+  if (rt_BlasBackwardSub_Sgl(pU, pb, x, N, P, unit_upper,
+                             true, true)) return;
+#endif
+
+  if (RT_SUBST_BLOCKED(P)) {
+    rt_BackwardSubstitutionBlockedCC_Sgl(pU - (N*N-1), pb - (N*P-1), x,
+                                         N, P, unit_upper);
+    return;
+  }
+
   for(k=P; k>0; k--) {
     creal32_T *pUcol = pU;
     for(i=0; i<N; i++) {
@@ -11,6 +11,13 @@
 
 #include "rt_matrixlib.h"
 
+#define RT_SB_FCN      rt_BackwardSubstitutionBlockedRR_Dbl
+#define RT_SB_REAL     real_T
+#define RT_SB_T_CPLX   0
+#define RT_SB_B_CPLX   0
+#define RT_SB_UPPER    1
+#include "rt_substblk.h"
+
 /* Function: rt_BackwardSubstitutionRR_Dbl =====================================
  * Abstract: Backward substitution: Solving Ux=b 
  *           U: real, double
@@ -29,6 +36,18 @@ void rt_BackwardSubstitutionRR_Dbl(real_T          *pU,
                                    boolean_T        unit_upper)
 {
   int_T i,k;
+
+#ifdef RT_MATRIXLIB_USE_BLAS
+  if (rt_BlasBackwardSub_Dbl(pU, pb, x, N, P, unit_upper,
+                             false, false)) return;
+#endif
+
+  if (RT_SUBST_BLOCKED(P)) {
+    rt_BackwardSubstitutionBlockedRR_Dbl(pU - (N*N-1), pb - (N*P-1), x,
+                                         N, P, unit_upper);
+    return;
+  }
+
   for(k=P; k>0; k--) {
     real_T *pUcol = pU;
     for(i=0; i<N; i++) {
@@ -0,0 +1,258 @@
+/* Copyright 2016 The MathWorks, Inc.
+ *
+ * File: rt_blasdispatch.h
+ *
+ * Abstract:
+ *      BLAS/LAPACK calls behind rt_BlasMatMult*, rt_BlasLU*,
+ *      rt_BlasForwardSub* and rt_BlasBackwardSub*.  rt_matrixlib_blas.c
+ *      defines
+ *
+ *        RT_BD_REAL   real_T or real32_T
+ *        RT_BD_SFX    _Dbl or _Sgl
+ *        RT_BD_GEMM   dgemm or sgemm
+ *        RT_BD_CGEMM  zgemm or cgemm
+ *        RT_BD_TRSM   dtrsm or strsm
+ *        RT_BD_CTRSM  ztrsm or ctrsm
+ *        RT_BD_GETRF  dgetrf or sgetrf
+ *        RT_BD_CGETRF zgetrf or cgetrf
+ *
+ *      and includes this file once per precision.  Complex operands are
+ *      passed to the BLAS as arrays of interleaved real and imaginary
+ *      parts, which is the layout of creal_T and creal32_T.  Operands that
+ *      mix real and complex are passed to the real routines, viewing the
+ *      complex matrix as a real one where the layout allows it and one
+ *      column at a time otherwise.
+ */
+
+#ifndef rt_blasdispatch_h
+#define rt_blasdispatch_h
+
+#define RT_BD_CAT2(a,b) a##b
+#define RT_BD_CAT(a,b)  RT_BD_CAT2(a,b)
+
+#endif /* rt_blasdispatch_h */
+
+
+/*
+ * Solve T*X = B in place of x (N x P), T an upper or lower triangular NxN
+ * matrix.  x is complex when T is.
+ */
+static void RT_BD_CAT(rt_BlasTriSolve,RT_BD_SFX)(const RT_BD_REAL *T,
+                                                boolean_T        tCplx,
+                                                RT_BD_REAL       *x,
+                                                boolean_T        xCplx,
+                                                int_T            N,
+                                                int_T            P,
+                                                const char       *uplo,
+                                                boolean_T        unit)
+{
+  const RT_BD_REAL one[2] = {(RT_BD_REAL)1.0, (RT_BD_REAL)0.0};
+  const char       *diag  = unit ? "U" : "N";
+  RT_BLAS_INT      n      = N;
+  RT_BLAS_INT      p      = P;
+
+  if (tCplx) {
+    RT_BD_CTRSM("L", uplo, "N", diag, &n, &p, one, T, &n, x, &n);
+  } else if (!xCplx) {
+    RT_BD_TRSM("L", uplo, "N", diag, &n, &p, one, T, &n, x, &n);
+  } else {
+    /* Each complex column of x is a real 2 x N matrix X with X*T' = B' */
+    RT_BLAS_INT two = 2;
+    int_T       k;
+    for (k = 0; k < P; k++) {
+      RT_BD_TRSM("R", uplo, "T", diag, &two, &n, one, T, &n,
+                 x + 2*N*k, &two);
+    }
+  }
+}
+
+/* Function: rt_BlasMatMult ====================================================
+ * Abstract:
+ *      y = A*B (or y += A*B with inc) through xGEMM, A dims[0] x dims[1]
+ *      and B dims[1] x dims[2].  Returns false, leaving y alone, when the
+ *      operands are below the BLAS threshold.
+ */
+boolean_T RT_BD_CAT(rt_BlasMatMult,RT_BD_SFX)(void          *y,
+                                              const void    *A,
+                                              const void    *B,
+                                              const int_T   dims[3],
+                                              boolean_T     aCplx,
+                                              boolean_T     bCplx,
+                                              boolean_T     inc)
+{
+  const RT_BD_REAL one[2]  = {(RT_BD_REAL)1.0, (RT_BD_REAL)0.0};
+  RT_BD_REAL       beta[2];
+  const RT_BD_REAL *a = (const RT_BD_REAL *)A;
+  const RT_BD_REAL *b = (const RT_BD_REAL *)B;
+  RT_BD_REAL       *c = (RT_BD_REAL *)y;
+  RT_BLAS_INT      m  = dims[0];
+  RT_BLAS_INT      n  = dims[1];
+  RT_BLAS_INT      p  = dims[2];
+
+  if (!rt_BlasWorthIt(dims[0], dims[1], dims[2])) return(false);
+
+  beta[0] = inc ? (RT_BD_REAL)1.0 : (RT_BD_REAL)0.0;
+  beta[1] = (RT_BD_REAL)0.0;
+
+  if (aCplx && bCplx) {
+    RT_BD_CGEMM("N", "N", &m, &p, &n, one, a, &m, b, &n, beta, c, &m);
+  } else if (aCplx) {
+    /* A and y are real 2*dims[0] x dims[1] and 2*dims[0] x dims[2] */
+    RT_BLAS_INT m2 = 2*m;
+    RT_BD_GEMM("N", "N", &m2, &p, &n, one, a, &m2, b, &n, beta, c, &m2);
+  } else if (bCplx) {
+    /* Column k of y, as a real 2 x dims[0] matrix, is B(:,k) * A' with
+     * B(:,k) a real 2 x dims[1] matrix */
+    RT_BLAS_INT two = 2;
+    int_T       k;
+    for (k = 0; k < dims[2]; k++) {
+      RT_BD_GEMM("N", "T", &two, &m, &n, one, b + 2*dims[1]*k, &two,
+                 a, &m, beta, c + 2*dims[0]*k, &two);
+    }
+  } else {
+    RT_BD_GEMM("N", "N", &m, &p, &n, one, a, &m, b, &n, beta, c, &m);
+  }
+  return(true);
+}
+
+/* Function: rt_BlasLU =========================================================
+ * Abstract:
+ *      LU factorization of the NxN matrix A through xGETRF, with the row
+ *      interchanges returned as the permutation vector of rt_lu_real.
+ *      Returns false, leaving A alone, when N is below the BLAS threshold.
+ *
+ *      xGETRF writes its pivots straight into piv when RT_BLAS_INT and
+ *      int32_T have the same size, and into a buffer on the stack
+ *      otherwise; only matrices of order above RT_BLAS_LU_STACK_PIVOTS then
+ *      allocate one.  Entry i of the permutation depends on the first i+1
+ *      pivots only, so it is computed from the last entry down, overwriting
+ *      pivots no longer needed.
+ */
+boolean_T RT_BD_CAT(rt_BlasLU,RT_BD_SFX)(void        *A,
+                                         const int_T N,
+                                         int32_T     *piv,
+                                         boolean_T   cplx)
+{
+  RT_BLAS_INT ipivBuf[RT_BLAS_LU_STACK_PIVOTS];
+  RT_BLAS_INT *ipiv = ipivBuf;
+  RT_BLAS_INT n = N;
+  RT_BLAS_INT info;
+  int_T       i, k;
+
+  if (!rt_MatrixLibUseBlas || N < rt_MatrixLibBlasMinDim) return(false);
+
+  if (sizeof(RT_BLAS_INT) == sizeof(int32_T)) {
+    ipiv = (RT_BLAS_INT *)piv;
+  } else if (N > RT_BLAS_LU_STACK_PIVOTS) {
+    ipiv = (RT_BLAS_INT *)malloc(N*sizeof(RT_BLAS_INT));
+    if (ipiv == NULL) return(false);
+  }
+
+  if (cplx) {
+    RT_BD_CGETRF(&n, &n, (RT_BD_REAL *)A, &n, ipiv, &info);
+  } else {
+    RT_BD_GETRF(&n, &n, (RT_BD_REAL *)A, &n, ipiv, &info);
+  }
+
+  /* info > 0 flags a zero pivot; the factorization is complete as with
+   * rt_lu_real, so the caller's substitutions proceed the same way.
+   * Interchange k swaps rows k and ipiv[k]-1 >= k, so those after i leave
+   * row i alone and piv[i] is i taken through interchanges i down to 0. */
+  for (i = N-1; i >= 0; i--) {
+    int_T r = i;
+    for (k = i; k >= 0; k--) {
+      const int_T p = (int_T)ipiv[k] - 1;
+      if (r == k) {
+        r = p;
+      } else if (r == p) {
+        r = k;
+      }
+    }
+    piv[i] = (int32_T)r;
+  }
+
+  if ((ipiv != ipivBuf) && ((void *)ipiv != (void *)piv)) {
+    free(ipiv);
+  }
+  return(true);
+}
+
+/* Function: rt_BlasForwardSub =================================================
+ * Abstract:
+ *      x = L \ b(piv,:) through xTRSM, L lower (or unit lower) triangular
+ *      NxN and b NxP, as rt_ForwardSubstitution*.  x is complex when L or b
+ *      is.  Returns false when the operands are below the BLAS threshold.
+ */
+boolean_T RT_BD_CAT(rt_BlasForwardSub,RT_BD_SFX)(const void    *L,
+                                                 const void    *b,
+                                                 void          *x,
+                                                 int_T         N,
+                                                 int_T         P,
+                                                 const int32_T *piv,
+                                                 boolean_T     unitLower,
+                                                 boolean_T     lCplx,
+                                                 boolean_T     bCplx)
+{
+  const RT_BD_REAL *pb    = (const RT_BD_REAL *)b;
+  RT_BD_REAL       *px    = (RT_BD_REAL *)x;
+  const boolean_T  xCplx  = lCplx || bCplx;
+  int_T            i, k;
+
+  if (!rt_BlasWorthIt(N, N, P)) return(false);
+
+  for (k = 0; k < P; k++) {
+    for (i = 0; i < N; i++) {
+      const int_T src = piv[i] + k*N;
+      const int_T dst = i + k*N;
+      if (bCplx) {
+        px[2*dst]   = pb[2*src];
+        px[2*dst+1] = pb[2*src+1];
+      } else if (xCplx) {
+        px[2*dst]   = pb[src];
+        px[2*dst+1] = (RT_BD_REAL)0.0;
+      } else {
+        px[dst] = pb[src];
+      }
+    }
+  }
+
+  RT_BD_CAT(rt_BlasTriSolve,RT_BD_SFX)((const RT_BD_REAL *)L, lCplx, px,
+                                       xCplx, N, P, "L", unitLower);
+  return(true);
+}
+
+/* Function: rt_BlasBackwardSub ================================================
+ * Abstract:
+ *      x = U \ b through xTRSM, U upper (or unit upper) triangular NxN and b
+ *      NxP, as rt_BackwardSubstitution*: pU and pb point to the last
+ *      elements of U and b.  b is complex when U is.  Returns false when the
+ *      operands are below the BLAS threshold.
+ */
+boolean_T RT_BD_CAT(rt_BlasBackwardSub,RT_BD_SFX)(const void    *pU,
+                                                  const void    *pb,
+                                                  void          *x,
+                                                  int_T         N,
+                                                  int_T         P,
+                                                  boolean_T     unitUpper,
+                                                  boolean_T     uCplx,
+                                                  boolean_T     bCplx)
+{
+  const int_T      uw = uCplx ? 2 : 1;
+  const int_T      bw = bCplx ? 2 : 1;
+  const RT_BD_REAL *U;
+  const RT_BD_REAL *b;
+
+  if (!rt_BlasWorthIt(N, N, P)) return(false);
+
+  U = (const RT_BD_REAL *)pU - uw*(N*N-1);
+  b = (const RT_BD_REAL *)pb - bw*(N*P-1);
+  if ((const void *)b != x) {
+    (void)memmove(x, b, bw*N*P*sizeof(RT_BD_REAL));
+  }
+
+  RT_BD_CAT(rt_BlasTriSolve,RT_BD_SFX)(U, uCplx, (RT_BD_REAL *)x, bCplx,
+                                       N, P, "U", unitUpper);
+  return(true);
+}
+
+/* [EOF] rt_blasdispatch.h */
@@ -11,6 +11,18 @@
 #include <math.h>
 #include "rt_matrixlib.h"
 
+#ifdef CREAL_T
+#define RT_SB_FCN      rt_ForwardSubstitutionBlockedCR_Sgl
+#define RT_SB_REAL     real32_T
+#define RT_SB_CREAL    creal32_T
+#define RT_SB_CTIMES   rt_ComplexTimes_Sgl
+#define RT_SB_CRDIVIDE rt_ComplexRDivide_Sgl
+#define RT_SB_T_CPLX   1
+#define RT_SB_B_CPLX   0
+#define RT_SB_UPPER    0
+#include "rt_substblk.h"
+#endif
+
 /* Function: rt_ForwardSubstitutionCR_Sgl ======================================
  * Abstract: Forward substitution: solving Lx=b 
  *           L: Complex, double
@@ -31,6 +43,17 @@ void rt_ForwardSubstitutionCR_Sgl(creal32_T      *pL,
                                   boolean_T       unit_lower)
 {
   int_T i, k;
+
+#ifdef RT_MATRIXLIB_USE_BLAS
+  if (rt_BlasForwardSub_Sgl(pL, pb, x, N, P, piv, unit_lower,
+                            true, false)) return;
+#endif
+
+  if (RT_SUBST_BLOCKED(P)) {
+    rt_ForwardSubstitutionBlockedCR_Sgl(pL, pb, x, N, P, piv, unit_lower);
+    return;
+  }
+
   for(k=0; k<P; k++) {
     creal32_T *pLcol = pL;
     for(i=0; i<N; i++) {
@@ -10,6 +10,18 @@
 
 #include "rt_matrixlib.h"
 
+#ifdef CREAL_T
+#define RT_SB_FCN      rt_ForwardSubstitutionBlockedRC_Dbl
+#define RT_SB_REAL     real_T
+#define RT_SB_CREAL    creal_T
+#define RT_SB_CTIMES   rt_ComplexTimes_Dbl
+#define RT_SB_CRDIVIDE rt_ComplexRDivide_Dbl
+#define RT_SB_T_CPLX   0
+#define RT_SB_B_CPLX   1
+#define RT_SB_UPPER    0
+#include "rt_substblk.h"
+#endif
+
 /* Function: rt_ForwardSubstitutionRC_Dbl =====================================
  * Abstract: Forward substitution: solving Lx=b 
  *           L: Real,    double
@@ -30,6 +42,17 @@ void rt_ForwardSubstitutionRC_Dbl(real_T        *pL,
                                   boolean_T      unit_lower)
 {
   int_T i, k;
+
+#ifdef RT_MATRIXLIB_USE_BLAS
+  if (rt_BlasForwardSub_Dbl(pL, pb, x, N, P, piv, unit_lower,
+                            false, true)) return;
+#endif
+
+  if (RT_SUBST_BLOCKED(P)) {
+    rt_ForwardSubstitutionBlockedRC_Dbl(pL, pb, x, N, P, piv, unit_lower);
+    return;
+  }
+
   for(k=0; k<P; k++) {
     real_T *pLcol = pL;
     for(i=0; i<N; i++) {
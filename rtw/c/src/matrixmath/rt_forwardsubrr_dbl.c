@@ -10,6 +10,13 @@
 
 #include "rt_matrixlib.h"
 
+#define RT_SB_FCN      rt_ForwardSubstitutionBlockedRR_Dbl
+#define RT_SB_REAL     real_T
+#define RT_SB_T_CPLX   0
+#define RT_SB_B_CPLX   0
+#define RT_SB_UPPER    0
+#include "rt_substblk.h"
+
 /* Function: rt_ForwardSubstitutionRR_Dbl ======================================
  * Abstract: Forward substitution: solving Lx=b 
  *           L: Real, double
@@ -30,6 +37,17 @@ void rt_ForwardSubstitutionRR_Dbl(real_T        *pL,
 {  
   /* Real inputs: */
   int_T i, k;
+
+#ifdef RT_MATRIXLIB_USE_BLAS
+  if (rt_BlasForwardSub_Dbl(pL, pb, x, N, P, piv, unit_lower,
+                            false, false)) return;
+#endif
+
+  if (RT_SUBST_BLOCKED(P)) {
+    rt_ForwardSubstitutionBlockedRR_Dbl(pL, pb, x, N, P, piv, unit_lower);
+    return;
+  }
+
   for(k=0; k<P; k++) {
     real_T *pLcol = pL;
     for(i=0; i<N; i++) {
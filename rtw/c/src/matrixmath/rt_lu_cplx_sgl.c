@@ -10,24 +10,23 @@
 #include <math.h>
 #include "rt_matrixlib.h"
 
-/* Function: rt_lu_cplx ========================================================
- * Abstract: A is complex.
+#ifdef CREAL_T
+
+/* Function: rt_lu_cplx_sgl_panel ==============================================
+ * Abstract: Factor columns k0 to k1-1 of A, swapping whole rows.  The columns
+ *           to the right of the panel are only swapped.
  *
  */
-#ifdef CREAL_T
-void rt_lu_cplx_sgl(creal32_T *A,     /* in and out                         */
-                    const int_T n,  /* number or rows = number of columns */
-                    int32_T *piv)   /* pivote vector                      */
+static void rt_lu_cplx_sgl_panel(creal32_T   *A,
+                                 const int_T n,
+                                 int32_T     *piv,
+                                 const int_T k0,
+                                 const int_T k1)
 {
   int_T k;
 
-  /* initialize row-pivot indices: */
-  for (k = 0; k < n; k++) {
-    piv[k] = k;
-  }
-
   /* Loop over each column: */
-  for (k = 0; k < n; k++) {
+  for (k = k0; k < k1; k++) {
     const int_T kn = k*n;
     int_T p = k;
 
@@ -86,8 +85,8 @@ void rt_lu_cplx_sgl(creal32_T *A,     /* in and out                         */
           rt_ComplexTimes_Sgl(&A[i+kn], A[i+kn], Adiag);
         }
 
-        /* subtract multiple of column from remaining columns */
-        for (j = k+1; j < n; j++) {
+        /* subtract multiple of column from remaining columns of the panel */
+        for (j = k+1; j < k1; j++) {
           int_T j_n = j*n;
           for (i = k+1; i < n; i++) {
             /* Multiply: c = A[i+kn] * A[k+j_n]: */
@@ -103,5 +102,142 @@ void rt_lu_cplx_sgl(creal32_T *A,     /* in and out                         */
     }
   }
 }
+
+/* Function: rt_lu_cplx_sgl_update =============================================
+ * Abstract: Apply the panel k0 to k1-1 to the columns right of it:
+ *           U12 = L11 \ A12 and A22 -= L21*U12.  Each element is updated by
+ *           the panel columns in turn, as in the unblocked factorization, and
+ *           columns with a zero pivot are skipped likewise.
+ *
+ *           The register tiles multiply without the zero tests of
+ *           rt_ComplexTimes_Sgl.  That only changes results that are zero or
+ *           NaN, and those elements are updated again with it.
+ */
+static void rt_lu_cplx_sgl_update(creal32_T   *A,
+                                  const int_T n,
+                                  const int_T k0,
+                                  const int_T k1)
+{
+  int_T kk[RT_LU_NB];                   /* panel columns with a pivot */
+  int_T nk = 0;
+  int_T i, j, t;
+
+  for (t = k0; t < k1; t++) {
+    if (!((A[t+t*n].re == 0.0F) && (A[t+t*n].im == 0.0F))) kk[nk++] = t;
+  }
+
+  /* U12 = L11 \ A12 */
+  for (j = k1; j < n; j++) {
+    const int_T j_n = j*n;
+    for (t = 0; t < nk; t++) {
+      const int_T k  = kk[t];
+      const int_T kn = k*n;
+      for (i = k+1; i < k1; i++) {
+        creal32_T c;
+        rt_ComplexTimes_Sgl(&c, A[i+kn], A[k+j_n]);
+        A[i+j_n].re -= c.re;
+        A[i+j_n].im -= c.im;
+      }
+    }
+  }
+
+  /* A22 -= L21*U12, on RT_LU_MR x RT_LU_NR tiles held in registers */
+  for (j = k1; j < n; j += RT_LU_NR) {
+    const int_T nr = (n-j > RT_LU_NR) ? RT_LU_NR : n-j;
+    for (i = k1; i < n; i += RT_LU_MR) {
+      const int_T mr = (n-i > RT_LU_MR) ? RT_LU_MR : n-i;
+      int_T r, c;
+      if (mr == RT_LU_MR && nr == RT_LU_NR) {
+        real32_T accRe[RT_LU_NR][RT_LU_MR];
+        real32_T accIm[RT_LU_NR][RT_LU_MR];
+        for (c = 0; c < RT_LU_NR; c++) {
+          for (r = 0; r < RT_LU_MR; r++) {
+            accRe[c][r] = A[i+r+(j+c)*n].re;
+            accIm[c][r] = A[i+r+(j+c)*n].im;
+          }
+        }
+        for (t = 0; t < nk; t++) {
+          const creal32_T *l = A + kk[t]*n + i;
+          for (c = 0; c < RT_LU_NR; c++) {
+            const creal32_T u = A[kk[t]+(j+c)*n];
+            for (r = 0; r < RT_LU_MR; r++) {
+              accRe[c][r] -= l[r].re*u.re - l[r].im*u.im;
+              accIm[c][r] -= l[r].re*u.im + l[r].im*u.re;
+            }
+          }
+        }
+        for (c = 0; c < RT_LU_NR; c++) {
+          for (r = 0; r < RT_LU_MR; r++) {
+            creal32_T *a = &A[i+r+(j+c)*n];
+            if (accRe[c][r] == 0.0F || accRe[c][r] != accRe[c][r] ||
+                accIm[c][r] == 0.0F || accIm[c][r] != accIm[c][r]) {
+              for (t = 0; t < nk; t++) {
+                creal32_T p;
+                rt_ComplexTimes_Sgl(&p, A[i+r+kk[t]*n], A[kk[t]+(j+c)*n]);
+                a->re -= p.re;
+                a->im -= p.im;
+              }
+            } else {
+              a->re = accRe[c][r];
+              a->im = accIm[c][r];
+            }
+          }
+        }
+      } else {
+        for (c = 0; c < nr; c++) {
+          creal32_T *a = A + i + (j+c)*n;
+          for (t = 0; t < nk; t++) {
+            const creal32_T *l = A + kk[t]*n + i;
+            const creal32_T u  = A[kk[t]+(j+c)*n];
+            for (r = 0; r < mr; r++) {
+              creal32_T p;
+              rt_ComplexTimes_Sgl(&p, l[r], u);
+              a[r].re -= p.re;
+              a[r].im -= p.im;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+/* Function: rt_lu_cplx ========================================================
+ * Abstract: A is complex.
+ *
+ *           Matrices of order RT_LU_MIN_BLOCKED and more are factored in
+ *           panels of RT_LU_NB columns, with a blocked update of the
+ *           columns right of each panel.  The results are the same as
+ *           factoring one column at a time.
+ */
+void rt_lu_cplx_sgl(creal32_T *A,     /* in and out                         */
+                    const int_T n,  /* number or rows = number of columns */
+                    int32_T *piv)   /* pivote vector                      */
+{
+  int_T k;
+
+#ifdef RT_MATRIXLIB_USE_BLAS
+  if (rt_BlasLU_Sgl(A, n, piv, true)) return;
+#endif
+
+  /* initialize row-pivot indices: */
+  for (k = 0; k < n; k++) {
+    piv[k] = k;
+  }
+
+  if (n < RT_LU_MIN_BLOCKED) {
+    rt_lu_cplx_sgl_panel(A, n, piv, 0, n);
+    return;
+  }
+
+  /* Loop over each panel: */
+  for (k = 0; k < n; k += RT_LU_NB) {
+    const int_T k1 = (n-k > RT_LU_NB) ? k+RT_LU_NB : n;
+    rt_lu_cplx_sgl_panel(A, n, piv, k, k1);
+    if (k1 < n) {
+      rt_lu_cplx_sgl_update(A, n, k, k1);
+    }
+  }
+}
 #endif
 /* [EOF] rt_lu_cplx_sgl.c */
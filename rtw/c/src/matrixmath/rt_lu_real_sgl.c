@@ -10,23 +10,21 @@
 #include <math.h>
 #include "rt_matrixlib.h"
 
-/* Function: rt_lu_real  =======================================================
- * Abstract: A is real.
+/* Function: rt_lu_real_sgl_panel ==============================================
+ * Abstract: Factor columns k0 to k1-1 of A, swapping whole rows.  The columns
+ *           to the right of the panel are only swapped.
  *
  */
-void rt_lu_real_sgl(real32_T      *A,    /* in and out                         */
-                const int_T n,     /* number or rows = number of columns */
-                int32_T     *piv)  /* pivote vector                      */
+static void rt_lu_real_sgl_panel(real32_T    *A,
+                                 const int_T n,
+                                 int32_T     *piv,
+                                 const int_T k0,
+                                 const int_T k1)
 {
   int_T k;
 
-  /* initialize row-pivot indices: */
-  for (k = 0; k < n; k++) {
-    piv[k] = k;
-  }
-
   /* Loop over each column: */
-  for (k = 0; k < n; k++) {
+  for (k = k0; k < k1; k++) {
     const int_T kn = k*n;
     int_T p = k;
 
@@ -67,8 +65,8 @@ void rt_lu_real_sgl(real32_T      *A,    /* in and out                         *
           A[i+kn] *= Adiag;
         }
 
-        /* subtract multiple of column from remaining columns */
-        for (j = k+1; j < n; j++) {
+        /* subtract multiple of column from remaining columns of the panel */
+        for (j = k+1; j < k1; j++) {
           int_T j_n = j*n;
           for (i = k+1; i < n; i++) {
             A[i+j_n] -= A[i+kn]*A[k+j_n];
@@ -79,4 +77,109 @@ void rt_lu_real_sgl(real32_T      *A,    /* in and out                         *
   }
 }
 
+/* Function: rt_lu_real_sgl_update =============================================
+ * Abstract: Apply the panel k0 to k1-1 to the columns right of it:
+ *           U12 = L11 \ A12 and A22 -= L21*U12.  Each element is updated by
+ *           the panel columns in turn, as in the unblocked factorization, and
+ *           columns with a zero pivot are skipped likewise.
+ *
+ */
+static void rt_lu_real_sgl_update(real32_T    *A,
+                                  const int_T n,
+                                  const int_T k0,
+                                  const int_T k1)
+{
+  int_T kk[RT_LU_NB];                   /* panel columns with a pivot */
+  int_T nk = 0;
+  int_T i, j, t;
+
+  for (t = k0; t < k1; t++) {
+    if (A[t+t*n] != 0.0F) kk[nk++] = t;
+  }
+
+  /* U12 = L11 \ A12 */
+  for (j = k1; j < n; j++) {
+    const int_T j_n = j*n;
+    for (t = 0; t < nk; t++) {
+      const int_T k  = kk[t];
+      const int_T kn = k*n;
+      for (i = k+1; i < k1; i++) {
+        A[i+j_n] -= A[i+kn]*A[k+j_n];
+      }
+    }
+  }
+
+  /* A22 -= L21*U12, on RT_LU_MR x RT_LU_NR tiles held in registers */
+  for (j = k1; j < n; j += RT_LU_NR) {
+    const int_T nr = (n-j > RT_LU_NR) ? RT_LU_NR : n-j;
+    for (i = k1; i < n; i += RT_LU_MR) {
+      const int_T mr = (n-i > RT_LU_MR) ? RT_LU_MR : n-i;
+      int_T r, c;
+      if (mr == RT_LU_MR && nr == RT_LU_NR) {
+        real32_T acc[RT_LU_NR][RT_LU_MR];
+        for (c = 0; c < RT_LU_NR; c++) {
+          for (r = 0; r < RT_LU_MR; r++) acc[c][r] = A[i+r+(j+c)*n];
+        }
+        for (t = 0; t < nk; t++) {
+          const real32_T *l = A + kk[t]*n + i;
+          for (c = 0; c < RT_LU_NR; c++) {
+            const real32_T u = A[kk[t]+(j+c)*n];
+            for (r = 0; r < RT_LU_MR; r++) acc[c][r] -= l[r]*u;
+          }
+        }
+        for (c = 0; c < RT_LU_NR; c++) {
+          for (r = 0; r < RT_LU_MR; r++) A[i+r+(j+c)*n] = acc[c][r];
+        }
+      } else {
+        for (c = 0; c < nr; c++) {
+          real32_T *a = A + i + (j+c)*n;
+          for (t = 0; t < nk; t++) {
+            const real32_T *l = A + kk[t]*n + i;
+            const real32_T u  = A[kk[t]+(j+c)*n];
+            for (r = 0; r < mr; r++) a[r] -= l[r]*u;
+          }
+        }
+      }
+    }
+  }
+}
+
+/* Function: rt_lu_real  =======================================================
+ * Abstract: A is real.
+ *
+ *           Matrices of order RT_LU_MIN_BLOCKED and more are factored in
+ *           panels of RT_LU_NB columns, with a blocked update of the
+ *           columns right of each panel.  The results are the same as
+ *           factoring one column at a time.
+ */
+void rt_lu_real_sgl(real32_T      *A,    /* in and out                         */
+                const int_T n,     /* number or rows = number of columns */
+                int32_T     *piv)  /* pivote vector                      */
+{
+  int_T k;
+
+#ifdef RT_MATRIXLIB_USE_BLAS
+  if (rt_BlasLU_Sgl(A, n, piv, false)) return;
+#endif
+
+  /* initialize row-pivot indices: */
+  for (k = 0; k < n; k++) {
+    piv[k] = k;
+  }
+
+  if (n < RT_LU_MIN_BLOCKED) {
+    rt_lu_real_sgl_panel(A, n, piv, 0, n);
+    return;
+  }
+
+  /* Loop over each panel: */
+  for (k = 0; k < n; k += RT_LU_NB) {
+    const int_T k1 = (n-k > RT_LU_NB) ? k+RT_LU_NB : n;
+    rt_lu_real_sgl_panel(A, n, piv, k, k1);
+    if (k1 < n) {
+      rt_lu_real_sgl_update(A, n, k, k1);
+    }
+  }
+}
+
 /* [EOF] rt_lu_real_sgl.c */
@@ -49,5 +49,42 @@ void rt_MatDivCC_Dbl(creal_T       *Out,
 
   rt_BackwardSubstitutionCC_Dbl(lu + N2 -1, x + NP -1, Out, N, P, unit_upper);
 }
+
+/* Function: rt_MatDivCCCached_Dbl ============================================
+ * Abstract:
+ *           Calculate inv(In1)*In2 like rt_MatDivCC_Dbl, but keep the
+ *           factorization of In1 between calls.  In1Prev holds the In1 that
+ *           lu and piv were computed from and *luValid is set once they
+ *           are.  While In1 is unchanged, only the substitutions are run.
+ *           Clear *luValid to force a new factorization.
+ */
+void rt_MatDivCCCached_Dbl(creal_T       *Out,
+                           const creal_T *In1,
+                           const creal_T *In2,
+                           creal_T       *lu,
+                           int32_T       *piv,
+                           creal_T       *x,
+                           const int_T    dims[3],
+                           creal_T       *In1Prev,
+                           boolean_T     *luValid)
+{
+  int_T N = dims[0];
+  int_T N2 = N * N;
+  int_T P = dims[2];
+  int_T NP = N * P;
+  const boolean_T unit_upper = false;
+  const boolean_T unit_lower = true;
+
+  if (!*luValid || memcmp(In1Prev, In1, N2*sizeof(creal_T)) != 0) {
+    (void)memcpy(In1Prev, In1, N2*sizeof(creal_T));
+    (void)memcpy(lu, In1, N2*sizeof(creal_T));
+    rt_lu_cplx(lu, N, piv);
+    *luValid = true;
+  }
+
+  rt_ForwardSubstitutionCC_Dbl(lu, In2, x, N, P, piv, unit_lower);
+
+  rt_BackwardSubstitutionCC_Dbl(lu + N2 -1, x + NP -1, Out, N, P, unit_upper);
+}
 #endif
 /* [EOF] rt_matdivcc_dbl.c */
@@ -39,5 +39,42 @@ void rt_MatDivRC_Dbl(creal_T       *Out,
 
   rt_BackwardSubstitutionRC_Dbl(lu + N2 -1, x + NP -1, Out, N, P, unit_upper);
 }
+
+/* Function: rt_MatDivRCCached_Dbl ============================================
+ * Abstract:
+ *           Calculate inv(In1)*In2 like rt_MatDivRC_Dbl, but keep the
+ *           factorization of In1 between calls.  In1Prev holds the In1 that
+ *           lu and piv were computed from and *luValid is set once they
+ *           are.  While In1 is unchanged, only the substitutions are run.
+ *           Clear *luValid to force a new factorization.
+ */
+void rt_MatDivRCCached_Dbl(creal_T       *Out,
+                           const real_T  *In1,
+                           const creal_T *In2,
+                           real_T        *lu,
+                           int32_T       *piv,
+                           creal_T       *x,
+                           const int_T    dims[3],
+                           real_T        *In1Prev,
+                           boolean_T     *luValid)
+{
+  int_T N = dims[0];
+  int_T N2 = N * N;
+  int_T P = dims[2];
+  int_T NP = N * P;
+  const boolean_T unit_upper = false;
+  const boolean_T unit_lower = true;
+
+  if (!*luValid || memcmp(In1Prev, In1, N2*sizeof(real_T)) != 0) {
+    (void)memcpy(In1Prev, In1, N2*sizeof(real_T));
+    (void)memcpy(lu, In1, N2*sizeof(real_T));
+    rt_lu_real(lu, N, piv);
+    *luValid = true;
+  }
+
+  rt_ForwardSubstitutionRC_Dbl(lu, In2, x, N, P, piv, unit_lower);
+
+  rt_BackwardSubstitutionRC_Dbl(lu + N2 -1, x + NP -1, Out, N, P, unit_upper);
+}
 #endif
 /* [EOF] rt_matdivrc_dbl.c */
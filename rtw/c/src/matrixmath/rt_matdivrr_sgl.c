@@ -50,4 +50,41 @@ void rt_MatDivRR_Sgl(real32_T       *Out,
   rt_BackwardSubstitutionRR_Sgl(lu + N2 -1, x + NP -1, Out, N, P, unit_upper);
 }
 
+/* Function: rt_MatDivRRCached_Sgl ============================================
+ * Abstract:
+ *           Calculate inv(In1)*In2 like rt_MatDivRR_Sgl, but keep the
+ *           factorization of In1 between calls.  In1Prev holds the In1 that
+ *           lu and piv were computed from and *luValid is set once they
+ *           are.  While In1 is unchanged, only the substitutions are run.
+ *           Clear *luValid to force a new factorization.
+ */
+void rt_MatDivRRCached_Sgl(real32_T       *Out,
+                           const real32_T *In1,
+                           const real32_T *In2,
+                           real32_T       *lu,
+                           int32_T        *piv,
+                           real32_T       *x,
+                           const int_T     dims[3],
+                           real32_T       *In1Prev,
+                           boolean_T      *luValid)
+{
+  int_T N = dims[0];
+  int_T N2 = N * N;
+  int_T P = dims[2];
+  int_T NP = N * P;
+  const boolean_T unit_upper = false;
+  const boolean_T unit_lower = true;
+
+  if (!*luValid || memcmp(In1Prev, In1, N2*sizeof(real32_T)) != 0) {
+    (void)memcpy(In1Prev, In1, N2*sizeof(real32_T));
+    (void)memcpy(lu, In1, N2*sizeof(real32_T));
+    rt_lu_real_sgl(lu, N, piv);
+    *luValid = true;
+  }
+
+  rt_ForwardSubstitutionRR_Sgl(lu, In2, x, N, P, piv, unit_lower);
+
+  rt_BackwardSubstitutionRR_Sgl(lu + N2 -1, x + NP -1, Out, N, P, unit_upper);
+}
+
 /* [EOF] rt_matdivrr_dbl.c */
@@ -11,6 +11,17 @@
 
 #include "rt_matrixlib.h"
 
+#ifdef CREAL_T
+#define RT_MM_FCN    rt_MatMultAndIncBlockedRC_Sgl
+#define RT_MM_REAL   real32_T
+#define RT_MM_CREAL  creal32_T
+#define RT_MM_CTIMES rt_ComplexTimes_Sgl
+#define RT_MM_A_CPLX 0
+#define RT_MM_B_CPLX 1
+#define RT_MM_INC    1
+#include "rt_matmultblk.h"
+#endif
+
 /*
  * Function: rt_MatMultAndIncRC_Sgl
  * Abstract:
@@ -25,6 +36,13 @@ void rt_MatMultAndIncRC_Sgl(creal32_T       *y,
                             const int_T       dims[3])
 {
   int_T k;
+#ifdef RT_MATRIXLIB_USE_BLAS
+  if (rt_BlasMatMult_Sgl(y, A, B, dims, false, true, true)) return;
+#endif
+  if (RT_MATMULT_BLOCKED(dims)) {
+    rt_MatMultAndIncBlockedRC_Sgl(y, A, B, dims);
+    return;
+  }
   for(k=dims[2]; k-- > 0; ) {
     const real32_T *A1 = A;
     int_T i;
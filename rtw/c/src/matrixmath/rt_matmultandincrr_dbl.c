@@ -10,6 +10,13 @@
 
 #include "rt_matrixlib.h"
 
+#define RT_MM_FCN    rt_MatMultAndIncBlockedRR_Dbl
+#define RT_MM_REAL   real_T
+#define RT_MM_A_CPLX 0
+#define RT_MM_B_CPLX 0
+#define RT_MM_INC    1
+#include "rt_matmultblk.h"
+
 /*
  * Function: rt_MatMultAndIncRR_Dbl
  * Abstract:
@@ -23,6 +30,13 @@ void rt_MatMultAndIncRR_Dbl(real_T       *y,
                             const int_T    dims[3])
 {
   int_T k;
+#ifdef RT_MATRIXLIB_USE_BLAS
+  if (rt_BlasMatMult_Dbl(y, A, B, dims, false, false, true)) return;
+#endif
+  if (RT_MATMULT_BLOCKED(dims)) {
+    rt_MatMultAndIncBlockedRR_Dbl(y, A, B, dims);
+    return;
+  }
   for(k=dims[2]; k-- > 0; ) {
     const real_T *A1 = A;
     int_T i;
@@ -0,0 +1,258 @@
+/* Copyright 2016 The MathWorks, Inc.
+ *
+ * File: rt_matmultblk.h
+ *
+ * Abstract:
+ *      Register and cache blocked kernel for the rt_MatMult* and
+ *      rt_MatMultAndInc* support routines.  Each of their sources defines
+ *
+ *        RT_MM_FCN     name of the static kernel
+ *        RT_MM_REAL    real_T or real32_T
+ *        RT_MM_CREAL   creal_T or creal32_T, for complex operands
+ *        RT_MM_CTIMES  rt_ComplexTimes_Dbl or _Sgl, for complex operands
+ *        RT_MM_A_CPLX  1 if A is complex, else 0
+ *        RT_MM_B_CPLX  1 if B is complex, else 0
+ *        RT_MM_INC     1 to add A*B to y, 0 to store it
+ *
+ *      and then includes this file.  The kernel is used when the operands
+ *      are large enough, see RT_MATMULT_BLOCKED.
+ *
+ *      The kernel works on RT_MATMULT_MR x RT_MATMULT_NR tiles of y held in
+ *      local accumulators, which the compiler keeps in vector registers of
+ *      the target it builds for (e.g. with -mavx2, -mavx512f or on NEON).
+ *      Each element of y is still summed over j in the same order as the
+ *      reference loops, so real results are identical to them.  Complex
+ *      products skip the zero tests of rt_ComplexTimes_*; the elements that
+ *      come out NaN are recomputed with it.
+ */
+
+#ifndef rt_matmultblk_h
+#define rt_matmultblk_h
+
+/* Rows x columns of y in a register tile */
+#ifndef RT_MATMULT_MR
+# if defined(__AVX512F__)
+#  define RT_MATMULT_MR 16
+# elif defined(__AVX__) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define RT_MATMULT_MR 8
+# else
+#  define RT_MATMULT_MR 4
+# endif
+#endif
+#ifndef RT_MATMULT_NR
+# define RT_MATMULT_NR 4
+#endif
+
+/* Rows of A and inner dimension kept in cache while the columns of B and y
+ * are swept */
+#ifndef RT_MATMULT_MC
+# define RT_MATMULT_MC 128
+#endif
+#ifndef RT_MATMULT_KC
+# define RT_MATMULT_KC 256
+#endif
+
+/* Use the blocked kernel for y (dims[0] x dims[2]) = A (dims[0] x dims[1]) *
+ * B (dims[1] x dims[2]) of at least one full tile */
+#ifndef RT_MATMULT_MIN_INNER
+# define RT_MATMULT_MIN_INNER 8
+#endif
+#ifdef RT_MATMULT_NO_BLOCKING
+# define RT_MATMULT_BLOCKED(dims) 0
+#else
+# define RT_MATMULT_BLOCKED(dims) ((dims)[0] >= RT_MATMULT_MR && \
+                                   (dims)[2] >= RT_MATMULT_NR && \
+                                   (dims)[1] >= RT_MATMULT_MIN_INNER)
+#endif
+
+#define RT_MM_CAT2(a,b) a##b
+#define RT_MM_CAT(a,b)  RT_MM_CAT2(a,b)
+
+#endif /* rt_matmultblk_h */
+
+
+#if RT_MM_A_CPLX
+# define RT_MM_TA RT_MM_CREAL
+#else
+# define RT_MM_TA RT_MM_REAL
+#endif
+#if RT_MM_B_CPLX
+# define RT_MM_TB RT_MM_CREAL
+#else
+# define RT_MM_TB RT_MM_REAL
+#endif
+
+#define RT_MM_Y(c,r) y[(k+(c))*m + i+(r)]
+
+#if !RT_MM_A_CPLX && !RT_MM_B_CPLX
+
+# define RT_MM_TY RT_MM_REAL
+# define RT_MM_ACC_DECL RT_MM_REAL accRe[RT_MATMULT_NR][RT_MATMULT_MR];
+# if RT_MM_INC
+#  define RT_MM_INIT(c,r)  accRe[c][r] = (RT_MM_REAL)0.0
+#  define RT_MM_STORE(c,r) RT_MM_Y(c,r) += accRe[c][r]
+# else
+#  define RT_MM_INIT(c,r)  accRe[c][r] = (j0 == 0) ? (RT_MM_REAL)0.0 : RT_MM_Y(c,r)
+#  define RT_MM_STORE(c,r) RT_MM_Y(c,r) = accRe[c][r]
+# endif
+# define RT_MM_MAC(c,r,a,b) accRe[c][r] += (a) * (b)
+
+#else
+
+# define RT_MM_TY RT_MM_CREAL
+# define RT_MM_ACC_DECL RT_MM_REAL accRe[RT_MATMULT_NR][RT_MATMULT_MR]; \
+                        RT_MM_REAL accIm[RT_MATMULT_NR][RT_MATMULT_MR];
+# if RT_MM_INC
+#  define RT_MM_INIT(c,r)  accRe[c][r] = accIm[c][r] = (RT_MM_REAL)0.0
+#  define RT_MM_STORE(c,r)                                              \
+    if (accRe[c][r] != accRe[c][r] || accIm[c][r] != accIm[c][r]) {     \
+        RT_MM_CREAL s;                                                  \
+        RT_MM_CAT(RT_MM_FCN,Element)(&s, A + i+(r), B + (k+(c))*n, m, n); \
+        RT_MM_Y(c,r).re += s.re;                                        \
+        RT_MM_Y(c,r).im += s.im;                                        \
+    } else {                                                            \
+        RT_MM_Y(c,r).re += accRe[c][r];                                 \
+        RT_MM_Y(c,r).im += accIm[c][r];                                 \
+    }
+# else
+#  define RT_MM_INIT(c,r)                                               \
+    if (j0 == 0) {                                                      \
+        accRe[c][r] = accIm[c][r] = (RT_MM_REAL)0.0;                    \
+    } else {                                                            \
+        accRe[c][r] = RT_MM_Y(c,r).re;                                  \
+        accIm[c][r] = RT_MM_Y(c,r).im;                                  \
+    }
+#  define RT_MM_STORE(c,r)                                              \
+    if (j1 == n &&                                                      \
+        (accRe[c][r] != accRe[c][r] || accIm[c][r] != accIm[c][r])) {   \
+        RT_MM_CAT(RT_MM_FCN,Element)(&RT_MM_Y(c,r), A + i+(r),          \
+                                     B + (k+(c))*n, m, n);              \
+    } else {                                                            \
+        RT_MM_Y(c,r).re = accRe[c][r];                                  \
+        RT_MM_Y(c,r).im = accIm[c][r];                                  \
+    }
+# endif
+# if RT_MM_A_CPLX && RT_MM_B_CPLX
+#  define RT_MM_MAC(c,r,a,b) accRe[c][r] += (a).re*(b).re - (a).im*(b).im; \
+                             accIm[c][r] += (a).re*(b).im + (a).im*(b).re
+# elif RT_MM_A_CPLX
+#  define RT_MM_MAC(c,r,a,b) accRe[c][r] += (a).re*(b); \
+                             accIm[c][r] += (a).im*(b)
+# else
+#  define RT_MM_MAC(c,r,a,b) accRe[c][r] += (a)*(b).re; \
+                             accIm[c][r] += (a)*(b).im
+# endif
+
+/*
+ * Sum of A(i,:)*B(:,k) as in the reference loops, A pointing to A(i,0) and B
+ * to B(0,k).
+ */
+static void RT_MM_CAT(RT_MM_FCN,Element)(RT_MM_CREAL     *s,
+                                         const RT_MM_TA  *A,
+                                         const RT_MM_TB  *B,
+                                         int_T           m,
+                                         int_T           n)
+{
+  int_T j;
+  s->re = (RT_MM_REAL)0.0;
+  s->im = (RT_MM_REAL)0.0;
+  for(j=0; j<n; j++) {
+    RT_MM_CREAL c;
+    RT_MM_CREAL a1c;
+    RT_MM_CREAL b1c;
+#if RT_MM_A_CPLX
+    a1c = A[j*m];
+#else
+    a1c.re = A[j*m];
+    a1c.im = (RT_MM_REAL)0.0;
+#endif
+#if RT_MM_B_CPLX
+    b1c = B[j];
+#else
+    b1c.re = B[j];
+    b1c.im = (RT_MM_REAL)0.0;
+#endif
+    RT_MM_CTIMES(&c, a1c, b1c);
+    s->re += c.re;
+    s->im += c.im;
+  }
+}
+
+#endif
+
+/* y(i:i+MRB-1,k:k+NRB-1) (+)= A(i:i+MRB-1,j0:j1-1) * B(j0:j1-1,k:k+NRB-1) */
+#define RT_MM_TILE(MRB,NRB)                                             \
+  {                                                                     \
+    RT_MM_ACC_DECL                                                      \
+    int_T r, c, j;                                                      \
+    for(c=0; c<(NRB); c++) {                                            \
+      for(r=0; r<(MRB); r++) {                                          \
+        RT_MM_INIT(c,r);                                                \
+      }                                                                 \
+    }                                                                   \
+    for(j=j0; j<j1; j++) {                                              \
+      const RT_MM_TA *a = A + j*m + i;                                  \
+      const RT_MM_TB *b = B + k*n + j;                                  \
+      for(c=0; c<(NRB); c++) {                                          \
+        for(r=0; r<(MRB); r++) {                                        \
+          RT_MM_MAC(c,r,a[r],b[c*n]);                                   \
+        }                                                               \
+      }                                                                 \
+    }                                                                   \
+    for(c=0; c<(NRB); c++) {                                            \
+      for(r=0; r<(MRB); r++) {                                          \
+        RT_MM_STORE(c,r);                                               \
+      }                                                                 \
+    }                                                                   \
+  }
+
+/*
+ * Blocked y = A*B (or y += A*B).  Without RT_MM_INC the inner dimension is
+ * split into panels of RT_MATMULT_KC, y holding the partial sums in between;
+ * y += A*B adds complete sums to y, as the reference loops do.
+ */
+static void RT_MM_FCN(RT_MM_TY       *y,
+                      const RT_MM_TA *A,
+                      const RT_MM_TB *B,
+                      const int_T    dims[3])
+{
+  const int_T m = dims[0];
+  const int_T n = dims[1];
+  const int_T p = dims[2];
+#if RT_MM_INC
+  const int_T kc = n;
+#else
+  const int_T kc = RT_MATMULT_KC;
+#endif
+  int_T j0, i0, k, i;
+
+  for(j0=0; j0<n; j0+=kc) {
+    const int_T j1 = (n-j0 > kc) ? j0+kc : n;
+    for(i0=0; i0<m; i0+=RT_MATMULT_MC) {
+      const int_T i1 = (m-i0 > RT_MATMULT_MC) ? i0+RT_MATMULT_MC : m;
+      for(k=0; k<p; k+=RT_MATMULT_NR) {
+        const int_T nr = (p-k > RT_MATMULT_NR) ? RT_MATMULT_NR : p-k;
+        for(i=i0; i<i1; i+=RT_MATMULT_MR) {
+          const int_T mr = (i1-i > RT_MATMULT_MR) ? RT_MATMULT_MR : i1-i;
+          if (mr == RT_MATMULT_MR && nr == RT_MATMULT_NR) {
+            RT_MM_TILE(RT_MATMULT_MR,RT_MATMULT_NR)
+          } else {
+            RT_MM_TILE(mr,nr)
+          }
+        }
+      }
+    }
+  }
+}
+
+#undef RT_MM_TA
+#undef RT_MM_TB
+#undef RT_MM_TY
+#undef RT_MM_Y
+#undef RT_MM_ACC_DECL
+#undef RT_MM_INIT
+#undef RT_MM_STORE
+#undef RT_MM_MAC
+#undef RT_MM_TILE
+
+/* [EOF] rt_matmultblk.h */
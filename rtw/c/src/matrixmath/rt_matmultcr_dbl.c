@@ -10,6 +10,17 @@
 
 #include "rt_matrixlib.h"
 
+#ifdef CREAL_T
+#define RT_MM_FCN    rt_MatMultBlockedCR_Dbl
+#define RT_MM_REAL   real_T
+#define RT_MM_CREAL  creal_T
+#define RT_MM_CTIMES rt_ComplexTimes_Dbl
+#define RT_MM_A_CPLX 1
+#define RT_MM_B_CPLX 0
+#define RT_MM_INC    0
+#include "rt_matmultblk.h"
+#endif
+
 /*
  * Function: rt_MatMultCR_Dbl
  * Abstract:
@@ -24,6 +35,13 @@ void rt_MatMultCR_Dbl(creal_T       *y,
                       const int_T     dims[3])
 {
   int_T k;
+#ifdef RT_MATRIXLIB_USE_BLAS
+  if (rt_BlasMatMult_Dbl(y, A, B, dims, true, false, false)) return;
+#endif
+  if (RT_MATMULT_BLOCKED(dims)) {
+    rt_MatMultBlockedCR_Dbl(y, A, B, dims);
+    return;
+  }
   for(k=dims[2]; k-- > 0; ) {
     const creal_T *A1 = A;
     int_T i;
@@ -313,6 +313,320 @@ extern void rt_MatDivCC_Sgl(creal32_T       *Out,
                             const int_T      dims[3]);
 #endif
 
+/* Matrix division reusing the factorization of an unchanged In1 */
+extern void rt_MatDivRRCached_Dbl(real_T        *Out,
+                                  const real_T  *In1,
+                                  const real_T  *In2,
+                                  real_T        *lu,
+                                  int32_T       *piv,
+                                  real_T        *x,
+                                  const int_T    dims[3],
+                                  real_T        *In1Prev,
+                                  boolean_T     *luValid);
+
+#ifdef CREAL_T
+extern void rt_MatDivRCCached_Dbl(creal_T       *Out,
+                                  const real_T  *In1,
+                                  const creal_T *In2,
+                                  real_T        *lu,
+                                  int32_T       *piv,
+                                  creal_T       *x,
+                                  const int_T    dims[3],
+                                  real_T        *In1Prev,
+                                  boolean_T     *luValid);
+
+extern void rt_MatDivCRCached_Dbl(creal_T       *Out,
+                                  const creal_T *In1,
+                                  const real_T  *In2,
+                                  creal_T       *lu,
+                                  int32_T       *piv,
+                                  creal_T       *x,
+                                  const int_T    dims[3],
+                                  creal_T       *In1Prev,
+                                  boolean_T     *luValid);
+
+extern void rt_MatDivCCCached_Dbl(creal_T       *Out,
+                                  const creal_T *In1,
+                                  const creal_T *In2,
+                                  creal_T       *lu,
+                                  int32_T       *piv,
+                                  creal_T       *x,
+                                  const int_T    dims[3],
+                                  creal_T       *In1Prev,
+                                  boolean_T     *luValid);
+#endif
+
+extern void rt_MatDivRRCached_Sgl(real32_T        *Out,
+                                  const real32_T  *In1,
+                                  const real32_T  *In2,
+                                  real32_T        *lu,
+                                  int32_T         *piv,
+                                  real32_T        *x,
+                                  const int_T      dims[3],
+                                  real32_T        *In1Prev,
+                                  boolean_T       *luValid);
+
+#ifdef CREAL_T
+extern void rt_MatDivRCCached_Sgl(creal32_T       *Out,
+                                  const real32_T  *In1,
+                                  const creal32_T *In2,
+                                  real32_T        *lu,
+                                  int32_T         *piv,
+                                  creal32_T       *x,
+                                  const int_T      dims[3],
+                                  real32_T        *In1Prev,
+                                  boolean_T       *luValid);
+
+extern void rt_MatDivCRCached_Sgl(creal32_T       *Out,
+                                  const creal32_T *In1,
+                                  const real32_T  *In2,
+                                  creal32_T       *lu,
+                                  int32_T         *piv,
+                                  creal32_T       *x,
+                                  const int_T      dims[3],
+                                  creal32_T       *In1Prev,
+                                  boolean_T       *luValid);
+
+extern void rt_MatDivCCCached_Sgl(creal32_T       *Out,
+                                  const creal32_T *In1,
+                                  const creal32_T *In2,
+                                  creal32_T       *lu,
+                                  int32_T         *piv,
+                                  creal32_T       *x,
+                                  const int_T      dims[3],
+                                  creal32_T       *In1Prev,
+                                  boolean_T       *luValid);
+#endif
+
+
+/* Fixed-size kernels for small real matrices, see rt_matsmall.h */
+extern void rt_MatMult3RR_Dbl(real_T       *y,
+                              const real_T *A,
+                              const real_T *B,
+                              const int_T   P);
+
+extern void rt_MatDiv3RR_Dbl(real_T       *Out,
+                             const real_T *In1,
+                             const real_T *In2,
+                             const int_T   P);
+
+extern void rt_MatInv3R_Dbl(real_T       *Out,
+                            const real_T *In);
+
+extern void rt_MatMultBatch3RR_Dbl(real_T       *y,
+                                   const real_T *A,
+                                   const real_T *B,
+                                   const int_T   P,
+                                   const int_T   count);
+
+extern void rt_MatDivBatch3RR_Dbl(real_T       *Out,
+                                  const real_T *In1,
+                                  const real_T *In2,
+                                  const int_T   P,
+                                  const int_T   count);
+
+extern void rt_MatMult4RR_Dbl(real_T       *y,
+                              const real_T *A,
+                              const real_T *B,
+                              const int_T   P);
+
+extern void rt_MatDiv4RR_Dbl(real_T       *Out,
+                             const real_T *In1,
+                             const real_T *In2,
+                             const int_T   P);
+
+extern void rt_MatInv4R_Dbl(real_T       *Out,
+                            const real_T *In);
+
+extern void rt_MatMultBatch4RR_Dbl(real_T       *y,
+                                   const real_T *A,
+                                   const real_T *B,
+                                   const int_T   P,
+                                   const int_T   count);
+
+extern void rt_MatDivBatch4RR_Dbl(real_T       *Out,
+                                  const real_T *In1,
+                                  const real_T *In2,
+                                  const int_T   P,
+                                  const int_T   count);
+
+extern void rt_MatMult6RR_Dbl(real_T       *y,
+                              const real_T *A,
+                              const real_T *B,
+                              const int_T   P);
+
+extern void rt_MatDiv6RR_Dbl(real_T       *Out,
+                             const real_T *In1,
+                             const real_T *In2,
+                             const int_T   P);
+
+extern void rt_MatInv6R_Dbl(real_T       *Out,
+                            const real_T *In);
+
+extern void rt_MatMultBatch6RR_Dbl(real_T       *y,
+                                   const real_T *A,
+                                   const real_T *B,
+                                   const int_T   P,
+                                   const int_T   count);
+
+extern void rt_MatDivBatch6RR_Dbl(real_T       *Out,
+                                  const real_T *In1,
+                                  const real_T *In2,
+                                  const int_T   P,
+                                  const int_T   count);
+
+extern void rt_MatMult3RR_Sgl(real32_T       *y,
+                              const real32_T *A,
+                              const real32_T *B,
+                              const int_T     P);
+
+extern void rt_MatDiv3RR_Sgl(real32_T       *Out,
+                             const real32_T *In1,
+                             const real32_T *In2,
+                             const int_T     P);
+
+extern void rt_MatInv3R_Sgl(real32_T       *Out,
+                            const real32_T *In);
+
+extern void rt_MatMultBatch3RR_Sgl(real32_T       *y,
+                                   const real32_T *A,
+                                   const real32_T *B,
+                                   const int_T     P,
+                                   const int_T     count);
+
+extern void rt_MatDivBatch3RR_Sgl(real32_T       *Out,
+                                  const real32_T *In1,
+                                  const real32_T *In2,
+                                  const int_T     P,
+                                  const int_T     count);
+
+extern void rt_MatMult4RR_Sgl(real32_T       *y,
+                              const real32_T *A,
+                              const real32_T *B,
+                              const int_T     P);
+
+extern void rt_MatDiv4RR_Sgl(real32_T       *Out,
+                             const real32_T *In1,
+                             const real32_T *In2,
+                             const int_T     P);
+
+extern void rt_MatInv4R_Sgl(real32_T       *Out,
+                            const real32_T *In);
+
+extern void rt_MatMultBatch4RR_Sgl(real32_T       *y,
+                                   const real32_T *A,
+                                   const real32_T *B,
+                                   const int_T     P,
+                                   const int_T     count);
+
+extern void rt_MatDivBatch4RR_Sgl(real32_T       *Out,
+                                  const real32_T *In1,
+                                  const real32_T *In2,
+                                  const int_T     P,
+                                  const int_T     count);
+
+extern void rt_MatMult6RR_Sgl(real32_T       *y,
+                              const real32_T *A,
+                              const real32_T *B,
+                              const int_T     P);
+
+extern void rt_MatDiv6RR_Sgl(real32_T       *Out,
+                             const real32_T *In1,
+                             const real32_T *In2,
+                             const int_T     P);
+
+extern void rt_MatInv6R_Sgl(real32_T       *Out,
+                            const real32_T *In);
+
+extern void rt_MatMultBatch6RR_Sgl(real32_T       *y,
+                                   const real32_T *A,
+                                   const real32_T *B,
+                                   const int_T     P,
+                                   const int_T     count);
+
+extern void rt_MatDivBatch6RR_Sgl(real32_T       *Out,
+                                  const real32_T *In1,
+                                  const real32_T *In2,
+                                  const int_T     P,
+                                  const int_T     count);
+
+
+/* Optional BLAS/LAPACK backend, see rt_matrixlib_blas.c */
+#ifdef RT_MATRIXLIB_USE_BLAS
+
+#ifndef RT_MATRIXLIB_BLAS_MIN_DIM
+#define RT_MATRIXLIB_BLAS_MIN_DIM 64
+#endif
+
+extern boolean_T rt_MatrixLibUseBlas;
+extern int_T     rt_MatrixLibBlasMinDim;
+
+extern boolean_T rt_BlasMatMult_Dbl(void          *y,
+                                   const void    *A,
+                                   const void    *B,
+                                   const int_T   dims[3],
+                                   boolean_T     aCplx,
+                                   boolean_T     bCplx,
+                                   boolean_T     inc);
+
+extern boolean_T rt_BlasLU_Dbl(void        *A,
+                              const int_T N,
+                              int32_T     *piv,
+                              boolean_T   cplx);
+
+extern boolean_T rt_BlasForwardSub_Dbl(const void    *L,
+                                      const void    *b,
+                                      void          *x,
+                                      int_T         N,
+                                      int_T         P,
+                                      const int32_T *piv,
+                                      boolean_T     unitLower,
+                                      boolean_T     lCplx,
+                                      boolean_T     bCplx);
+
+extern boolean_T rt_BlasBackwardSub_Dbl(const void    *pU,
+                                       const void    *pb,
+                                       void          *x,
+                                       int_T         N,
+                                       int_T         P,
+                                       boolean_T     unitUpper,
+                                       boolean_T     uCplx,
+                                       boolean_T     bCplx);
+
+extern boolean_T rt_BlasMatMult_Sgl(void          *y,
+                                   const void    *A,
+                                   const void    *B,
+                                   const int_T   dims[3],
+                                   boolean_T     aCplx,
+                                   boolean_T     bCplx,
+                                   boolean_T     inc);
+
+extern boolean_T rt_BlasLU_Sgl(void        *A,
+                              const int_T N,
+                              int32_T     *piv,
+                              boolean_T   cplx);
+
+extern boolean_T rt_BlasForwardSub_Sgl(const void    *L,
+                                      const void    *b,
+                                      void          *x,
+                                      int_T         N,
+                                      int_T         P,
+                                      const int32_T *piv,
+                                      boolean_T     unitLower,
+                                      boolean_T     lCplx,
+                                      boolean_T     bCplx);
+
+extern boolean_T rt_BlasBackwardSub_Sgl(const void    *pU,
+                                       const void    *pb,
+                                       void          *x,
+                                       int_T         N,
+                                       int_T         P,
+                                       boolean_T     unitUpper,
+                                       boolean_T     uCplx,
+                                       boolean_T     bCplx);
+
+#endif /* RT_MATRIXLIB_USE_BLAS */
+
 
 /* Matrix multiplication defines */
 
@@ -322,6 +636,24 @@ extern void rt_MatDivCC_Sgl(creal32_T       *Out,
 /* Quick (approximate) complex absolute value for singles: */
 #define CQABSSGL(X) (real32_T)(fabs( (real_T) (X).re) + fabs( (real_T) (X).im)) 
 
+/* LU factorization defines */
+
+/* rt_lu_* factor matrices of order RT_LU_MIN_BLOCKED and more in panels of
+ * RT_LU_NB columns, updating the trailing matrix on RT_LU_MR x RT_LU_NR
+ * register tiles: */
+#ifndef RT_LU_NB
+#define RT_LU_NB 32
+#endif
+#ifndef RT_LU_MIN_BLOCKED
+#define RT_LU_MIN_BLOCKED 64
+#endif
+#ifndef RT_LU_MR
+#define RT_LU_MR 8
+#endif
+#ifndef RT_LU_NR
+#define RT_LU_NR 4
+#endif
+
 #ifdef CREAL_T
 extern void rt_ComplexTimes_Dbl(creal_T       *Out,
                                 const creal_T In1,
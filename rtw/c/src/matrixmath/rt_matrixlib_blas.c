@@ -0,0 +1,150 @@
+/* Copyright 2016 The MathWorks, Inc.
+ *
+ * File: rt_matrixlib_blas.c
+ *
+ * Abstract:
+ *      Optional BLAS/LAPACK backend of the matrix library.  When the
+ *      library is compiled with -DRT_MATRIXLIB_USE_BLAS, rt_MatMult*,
+ *      rt_MatMultAndInc*, rt_lu_*, rt_ForwardSubstitution* and
+ *      rt_BackwardSubstitution* first offer their operands to the functions
+ *      here, which call xGEMM, xGETRF and xTRSM.  Operands below the
+ *      threshold rt_MatrixLibBlasMinDim (RT_MATRIXLIB_BLAS_MIN_DIM by
+ *      default) are declined and the portable C code runs as before.
+ *      Setting rt_MatrixLibUseBlas to false at run time declines all of
+ *      them.
+ *
+ *      The model must then be linked with a BLAS and LAPACK, e.g.
+ *      -lopenblas.  The prototypes are those of extern/include/blas.h, with
+ *      ptrdiff_t integers.  For a library built with 32-bit integers, such
+ *      as the default OpenBLAS, compile with -DRT_BLAS_INT=int.
+ *
+ *      rt_lu_* through xGETRF let it pivot in the caller's vector when
+ *      RT_BLAS_INT is 32 bits, and in a stack buffer of
+ *      RT_BLAS_LU_STACK_PIVOTS integers otherwise.  Larger matrices then
+ *      allocate a pivot vector of N integers.
+ */
+
+#include "rt_matrixlib.h"
+
+#ifdef RT_MATRIXLIB_USE_BLAS
+
+#include <stdlib.h>   /* needed for malloc, free */
+#include <string.h>   /* needed for memmove */
+#include <stddef.h>   /* needed for ptrdiff_t */
+
+#ifdef RT_BLAS_INT
+
+/* The routines of extern/include/blas.h with RT_BLAS_INT integers */
+# if defined(_WIN32) || defined(__hpux)
+#  define FORTRAN_WRAPPER(x) x
+# else
+#  define FORTRAN_WRAPPER(x) x ## _
+# endif
+
+# define dgemm FORTRAN_WRAPPER(dgemm)
+# define sgemm FORTRAN_WRAPPER(sgemm)
+# define zgemm FORTRAN_WRAPPER(zgemm)
+# define cgemm FORTRAN_WRAPPER(cgemm)
+# define dtrsm FORTRAN_WRAPPER(dtrsm)
+# define strsm FORTRAN_WRAPPER(strsm)
+# define ztrsm FORTRAN_WRAPPER(ztrsm)
+# define ctrsm FORTRAN_WRAPPER(ctrsm)
+
+# define RT_BLAS_GEMM_PROTO(f, T)                                       \
+  extern void f(const char *transa, const char *transb,                 \
+                const RT_BLAS_INT *m, const RT_BLAS_INT *n,             \
+                const RT_BLAS_INT *k, const T *alpha,                   \
+                const T *a, const RT_BLAS_INT *lda,                     \
+                const T *b, const RT_BLAS_INT *ldb,                     \
+                const T *beta, T *c, const RT_BLAS_INT *ldc)
+# define RT_BLAS_TRSM_PROTO(f, T)                                       \
+  extern void f(const char *side, const char *uplo,                     \
+                const char *transa, const char *diag,                   \
+                const RT_BLAS_INT *m, const RT_BLAS_INT *n,             \
+                const T *alpha, const T *a, const RT_BLAS_INT *lda,     \
+                T *b, const RT_BLAS_INT *ldb)
+
+RT_BLAS_GEMM_PROTO(dgemm, double);
+RT_BLAS_GEMM_PROTO(sgemm, float);
+RT_BLAS_GEMM_PROTO(zgemm, double);
+RT_BLAS_GEMM_PROTO(cgemm, float);
+RT_BLAS_TRSM_PROTO(dtrsm, double);
+RT_BLAS_TRSM_PROTO(strsm, float);
+RT_BLAS_TRSM_PROTO(ztrsm, double);
+RT_BLAS_TRSM_PROTO(ctrsm, float);
+
+#else
+
+# include "blas.h"
+# define RT_BLAS_INT ptrdiff_t
+
+#endif
+
+/* LAPACK LU factorization, not in blas.h */
+#define dgetrf FORTRAN_WRAPPER(dgetrf)
+#define sgetrf FORTRAN_WRAPPER(sgetrf)
+#define zgetrf FORTRAN_WRAPPER(zgetrf)
+#define cgetrf FORTRAN_WRAPPER(cgetrf)
+
+#define RT_LAPACK_GETRF_PROTO(f, T)                                     \
+  extern void f(const RT_BLAS_INT *m, const RT_BLAS_INT *n, T *a,       \
+                const RT_BLAS_INT *lda, RT_BLAS_INT *ipiv,              \
+                RT_BLAS_INT *info)
+
+RT_LAPACK_GETRF_PROTO(dgetrf, double);
+RT_LAPACK_GETRF_PROTO(sgetrf, float);
+RT_LAPACK_GETRF_PROTO(zgetrf, double);
+RT_LAPACK_GETRF_PROTO(cgetrf, float);
+
+
+/* Use the BLAS? Set before the model starts, or between steps. */
+boolean_T rt_MatrixLibUseBlas    = true;
+int_T     rt_MatrixLibBlasMinDim = RT_MATRIXLIB_BLAS_MIN_DIM;
+
+/*
+ * A product or solve of m x n by n x p operands goes to the BLAS when it
+ * takes at least as many operations as one of rt_MatrixLibBlasMinDim cubed.
+ */
+static boolean_T rt_BlasWorthIt(int_T m, int_T n, int_T p)
+{
+  const real_T d = (real_T)rt_MatrixLibBlasMinDim;
+  return(rt_MatrixLibUseBlas && m > 0 && n > 0 && p > 0 &&
+         (real_T)m * (real_T)n * (real_T)p >= d*d*d);
+}
+
+/* Pivots of xGETRF kept on the stack when RT_BLAS_INT is not 32 bits */
+#ifndef RT_BLAS_LU_STACK_PIVOTS
+#define RT_BLAS_LU_STACK_PIVOTS 256
+#endif
+
+#define RT_BD_REAL   real_T
+#define RT_BD_SFX    _Dbl
+#define RT_BD_GEMM   dgemm
+#define RT_BD_CGEMM  zgemm
+#define RT_BD_TRSM   dtrsm
+#define RT_BD_CTRSM  ztrsm
+#define RT_BD_GETRF  dgetrf
+#define RT_BD_CGETRF zgetrf
+#include "rt_blasdispatch.h"
+#undef RT_BD_REAL
+#undef RT_BD_SFX
+#undef RT_BD_GEMM
+#undef RT_BD_CGEMM
+#undef RT_BD_TRSM
+#undef RT_BD_CTRSM
+#undef RT_BD_GETRF
+#undef RT_BD_CGETRF
+
+#define RT_BD_REAL   real32_T
+#define RT_BD_SFX    _Sgl
+#define RT_BD_GEMM   sgemm
+#define RT_BD_CGEMM  cgemm
+#define RT_BD_TRSM   strsm
+#define RT_BD_CTRSM  ctrsm
+#define RT_BD_GETRF  sgetrf
+#define RT_BD_CGETRF cgetrf
+#include "rt_blasdispatch.h"
+
+#endif /* RT_MATRIXLIB_USE_BLAS */
+
+/* [EOF] rt_matrixlib_blas.c */
@@ -0,0 +1,348 @@
+/* Copyright 2016 The MathWorks, Inc.
+ *
+ * File: rt_matsmall.h
+ *
+ * Abstract:
+ *      Fixed-size kernels for small real matrices, e.g. 3x3 rotations and
+ *      6x6 rigid-body matrices.  Each of rt_matsmall_dbl.c and
+ *      rt_matsmall_sgl.c defines
+ *
+ *        RT_MS_REAL  real_T or real32_T
+ *        RT_MS_ABS   absolute value of an RT_MS_REAL
+ *        RT_MS_SFX   _Dbl or _Sgl
+ *        RT_MS_N     order of the matrices
+ *
+ *      and includes this file once per order, which defines
+ *
+ *        rt_MatMult<N>RR<SFX>       y = A*B, A NxN and B NxP
+ *        rt_MatDiv<N>RR<SFX>        Out = inv(In1)*In2, In1 NxN, In2 NxP
+ *        rt_MatInv<N>R<SFX>         Out = inv(In)
+ *        rt_MatMultBatch<N>RR<SFX>  count independent rt_MatMult<N>RR
+ *        rt_MatDivBatch<N>RR<SFX>   count independent rt_MatDiv<N>RR
+ *
+ *      All loops over rows and columns have the constant trip count N, so
+ *      the compiler unrolls them completely.  The results are the same as
+ *      those of rt_MatMultRR_* and rt_MatDivRR_*: the sums are formed in the
+ *      same order, and divides factor In1 as rt_lu_real does.
+ *
+ *      The batched kernels take the problems interleaved, element (r,c) of
+ *      problem l at X[(r + c*N)*count + l], and work on RT_MATSMALL_LANES
+ *      problems at a time with the problem index innermost, so that the
+ *      arithmetic vectorizes across matrices.
+ */
+
+#ifndef rt_matsmall_h
+#define rt_matsmall_h
+
+/* Problems handled together by the batched kernels */
+#ifndef RT_MATSMALL_LANES
+# define RT_MATSMALL_LANES 16
+#endif
+
+#define RT_MS_CAT4X(a,b,c,d) a##b##c##d
+#define RT_MS_CAT4(a,b,c,d)  RT_MS_CAT4X(a,b,c,d)
+#define RT_MS_NAME(pre,post) RT_MS_CAT4(pre,RT_MS_N,post,RT_MS_SFX)
+
+#endif /* rt_matsmall_h */
+
+
+#define RT_MS_NN (RT_MS_N*RT_MS_N)
+
+/* Function: rt_MatMult<N>RR ===================================================
+ * Abstract:
+ *      y = A*B, A NxN and B NxP
+ */
+void RT_MS_NAME(rt_MatMult,RR)(RT_MS_REAL       *y,
+                               const RT_MS_REAL *A,
+                               const RT_MS_REAL *B,
+                               const int_T      P)
+{
+  int_T i, j, k;
+  for (k = 0; k < P; k++) {
+    const RT_MS_REAL *b = B + k*RT_MS_N;
+    for (i = 0; i < RT_MS_N; i++) {
+      RT_MS_REAL acc = (RT_MS_REAL)0.0;
+      for (j = 0; j < RT_MS_N; j++) {
+        acc += A[i+j*RT_MS_N] * b[j];
+      }
+      y[i+k*RT_MS_N] = acc;
+    }
+  }
+}
+
+/* Function: rt_MatDiv<N>RR ====================================================
+ * Abstract:
+ *      Out = inv(In1)*In2, In1 NxN and In2 NxP, by LU factorization with
+ *      partial pivoting.  Out must not overlap In2.
+ */
+void RT_MS_NAME(rt_MatDiv,RR)(RT_MS_REAL       *Out,
+                              const RT_MS_REAL *In1,
+                              const RT_MS_REAL *In2,
+                              const int_T      P)
+{
+  RT_MS_REAL lu[RT_MS_NN];
+  int32_T    piv[RT_MS_N];
+  int_T i, j, k;
+
+  for (i = 0; i < RT_MS_NN; i++) {
+    lu[i] = In1[i];
+  }
+  for (i = 0; i < RT_MS_N; i++) {
+    piv[i] = i;
+  }
+
+  /* LU factorization, as in rt_lu_real */
+  for (k = 0; k < RT_MS_N; k++) {
+    RT_MS_REAL Amax = RT_MS_ABS(lu[k+k*RT_MS_N]);
+    RT_MS_REAL Adiag;
+    int_T p = k;
+    for (i = k+1; i < RT_MS_N; i++) {
+      RT_MS_REAL q = RT_MS_ABS(lu[i+k*RT_MS_N]);
+      if (q > Amax) {p = i; Amax = q;}
+    }
+    if (p != k) {
+      int32_T t1;
+      for (j = 0; j < RT_MS_N; j++) {
+        RT_MS_REAL t = lu[p+j*RT_MS_N];
+        lu[p+j*RT_MS_N] = lu[k+j*RT_MS_N];
+        lu[k+j*RT_MS_N] = t;
+      }
+      t1 = piv[p]; piv[p] = piv[k]; piv[k] = t1;
+    }
+    Adiag = lu[k+k*RT_MS_N];
+    if (Adiag != (RT_MS_REAL)0.0) {
+      Adiag = (RT_MS_REAL)1.0/Adiag;
+      for (i = k+1; i < RT_MS_N; i++) {
+        lu[i+k*RT_MS_N] *= Adiag;
+      }
+      for (j = k+1; j < RT_MS_N; j++) {
+        for (i = k+1; i < RT_MS_N; i++) {
+          lu[i+j*RT_MS_N] -= lu[i+k*RT_MS_N]*lu[k+j*RT_MS_N];
+        }
+      }
+    }
+  }
+
+  for (k = 0; k < P; k++) {
+    const RT_MS_REAL *b = In2 + k*RT_MS_N;
+    RT_MS_REAL       *x = Out + k*RT_MS_N;
+
+    /* Forward substitution with the unit lower triangle */
+    for (i = 0; i < RT_MS_N; i++) {
+      RT_MS_REAL s = (RT_MS_REAL)0.0;
+      for (j = 0; j < i; j++) {
+        s += lu[i+j*RT_MS_N] * x[j];
+      }
+      x[i] = b[piv[i]] - s;
+    }
+
+    /* Backward substitution with the upper triangle */
+    for (i = RT_MS_N-1; i >= 0; i--) {
+      RT_MS_REAL s = (RT_MS_REAL)0.0;
+      for (j = RT_MS_N-1; j > i; j--) {
+        s += lu[i+j*RT_MS_N] * x[j];
+      }
+      x[i] = (x[i] - s) / lu[i+i*RT_MS_N];
+    }
+  }
+}
+
+/* Function: rt_MatInv<N>R =====================================================
+ * Abstract:
+ *      Out = inv(In), In NxN.  Out must not overlap In.
+ */
+void RT_MS_NAME(rt_MatInv,R)(RT_MS_REAL       *Out,
+                             const RT_MS_REAL *In)
+{
+  RT_MS_REAL eye[RT_MS_NN];
+  int_T i;
+  for (i = 0; i < RT_MS_NN; i++) {
+    eye[i] = (i % (RT_MS_N+1) == 0) ? (RT_MS_REAL)1.0 : (RT_MS_REAL)0.0;
+  }
+  RT_MS_NAME(rt_MatDiv,RR)(Out, In, eye, RT_MS_N);
+}
+
+/* y(:,:,l0:l0+NL-1) = A(:,:,l0:l0+NL-1) * B(:,:,l0:l0+NL-1) */
+#define RT_MS_MULT_GROUP(NL)                                            \
+  {                                                                     \
+    int_T i, j, k, l;                                                   \
+    for (k = 0; k < P; k++) {                                           \
+      for (i = 0; i < RT_MS_N; i++) {                                   \
+        RT_MS_REAL acc[RT_MATSMALL_LANES];                              \
+        RT_MS_REAL *yl = y + (i+k*RT_MS_N)*count + l0;                  \
+        for (l = 0; l < (NL); l++) {                                    \
+          acc[l] = (RT_MS_REAL)0.0;                                     \
+        }                                                               \
+        for (j = 0; j < RT_MS_N; j++) {                                 \
+          const RT_MS_REAL *al = A + (i+j*RT_MS_N)*count + l0;          \
+          const RT_MS_REAL *bl = B + (j+k*RT_MS_N)*count + l0;          \
+          for (l = 0; l < (NL); l++) {                                  \
+            acc[l] += al[l] * bl[l];                                    \
+          }                                                             \
+        }                                                               \
+        for (l = 0; l < (NL); l++) {                                    \
+          yl[l] = acc[l];                                               \
+        }                                                               \
+      }                                                                 \
+    }                                                                   \
+  }
+
+/* Function: rt_MatMultBatch<N>RR ==============================================
+ * Abstract:
+ *      count independent y = A*B, A NxN and B NxP, interleaved.
+ */
+void RT_MS_NAME(rt_MatMultBatch,RR)(RT_MS_REAL       *y,
+                                    const RT_MS_REAL *A,
+                                    const RT_MS_REAL *B,
+                                    const int_T      P,
+                                    const int_T      count)
+{
+  int_T l0;
+  for (l0 = 0; l0 + RT_MATSMALL_LANES <= count; l0 += RT_MATSMALL_LANES) {
+    RT_MS_MULT_GROUP(RT_MATSMALL_LANES)
+  }
+  if (l0 < count) {
+    const int_T nl = count - l0;
+    RT_MS_MULT_GROUP(nl)
+  }
+}
+
+/* Function: rt_MatDivBatch<N>RR ===============================================
+ * Abstract:
+ *      count independent Out = inv(In1)*In2, In1 NxN and In2 NxP,
+ *      interleaved.  Each problem is pivoted on its own; the eliminations
+ *      and substitutions run across the problems, on local copies padded
+ *      to RT_MATSMALL_LANES problems with identity matrices.  A zero pivot
+ *      skips its elimination step as in rt_lu_real.
+ */
+void RT_MS_NAME(rt_MatDivBatch,RR)(RT_MS_REAL       *Out,
+                                   const RT_MS_REAL *In1,
+                                   const RT_MS_REAL *In2,
+                                   const int_T      P,
+                                   const int_T      count)
+{
+  int_T l0;
+  for (l0 = 0; l0 < count; l0 += RT_MATSMALL_LANES) {
+    const int_T nl = (count-l0 > RT_MATSMALL_LANES) ? RT_MATSMALL_LANES :
+                                                      count-l0;
+    RT_MS_REAL lu[RT_MS_NN][RT_MATSMALL_LANES];
+    RT_MS_REAL x[RT_MS_N][RT_MATSMALL_LANES];
+    RT_MS_REAL rdiag[RT_MATSMALL_LANES];
+    int32_T    piv[RT_MS_N][RT_MATSMALL_LANES];
+    int_T i, j, k, l;
+
+    for (i = 0; i < RT_MS_NN; i++) {
+      const RT_MS_REAL *al = In1 + i*count + l0;
+      for (l = 0; l < nl; l++) {
+        lu[i][l] = al[l];
+      }
+      for (; l < RT_MATSMALL_LANES; l++) {
+        lu[i][l] = (i % (RT_MS_N+1) == 0) ? (RT_MS_REAL)1.0 :
+                                            (RT_MS_REAL)0.0;
+      }
+    }
+    for (i = 0; i < RT_MS_N; i++) {
+      for (l = 0; l < RT_MATSMALL_LANES; l++) {
+        piv[i][l] = i;
+      }
+    }
+
+    for (k = 0; k < RT_MS_N; k++) {
+      /* Pivot each problem */
+      for (l = 0; l < RT_MATSMALL_LANES; l++) {
+        RT_MS_REAL Amax = RT_MS_ABS(lu[k+k*RT_MS_N][l]);
+        int_T p = k;
+        for (i = k+1; i < RT_MS_N; i++) {
+          RT_MS_REAL q = RT_MS_ABS(lu[i+k*RT_MS_N][l]);
+          if (q > Amax) {p = i; Amax = q;}
+        }
+        if (p != k) {
+          int32_T t1;
+          for (j = 0; j < RT_MS_N; j++) {
+            RT_MS_REAL t = lu[p+j*RT_MS_N][l];
+            lu[p+j*RT_MS_N][l] = lu[k+j*RT_MS_N][l];
+            lu[k+j*RT_MS_N][l] = t;
+          }
+          t1 = piv[p][l]; piv[p][l] = piv[k][l]; piv[k][l] = t1;
+        }
+      }
+
+      /* Eliminate across the problems */
+      for (l = 0; l < RT_MATSMALL_LANES; l++) {
+        rdiag[l] = (lu[k+k*RT_MS_N][l] != (RT_MS_REAL)0.0) ?
+            (RT_MS_REAL)1.0/lu[k+k*RT_MS_N][l] : (RT_MS_REAL)0.0;
+      }
+      for (i = k+1; i < RT_MS_N; i++) {
+        for (l = 0; l < RT_MATSMALL_LANES; l++) {
+          lu[i+k*RT_MS_N][l] = (rdiag[l] != (RT_MS_REAL)0.0) ?
+              lu[i+k*RT_MS_N][l]*rdiag[l] : lu[i+k*RT_MS_N][l];
+        }
+      }
+      for (j = k+1; j < RT_MS_N; j++) {
+        for (i = k+1; i < RT_MS_N; i++) {
+          for (l = 0; l < RT_MATSMALL_LANES; l++) {
+            lu[i+j*RT_MS_N][l] -= (rdiag[l] != (RT_MS_REAL)0.0) ?
+                lu[i+k*RT_MS_N][l]*lu[k+j*RT_MS_N][l] : (RT_MS_REAL)0.0;
+          }
+        }
+      }
+    }
+
+    for (k = 0; k < P; k++) {
+      const RT_MS_REAL *b = In2 + k*RT_MS_N*count + l0;
+      RT_MS_REAL       *o = Out + k*RT_MS_N*count + l0;
+
+      for (i = 0; i < RT_MS_N; i++) {
+        for (l = 0; l < nl; l++) {
+          x[i][l] = b[piv[i][l]*count + l];
+        }
+        for (; l < RT_MATSMALL_LANES; l++) {
+          x[i][l] = (RT_MS_REAL)0.0;
+        }
+      }
+
+      /* Forward substitution with the unit lower triangle */
+      for (i = 0; i < RT_MS_N; i++) {
+        RT_MS_REAL s[RT_MATSMALL_LANES];
+        for (l = 0; l < RT_MATSMALL_LANES; l++) {
+          s[l] = (RT_MS_REAL)0.0;
+        }
+        for (j = 0; j < i; j++) {
+          for (l = 0; l < RT_MATSMALL_LANES; l++) {
+            s[l] += lu[i+j*RT_MS_N][l] * x[j][l];
+          }
+        }
+        for (l = 0; l < RT_MATSMALL_LANES; l++) {
+          x[i][l] -= s[l];
+        }
+      }
+
+      /* Backward substitution with the upper triangle */
+      for (i = RT_MS_N-1; i >= 0; i--) {
+        RT_MS_REAL s[RT_MATSMALL_LANES];
+        for (l = 0; l < RT_MATSMALL_LANES; l++) {
+          s[l] = (RT_MS_REAL)0.0;
+        }
+        for (j = RT_MS_N-1; j > i; j--) {
+          for (l = 0; l < RT_MATSMALL_LANES; l++) {
+            s[l] += lu[i+j*RT_MS_N][l] * x[j][l];
+          }
+        }
+        for (l = 0; l < RT_MATSMALL_LANES; l++) {
+          x[i][l] = (x[i][l] - s[l]) / lu[i+i*RT_MS_N][l];
+        }
+      }
+
+      for (i = 0; i < RT_MS_N; i++) {
+        for (l = 0; l < nl; l++) {
+          o[i*count + l] = x[i][l];
+        }
+      }
+    }
+  }
+}
+
+#undef RT_MS_NN
+#undef RT_MS_MULT_GROUP
+
+/* [EOF] rt_matsmall.h */
@@ -0,0 +1,31 @@
+/* Copyright 2016 The MathWorks, Inc.
+ *
+ * File: rt_matsmall_dbl.c
+ *
+ * Abstract:
+ *      Simulink Coder support routines for multiplication, division and
+ *      inversion of small real double precision float matrices of fixed
+ *      order, see rt_matsmall.h
+ *
+ */
+
+#include <math.h>
+#include "rt_matrixlib.h"
+
+#define RT_MS_REAL   real_T
+#define RT_MS_ABS(x) fabs(x)
+#define RT_MS_SFX    _Dbl
+
+#define RT_MS_N 3
+#include "rt_matsmall.h"
+#undef RT_MS_N
+
+#define RT_MS_N 4
+#include "rt_matsmall.h"
+#undef RT_MS_N
+
+#define RT_MS_N 6
+#include "rt_matsmall.h"
+#undef RT_MS_N
+
+/* [EOF] rt_matsmall_dbl.c */
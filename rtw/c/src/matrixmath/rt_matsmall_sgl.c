@@ -0,0 +1,31 @@
+/* Copyright 2016 The MathWorks, Inc.
+ *
+ * File: rt_matsmall_sgl.c
+ *
+ * Abstract:
+ *      Simulink Coder support routines for multiplication, division and
+ *      inversion of small real single precision float matrices of fixed
+ *      order, see rt_matsmall.h
+ *
+ */
+
+#include <math.h>
+#include "rt_matrixlib.h"
+
+#define RT_MS_REAL   real32_T
+#define RT_MS_ABS(x) ((real32_T) fabs( (real_T)(x) ))
+#define RT_MS_SFX    _Sgl
+
+#define RT_MS_N 3
+#include "rt_matsmall.h"
+#undef RT_MS_N
+
+#define RT_MS_N 4
+#include "rt_matsmall.h"
+#undef RT_MS_N
+
+#define RT_MS_N 6
+#include "rt_matsmall.h"
+#undef RT_MS_N
+
+/* [EOF] rt_matsmall_sgl.c */
@@ -0,0 +1,266 @@
+/* Copyright 2016 The MathWorks, Inc.
+ *
+ * File: rt_substblk.h
+ *
+ * Abstract:
+ *      Kernel solving a triangular system for several right-hand sides at
+ *      once, for the rt_ForwardSubstitution* and rt_BackwardSubstitution*
+ *      support routines.  Each of their sources defines
+ *
+ *        RT_SB_FCN      name of the static kernel
+ *        RT_SB_REAL     real_T or real32_T
+ *        RT_SB_CREAL    creal_T or creal32_T, for complex operands
+ *        RT_SB_CTIMES   rt_ComplexTimes_Dbl or _Sgl, for complex operands
+ *        RT_SB_CRDIVIDE rt_ComplexRDivide_Dbl or _Sgl, for complex operands
+ *        RT_SB_T_CPLX   1 if the triangular matrix is complex, else 0
+ *        RT_SB_B_CPLX   1 if the right-hand side is complex, else 0
+ *        RT_SB_UPPER    1 to solve Ux=b, 0 to solve Lx=b(piv,:)
+ *
+ *      and then includes this file.  The kernel is used when there is more
+ *      than one right-hand side, see RT_SUBST_BLOCKED.
+ *
+ *      The reference loops read the whole triangle once per column of b,
+ *      along its rows.  The kernel reads it once per RT_SUBST_NB columns,
+ *      mostly along its columns.  Each element of x is still summed in the
+ *      same order, so real results are identical to those of the reference
+ *      loops.  Complex products in the tiles skip the zero tests of
+ *      rt_ComplexTimes_*; the sums that come out NaN are recomputed with it.
+ */
+
+#ifndef rt_substblk_h
+#define rt_substblk_h
+
+/* Rows x columns of x in a tile */
+#ifndef RT_SUBST_MR
+# define RT_SUBST_MR 4
+#endif
+#ifndef RT_SUBST_NB
+# define RT_SUBST_NB 8
+#endif
+
+#ifdef RT_SUBST_NO_BLOCKING
+# define RT_SUBST_BLOCKED(P) 0
+#else
+# define RT_SUBST_BLOCKED(P) ((P) > 1)
+#endif
+
+#define RT_SB_CAT2(a,b) a##b
+#define RT_SB_CAT(a,b)  RT_SB_CAT2(a,b)
+
+#endif /* rt_substblk_h */
+
+
+#if RT_SB_T_CPLX
+# define RT_SB_TT RT_SB_CREAL
+#else
+# define RT_SB_TT RT_SB_REAL
+#endif
+#if RT_SB_B_CPLX
+# define RT_SB_TB RT_SB_CREAL
+#else
+# define RT_SB_TB RT_SB_REAL
+#endif
+
+#if !RT_SB_T_CPLX && !RT_SB_B_CPLX
+
+# define RT_SB_TX RT_SB_REAL
+# define RT_SB_ZERO(s) (s) = (RT_SB_REAL)0.0
+# define RT_SB_MAC(s,t,xv) (s) += (t) * (xv)
+# define RT_SB_MAC_FAST(s,t,xv) RT_SB_MAC(s,t,xv)
+# define RT_SB_FINISH(xi,bv,s,d)                                        \
+    if (unit) {                                                         \
+      *(xi) = (bv) - (s);                                               \
+    } else {                                                            \
+      *(xi) = ((bv) - (s)) / (d);                                       \
+    }
+
+#else
+
+# define RT_SB_TX RT_SB_CREAL
+# define RT_SB_ZERO(s) (s).re = (s).im = (RT_SB_REAL)0.0
+# if RT_SB_T_CPLX
+#  define RT_SB_TOCPLX(ct,t) (ct) = (t)
+# else
+#  define RT_SB_TOCPLX(ct,t) (ct).re = (t); (ct).im = (RT_SB_REAL)0.0
+# endif
+# define RT_SB_MAC(s,t,xv)                                              \
+    {                                                                   \
+      RT_SB_CREAL ct;                                                   \
+      RT_SB_CREAL p;                                                    \
+      RT_SB_TOCPLX(ct,t);                                               \
+      RT_SB_CTIMES(&p, ct, xv);                                         \
+      (s).re += p.re;                                                   \
+      (s).im += p.im;                                                   \
+    }
+/* s += t*xv without the zero tests of RT_SB_CTIMES.  Products that differ
+ * from it are zeros of the other sign, which do not change a sum that
+ * starts at +0, or NaN, so only sums that come out NaN differ. */
+# if RT_SB_T_CPLX
+#  define RT_SB_MAC_FAST(s,t,xv)                                        \
+    (s).re += (t).re*(xv).re - (t).im*(xv).im;                          \
+    (s).im += (t).re*(xv).im + (t).im*(xv).re
+# else
+#  define RT_SB_MAC_FAST(s,t,xv)                                        \
+    (s).re += (t)*(xv).re;                                              \
+    (s).im += (t)*(xv).im
+# endif
+# if RT_SB_B_CPLX
+#  define RT_SB_DIFF(cdiff,bv,s) (cdiff).re = (bv).re - (s).re;         \
+                                 (cdiff).im = (bv).im - (s).im
+# else
+#  define RT_SB_DIFF(cdiff,bv,s) (cdiff).re = (bv) - (s).re;            \
+                                 (cdiff).im = -(s).im
+# endif
+# define RT_SB_FINISH(xi,bv,s,d)                                        \
+    {                                                                   \
+      RT_SB_CREAL cdiff;                                                \
+      RT_SB_DIFF(cdiff,bv,s);                                           \
+      if (unit) {                                                       \
+        *(xi) = cdiff;                                                  \
+      } else {                                                          \
+        RT_SB_CREAL cT;                                                 \
+        RT_SB_TOCPLX(cT,d);                                             \
+        RT_SB_CRDIVIDE(xi, cdiff, cT);                                  \
+      }                                                                 \
+    }
+
+#endif
+
+#if RT_SB_T_CPLX || RT_SB_B_CPLX
+/*
+ * Sum of T(i,j)*x(j) over the rows j solved before row i, as in the
+ * reference loops, x pointing to a column of x.
+ */
+static void RT_SB_CAT(RT_SB_FCN,Sum)(RT_SB_CREAL    *s,
+                                     const RT_SB_TT *T,
+                                     const RT_SB_TX *x,
+                                     int_T          N,
+                                     int_T          i)
+{
+  int_T j;
+  RT_SB_ZERO(*s);
+#if RT_SB_UPPER
+  for (j = N-1; j > i; j--)
+#else
+  for (j = 0; j < i; j++)
+#endif
+  {
+    RT_SB_MAC(*s, T[i + j*N], x[j]);
+  }
+}
+#endif
+
+/* s(0:MRB-1,0:NBB-1) = sums over the rows solved before rows i0 to i0+MRB-1 */
+#if RT_SB_UPPER
+# define RT_SB_SOLVED_RANGE for (j = N-1; j >= i0+mr; j--)
+#else
+# define RT_SB_SOLVED_RANGE for (j = 0; j < i0; j++)
+#endif
+#define RT_SB_SOLVED(MRB,NBB)                                           \
+  {                                                                     \
+    for (c = 0; c < (NBB); c++) {                                       \
+      for (r = 0; r < (MRB); r++) {                                     \
+        RT_SB_ZERO(s[c][r]);                                            \
+      }                                                                 \
+    }                                                                   \
+    RT_SB_SOLVED_RANGE {                                                \
+      const RT_SB_TT *t = T + i0 + j*N;                                 \
+      for (c = 0; c < (NBB); c++) {                                     \
+        const RT_SB_TX xv = xk[j + c*N];                                \
+        for (r = 0; r < (MRB); r++) {                                   \
+          RT_SB_MAC_FAST(s[c][r], t[r], xv);                            \
+        }                                                               \
+      }                                                                 \
+    }                                                                   \
+  }
+
+/*
+ * Solve T*x = b for P right-hand sides, T upper or lower triangular NxN.  T,
+ * b and x point to their first elements; piv permutes the rows of b when T
+ * is lower triangular, and is not passed when it is upper triangular.
+ *
+ * The rows are solved in blocks of RT_SUBST_MR.  The part of each sum over
+ * the rows solved before the block is formed for the whole block on a
+ * RT_SUBST_MR x RT_SUBST_NB tile, reading columns of T.  The rest of each
+ * sum is added as each row of the block is solved.  Either way the terms
+ * of a sum are added in the order of the reference loops.
+ */
+static void RT_SB_FCN(const RT_SB_TT *T,
+                      const RT_SB_TB *b,
+                      RT_SB_TX       *x,
+                      int_T          N,
+                      int_T          P,
+#if !RT_SB_UPPER
+                      const int32_T  *piv,
+#endif
+                      boolean_T      unit)
+{
+  int_T k0;
+
+  for (k0 = 0; k0 < P; k0 += RT_SUBST_NB) {
+    const int_T    nb = (P-k0 > RT_SUBST_NB) ? RT_SUBST_NB : P-k0;
+    RT_SB_TX       *xk = x + k0*N;
+    const RT_SB_TB *bk = b + k0*N;
+    int_T          ib;
+
+    for (ib = 0; ib < N; ib += RT_SUBST_MR) {
+      const int_T mr = (N-ib > RT_SUBST_MR) ? RT_SUBST_MR : N-ib;
+#if RT_SB_UPPER
+      const int_T i0 = N-ib-mr;         /* rows i0 to i0+mr-1, bottom up */
+#else
+      const int_T i0 = ib;              /* rows i0 to i0+mr-1, top down */
+#endif
+      RT_SB_TX s[RT_SUBST_NB][RT_SUBST_MR];
+      int_T    r, c, j;
+
+      /* Rows solved before the block */
+      if (mr == RT_SUBST_MR && nb == RT_SUBST_NB) {
+        RT_SB_SOLVED(RT_SUBST_MR,RT_SUBST_NB)
+      } else {
+        RT_SB_SOLVED(mr,nb)
+      }
+
+      /* Rows of the block, in order */
+      for (r = 0; r < mr; r++) {
+#if RT_SB_UPPER
+        const int_T    i  = i0+mr-1-r;
+        const RT_SB_TB *bi = bk + i;
+#else
+        const int_T    i  = i0+r;
+        const RT_SB_TB *bi = bk + piv[i];
+#endif
+        const int_T    ri = i-i0;
+        for (c = 0; c < nb; c++) {
+#if RT_SB_UPPER
+          for (j = i0+mr-1; j > i; j--)
+#else
+          for (j = i0; j < i; j++)
+#endif
+          {
+            RT_SB_MAC(s[c][ri], T[i + j*N], xk[j + c*N]);
+          }
+#if RT_SB_T_CPLX || RT_SB_B_CPLX
+          if (s[c][ri].re != s[c][ri].re || s[c][ri].im != s[c][ri].im) {
+            RT_SB_CAT(RT_SB_FCN,Sum)(&s[c][ri], T, xk + c*N, N, i);
+          }
+#endif
+          RT_SB_FINISH(xk + i + c*N, bi[c*N], s[c][ri], T[i + i*N])
+        }
+      }
+    }
+  }
+}
+
+#undef RT_SB_TT
+#undef RT_SB_TB
+#undef RT_SB_TX
+#undef RT_SB_ZERO
+#undef RT_SB_MAC
+#undef RT_SB_MAC_FAST
+#undef RT_SB_FINISH
+#undef RT_SB_TOCPLX
+#undef RT_SB_DIFF
+#undef RT_SB_SOLVED_RANGE
+#undef RT_SB_SOLVED
+
+/* [EOF] rt_substblk.h */
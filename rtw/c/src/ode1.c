@@ -27,19 +27,29 @@ typedef struct IntgData_tag {
   /* dynamically allocated data */
   extern const char *RT_MEMORY_ALLOCATION_ERROR;
 
+  /* Lay out the vectors of id on the arena a */
+  static void local_layout(IntgData *id, rtArena *a, int_T nx)
+  {
+      id->f0 = (real_T *) rtArenaTake(a, nx * sizeof(real_T));
+  }
+
   void rt_ODECreateIntegrationData(RTWSolverInfo *si)
   {
-      IntgData *id = (IntgData *) malloc(sizeof(IntgData));
+      int_T    nx = rtsiGetNumContStates(si);
+      IntgData layout;
+      IntgData *id;
+      rtArena  a;
+
+      /* One block: the IntgData followed by its vectors */
+      rtArenaInit(&a, NULL, sizeof(IntgData));
+      local_layout(&layout, &a, nx);
+      id = (IntgData *) RT_ARENA_MALLOC(rtArenaSize(&a));
       if(id == NULL) {
           rtsiSetErrorStatus(si, RT_MEMORY_ALLOCATION_ERROR);
           return;
       }
-      
-      id->f0 = (real_T *) malloc(rtsiGetNumContStates(si) * sizeof(real_T));
-      if(id->f0 == NULL) {
-          rtsiSetErrorStatus(si, RT_MEMORY_ALLOCATION_ERROR);
-          return;
-      }
+      rtArenaInit(&a, id, sizeof(IntgData));
+      local_layout(id, &a, nx);
       
       rtsiSetSolverData(si, (void *)id);
       rtsiSetdX(si, id->f0);
@@ -51,10 +61,7 @@ typedef struct IntgData_tag {
       IntgData *id = rtsiGetSolverData(si);
       
       if (id != NULL) {
-          if (id->f0 != NULL) {
-              free(id->f0);
-          }
-          free(id);
+          RT_ARENA_FREE(id);
           rtsiSetSolverData(si, NULL);
       }
   }
@@ -3,6 +3,28 @@
  *
  * File: ode14x.c        
  *
+ * Abstract:
+ *      When compiled with -DODE14X_SPARSE_JACOBIAN, the application can pass
+ *      the sparsity pattern of the Jacobian to rt_ODE14xSetJacobianPattern().
+ *      The Jacobian is then approximated with one derivative evaluation per
+ *      group of structurally independent columns, kept in compressed-column
+ *      storage and the iteration matrix is factored with a sparse LU.
+ *      Without a pattern the dense Jacobian is used.
+ *
+ *      When compiled with -DODE14X_REUSE_JACOBIAN, the Jacobian is kept for
+ *      up to ODE14X_MAX_JACOBIAN_AGE steps and the factored iteration matrix
+ *      of each extrapolation order is kept while the step size does not
+ *      change.  The Jacobian is recomputed for the next step when successive
+ *      Newton corrections shrink by less than ODE14X_NEWTON_RATE, which needs
+ *      two or more Newton iterations.  rt_ODE14xGetStatistics() returns the
+ *      number of Jacobians and factorizations.
+ *
+ *      When compiled with -DODE14X_PARALLEL_JACOBIAN (and RT_MALLOC), the
+ *      application can pass copies of the model to
+ *      rt_ODE14xSetJacobianWorkers().  The columns of the Jacobian, or the
+ *      groups of columns of the sparse one, are then differenced on a pool
+ *      of threads, one per copy, with the model itself taking columns in
+ *      the calling thread.  The Jacobian is the same as the serial one.
  */
 
 #include <math.h>
@@ -16,8 +38,143 @@
 #include "rt_matrixlib.h"
 #include "odesup.h"
 
+#ifdef ODE14X_SPARSE_JACOBIAN
+# include <stdlib.h>
+#endif
+
+#ifdef ODE14X_PARALLEL_JACOBIAN
+# ifndef RT_MALLOC
+#  error "ODE14X_PARALLEL_JACOBIAN needs RT_MALLOC models"
+# endif
+# include <stdlib.h>
+# include <pthread.h>
+#endif
+
 #define MAXORDER 4
 
+#if defined(ODE14X_SPARSE_JACOBIAN) || defined(ODE14X_PARALLEL_JACOBIAN)
+static const char_T *rt_ODE14xMemoryError   = "ode14x: memory allocation error";
+#endif
+
+#ifdef ODE14X_REUSE_JACOBIAN
+
+/* Number of steps a Jacobian is used for before it is recomputed */
+#ifndef ODE14X_MAX_JACOBIAN_AGE
+# define ODE14X_MAX_JACOBIAN_AGE 10
+#endif
+
+/* Newton convergence rate above which the Jacobian is recomputed */
+#ifndef ODE14X_NEWTON_RATE
+# define ODE14X_NEWTON_RATE 0.5
+#endif
+
+/* Newton corrections below this, relative to the states, are converged */
+#ifndef ODE14X_NEWTON_TOL
+# define ODE14X_NEWTON_TOL 1e-12
+#endif
+
+/* The iteration matrix of each extrapolation order is kept */
+# define NUMLU MAXORDER
+#else
+# define NUMLU 1
+#endif
+
+#ifdef ODE14X_SPARSE_JACOBIAN
+
+/* Relative threshold for keeping the diagonal as pivot in the sparse LU */
+#ifndef ODE14X_PIVOT_TOL
+# define ODE14X_PIVOT_TOL 0.1
+#endif
+
+static const char_T *rt_ODE14xSingularError = "ode14x: singular iteration matrix";
+
+/* LU factors: unit lower L with the diagonal first, U with the diagonal last */
+typedef struct SparseLU_tag {
+    int_T   *Lp;        /* nx+1 */
+    int_T   *Li;
+    real_T  *Lx;
+    int_T   Lmax;
+    int_T   *Up;        /* nx+1 */
+    int_T   *Ui;
+    real_T  *Ux;
+    int_T   Umax;
+    int_T   *pinv;      /* nx, pivot step of each row */
+} SparseLU;
+
+typedef struct SparseJac_tag {
+    /* Pattern of the iteration matrix W = I - hN*J: the Jacobian plus the
+       diagonal, compressed columns */
+    int_T   *Jc;        /* nx+1 */
+    int_T   *Ir;        /* Jc[nx] */
+    real_T  *Jx;        /* Jacobian values in the pattern of W */
+    real_T  *Wx;        /* iteration matrix values */
+
+    /* numjac: columns grouped so that no two columns of a group share a row */
+    int_T   nColors;
+    int_T   *colorJc;   /* nColors+1 */
+    int_T   *colorCols; /* nx */
+    real_T  *del;       /* nx */
+
+    /* LU of W, one for each iteration matrix that is kept */
+    SparseLU lu[NUMLU];
+
+    /* LU workspace */
+    int_T   *xi;        /* nx, rows reached by a column */
+    int_T   *stack;     /* nx */
+    int_T   *pstack;    /* nx */
+    int_T   *mark;      /* nx */
+    real_T  *x;         /* nx */
+} SparseJac;
+
+#endif
+
+/* numjac: the operands of a Jacobian evaluation, one task per column or
+   per group of columns */
+typedef struct NumjacJob_tag {
+    real_T       *y;
+    const real_T *Fty;
+    real_T       *fac;
+    real_T       *dFdy;   /* dense Jacobian, or NULL */
+#ifdef ODE14X_SPARSE_JACOBIAN
+    SparseJac    *sp;     /* sparse Jacobian, or NULL */
+#endif
+    int_T        nx;
+    real_T       BL;
+    real_T       BU;
+    real_T       FACMIN;
+} NumjacJob;
+
+#define NUMJAC_THRESH 1e-6
+#define NUMJAC_FACMAX 0.1
+
+#ifdef ODE14X_PARALLEL_JACOBIAN
+
+/* A thread of the Jacobian pool and its copy of the model */
+typedef struct JacWorker_tag {
+    struct JacPool_tag *pool;
+    RTWSolverInfo      *si;      /* solver info of the copy */
+    real_T             *fdel;    /* nx, sparse numjac workspace */
+    pthread_t          thread;
+} JacWorker;
+
+typedef struct JacPool_tag {
+    int_T                  nWorkers;
+    JacWorker              *workers;   /* nWorkers */
+    rt_ODE14xWorkerSyncFcn sync;
+    pthread_mutex_t        mutex;
+    pthread_cond_t         wake;       /* a job was posted, or quit */
+    pthread_cond_t         idle;       /* the last worker finished a job */
+    uint32_T               generation; /* jobs posted */
+    const NumjacJob        *job;
+    int_T                  nTasks;
+    int_T                  nextTask;   /* next task to take */
+    int_T                  nRunning;   /* workers still on the job */
+    boolean_T              quit;
+} JacPool;
+
+#endif
+
+
 static int_T rt_ODE14x_N[MAXORDER] = {12, 8, 6, 4};
 
 typedef struct IntgData_tag {
@@ -34,10 +191,281 @@ typedef struct IntgData_tag {
     real_T  *DFDX; /* nx x nx */
 
     /* LU: */
-    real_T  *W;    /* nx x nx */
-    int32_T *pivots; /* nx */
+    real_T  *W;    /* NUMLU x nx x nx */
+    int32_T *pivots; /* NUMLU x nx */
+
+    /* statistics: */
+    uint32_T nJacobians;      /* Jacobian evaluations */
+    uint32_T nFactorizations; /* LU factorizations of iteration matrices */
+
+#ifdef ODE14X_REUSE_JACOBIAN
+    /* reuse: */
+    int_T   jacAge;         /* steps the Jacobian has been used for, 0 if
+                               it has to be recomputed */
+    real_T  luHN[MAXORDER]; /* hN of the factored iteration matrix of each
+                               order, 0 if there is none */
+#endif
+
+#ifdef ODE14X_SPARSE_JACOBIAN
+    SparseJac *sparse; /* NULL to use DFDX and W */
+#endif
+
+#ifdef ODE14X_PARALLEL_JACOBIAN
+    JacPool *pool;     /* NULL to difference in the calling thread */
+#endif
 } IntgData;
 
+#ifdef ODE14X_SPARSE_JACOBIAN
+
+/* Function: local_destroy_sparse ==============================================
+ * Abstract:
+ *      Free the sparse Jacobian data.
+ */
+static void local_destroy_sparse(SparseJac *sp)
+{
+    int_T l;
+
+    if (sp == NULL) return;
+
+    free(sp->Jc);
+    free(sp->Ir);
+    free(sp->Jx);
+    free(sp->Wx);
+    free(sp->colorJc);
+    free(sp->colorCols);
+    free(sp->del);
+    for (l = 0; l < NUMLU; l++) {
+        free(sp->lu[l].Lp);
+        free(sp->lu[l].Li);
+        free(sp->lu[l].Lx);
+        free(sp->lu[l].Up);
+        free(sp->lu[l].Ui);
+        free(sp->lu[l].Ux);
+        free(sp->lu[l].pinv);
+    }
+    free(sp->xi);
+    free(sp->stack);
+    free(sp->pstack);
+    free(sp->mark);
+    free(sp->x);
+    free(sp);
+
+} /* end local_destroy_sparse */
+
+
+/* Function: local_color_columns ===============================================
+ * Abstract:
+ *      Greedily group the columns of W so that no two columns of a group
+ *      have a nonzero in the same row.  Perturbing all states of a group at
+ *      once then gives each of their Jacobian columns from one derivative
+ *      evaluation.  Returns 0 on success.
+ */
+static int_T local_color_columns(SparseJac *sp, int_T nx)
+{
+    int_T  nnz      = sp->Jc[nx];
+    int_T  *rowJc   = (int_T *) calloc(nx+1, sizeof(int_T));
+    int_T  *rowCols = (int_T *) malloc((nnz > 0 ? nnz : 1)*sizeof(int_T));
+    int_T  *color   = (int_T *) malloc(nx*sizeof(int_T));
+    int_T  *used    = (int_T *) malloc(nx*sizeof(int_T));
+    int_T  i, j, p, q, c;
+    int_T  status   = 1;
+
+    if (rowJc == NULL || rowCols == NULL || color == NULL || used == NULL) {
+        goto EXIT_POINT;
+    }
+
+    /* Columns of each row, in increasing order */
+    for (p = 0; p < nnz; p++) rowJc[sp->Ir[p]+1]++;
+    for (i = 0; i < nx; i++) rowJc[i+1] += rowJc[i];
+    for (i = 0; i < nx; i++) used[i] = rowJc[i];
+    for (j = 0; j < nx; j++) {
+        for (p = sp->Jc[j]; p < sp->Jc[j+1]; p++) {
+            rowCols[used[sp->Ir[p]]++] = j;
+        }
+    }
+
+    /* used[c] == j marks the colors of the columns sharing a row with j */
+    for (c = 0; c < nx; c++) used[c] = -1;
+    sp->nColors = 0;
+    for (j = 0; j < nx; j++) {
+        for (p = sp->Jc[j]; p < sp->Jc[j+1]; p++) {
+            i = sp->Ir[p];
+            for (q = rowJc[i]; q < rowJc[i+1] && rowCols[q] < j; q++) {
+                used[color[rowCols[q]]] = j;
+            }
+        }
+        for (c = 0; c < sp->nColors && used[c] == j; c++) ;
+        color[j] = c;
+        if (c == sp->nColors) sp->nColors++;
+    }
+
+    sp->colorJc = (int_T *) calloc(sp->nColors+1, sizeof(int_T));
+    if (sp->colorJc == NULL) goto EXIT_POINT;
+    for (j = 0; j < nx; j++) sp->colorJc[color[j]+1]++;
+    for (c = 0; c < sp->nColors; c++) sp->colorJc[c+1] += sp->colorJc[c];
+    for (c = 0; c < sp->nColors; c++) used[c] = sp->colorJc[c];
+    for (j = 0; j < nx; j++) sp->colorCols[used[color[j]]++] = j;
+    status = 0;
+
+  EXIT_POINT:
+    free(rowJc);
+    free(rowCols);
+    free(color);
+    free(used);
+    return(status);
+
+} /* end local_color_columns */
+
+
+/* Function: local_create_sparse ===============================================
+ * Abstract:
+ *      Create the sparse Jacobian data from the compressed-column pattern
+ *      (Jc, Ir) of the Jacobian.  The diagonal is added for W.
+ */
+static SparseJac *local_create_sparse(int_T        nx,
+                                      const int_T  *Jc,
+                                      const int_T  *Ir)
+{
+    SparseJac *sp = (SparseJac *) calloc(1, sizeof(SparseJac));
+    int_T     nzMax;
+    int_T     i, j, l, p;
+
+    if (sp == NULL) return(NULL);
+
+    nzMax = Jc[nx] + nx;
+    sp->Jc        = (int_T *)  malloc((nx+1)*sizeof(int_T));
+    sp->Ir        = (int_T *)  malloc(nzMax*sizeof(int_T));
+    sp->colorCols = (int_T *)  malloc(nx*sizeof(int_T));
+    sp->del       = (real_T *) malloc(nx*sizeof(real_T));
+    sp->xi        = (int_T *)  malloc(nx*sizeof(int_T));
+    sp->stack     = (int_T *)  malloc(nx*sizeof(int_T));
+    sp->pstack    = (int_T *)  malloc(nx*sizeof(int_T));
+    sp->mark      = (int_T *)  malloc(nx*sizeof(int_T));
+    sp->x         = (real_T *) malloc(nx*sizeof(real_T));
+    if (sp->Jc == NULL || sp->Ir == NULL || sp->colorCols == NULL ||
+        sp->del == NULL || sp->xi == NULL || sp->stack == NULL ||
+        sp->pstack == NULL || sp->mark == NULL || sp->x == NULL) {
+        goto ERROR_EXIT;
+    }
+
+    /* Pattern of W, each row of a column once */
+    for (i = 0; i < nx; i++) sp->mark[i] = -1;
+    sp->Jc[0] = 0;
+    for (j = 0; j < nx; j++) {
+        int_T nz = sp->Jc[j];
+
+        sp->mark[j]  = j;
+        sp->Ir[nz++] = j;
+        for (p = Jc[j]; p < Jc[j+1]; p++) {
+            i = Ir[p];
+            if (sp->mark[i] != j) {
+                sp->mark[i]  = j;
+                sp->Ir[nz++] = i;
+            }
+        }
+        sp->Jc[j+1] = nz;
+    }
+
+    sp->Jx = (real_T *) malloc(sp->Jc[nx]*sizeof(real_T));
+    sp->Wx = (real_T *) malloc(sp->Jc[nx]*sizeof(real_T));
+    if (sp->Jx == NULL || sp->Wx == NULL) goto ERROR_EXIT;
+
+    if (local_color_columns(sp, nx) != 0) goto ERROR_EXIT;
+
+    /* Initial size of the factors, they grow if there is more fill-in */
+    for (l = 0; l < NUMLU; l++) {
+        SparseLU *lu = &sp->lu[l];
+
+        lu->Lp   = (int_T *)  malloc((nx+1)*sizeof(int_T));
+        lu->Up   = (int_T *)  malloc((nx+1)*sizeof(int_T));
+        lu->pinv = (int_T *)  malloc(nx*sizeof(int_T));
+        lu->Lmax = lu->Umax = sp->Jc[nx] + nx;
+        lu->Li   = (int_T *)  malloc(lu->Lmax*sizeof(int_T));
+        lu->Lx   = (real_T *) malloc(lu->Lmax*sizeof(real_T));
+        lu->Ui   = (int_T *)  malloc(lu->Umax*sizeof(int_T));
+        lu->Ux   = (real_T *) malloc(lu->Umax*sizeof(real_T));
+        if (lu->Lp == NULL || lu->Up == NULL || lu->pinv == NULL ||
+            lu->Li == NULL || lu->Lx == NULL || lu->Ui == NULL ||
+            lu->Ux == NULL) {
+            goto ERROR_EXIT;
+        }
+    }
+
+    return(sp);
+
+  ERROR_EXIT:
+    local_destroy_sparse(sp);
+    return(NULL);
+
+} /* end local_create_sparse */
+
+
+/* Function: rt_ODE14xSetJacobianPattern =======================================
+ * Abstract:
+ *      Use the sparse Jacobian with the given compressed-column pattern:
+ *      Ir[Jc[j]] ... Ir[Jc[j+1]-1] are the rows i of the derivatives
+ *      dx_i/dt that depend on state j.  Passing Jc == NULL goes back to the
+ *      dense Jacobian.  Call after rt_ODECreateIntegrationData().
+ */
+void rt_ODE14xSetJacobianPattern(RTWSolverInfo *si,
+                                 const int_T   *Jc,
+                                 const int_T   *Ir)
+{
+    IntgData *id = rtsiGetSolverData(si);
+
+#ifdef NCSTATES
+    int_T     nx = NCSTATES;
+#else
+    int_T     nx = rtsiGetNumContStates(si);
+#endif
+
+    local_destroy_sparse(id->sparse);
+    id->sparse = NULL;
+
+#ifdef ODE14X_REUSE_JACOBIAN
+    id->jacAge = 0;
+#endif
+    if (Jc != NULL) {
+        id->sparse = local_create_sparse(nx, Jc, Ir);
+        if (id->sparse == NULL) {
+            rtsiSetErrorStatus(si, rt_ODE14xMemoryError);
+        }
+    }
+
+} /* end rt_ODE14xSetJacobianPattern */
+
+#endif
+
+#ifdef ODE14X_PARALLEL_JACOBIAN
+
+/* Function: local_destroy_pool ================================================
+ * Abstract:
+ *      Stop the threads of the Jacobian pool and free it.
+ */
+static void local_destroy_pool(JacPool *pool)
+{
+    int_T w;
+
+    if (pool == NULL) return;
+
+    (void)pthread_mutex_lock(&pool->mutex);
+    pool->quit = true;
+    (void)pthread_cond_broadcast(&pool->wake);
+    (void)pthread_mutex_unlock(&pool->mutex);
+    for (w = 0; w < pool->nWorkers; w++) {
+        (void)pthread_join(pool->workers[w].thread, NULL);
+        free(pool->workers[w].fdel);
+    }
+    (void)pthread_cond_destroy(&pool->idle);
+    (void)pthread_cond_destroy(&pool->wake);
+    (void)pthread_mutex_destroy(&pool->mutex);
+    free(pool->workers);
+    free(pool);
+
+} /* end local_destroy_pool */
+
+#endif
+
 #ifndef RT_MALLOC
   /* statically declare data */
   static real_T   rt_ODE14x_X0[NCSTATES];
@@ -48,8 +476,8 @@ typedef struct IntgData_tag {
   static real_T   rt_ODE14x_E[MAXORDER*NCSTATES];
   static real_T   rt_ODE14x_FAC[NCSTATES];
   static real_T   rt_ODE14x_DFDX[NCSTATES*NCSTATES];
-  static real_T   rt_ODE14x_W[NCSTATES*NCSTATES];
-  static int32_T  rt_ODE14x_PIVOTS[NCSTATES];
+  static real_T   rt_ODE14x_W[NUMLU*NCSTATES*NCSTATES];
+  static int32_T  rt_ODE14x_PIVOTS[NUMLU*NCSTATES];
 
   static IntgData rt_ODE14x_IntgData = {rt_ODE14x_X0,
                                         rt_ODE14x_F0,
@@ -60,7 +488,17 @@ typedef struct IntgData_tag {
 					rt_ODE14x_FAC,
 					rt_ODE14x_DFDX,
                                         rt_ODE14x_W,
-                                        rt_ODE14x_PIVOTS};
+                                        rt_ODE14x_PIVOTS,
+                                        0U,
+                                        0U
+#ifdef ODE14X_REUSE_JACOBIAN
+                                        , 0
+                                        , {0.0}
+#endif
+#ifdef ODE14X_SPARSE_JACOBIAN
+                                        , NULL
+#endif
+                                        };
 					
   void rt_ODECreateIntegrationData(RTWSolverInfo *si)
   {
@@ -78,33 +516,57 @@ typedef struct IntgData_tag {
 #else
   /* dynamically allocated data */
 
+  /* Lay out the vectors of id on the arena a, those of every step first */
+  static void local_layout(IntgData *id, rtArena *a, int_T nx)
+  {
+      size_t vsize = nx * sizeof(real_T);
+
+      id->x0      = (real_T *)  rtArenaTake(a, vsize);
+      id->f0      = (real_T *)  rtArenaTake(a, vsize);
+      id->x1start = (real_T *)  rtArenaTake(a, vsize);
+      id->f1      = (real_T *)  rtArenaTake(a, vsize);
+      id->Delta   = (real_T *)  rtArenaTake(a, vsize);
+      id->E       = (real_T *)  rtArenaTake(a, MAXORDER * vsize);
+      id->fac     = (real_T *)  rtArenaTake(a, vsize);
+      id->pivots  = (int32_T *) rtArenaTake(a, NUMLU * nx * sizeof(int32_T));
+#ifdef ODE14X_SPARSE_JACOBIAN
+      /* DFDX and W are allocated on first use if there is no pattern */
+      id->W       = NULL;
+      id->DFDX    = NULL;
+#else
+      id->W       = (real_T *)  rtArenaTake(a, NUMLU * nx * vsize);
+      id->DFDX    = (real_T *)  rtArenaTake(a, nx * vsize);
+#endif
+  }
+
   void rt_ODECreateIntegrationData(RTWSolverInfo *si)
   {
-      int_T nx    = rtsiGetNumContStates(si);
-      int_T vsize = nx * sizeof(real_T);
-      int_T msize = nx * vsize;
-      int_T size  = (6+MAXORDER)*vsize + 2*msize + nx*sizeof(int_T); 
+      int_T    nx = rtsiGetNumContStates(si);
+      IntgData layout;
+      IntgData *id;
+      rtArena  a;
 
-      IntgData *id = (IntgData *) malloc(sizeof(IntgData));
+      /* One block: the IntgData followed by its vectors */
+      rtArenaInit(&a, NULL, sizeof(IntgData));
+      local_layout(&layout, &a, nx);
+      id = (IntgData *) RT_ARENA_MALLOC(rtArenaSize(&a));
       if(id == NULL) {
           rtsiSetErrorStatus(si, RT_MEMORY_ALLOCATION_ERROR);
           return;
       }
-      
-      id->x0 = (real_T *) malloc(size);
-      if(id->x0 == NULL) {
-          rtsiSetErrorStatus(si, RT_MEMORY_ALLOCATION_ERROR);
-          return;
-      }
-      id->f0      = id->x0      + nx;
-      id->x1start = id->f0      + nx;
-      id->f1      = id->x1start + nx;
-      id->Delta   = id->f1      + nx;
-      id->E       = id->Delta   + nx;
-      id->fac     = id->E       + MAXORDER * nx;
-      id->DFDX    = id->fac     + nx;
-      id->W       = id->DFDX    + nx * nx;
-      id->pivots  = (int32_T *) (id->W + nx * nx);
+      rtArenaInit(&a, id, sizeof(IntgData));
+      local_layout(id, &a, nx);
+#ifdef ODE14X_SPARSE_JACOBIAN
+      id->sparse  = NULL;
+#endif
+      id->nJacobians      = 0U;
+      id->nFactorizations = 0U;
+#ifdef ODE14X_PARALLEL_JACOBIAN
+      id->pool            = NULL;
+#endif
+#ifdef ODE14X_REUSE_JACOBIAN
+      id->jacAge = 0;
+#endif
 
       { /* Initialize */
 	  real_T SQRT_EPS = 1.5e-8;   /* sqrt(utGetEps()); */
@@ -112,6 +574,11 @@ typedef struct IntgData_tag {
 	  for (i = 0; i < nx; i++) {
 	      id->fac[i] = SQRT_EPS;
 	  } 
+#ifdef ODE14X_REUSE_JACOBIAN
+	  for (i = 0; i < MAXORDER; i++) {
+	      id->luHN[i] = 0.0;
+	  }
+#endif
       }
 
       rtsiSetSolverData(si, (void *)id);
@@ -123,122 +590,824 @@ typedef struct IntgData_tag {
       IntgData *id = rtsiGetSolverData(si);
       
       if (id != NULL) {
-          if (id->x0 != NULL) {
-              free(id->x0);
+#ifdef ODE14X_SPARSE_JACOBIAN
+          if (id->DFDX != NULL) {
+              free(id->DFDX);
           }
-          free(id);
+          local_destroy_sparse(id->sparse);
+#endif
+#ifdef ODE14X_PARALLEL_JACOBIAN
+          local_destroy_pool(id->pool);
+#endif
+          RT_ARENA_FREE(id);
           rtsiSetSolverData(si, NULL);
       }
   }
 #endif
 
 
-/* Simplified version of numjac.cpp, for use with RTW. */
-void local_numjac(RTWSolverInfo   *si,
-		  real_T          *y,
-		  const real_T    *Fty,
-		  real_T          *fac,
-		  real_T          *dFdy)
+/* Function: local_numjac_job ==================================================
+ * Abstract:
+ *      Set up job for the Jacobian at y, with F(t,y) in Fty.
+ */
+static void local_numjac_job(NumjacJob *job, int_T nx, real_T *y,
+                             const real_T *Fty, real_T *fac)
 {
-    /* constants */
-    real_T THRESH = 1e-6;
-    real_T EPS    = 2.2e-16;  /* utGetEps(); */
-    real_T BL     = pow(EPS, 0.75);
-    real_T BU     = pow(EPS, 0.25);
-    real_T FACMIN = pow(EPS, 0.78);
-    real_T FACMAX = 0.1;
+    real_T EPS = 2.2e-16;  /* utGetEps(); */
 
-#ifdef NCSTATES
-    int_T     nx = NCSTATES;
-#else
-    int_T     nx = rtsiGetNumContStates(si);
+    job->y      = y;
+    job->Fty    = Fty;
+    job->fac    = fac;
+    job->dFdy   = NULL;
+#ifdef ODE14X_SPARSE_JACOBIAN
+    job->sp     = NULL;
 #endif
+    job->nx     = nx;
+    job->BL     = pow(EPS, 0.75);
+    job->BU     = pow(EPS, 0.25);
+    job->FACMIN = pow(EPS, 0.78);
+
+} /* end local_numjac_job */
+
+
+/* Function: local_numjac_del ==================================================
+ * Abstract:
+ *      Select an increment del for a difference approximation to column j
+ *      of dFdy.  The vector fac accounts for experience gained in previous
+ *      calls to numjac.
+ */
+static real_T local_numjac_del(const NumjacJob *job, const real_T *x, int_T j)
+{
+    real_T *fac = job->fac;
+    real_T xscale;
+    real_T temp;
+    real_T del;
+
+    xscale = fabs(x[j]);
+    if (xscale < NUMJAC_THRESH) xscale = NUMJAC_THRESH;
+    temp = (x[j] + fac[j]*xscale);
+    del  = temp  - job->y[j];
+    while (del == 0.0) {
+        if (fac[j] < NUMJAC_FACMAX) {
+            fac[j] *= 100.0;
+            if (fac[j] > NUMJAC_FACMAX) fac[j] = NUMJAC_FACMAX;
+            temp = (x[j] + fac[j]*xscale);
+            del  = temp  - x[j];
+        } else {
+            del = NUMJAC_THRESH; /* thresh is nonzero */
+            break;
+        }
+    }
+    /* Keep del pointing into region. */
+    if (job->Fty[j] >= 0.0) del = fabs(del);
+    else del = -fabs(del);
 
-    real_T    *x = rtsiGetContStates(si);
+    return(del);
+
+} /* end local_numjac_del */
+
+
+/* Function: local_numjac_fac ==================================================
+ * Abstract:
+ *      Adjust fac[j] for next call to numjac from the largest difference
+ *      difmax of column j, found in row rowmax where F(y+del) is FdelRowmax.
+ */
+static void local_numjac_fac(const NumjacJob *job, int_T j, real_T difmax,
+                             int_T rowmax, real_T FdelRowmax)
+{
+    const real_T *Fty = job->Fty;
+    real_T       *fac = job->fac;
+    real_T       fscale;
+
+    if (((FdelRowmax != 0.0) && (Fty[rowmax] != 0.0)) || (difmax == 0.0)) {
+        fscale = fabs(FdelRowmax);
+        if (fscale < fabs(Fty[rowmax])) fscale = fabs(Fty[rowmax]);
+
+        if (difmax <= job->BL*fscale) {
+            /* The difference is small, so increase the increment. */
+            fac[j] *= 10.0;
+            if (fac[j] > NUMJAC_FACMAX) fac[j] = NUMJAC_FACMAX;
+
+        } else if (difmax > job->BU*fscale) {
+            /* The difference is large, so reduce the increment. */
+            fac[j] *= 0.1;
+            if (fac[j] < job->FACMIN) fac[j] = job->FACMIN;
+
+        }
+    }
+
+} /* end local_numjac_fac */
+
+
+/* Function: local_numjac_column ===============================================
+ * Abstract:
+ *      Column j of the dense Jacobian, evaluating the model of si, whose
+ *      states are job->y on entry and on exit.
+ */
+static void local_numjac_column(RTWSolverInfo *si, const NumjacJob *job,
+                                int_T j)
+{
+    real_T    *x  = rtsiGetContStates(si);
+    real_T    *p  = job->dFdy + j*job->nx;
     real_T    del;
     real_T    difmax;
     real_T    FdelRowmax;
     real_T    temp;
     real_T    Fdiff;
     real_T    maybe;
-    real_T    xscale;
-    real_T    fscale;
-    real_T    *p;
     int_T     rowmax;
-    int_T     i,j;
-
-    if (x != y) (void)memcpy(x,y,nx*sizeof(real_T));
-
-    for (p = dFdy, j = 0; j < nx; j++, p += nx) {
-
-        /* Select an increment del for a difference approximation to
-           column j of dFdy.  The vector fac accounts for experience
-           gained in previous calls to numjac. */
-        xscale = fabs(x[j]);
-        if (xscale < THRESH) xscale = THRESH;
-	temp = (x[j] + fac[j]*xscale); 
-        del  = temp  - y[j];
-        while (del == 0.0) {
-            if (fac[j] < FACMAX) {
-                fac[j] *= 100.0;
-                if (fac[j] > FACMAX) fac[j] = FACMAX;
-		temp = (x[j] + fac[j]*xscale); 
-                del  = temp  - x[j];
-            } else {
-                del = THRESH; /* thresh is nonzero */
-                break;
-            }
+    int_T     i;
+
+    del = local_numjac_del(job, x, j);
+
+    /* Form a difference approximation to column j of dFdy. */
+    temp = x[j];
+    x[j] += del;
+
+    rtsiSetdX(si,p);
+    OUTPUTS(si,0);
+    DERIVATIVES(si);
+
+    x[j] = temp;
+    difmax = 0.0;
+    rowmax = 0;
+    FdelRowmax = p[0];
+    temp = 1.0 / del;
+    for (i = 0; i < job->nx; i++) {
+        Fdiff = p[i] - job->Fty[i];
+        maybe = fabs(Fdiff);
+        if (maybe > difmax) {
+            difmax = maybe;
+            rowmax = i;
+            FdelRowmax = p[i];
         }
-        /* Keep del pointing into region. */
-        if (Fty[j] >= 0.0) del = fabs(del);
-        else del = -fabs(del);
+        p[i] = temp * Fdiff;
+    }
+
+    local_numjac_fac(job, j, difmax, rowmax, FdelRowmax);
 
-        /* Form a difference approximation to column j of dFdy. */
-        temp = x[j];
+} /* end local_numjac_column */
+
+#ifdef ODE14X_SPARSE_JACOBIAN
+
+/* Function: local_numjac_group ================================================
+ * Abstract:
+ *      The columns of group c of the sparse Jacobian, evaluating the model
+ *      of si, whose states are job->y on entry and on exit.  fdel is used as
+ *      workspace.
+ */
+static void local_numjac_group(RTWSolverInfo *si, const NumjacJob *job,
+                               int_T c, real_T *fdel)
+{
+    SparseJac *sp = job->sp;
+    real_T    *x  = rtsiGetContStates(si);
+    real_T    del;
+    real_T    difmax;
+    real_T    FdelRowmax;
+    real_T    temp;
+    real_T    Fdiff;
+    real_T    maybe;
+    int_T     rowmax;
+    int_T     i,j,p,q;
+
+    /* Select the increments of the columns of this group, as in
+       local_numjac, and perturb their states together. */
+    for (q = sp->colorJc[c]; q < sp->colorJc[c+1]; q++) {
+        j   = sp->colorCols[q];
+        del = local_numjac_del(job, x, j);
+
+        sp->del[j] = del;
         x[j] += del;
+    }
+
+    rtsiSetdX(si,fdel);
+    OUTPUTS(si,0);
+    DERIVATIVES(si);
 
-	rtsiSetdX(si,p);
-	OUTPUTS(si,0);
-	DERIVATIVES(si);
+    /* The rows of a column are not touched by the other columns of
+       its group, so each column is differenced on its own rows. */
+    for (q = sp->colorJc[c]; q < sp->colorJc[c+1]; q++) {
+        j   = sp->colorCols[q];
+        del = sp->del[j];
 
-        x[j] = temp;
+        x[j] = job->y[j];
         difmax = 0.0;
         rowmax = 0;
-        FdelRowmax = p[0];
+        FdelRowmax = fdel[0];
         temp = 1.0 / del;
-        for (i = 0; i < nx; i++) {
-            Fdiff = p[i] - Fty[i];
+        for (p = sp->Jc[j]; p < sp->Jc[j+1]; p++) {
+            i = sp->Ir[p];
+            Fdiff = fdel[i] - job->Fty[i];
             maybe = fabs(Fdiff);
             if (maybe > difmax) {
                 difmax = maybe;
                 rowmax = i;
-                FdelRowmax = p[i];
+                FdelRowmax = fdel[i];
             }
-            p[i] = temp * Fdiff;
+            sp->Jx[p] = temp * Fdiff;
         }
 
-        /* Adjust fac for next call to numjac. */
-        if (((FdelRowmax != 0.0) && (Fty[rowmax] != 0.0)) || (difmax == 0.0)) {
-            fscale = fabs(FdelRowmax);
-            if (fscale < fabs(Fty[rowmax])) fscale = fabs(Fty[rowmax]);
+        local_numjac_fac(job, j, difmax, rowmax, FdelRowmax);
+    }
 
-	    if (difmax <= BL*fscale) {
-                /* The difference is small, so increase the increment. */
-                fac[j] *= 10.0;
-                if (fac[j] > FACMAX) fac[j] = FACMAX;
+} /* end local_numjac_group */
 
-            } else if (difmax > BU*fscale) {
-                /* The difference is large, so reduce the increment. */
-                fac[j] *= 0.1;
-                if (fac[j] < FACMIN) fac[j] = FACMIN;
+#endif
 
-            }
+
+/* Function: local_numjac_task =================================================
+ * Abstract:
+ *      Task k of job: column k of the dense Jacobian or group k of the
+ *      sparse one.
+ */
+static void local_numjac_task(RTWSolverInfo *si, const NumjacJob *job,
+                              int_T k, real_T *fdel)
+{
+#ifdef ODE14X_SPARSE_JACOBIAN
+    if (job->sp != NULL) {
+        local_numjac_group(si, job, k, fdel);
+        return;
+    }
+#endif
+    (void)fdel;
+    local_numjac_column(si, job, k);
+
+} /* end local_numjac_task */
+
+#ifdef ODE14X_PARALLEL_JACOBIAN
+
+/* Function: local_pool_thread =================================================
+ * Abstract:
+ *      Worker thread of the Jacobian pool: runs the tasks of each job it is
+ *      woken for on its copy of the model.
+ */
+static void *local_pool_thread(void *arg)
+{
+    JacWorker *w    = (JacWorker *) arg;
+    JacPool   *pool = w->pool;
+    uint32_T  seen  = 0U;
+
+    for (;;) {
+        int_T k;
+
+        (void)pthread_mutex_lock(&pool->mutex);
+        while (pool->generation == seen && !pool->quit) {
+            (void)pthread_cond_wait(&pool->wake, &pool->mutex);
+        }
+        if (pool->quit) {
+            (void)pthread_mutex_unlock(&pool->mutex);
+            break;
+        }
+        seen = pool->generation;
+        k    = pool->nextTask++;
+        (void)pthread_mutex_unlock(&pool->mutex);
+
+        while (k < pool->nTasks) {
+            local_numjac_task(w->si, pool->job, k, w->fdel);
+            (void)pthread_mutex_lock(&pool->mutex);
+            k = pool->nextTask++;
+            (void)pthread_mutex_unlock(&pool->mutex);
+        }
+
+        (void)pthread_mutex_lock(&pool->mutex);
+        if (--pool->nRunning == 0) (void)pthread_cond_signal(&pool->idle);
+        (void)pthread_mutex_unlock(&pool->mutex);
+    }
+    return(NULL);
+
+} /* end local_pool_thread */
+
+
+/* Function: local_pool_run ====================================================
+ * Abstract:
+ *      Run the nTasks tasks of job on the model of si and its copies.  The
+ *      copies are brought to the state of the model of si first, and the
+ *      caller takes tasks too, with fdel as workspace.
+ */
+static void local_pool_run(RTWSolverInfo *si, JacPool *pool,
+                           const NumjacJob *job, int_T nTasks, real_T *fdel)
+{
+    int_T w, k;
+
+    for (w = 0; w < pool->nWorkers; w++) {
+        RTWSolverInfo *wsi = pool->workers[w].si;
+
+        if (pool->sync != NULL) {
+            pool->sync(rtsiGetRTModelPtr(wsi), rtsiGetRTModelPtr(si));
+        }
+        (void)memcpy(rtsiGetContStates(wsi), job->y, job->nx*sizeof(real_T));
+        rtsiSetT(wsi, rtsiGetT(si));
+        rtsiSetSimTimeStep(wsi, MINOR_TIME_STEP);
+    }
+
+    (void)pthread_mutex_lock(&pool->mutex);
+    pool->job      = job;
+    pool->nTasks   = nTasks;
+    pool->nextTask = 0;
+    pool->nRunning = pool->nWorkers;
+    pool->generation++;
+    (void)pthread_cond_broadcast(&pool->wake);
+    k = pool->nextTask++;
+    (void)pthread_mutex_unlock(&pool->mutex);
+
+    while (k < nTasks) {
+        local_numjac_task(si, job, k, fdel);
+        (void)pthread_mutex_lock(&pool->mutex);
+        k = pool->nextTask++;
+        (void)pthread_mutex_unlock(&pool->mutex);
+    }
+
+    (void)pthread_mutex_lock(&pool->mutex);
+    while (pool->nRunning > 0) {
+        (void)pthread_cond_wait(&pool->idle, &pool->mutex);
+    }
+    (void)pthread_mutex_unlock(&pool->mutex);
+
+} /* end local_pool_run */
+
+
+/* Function: rt_ODE14xSetJacobianWorkers =======================================
+ * Abstract:
+ *      Difference the Jacobian on nWorkers threads besides the calling one,
+ *      thread w evaluating the copy of the model whose solver info is
+ *      workers[w].  The copies are separate RT_MALLOC instances of the model
+ *      of si, set up like it with rt_ODECreateSolverInfo().  Before each
+ *      Jacobian, sync(copy, model) is called with their RTModel pointers to
+ *      bring the data a copy's derivatives depend on, other than the states
+ *      and time, up to date; it may be NULL if there is no such data.
+ *      Passing nWorkers == 0 stops the threads.  Call after
+ *      rt_ODECreateIntegrationData().
+ */
+void rt_ODE14xSetJacobianWorkers(RTWSolverInfo          *si,
+                                 int_T                  nWorkers,
+                                 RTWSolverInfo *const   *workers,
+                                 rt_ODE14xWorkerSyncFcn sync)
+{
+    IntgData *id   = rtsiGetSolverData(si);
+    JacPool  *pool = NULL;
+    int_T    nx    = rtsiGetNumContStates(si);
+    int_T    w;
+
+    local_destroy_pool(id->pool);
+    id->pool = NULL;
+    if (nWorkers <= 0) return;
+
+    pool = (JacPool *) calloc(1, sizeof(JacPool));
+    if (pool == NULL) goto ERROR_EXIT;
+    pool->workers = (JacWorker *) calloc(nWorkers, sizeof(JacWorker));
+    if (pool->workers == NULL) {
+        free(pool);
+        goto ERROR_EXIT;
+    }
+    pool->sync = sync;
+    (void)pthread_mutex_init(&pool->mutex, NULL);
+    (void)pthread_cond_init(&pool->wake, NULL);
+    (void)pthread_cond_init(&pool->idle, NULL);
+
+    for (w = 0; w < nWorkers; w++) {
+        JacWorker *wk = &pool->workers[w];
+
+        wk->pool = pool;
+        wk->si   = workers[w];
+        wk->fdel = (real_T *) malloc(nx*sizeof(real_T));
+        if (wk->fdel == NULL ||
+            pthread_create(&wk->thread, NULL, local_pool_thread, wk) != 0) {
+            free(wk->fdel);
+            local_destroy_pool(pool);
+            goto ERROR_EXIT;
+        }
+        pool->nWorkers++;
+    }
+
+    id->pool = pool;
+    return;
+
+  ERROR_EXIT:
+    rtsiSetErrorStatus(si, rt_ODE14xMemoryError);
+
+} /* end rt_ODE14xSetJacobianWorkers */
+
+#endif
+
+
+/* Function: local_numjac_run ==================================================
+ * Abstract:
+ *      Run the nTasks tasks of job, in parallel if there is a pool.
+ */
+static void local_numjac_run(RTWSolverInfo *si, const NumjacJob *job,
+                             int_T nTasks, real_T *fdel)
+{
+    real_T *x = rtsiGetContStates(si);
+    int_T  k;
+
+    if (x != job->y) (void)memcpy(x,job->y,job->nx*sizeof(real_T));
+
+#ifdef ODE14X_PARALLEL_JACOBIAN
+    {
+        IntgData *id = rtsiGetSolverData(si);
+        if (id->pool != NULL) {
+            local_pool_run(si, id->pool, job, nTasks, fdel);
+            return;
         }
     }
+#endif
+
+    for (k = 0; k < nTasks; k++) {
+        local_numjac_task(si, job, k, fdel);
+    }
+
+} /* end local_numjac_run */
+
+
+/* Simplified version of numjac.cpp, for use with RTW. */
+void local_numjac(RTWSolverInfo   *si,
+		  real_T          *y,
+		  const real_T    *Fty,
+		  real_T          *fac,
+		  real_T          *dFdy)
+{
+    NumjacJob job;
+
+#ifdef NCSTATES
+    int_T     nx = NCSTATES;
+#else
+    int_T     nx = rtsiGetNumContStates(si);
+#endif
+
+    local_numjac_job(&job, nx, y, Fty, fac);
+    job.dFdy = dFdy;
+    local_numjac_run(si, &job, nx, NULL);
 
 } /* end local_numjac */
 
 
+#ifdef ODE14X_SPARSE_JACOBIAN
+
+/* Function: local_numjac_sparse ===============================================
+ * Abstract:
+ *      local_numjac for the pattern of sp, perturbing one group of columns
+ *      per derivative evaluation.  The Jacobian is returned in sp->Jx and
+ *      fdel is used as workspace.
+ */
+static void local_numjac_sparse(RTWSolverInfo   *si,
+                                real_T          *y,
+                                const real_T    *Fty,
+                                real_T          *fac,
+                                SparseJac       *sp,
+                                real_T          *fdel)
+{
+    NumjacJob job;
+
+#ifdef NCSTATES
+    int_T     nx = NCSTATES;
+#else
+    int_T     nx = rtsiGetNumContStates(si);
+#endif
+
+    local_numjac_job(&job, nx, y, Fty, fac);
+    job.sp = sp;
+    local_numjac_run(si, &job, sp->nColors, fdel);
+
+} /* end local_numjac_sparse */
+
+
+/* Function: local_sparse_grow =================================================
+ * Abstract:
+ *      Make room for at least nzNeeded entries in a factor.  Returns 0 on
+ *      success.
+ */
+static int_T local_sparse_grow(int_T **i, real_T **x, int_T *nzMax,
+                               int_T nzNeeded)
+{
+    int_T  nz = 2*(*nzMax) + nzNeeded;
+    int_T  *iNew;
+    real_T *xNew;
+
+    if ((iNew = (int_T *) realloc(*i, nz*sizeof(int_T))) == NULL) return(1);
+    *i = iNew;
+    if ((xNew = (real_T *) realloc(*x, nz*sizeof(real_T))) == NULL) return(1);
+    *x = xNew;
+    *nzMax = nz;
+    return(0);
+
+} /* end local_sparse_grow */
+
+
+/* Function: local_sparse_reach ================================================
+ * Abstract:
+ *      Depth-first search of the graph of L from the rows of column k of W.
+ *      The rows that L \ W(:,k) can fill are returned in xi[top..nx-1] in
+ *      topological order.
+ */
+static int_T local_sparse_reach(SparseJac *sp, const SparseLU *lu, int_T nx,
+                                int_T k)
+{
+    int_T top = nx;
+    int_T p;
+
+    for (p = sp->Jc[k]; p < sp->Jc[k+1]; p++) {
+        int_T head = 0;
+
+        if (sp->mark[sp->Ir[p]] == k) continue;
+
+        sp->stack[0] = sp->Ir[p];
+        while (head >= 0) {
+            int_T     j    = sp->stack[head];
+            int_T     J    = lu->pinv[j];
+            boolean_T done = true;
+            int_T     q, qEnd;
+
+            if (sp->mark[j] != k) {
+                sp->mark[j]       = k;
+                sp->pstack[head]  = (J < 0) ? 0 : lu->Lp[J];
+            }
+            qEnd = (J < 0) ? 0 : lu->Lp[J+1];
+            for (q = sp->pstack[head]; q < qEnd; q++) {
+                int_T i = lu->Li[q];
+
+                if (sp->mark[i] == k) continue;
+                sp->pstack[head]   = q;
+                sp->stack[++head]  = i;
+                done = false;
+                break;
+            }
+            if (done) {
+                head--;
+                sp->xi[--top] = j;
+            }
+        }
+    }
+    return(top);
+
+} /* end local_sparse_reach */
+
+
+/* Function: local_sparse_lu ===================================================
+ * Abstract:
+ *      Left-looking LU of W with partial pivoting, preferring the diagonal
+ *      when it is within ODE14X_PIVOT_TOL of the largest candidate.
+ *      Returns 0 on success.
+ */
+static int_T local_sparse_lu(RTWSolverInfo *si, SparseJac *sp, SparseLU *lu,
+                             int_T nx)
+{
+    real_T *x  = sp->x;
+    int_T  lnz = 0;
+    int_T  unz = 0;
+    int_T  i, k, p, top;
+
+    for (i = 0; i < nx; i++) {
+        lu->pinv[i] = -1;
+        sp->mark[i] = -1;
+        x[i]        = 0.0;
+    }
+
+    for (k = 0; k < nx; k++) {
+        int_T  ipiv = -1;
+        real_T a    = -1.0;
+        real_T pivot;
+
+        lu->Lp[k] = lnz;
+        lu->Up[k] = unz;
+        if ((lnz + nx > lu->Lmax &&
+             local_sparse_grow(&lu->Li, &lu->Lx, &lu->Lmax, lnz + nx) != 0) ||
+            (unz + nx > lu->Umax &&
+             local_sparse_grow(&lu->Ui, &lu->Ux, &lu->Umax, unz + nx) != 0)) {
+            rtsiSetErrorStatus(si, rt_ODE14xMemoryError);
+            return(1);
+        }
+
+        /* x = L \ W(:,k) */
+        top = local_sparse_reach(sp, lu, nx, k);
+        for (p = sp->Jc[k]; p < sp->Jc[k+1]; p++) x[sp->Ir[p]] = sp->Wx[p];
+        for (p = top; p < nx; p++) {
+            int_T j = sp->xi[p];
+            int_T J = lu->pinv[j];
+            int_T q;
+
+            if (J < 0) continue;
+            for (q = lu->Lp[J]+1; q < lu->Lp[J+1]; q++) {
+                x[lu->Li[q]] -= lu->Lx[q]*x[j];
+            }
+        }
+
+        /* Split x into U(:,k) and the pivot candidates */
+        for (p = top; p < nx; p++) {
+            i = sp->xi[p];
+            if (lu->pinv[i] < 0) {
+                real_T t = fabs(x[i]);
+                if (t > a) {a = t; ipiv = i;}
+            } else {
+                lu->Ui[unz]   = lu->pinv[i];
+                lu->Ux[unz++] = x[i];
+            }
+        }
+        if (ipiv == -1 || a <= 0.0) {
+            for (p = top; p < nx; p++) x[sp->xi[p]] = 0.0;
+            rtsiSetErrorStatus(si, rt_ODE14xSingularError);
+            return(1);
+        }
+        if (lu->pinv[k] < 0 && fabs(x[k]) >= a*ODE14X_PIVOT_TOL) ipiv = k;
+
+        pivot = x[ipiv];
+        lu->Ui[unz]   = k;
+        lu->Ux[unz++] = pivot;
+        lu->pinv[ipiv] = k;
+        lu->Li[lnz]   = ipiv;
+        lu->Lx[lnz++] = 1.0;
+        for (p = top; p < nx; p++) {
+            i = sp->xi[p];
+            if (lu->pinv[i] < 0) {
+                lu->Li[lnz]   = i;
+                lu->Lx[lnz++] = x[i] / pivot;
+            }
+            x[i] = 0.0;
+        }
+    }
+    lu->Lp[nx] = lnz;
+    lu->Up[nx] = unz;
+
+    /* Rows of L in pivot order */
+    for (p = 0; p < lnz; p++) lu->Li[p] = lu->pinv[lu->Li[p]];
+    return(0);
+
+} /* end local_sparse_lu */
+
+
+/* Function: local_sparse_solve ================================================
+ * Abstract:
+ *      b = U \ (L \ (P*b)) with the factors of local_sparse_lu.
+ */
+static void local_sparse_solve(const SparseJac *sp, const SparseLU *lu,
+                               int_T nx, real_T *b)
+{
+    real_T *x = sp->x;
+    int_T  i, j, p;
+
+    for (i = 0; i < nx; i++) x[lu->pinv[i]] = b[i];
+    for (j = 0; j < nx; j++) {
+        for (p = lu->Lp[j]+1; p < lu->Lp[j+1]; p++) {
+            x[lu->Li[p]] -= lu->Lx[p]*x[j];
+        }
+    }
+    for (j = nx-1; j >= 0; j--) {
+        x[j] /= lu->Ux[lu->Up[j+1]-1];
+        for (p = lu->Up[j]; p < lu->Up[j+1]-1; p++) {
+            x[lu->Ui[p]] -= lu->Ux[p]*x[j];
+        }
+    }
+    (void)memcpy(b, x, nx*sizeof(real_T));
+
+} /* end local_sparse_solve */
+
+#endif
+
+
+/* Function: local_jacobian ====================================================
+ * Abstract:
+ *      J = dF/dx at (t0, x0) with F(t0, x0) in f0.  Returns 0 on success.
+ */
+static int_T local_jacobian(RTWSolverInfo *si, IntgData *id, int_T nx)
+{
+    id->nJacobians++;
+
+#ifdef ODE14X_SPARSE_JACOBIAN
+    if (id->sparse != NULL) {
+        local_numjac_sparse(si,id->x0,id->f0,id->fac,id->sparse,id->f1);
+        return(0);
+    }
+    if (id->DFDX == NULL) {
+        id->DFDX = (real_T *) malloc((1+NUMLU)*nx*nx*sizeof(real_T));
+        if (id->DFDX == NULL) {
+            rtsiSetErrorStatus(si, rt_ODE14xMemoryError);
+            return(1);
+        }
+        id->W = id->DFDX + nx*nx;
+    }
+#else
+    (void)nx;
+#endif
+
+    local_numjac(si,id->x0,id->f0,id->fac,id->DFDX);
+    return(0);
+
+} /* end local_jacobian */
+
+
+/* Function: local_lu ==========================================================
+ * Abstract:
+ *      [L,U] = lu(I - hN*J) into the LU storage l.  Returns 0 on success.
+ */
+static int_T local_lu(RTWSolverInfo *si, IntgData *id, int_T nx, real_T hN,
+                      int_T l)
+{
+    real_T *W = id->W + l*nx*nx;
+    real_T *p;
+    int_T  i;
+
+    id->nFactorizations++;
+
+#ifdef ODE14X_SPARSE_JACOBIAN
+    if (id->sparse != NULL) {
+        SparseJac *sp = id->sparse;
+        int_T     j;
+
+        for (j = 0; j < nx; j++) {
+            for (i = sp->Jc[j]; i < sp->Jc[j+1]; i++) {
+                sp->Wx[i] = sp->Jx[i] * (-hN);
+                if (sp->Ir[i] == j) sp->Wx[i] += 1.0;
+            }
+        }
+        return(local_sparse_lu(si, sp, &sp->lu[l], nx));
+    }
+#else
+    (void)si;
+#endif
+
+    (void) memcpy(W, id->DFDX, nx*nx*sizeof(real_T));
+    for (p = W, i = 0; i < nx*nx; i++, p++) *p *= (-hN);
+    for (p = W, i = 0; i < nx; i++, p += (nx+1)) *p += 1.0;
+    rt_lu_real(W,nx,id->pivots + l*nx);
+    return(0);
+
+} /* end local_lu */
+
+
+/* Function: local_solve =======================================================
+ * Abstract:
+ *      Delta = (U \ (L \ Delta)) with the LU storage l, tmp is used as
+ *      workspace.
+ */
+static void local_solve(IntgData *id, int_T nx, int_T l, real_T *Delta,
+                        real_T *tmp)
+{
+    real_T *W = id->W + l*nx*nx;
+
+#ifdef ODE14X_SPARSE_JACOBIAN
+    if (id->sparse != NULL) {
+        local_sparse_solve(id->sparse, &id->sparse->lu[l], nx, Delta);
+        return;
+    }
+#endif
+
+    /* Modeled after rt_matdivrr_dbl.c */
+    rt_ForwardSubstitutionRR_Dbl(W,Delta,tmp,nx,1,id->pivots + l*nx,1);
+    rt_BackwardSubstitutionRR_Dbl(W+nx*nx-1,tmp+nx-1,Delta,nx,1,0);
+
+} /* end local_solve */
+
+#ifdef ODE14X_REUSE_JACOBIAN
+
+/* Function: local_newton_rate =================================================
+ * Abstract:
+ *      Update the largest ratio max(abs(Delta))/max(abs(DeltaPrev)) of
+ *      successive Newton corrections.  iter is 0 for the first correction.
+ *      Corrections at the round-off level of the states x do not count.
+ */
+static void local_newton_rate(const real_T *Delta,
+                              const real_T *x,
+                              int_T        nx,
+                              int_T        iter,
+                              real_T       *normPrev,
+                              real_T       *rate)
+{
+    real_T norm  = 0.0;
+    real_T xnorm = 1.0;
+    int_T  i;
+
+    for (i = 0; i < nx; i++) {
+        if (fabs(Delta[i]) > norm) norm = fabs(Delta[i]);
+        if (fabs(x[i]) > xnorm) xnorm = fabs(x[i]);
+    }
+    if (norm <= ODE14X_NEWTON_TOL*xnorm) norm = 0.0;
+    if (iter > 0 && norm > 0.0) {
+        real_T r = (*normPrev > 0.0) ? norm / *normPrev : 1.0;
+        if (r > *rate) *rate = r;
+    }
+    *normPrev = norm;
+
+} /* end local_newton_rate */
+
+#endif
+
+
+/* Function: rt_ODE14xGetStatistics ============================================
+ * Abstract:
+ *      Return the number of Jacobian evaluations and LU factorizations done
+ *      since the integration data was created.
+ */
+void rt_ODE14xGetStatistics(RTWSolverInfo *si,
+                            uint32_T      *nJacobians,
+                            uint32_T      *nFactorizations)
+{
+    IntgData *id = rtsiGetSolverData(si);
+
+    if (nJacobians != NULL) *nJacobians = id->nJacobians;
+    if (nFactorizations != NULL) *nFactorizations = id->nFactorizations;
+
+} /* end rt_ODE14xGetStatistics */
+
+
 void rt_ODEUpdateContinuousStates(RTWSolverInfo *si)
 {
     time_T    t0         = rtsiGetT(si);
@@ -255,12 +1424,12 @@ void rt_ODEUpdateContinuousStates(RTWSolverInfo *si)
     real_T    *f1        = id->f1;
     real_T    *Delta     = id->Delta;
     real_T    *E         = id->E;
-    real_T    *fac       = id->fac;
-    real_T    *dfdx      = id->DFDX;
-    real_T    *W         = id->W;
-    int_T     *pivots    = id->pivots;
     int_T     *N         = &(rt_ODE14x_N[0]); 
     int_T     i,j,k,iter;
+#ifdef ODE14X_REUSE_JACOBIAN
+    real_T    rate      = 0.0; /* largest Newton convergence rate */
+    real_T    normPrev  = 0.0;
+#endif
 
 #ifdef NCSTATES
     int_T     nx        = NCSTATES;
@@ -279,27 +1448,45 @@ void rt_ODEUpdateContinuousStates(RTWSolverInfo *si)
     DERIVATIVES(si);
 
     /* Compute the Jacobian */
-    local_numjac(si,x0,f0,fac,dfdx);
+#ifdef ODE14X_REUSE_JACOBIAN
+    if (id->jacAge == 0 || id->jacAge >= ODE14X_MAX_JACOBIAN_AGE) {
+        if (local_jacobian(si,id,nx) != 0) return;
+        id->jacAge = 0;
+        for (j = 0; j < MAXORDER; j++) id->luHN[j] = 0.0;
+    }
+#else
+    if (local_jacobian(si,id,nx) != 0) return;
+#endif
 
     for (j = 0; j < order; j++) {
 	
-	real_T *p;
 	real_T hN = h / N[j];
 	
 	/* Get the iteration matrix and solution at t0 */
 
 	/* [L,U] = lu(I - hN*J) */
-        (void) memcpy(W, dfdx, nx*nx*sizeof(real_T));
-        for (p = W, i = 0; i < nx*nx; i++, p++) *p *= (-hN);
-        for (p = W, i = 0; i < nx; i++, p += (nx+1)) *p += 1.0;
-	rt_lu_real(W,nx,pivots);
+#ifdef ODE14X_REUSE_JACOBIAN
+	int_T  l  = j;
+
+	if (id->luHN[j] != hN) {
+	    id->luHN[j] = 0.0;
+	    if (local_lu(si,id,nx,hN,l) != 0) return;
+	    id->luHN[j] = hN;
+	}
+#else
+	int_T  l  = 0;
+
+	if (local_lu(si,id,nx,hN,l) != 0) return;
+#endif
 
 	/* First Newton's iteration at t0. */
 	/* rhs = hN*f0  */
 	for (i = 0; i < nx; i++) Delta[i] = hN*f0[i];
 	/* Delta = (U \ (L \ rhs)) */
-	rt_ForwardSubstitutionRR_Dbl(W,Delta,f1,nx,1,pivots,1);
-	rt_BackwardSubstitutionRR_Dbl(W+nx*nx-1,f1+nx-1,Delta,nx,1,0);
+	local_solve(id,nx,l,Delta,f1);
+#ifdef ODE14X_REUSE_JACOBIAN
+	local_newton_rate(Delta,x0,nx,0,&normPrev,&rate);
+#endif
 	/* ytmp = y0 + Delta */ 
 	(void)memcpy(x1, x0, nx*sizeof(real_T));
 	for (i = 0; i < nx; i++) x1[i] += Delta[i];
@@ -320,8 +1507,10 @@ void rt_ODEUpdateContinuousStates(RTWSolverInfo *si)
 
 	    for (i = 0; i < nx; i++) Delta[i] = (x0[i]-x1[i]) + hN*f1[i];
 
-	    rt_ForwardSubstitutionRR_Dbl(W,Delta,f1,nx,1,pivots,1);
-	    rt_BackwardSubstitutionRR_Dbl(W+nx*nx-1,f1+nx-1,Delta,nx,1,0);
+	    local_solve(id,nx,l,Delta,f1);
+#ifdef ODE14X_REUSE_JACOBIAN
+	    local_newton_rate(Delta,x1,nx,iter,&normPrev,&rate);
+#endif
 
 	    for (i = 0; i < nx; i++) x1[i] += Delta[i];
 	}
@@ -354,9 +1543,11 @@ void rt_ODEUpdateContinuousStates(RTWSolverInfo *si)
 		    for (i = 0; i < nx; i++) Delta[i] = (x1start[i]-x1[i]) + hN*f1[i];
 		}
 
-		/* Modeled after rt_matdivrr_dbl.c, use f1 as a temp storage */
-		rt_ForwardSubstitutionRR_Dbl(W,Delta,f1,nx,1,pivots,1);
-		rt_BackwardSubstitutionRR_Dbl(W+nx*nx-1,f1+nx-1,Delta,nx,1,0);
+		/* Use f1 as a temp storage */
+		local_solve(id,nx,l,Delta,f1);
+#ifdef ODE14X_REUSE_JACOBIAN
+		local_newton_rate(Delta,x1,nx,iter,&normPrev,&rate);
+#endif
 
 		for (i = 0; i < nx; i++) x1[i] += Delta[i];
 	    }   
@@ -389,6 +1580,11 @@ void rt_ODEUpdateContinuousStates(RTWSolverInfo *si)
     /* t1 = t0 + h; */
     rtsiSetT(si,rtsiGetSolverStopTime(si));
 
+#ifdef ODE14X_REUSE_JACOBIAN
+    /* Recompute the Jacobian for the next step if Newton converged slowly */
+    id->jacAge = (rate > ODE14X_NEWTON_RATE) ? 0 : id->jacAge + 1;
+#endif
+
     PROJECTION(si);
     REDUCTION(si);
 
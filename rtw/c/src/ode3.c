@@ -47,22 +47,33 @@ void rt_ODECreateIntegrationData(RTWSolverInfo *si)
 #else
   /* dynamically allocated data */
 
+  /* Lay out the vectors of id on the arena a, those of every step first */
+  static void local_layout(IntgData *id, rtArena *a, int_T nx)
+  {
+      int_T i;
+      id->y = (real_T *) rtArenaTake(a, nx * sizeof(real_T));
+      for (i = 0; i < 3; i++) {
+          id->f[i] = (real_T *) rtArenaTake(a, nx * sizeof(real_T));
+      }
+  }
+
   void rt_ODECreateIntegrationData(RTWSolverInfo *si)
   {
-      IntgData *id = (IntgData *) malloc(sizeof(IntgData));
+      int_T    nx = rtsiGetNumContStates(si);
+      IntgData layout;
+      IntgData *id;
+      rtArena  a;
+
+      /* One block: the IntgData followed by its vectors */
+      rtArenaInit(&a, NULL, sizeof(IntgData));
+      local_layout(&layout, &a, nx);
+      id = (IntgData *) RT_ARENA_MALLOC(rtArenaSize(&a));
       if(id == NULL) {
           rtsiSetErrorStatus(si, RT_MEMORY_ALLOCATION_ERROR);
           return;
       }
-      
-      id->y = (real_T *) malloc(4*rtsiGetNumContStates(si) * sizeof(real_T));
-      if(id->y == NULL) {
-          rtsiSetErrorStatus(si, RT_MEMORY_ALLOCATION_ERROR);
-          return;
-      }
-      id->f[0] = id->y + rtsiGetNumContStates(si);
-      id->f[1] = id->f[0] + rtsiGetNumContStates(si);
-      id->f[2] = id->f[1] + rtsiGetNumContStates(si);
+      rtArenaInit(&a, id, sizeof(IntgData));
+      local_layout(id, &a, nx);
       
       rtsiSetSolverData(si, (void *)id);
       rtsiSetSolverName(si,"ode3");
@@ -73,10 +84,7 @@ void rt_ODECreateIntegrationData(RTWSolverInfo *si)
       IntgData *id = rtsiGetSolverData(si);
       
       if (id != NULL) {
-          if (id->y != NULL) {
-              free(id->y);
-          }
-          free(id);
+          RT_ARENA_FREE(id);
           rtsiSetSolverData(si, NULL);
       }
   }
@@ -114,9 +122,7 @@ void rt_ODEUpdateContinuousStates(RTWSolverInfo *si)
 
     /* f(:,2) = feval(odefile, t + hA(1), y + f*hB(:,1), args(:)(*)); */
     hB[0] = h * rt_ODE3_B[0][0];
-    for (i = 0; i < nXc; i++) {
-	x[i] = y[i] + (f0[i]*hB[0]);
-    }
+    rt_ODEStageCombination(x, y, id->f, hB, 1, nXc);
     rtsiSetT(si, t + h*rt_ODE3_A[0]);
     rtsiSetdX(si, f1);
     OUTPUTS(si,0);
@@ -124,9 +130,7 @@ void rt_ODEUpdateContinuousStates(RTWSolverInfo *si)
 
     /* f(:,3) = feval(odefile, t + hA(2), y + f*hB(:,2), args(:)(*)); */
     for (i = 0; i <= 1; i++) hB[i] = h * rt_ODE3_B[1][i];
-    for (i = 0; i < nXc; i++) {
-	x[i] = y[i] + (f0[i]*hB[0] + f1[i]*hB[1]);
-    }
+    rt_ODEStageCombination(x, y, id->f, hB, 2, nXc);
     rtsiSetT(si, t + h*rt_ODE3_A[1]);
     rtsiSetdX(si, f2);
     OUTPUTS(si,0);
@@ -135,9 +139,7 @@ void rt_ODEUpdateContinuousStates(RTWSolverInfo *si)
     /* tnew = t + hA(3);
        ynew = y + f*hB(:,3); */
     for (i = 0; i <= 2; i++) hB[i] = h * rt_ODE3_B[2][i];
-    for (i = 0; i < nXc; i++) {
-	x[i] = y[i] + (f0[i]*hB[0] + f1[i]*hB[1] + f2[i]*hB[2]);
-    }
+    rt_ODEStageCombination(x, y, id->f, hB, 3, nXc);
     rtsiSetT(si, tnew);
 
     PROJECTION(si);
@@ -38,23 +38,33 @@ typedef struct IntgData_tag {
 #else
   /* dynamically allocated data */
 
+  /* Lay out the vectors of id on the arena a, those of every step first */
+  static void local_layout(IntgData *id, rtArena *a, int_T nx)
+  {
+      int_T i;
+      id->y = (real_T *) rtArenaTake(a, nx * sizeof(real_T));
+      for (i = 0; i < 4; i++) {
+          id->f[i] = (real_T *) rtArenaTake(a, nx * sizeof(real_T));
+      }
+  }
+
   void rt_ODECreateIntegrationData(RTWSolverInfo *si)
   {
-      IntgData *id = (IntgData *) malloc(sizeof(IntgData));
+      int_T    nx = rtsiGetNumContStates(si);
+      IntgData layout;
+      IntgData *id;
+      rtArena  a;
+
+      /* One block: the IntgData followed by its vectors */
+      rtArenaInit(&a, NULL, sizeof(IntgData));
+      local_layout(&layout, &a, nx);
+      id = (IntgData *) RT_ARENA_MALLOC(rtArenaSize(&a));
       if(id == NULL) {
           rtsiSetErrorStatus(si, RT_MEMORY_ALLOCATION_ERROR);
           return;
       }
-      
-      id->y = (real_T *) malloc(5*rtsiGetNumContStates(si) * sizeof(real_T));
-      if(id->y == NULL) {
-          rtsiSetErrorStatus(si, RT_MEMORY_ALLOCATION_ERROR);
-          return;
-      }
-      id->f[0] = id->y + rtsiGetNumContStates(si);
-      id->f[1] = id->f[0] + rtsiGetNumContStates(si);
-      id->f[2] = id->f[1] + rtsiGetNumContStates(si);
-      id->f[3] = id->f[2] + rtsiGetNumContStates(si);
+      rtArenaInit(&a, id, sizeof(IntgData));
+      local_layout(id, &a, nx);
       
       rtsiSetSolverData(si, (void *)id);
       rtsiSetSolverName(si,"ode4");
@@ -65,10 +75,7 @@ typedef struct IntgData_tag {
       IntgData *id = rtsiGetSolverData(si);
       
       if (id != NULL) {
-          if (id->y != NULL) {
-              free(id->y);
-          }
-          free(id);
+          RT_ARENA_FREE(id);
           rtsiSetSolverData(si, NULL);
       }
   }
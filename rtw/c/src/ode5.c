@@ -28,50 +28,87 @@ static real_T rt_ODE5_B[6][6] = {
     {35.0/384.0, 0.0, 500.0/1113.0, 125.0/192.0, -2187.0/6784.0, 11.0/84.0}
 };
 
+#ifdef ODE_ADAPTIVE_STEP
+/* Error estimate of the embedded 4th order solution, b - bhat */
+static const real_T rt_ODE5_E[7] = {
+    71.0/57600.0, 0.0, -71.0/16695.0, 71.0/1920.0, -17253.0/339200.0,
+    22.0/525.0, -1.0/40.0
+};
+# define ODE5_NF 7      /* f(:,7) = f(t+h, ynew) is f(:,1) of the next step */
+#else
+# define ODE5_NF 6
+#endif
+
 typedef struct IntgData_tag {
     real_T *y;
-    real_T *f[6];
+    real_T *f[ODE5_NF];
+#ifdef ODE_ADAPTIVE_STEP
+    ODEAdaptiveData ad;
+#endif
 } IntgData;
 
 #ifndef RT_MALLOC
   /* statically declare data */
   static real_T   rt_ODE5_Y[NCSTATES];
-  static real_T   rt_ODE5_F[6][NCSTATES];
+  static real_T   rt_ODE5_F[ODE5_NF][NCSTATES];
   static IntgData rt_ODE5_IntgData = {rt_ODE5_Y,
                                       {rt_ODE5_F[0],
                                        rt_ODE5_F[1],
                                        rt_ODE5_F[2],
                                        rt_ODE5_F[3],
                                        rt_ODE5_F[4],
-                                       rt_ODE5_F[5]}};
+                                       rt_ODE5_F[5]
+#ifdef ODE_ADAPTIVE_STEP
+                                      ,rt_ODE5_F[6]
+#endif
+                                      }
+#ifdef ODE_ADAPTIVE_STEP
+                                      /* set by rt_ODEAdaptiveInit */
+                                      ,{0.0, 0.0, 0.0, 0U, 0U, 0U}
+#endif
+                                      };
 
   void rt_ODECreateIntegrationData(RTWSolverInfo *si)
   {
+#ifdef ODE_ADAPTIVE_STEP
+      rt_ODEAdaptiveInit(&rt_ODE5_IntgData.ad);
+#endif
       rtsiSetSolverData(si,(void *)&rt_ODE5_IntgData);
       rtsiSetSolverName(si,"ode5");
   }
 #else
   /* dynamically allocated data */
 
+  /* Lay out the vectors of id on the arena a, those of every step first */
+  static void local_layout(IntgData *id, rtArena *a, int_T nx)
+  {
+      int_T i;
+      id->y = (real_T *) rtArenaTake(a, nx * sizeof(real_T));
+      for (i = 0; i < ODE5_NF; i++) {
+          id->f[i] = (real_T *) rtArenaTake(a, nx * sizeof(real_T));
+      }
+  }
+
   void rt_ODECreateIntegrationData(RTWSolverInfo *si)
   {
-      IntgData *id = (IntgData *) malloc(sizeof(IntgData));
+      int_T    nx = rtsiGetNumContStates(si);
+      IntgData layout;
+      IntgData *id;
+      rtArena  a;
+
+      /* One block: the IntgData followed by its vectors */
+      rtArenaInit(&a, NULL, sizeof(IntgData));
+      local_layout(&layout, &a, nx);
+      id = (IntgData *) RT_ARENA_MALLOC(rtArenaSize(&a));
       if(id == NULL) {
           rtsiSetErrorStatus(si, RT_MEMORY_ALLOCATION_ERROR);
           return;
       }
-      
-      id->y = (real_T *) malloc(7*rtsiGetNumContStates(si) * sizeof(real_T));
-      if(id->y == NULL) {
-          rtsiSetErrorStatus(si, RT_MEMORY_ALLOCATION_ERROR);
-          return;
-      }
-      id->f[0] = id->y + rtsiGetNumContStates(si);
-      id->f[1] = id->f[0] + rtsiGetNumContStates(si);
-      id->f[2] = id->f[1] + rtsiGetNumContStates(si);
-      id->f[3] = id->f[2] + rtsiGetNumContStates(si);
-      id->f[4] = id->f[3] + rtsiGetNumContStates(si);
-      id->f[5] = id->f[4] + rtsiGetNumContStates(si);
+      rtArenaInit(&a, id, sizeof(IntgData));
+      local_layout(id, &a, nx);
+#ifdef ODE_ADAPTIVE_STEP
+      rt_ODEAdaptiveInit(&id->ad);
+#endif
       
       rtsiSetSolverData(si, (void *)id);
       rtsiSetSolverName(si,"ode5");
@@ -82,15 +119,135 @@ typedef struct IntgData_tag {
       IntgData *id = rtsiGetSolverData(si);
       
       if (id != NULL) {
-          if (id->y != NULL) {
-              free(id->y);
-          }
-          free(id);
+          RT_ARENA_FREE(id);
           rtsiSetSolverData(si, NULL);
       }
   }
 #endif
 
+#ifdef ODE_ADAPTIVE_STEP
+
+void rt_ODESetTolerances(RTWSolverInfo *si,
+                         real_T        relTol,
+                         real_T        absTol)
+{
+    IntgData *id = rtsiGetSolverData(si);
+
+    id->ad.relTol = relTol;
+    id->ad.absTol = absTol;
+}
+
+void rt_ODEGetStatistics(RTWSolverInfo *si,
+                         uint32_T      *nSteps,
+                         uint32_T      *nFailedSteps,
+                         uint32_T      *nDerivatives)
+{
+    IntgData *id = rtsiGetSolverData(si);
+
+    *nSteps       = id->ad.nSteps;
+    *nFailedSteps = id->ad.nFailedSteps;
+    *nDerivatives = id->ad.nDerivatives;
+}
+
+/*
+ * Adaptive step mode: Dormand-Prince 5(4) steps from t to the solver stop
+ * time, each sized from the error of the embedded 4th order solution.  The
+ * derivatives at the end of an accepted step are those at the start of the
+ * next one, so a step takes six derivative evaluations.
+ */
+void rt_ODEUpdateContinuousStates(RTWSolverInfo *si)
+{
+    time_T          t          = rtsiGetT(si);
+    time_T          tnew       = rtsiGetSolverStopTime(si);
+    real_T          *x         = rtsiGetContStates(si);
+    IntgData        *intgData  = rtsiGetSolverData(si);
+    ODEAdaptiveData *ad        = &intgData->ad;
+    real_T          *y         = intgData->y;
+    real_T          **f        = intgData->f;
+    real_T          hB[7];
+    real_T          err;
+    time_T          h, hnext, tend;
+    int_T           i, k;
+
+#ifdef NCSTATES
+    int_T     nXc        = NCSTATES;
+#else
+    int_T     nXc        = rtsiGetNumContStates(si);
+#endif
+
+    rtsiSetSimTimeStep(si,MINOR_TIME_STEP);
+
+    /* Save the state values at time t in y, we'll use x as ynew. */
+    (void)memcpy(y, x, nXc*sizeof(real_T));
+
+    /* Assumes that rtsiSetT and ModelOutputs are up-to-date */
+    /* f0 = f(t,y) */
+    rtsiSetdX(si, f[0]);
+    DERIVATIVES(si);
+    ad->nDerivatives++;
+
+    h = (ad->h > 0.0 && ad->h < tnew - t) ? ad->h : tnew - t;
+    while (t < tnew) {
+        /* Stretch a step that would leave less than a tenth of it to go */
+        const time_T hprop = h;
+        tend = (t + 1.1*h >= tnew) ? tnew : t + h;
+        h    = tend - t;
+
+        /* f(:,k+2) = feval(odefile, t + hA(k+1), y + f*hB(:,k+1), args(:)(*)) */
+        for (k = 0; k < 5; k++) {
+            for (i = 0; i <= k; i++) hB[i] = h * rt_ODE5_B[k][i];
+            rt_ODEStageCombination(x, y, f, hB, k+1, nXc);
+            rtsiSetT(si, (rt_ODE5_A[k] == 1.0) ? tend : t + h*rt_ODE5_A[k]);
+            rtsiSetdX(si, f[k+1]);
+            OUTPUTS(si,0);
+            DERIVATIVES(si);
+        }
+
+        /* ynew = y + f*hB(:,6); f(:,7) = feval(odefile, tend, ynew, args(:)(*)) */
+        for (i = 0; i <= 5; i++) hB[i] = h * rt_ODE5_B[5][i];
+        rt_ODEStageCombination(x, y, f, hB, 6, nXc);
+        rtsiSetT(si, tend);
+        rtsiSetdX(si, f[6]);
+        OUTPUTS(si,0);
+        DERIVATIVES(si);
+        ad->nDerivatives += 6;
+
+        /* err = f*hE */
+        for (i = 0; i < 7; i++) hB[i] = h * rt_ODE5_E[i];
+        err   = rt_ODEErrorNorm(y, x, f, hB, 7, nXc, ad);
+        hnext = rt_ODEAdaptiveStepSize(h, err, 4, t);
+
+        if (err <= 1.0) {
+            real_T *fnew = f[6];
+            f[6] = f[0];
+            f[0] = fnew;
+            (void)memcpy(y, x, nXc*sizeof(real_T));
+            t = tend;
+            ad->nSteps++;
+            /* A step cut short at tnew says nothing against the step tried */
+            if (h < hprop && hnext < hprop) hnext = hprop;
+            if (hnext == 0.0) hnext = h;
+            ad->h = hnext;
+        } else {
+            ad->nFailedSteps++;
+            if (hnext == 0.0) {
+                (void)memcpy(x, y, nXc*sizeof(real_T));
+                rtsiSetT(si, t);
+                rtsiSetErrorStatus(si, RT_ODE_MIN_STEP_ERROR);
+                break;
+            }
+        }
+        h = hnext;
+    }
+
+    PROJECTION(si);
+    REDUCTION(si);
+
+    rtsiSetSimTimeStep(si,MAJOR_TIME_STEP);
+}
+
+#else
+
 void rt_ODEUpdateContinuousStates(RTWSolverInfo *si)
 {
     time_T    t          = rtsiGetT(si);
@@ -126,9 +283,7 @@ void rt_ODEUpdateContinuousStates(RTWSolverInfo *si)
 
     /* f(:,2) = feval(odefile, t + hA(1), y + f*hB(:,1), args(:)(*)); */
     hB[0] = h * rt_ODE5_B[0][0];
-    for (i = 0; i < nXc; i++) {
-	x[i] = y[i] + (f0[i]*hB[0]);
-    }
+    rt_ODEStageCombination(x, y, intgData->f, hB, 1, nXc);
     rtsiSetT(si, t + h*rt_ODE5_A[0]);
     rtsiSetdX(si, f1);
     OUTPUTS(si,0);
@@ -136,9 +291,7 @@ void rt_ODEUpdateContinuousStates(RTWSolverInfo *si)
 
     /* f(:,3) = feval(odefile, t + hA(2), y + f*hB(:,2), args(:)(*)); */
     for (i = 0; i <= 1; i++) hB[i] = h * rt_ODE5_B[1][i];
-    for (i = 0; i < nXc; i++) {
-	x[i] = y[i] + (f0[i]*hB[0] + f1[i]*hB[1]);
-    }
+    rt_ODEStageCombination(x, y, intgData->f, hB, 2, nXc);
     rtsiSetT(si, t + h*rt_ODE5_A[1]);
     rtsiSetdX(si, f2);
     OUTPUTS(si,0);
@@ -146,9 +299,7 @@ void rt_ODEUpdateContinuousStates(RTWSolverInfo *si)
 
     /* f(:,4) = feval(odefile, t + hA(3), y + f*hB(:,3), args(:)(*)); */
     for (i = 0; i <= 2; i++) hB[i] = h * rt_ODE5_B[2][i];
-    for (i = 0; i < nXc; i++) {
-	x[i] = y[i] + (f0[i]*hB[0] + f1[i]*hB[1] + f2[i]*hB[2]);
-    }
+    rt_ODEStageCombination(x, y, intgData->f, hB, 3, nXc);
     rtsiSetT(si, t + h*rt_ODE5_A[2]);
     rtsiSetdX(si, f3);
     OUTPUTS(si,0);
@@ -156,10 +307,7 @@ void rt_ODEUpdateContinuousStates(RTWSolverInfo *si)
 
     /* f(:,5) = feval(odefile, t + hA(4), y + f*hB(:,4), args(:)(*)); */
     for (i = 0; i <= 3; i++) hB[i] = h * rt_ODE5_B[3][i];
-    for (i = 0; i < nXc; i++) {
-	x[i] = y[i] + (f0[i]*hB[0] + f1[i]*hB[1] + f2[i]*hB[2] +
-		       f3[i]*hB[3]);
-    }
+    rt_ODEStageCombination(x, y, intgData->f, hB, 4, nXc);
     rtsiSetT(si, t + h*rt_ODE5_A[3]);
     rtsiSetdX(si, f4);
     OUTPUTS(si,0);
@@ -167,10 +315,7 @@ void rt_ODEUpdateContinuousStates(RTWSolverInfo *si)
 
     /* f(:,6) = feval(odefile, t + hA(5), y + f*hB(:,5), args(:)(*)); */
     for (i = 0; i <= 4; i++) hB[i] = h * rt_ODE5_B[4][i];
-    for (i = 0; i < nXc; i++) {
-	x[i] = y[i] + (f0[i]*hB[0] + f1[i]*hB[1] + f2[i]*hB[2] +
-		       f3[i]*hB[3] + f4[i]*hB[4]);
-    }
+    rt_ODEStageCombination(x, y, intgData->f, hB, 5, nXc);
     rtsiSetT(si, tnew);
     rtsiSetdX(si, f5);
     OUTPUTS(si,0);
@@ -179,10 +324,7 @@ void rt_ODEUpdateContinuousStates(RTWSolverInfo *si)
     /* tnew = t + hA(6);
        ynew = y + f*hB(:,6); */
     for (i = 0; i <= 5; i++) hB[i] = h * rt_ODE5_B[5][i];
-    for (i = 0; i < nXc; i++) {
-	x[i] = y[i] + (f0[i]*hB[0] + f1[i]*hB[1] + f2[i]*hB[2] +
-		       f3[i]*hB[3] + f4[i]*hB[4] + f5[i]*hB[5]);
-    }
+    rt_ODEStageCombination(x, y, intgData->f, hB, 6, nXc);
 
     PROJECTION(si);
     REDUCTION(si);
@@ -190,5 +332,6 @@ void rt_ODEUpdateContinuousStates(RTWSolverInfo *si)
     rtsiSetSimTimeStep(si,MAJOR_TIME_STEP);
 }
 
+#endif /* ODE_ADAPTIVE_STEP */
 
 /* [EOF] ode5.c */
@@ -105,10 +105,23 @@ static real_T rt_ODE8_C[13] = MAT13;
 
 static real_T rt_ODE8_A[13][13] = TWODMAT13;
 
+#ifdef ODE_ADAPTIVE_STEP
+/* Weights of the embedded 7th order solution */
+static const real_T rt_ODE8_BHAT[13] = {
+    13451932.0/455176623.0, 0.0, 0.0, 0.0, 0.0,
+    -808719846.0/976000145.0, 1757004468.0/5645159321.0,
+    656045339.0/265891186.0, -3867574721.0/1518517206.0,
+    465885868.0/322736535.0, 53011238.0/667516719.0, 2.0/45.0, 0.0
+};
+#endif
+
 typedef struct IntgData_tag {
     real_T *deltaY;
     real_T *f[13];
 	real_T *x0;
+#ifdef ODE_ADAPTIVE_STEP
+    ODEAdaptiveData ad;
+#endif
 } IntgData;
 
 #ifndef RT_MALLOC
@@ -132,50 +145,59 @@ typedef struct IntgData_tag {
 									   rt_ODE8_F[12],
 									  },
 									  rt_ODE8_X0
+#ifdef ODE_ADAPTIVE_STEP
+									  /* set by rt_ODEAdaptiveInit */
+									  ,{0.0, 0.0, 0.0, 0U, 0U, 0U}
+#endif
 									 };
 
   void rt_ODECreateIntegrationData(RTWSolverInfo *si)
   {
 	  ODE8_CONSTANTS
+#ifdef ODE_ADAPTIVE_STEP
+      rt_ODEAdaptiveInit(&rt_ODE8_IntgData.ad);
+#endif
       rtsiSetSolverData(si,(void *)&rt_ODE8_IntgData);
       rtsiSetSolverName(si,"ode8");
   }
 #else
   /* dynamically allocated data */
 
-  void rt_ODECreateIntegrationData(RTWSolverInfo *si)
+  /* Lay out the vectors of id on the arena a, those of every step first */
+  static void local_layout(IntgData *id, rtArena *a, int_T nx)
   {
-      int_T nX = rtsiGetNumContStates(si);
-      IntgData *id = (IntgData *) malloc(sizeof(IntgData));
-   
-	  if(id == NULL) {
-          rtsiSetErrorStatus(si, RT_MEMORY_ALLOCATION_ERROR);
-          return;
+      int_T i;
+      id->x0 = (real_T *) rtArenaTake(a, nx * sizeof(real_T));
+      for (i = 0; i < 13; i++) {
+          id->f[i] = (real_T *) rtArenaTake(a, nx * sizeof(real_T));
       }
-      
-      id->deltaY = (real_T *) malloc(15*rtsiGetNumContStates(si) * sizeof(real_T));
-      if(id->deltaY == NULL) {
+      id->deltaY = (real_T *) rtArenaTake(a, nx * sizeof(real_T));
+  }
+
+  void rt_ODECreateIntegrationData(RTWSolverInfo *si)
+  {
+      int_T    nx = rtsiGetNumContStates(si);
+      IntgData layout;
+      IntgData *id;
+      rtArena  a;
+
+      /* One block: the IntgData followed by its vectors */
+      rtArenaInit(&a, NULL, sizeof(IntgData));
+      local_layout(&layout, &a, nx);
+      id = (IntgData *) RT_ARENA_MALLOC(rtArenaSize(&a));
+      if(id == NULL) {
           rtsiSetErrorStatus(si, RT_MEMORY_ALLOCATION_ERROR);
           return;
       }
-      id->f[0]  = id->deltaY+ nX;
-      id->f[1]  = id->f[0]  + nX;
-      id->f[2]  = id->f[1]  + nX;
-      id->f[3]  = id->f[2]  + nX;
-      id->f[4]  = id->f[3]  + nX;
-      id->f[5]  = id->f[4]  + nX;
-	  id->f[6]  = id->f[5]  + nX;
-	  id->f[7]  = id->f[6]  + nX;
-	  id->f[8]  = id->f[7]  + nX;
-	  id->f[9]  = id->f[8]  + nX;
-	  id->f[10] = id->f[9]  + nX;
-	  id->f[11] = id->f[10] + nX;
-	  id->f[12] = id->f[11] + nX;
-	  id->x0    = id->f[12] + nX;
-
-	  ODE8_CONSTANTS
+      rtArenaInit(&a, id, sizeof(IntgData));
+      local_layout(id, &a, nx);
 
-	  rtsiSetSolverData(si, (void *)id);
+      ODE8_CONSTANTS
+#ifdef ODE_ADAPTIVE_STEP
+      rt_ODEAdaptiveInit(&id->ad);
+#endif
+      
+      rtsiSetSolverData(si, (void *)id);
       rtsiSetSolverName(si,"ode8");
   }
 
@@ -184,15 +206,222 @@ typedef struct IntgData_tag {
       IntgData *id = rtsiGetSolverData(si);
       
       if (id != NULL) {
-          if (id->deltaY != NULL) {
-              free(id->deltaY);
-          }
-          free(id);
+          RT_ARENA_FREE(id);
           rtsiSetSolverData(si, NULL);
       }
   }
 #endif
 
+#if defined(ODE_ADAPTIVE_STEP) || !defined(ODE8_REFERENCE_STAGES)
+
+/*
+ * Stage s is x = x0 + sum of h*A(s,j)*f[j], and the step x = x0 + sum of
+ * h*B(j)*f[j], each formed by rt_ODEStageCombination over the stages with
+ * nonzero coefficients.  The sums are those of the reference loops below
+ * with the zero terms left out, which changes the result only when a
+ * derivative is Inf or NaN.  Define ODE8_REFERENCE_STAGES to use the
+ * reference loops.
+ */
+static int_T rt_ODE8Coefficients(const real_T *a,
+                                 int_T        nA,
+                                 time_T       h,
+                                 real_T       *const *f,
+                                 real_T       *c,
+                                 real_T       **fc)
+{
+    int_T n = 0;
+    int_T j;
+
+    for (j = 0; j < nA; j++) {
+        if (a[j] != 0.0) {
+            c[n]  = h*a[j];
+            fc[n] = f[j];
+            n++;
+        }
+    }
+    return(n);
+}
+
+#endif
+
+#if defined(ODE_ADAPTIVE_STEP)
+
+void rt_ODESetTolerances(RTWSolverInfo *si,
+                         real_T        relTol,
+                         real_T        absTol)
+{
+    IntgData *id = rtsiGetSolverData(si);
+
+    id->ad.relTol = relTol;
+    id->ad.absTol = absTol;
+}
+
+void rt_ODEGetStatistics(RTWSolverInfo *si,
+                         uint32_T      *nSteps,
+                         uint32_T      *nFailedSteps,
+                         uint32_T      *nDerivatives)
+{
+    IntgData *id = rtsiGetSolverData(si);
+
+    *nSteps       = id->ad.nSteps;
+    *nFailedSteps = id->ad.nFailedSteps;
+    *nDerivatives = id->ad.nDerivatives;
+}
+
+/*
+ * Adaptive step mode: Dormand-Prince 8(7) steps from t to the solver stop
+ * time, each sized from the error of the embedded 7th order solution.
+ */
+void rt_ODEUpdateContinuousStates(RTWSolverInfo *si)
+{
+    time_T          t          = rtsiGetT(si);
+    time_T          tnew       = rtsiGetSolverStopTime(si);
+    real_T          *x         = rtsiGetContStates(si);
+    IntgData        *intgData  = rtsiGetSolverData(si);
+    ODEAdaptiveData *ad        = &intgData->ad;
+    real_T          *x0        = intgData->x0;
+    real_T          **f        = intgData->f;
+    real_T          c[NSTAGES];
+    real_T          *fc[NSTAGES];
+    real_T          err;
+    time_T          h, hnext, tend;
+    int_T           stagesIdx, n;
+
+#ifdef NCSTATES
+    int_T     nXc        = NCSTATES;
+#else
+    int_T     nXc        = rtsiGetNumContStates(si);
+#endif
+
+    rtsiSetSimTimeStep(si,MINOR_TIME_STEP);
+
+    /* Save the state values at time t in x0, we'll use x as ynew. */
+    (void)memcpy(x0, x, nXc*sizeof(real_T));
+
+    /* Assumes that rtsiSetT and ModelOutputs are up-to-date */
+    rtsiSetdX(si, f[0]);
+    DERIVATIVES(si);
+    ad->nDerivatives++;
+
+    h = (ad->h > 0.0 && ad->h < tnew - t) ? ad->h : tnew - t;
+    while (t < tnew) {
+        /* Stretch a step that would leave less than a tenth of it to go */
+        const time_T hprop = h;
+        tend = (t + 1.1*h >= tnew) ? tnew : t + h;
+        h    = tend - t;
+
+        for (stagesIdx = 1; stagesIdx < NSTAGES; stagesIdx++) {
+            n = rt_ODE8Coefficients(rt_ODE8_A[stagesIdx], stagesIdx, h, f, c, fc);
+            if (n > 0) {
+                rt_ODEStageCombination(x, x0, fc, c, n, nXc);
+            } else {
+                (void)memcpy(x, x0, nXc*sizeof(real_T));
+            }
+            rtsiSetT(si, (rt_ODE8_C[stagesIdx] == 1.0) ? tend :
+                     t + h*rt_ODE8_C[stagesIdx]);
+            rtsiSetdX(si, f[stagesIdx]);
+            OUTPUTS(si,0);
+            DERIVATIVES(si);
+        }
+        ad->nDerivatives += NSTAGES-1;
+
+        n = rt_ODE8Coefficients(rt_ODE8_B, NSTAGES, h, f, c, fc);
+        rt_ODEStageCombination(x, x0, fc, c, n, nXc);
+
+        /* err = sum of h*(B(j) - BHAT(j))*f[j] */
+        for (stagesIdx = 0; stagesIdx < NSTAGES; stagesIdx++) {
+            c[stagesIdx] = h*(rt_ODE8_B[stagesIdx] - rt_ODE8_BHAT[stagesIdx]);
+        }
+        err   = rt_ODEErrorNorm(x0, x, f, c, NSTAGES, nXc, ad);
+        hnext = rt_ODEAdaptiveStepSize(h, err, 7, t);
+
+        if (err <= 1.0) {
+            (void)memcpy(x0, x, nXc*sizeof(real_T));
+            t = tend;
+            ad->nSteps++;
+            /* A step cut short at tnew says nothing against the step tried */
+            if (h < hprop && hnext < hprop) hnext = hprop;
+            if (hnext == 0.0) hnext = h;
+            ad->h = hnext;
+            if (t < tnew) {
+                rtsiSetT(si, t);
+                rtsiSetdX(si, f[0]);
+                OUTPUTS(si,0);
+                DERIVATIVES(si);
+                ad->nDerivatives++;
+            }
+        } else {
+            ad->nFailedSteps++;
+            if (hnext == 0.0) {
+                (void)memcpy(x, x0, nXc*sizeof(real_T));
+                rtsiSetT(si, t);
+                rtsiSetErrorStatus(si, RT_ODE_MIN_STEP_ERROR);
+                break;
+            }
+        }
+        h = hnext;
+    }
+
+    PROJECTION(si);
+    REDUCTION(si);
+
+    rtsiSetSimTimeStep(si,MAJOR_TIME_STEP);
+}
+
+#elif !defined(ODE8_REFERENCE_STAGES)
+
+void rt_ODEUpdateContinuousStates(RTWSolverInfo *si)
+{
+    time_T    t          = rtsiGetT(si);
+    time_T    tnew       = rtsiGetSolverStopTime(si);
+    time_T    h          = rtsiGetStepSize(si);
+    real_T    *x         = rtsiGetContStates(si);
+    IntgData  *intgData  = rtsiGetSolverData(si);
+    real_T    *x0        = intgData->x0;
+    real_T    **f        = intgData->f;
+    real_T    c[NSTAGES];
+    real_T    *fc[NSTAGES];
+    int_T     stagesIdx, n;
+
+#ifdef NCSTATES
+    int_T     nXc        = NCSTATES;
+#else
+    int_T     nXc        = rtsiGetNumContStates(si);
+#endif
+
+    rtsiSetSimTimeStep(si,MINOR_TIME_STEP);
+
+    /* Save the state values at time t in x0, we'll use x as ynew. */
+    (void)memcpy(x0, x, nXc*sizeof(real_T));
+
+    /* Assumes that rtsiSetT and ModelOutputs are up-to-date */
+    rtsiSetdX(si, f[0]);
+    DERIVATIVES(si);
+
+    for (stagesIdx = 1; stagesIdx < NSTAGES; stagesIdx++) {
+        n = rt_ODE8Coefficients(rt_ODE8_A[stagesIdx], stagesIdx, h, f, c, fc);
+        if (n > 0) {
+            rt_ODEStageCombination(x, x0, fc, c, n, nXc);
+        } else {
+            (void)memcpy(x, x0, nXc*sizeof(real_T));
+        }
+        (stagesIdx==NSTAGES-1)? rtsiSetT(si, tnew) : rtsiSetT(si, t + h*rt_ODE8_C[stagesIdx]);
+        rtsiSetdX(si, f[stagesIdx]);
+        OUTPUTS(si,0);
+        DERIVATIVES(si);
+    }
+
+    n = rt_ODE8Coefficients(rt_ODE8_B, NSTAGES, h, f, c, fc);
+    rt_ODEStageCombination(x, x0, fc, c, n, nXc);
+
+    PROJECTION(si);
+    REDUCTION(si);
+
+    rtsiSetSimTimeStep(si,MAJOR_TIME_STEP);
+}
+
+#else
+
 void rt_ODEUpdateContinuousStates(RTWSolverInfo *si)
 {
     time_T    t          = rtsiGetT(si);
@@ -275,4 +504,6 @@ void rt_ODEUpdateContinuousStates(RTWSolverInfo *si)
     rtsiSetSimTimeStep(si,MAJOR_TIME_STEP);
 }
 
+#endif /* ODE_ADAPTIVE_STEP */
+
 /* [EOF] ode5.c */
@@ -12,11 +12,15 @@
 
 #include <math.h>
 #include <stddef.h> /* needed for NULL */
+#ifdef ODE_ADAPTIVE_STEP
+# include <float.h> /* needed for DBL_EPSILON */
+#endif
 
 #include "tmwtypes.h"
 
 #ifdef RT_MALLOC
 # include <stdlib.h>
+# include "rt_arena.h"
 #endif
 
 #ifdef USE_RTMODEL
@@ -61,6 +65,215 @@ void rt_ODEStateReduction(real_T* x, int_T* p, int_T n, real_T* r) {
     }
 }
 
+/* States per vector group of rt_ODEStageCombination */
+#ifndef RT_ODE_STAGE_LANES
+# define RT_ODE_STAGE_LANES 8
+#endif
+
+/*
+ * Runge-Kutta stage combination
+ *
+ *   x = y + (f[0]*c[0] + f[1]*c[1] + ... + f[n-1]*c[n-1]),   n >= 1,
+ *
+ * the terms added left to right as written.  Up to four terms are added per
+ * pass over the states, with x holding the partial sum between passes, so
+ * a combination of n terms streams through memory ceil(n/4) times.  Each
+ * pass forms RT_ODE_STAGE_LANES states at a time in a local array before
+ * storing them, which lets the compiler vectorize it without having to
+ * prove that x does not overlap y or the f[j].
+ */
+#define RT_ODE_T1 f0[i]*c0
+#define RT_ODE_T2 RT_ODE_T1 + f1[i]*c1
+#define RT_ODE_T3 RT_ODE_T2 + f2[i]*c2
+#define RT_ODE_T4 RT_ODE_T3 + f3[i]*c3
+#define RT_ODE_LOOP(E)                                                  \
+    for (i0 = 0; i0 <= nXc-RT_ODE_STAGE_LANES; i0 += RT_ODE_STAGE_LANES) { \
+        for (i = i0; i < i0+RT_ODE_STAGE_LANES; i++) s[i-i0] = E;       \
+        for (i = 0; i < RT_ODE_STAGE_LANES; i++) x[i0+i] = s[i];        \
+    }                                                                   \
+    for (i = i0; i < nXc; i++) x[i] = E
+#define RT_ODE_PASS(S)                                                  \
+    if (j == 0 && last) {                                               \
+        RT_ODE_LOOP(y[i] + (S));                                        \
+    } else if (j == 0) {                                                \
+        RT_ODE_LOOP(S);                                                 \
+    } else if (last) {                                                  \
+        RT_ODE_LOOP(y[i] + (x[i] + S));                                 \
+    } else {                                                            \
+        RT_ODE_LOOP(x[i] + S);                                          \
+    }
+
+void rt_ODEStageCombination(real_T       *x,
+                            const real_T *y,
+                            real_T       *const *f,
+                            const real_T *c,
+                            int_T        n,
+                            int_T        nXc)
+{
+    real_T s[RT_ODE_STAGE_LANES];
+    int_T  i0, i, j;
+
+    for (j = 0; j < n; j += 4) {
+        const int_T     m    = (n-j > 4) ? 4 : n-j;
+        const boolean_T last = (j+m == n);
+        const real_T    *f0  = f[j];
+        const real_T    *f1  = (m > 1) ? f[j+1] : f0;
+        const real_T    *f2  = (m > 2) ? f[j+2] : f0;
+        const real_T    *f3  = (m > 3) ? f[j+3] : f0;
+        const real_T    c0   = c[j];
+        const real_T    c1   = (m > 1) ? c[j+1] : 0.0;
+        const real_T    c2   = (m > 2) ? c[j+2] : 0.0;
+        const real_T    c3   = (m > 3) ? c[j+3] : 0.0;
+
+        switch (m) {
+          case 1:
+            RT_ODE_PASS(RT_ODE_T1)
+            break;
+          case 2:
+            RT_ODE_PASS(RT_ODE_T2)
+            break;
+          case 3:
+            RT_ODE_PASS(RT_ODE_T3)
+            break;
+          default:
+            RT_ODE_PASS(RT_ODE_T4)
+            break;
+        }
+    }
+}
+
+#undef RT_ODE_T1
+#undef RT_ODE_T2
+#undef RT_ODE_T3
+#undef RT_ODE_T4
+#undef RT_ODE_LOOP
+#undef RT_ODE_PASS
+
+#ifdef ODE_ADAPTIVE_STEP
+
+/*
+ * Adaptive step mode of ode5 and ode8, for non-real-time targets such as
+ * rsim.  Each call of rt_ODEUpdateContinuousStates still advances the states
+ * from t to the solver stop time, but it gets there in as many internal steps
+ * as the embedded error estimate of the solver calls for.  The fixed step
+ * size of the model is then the largest step taken.
+ */
+#ifndef ODE_ADAPTIVE_RELTOL
+# define ODE_ADAPTIVE_RELTOL 1.0e-3
+#endif
+#ifndef ODE_ADAPTIVE_ABSTOL
+# define ODE_ADAPTIVE_ABSTOL 1.0e-6
+#endif
+
+typedef struct ODEAdaptiveData_tag {
+    real_T   relTol;
+    real_T   absTol;
+    time_T   h;              /* next internal step, 0 before the first */
+    uint32_T nSteps;         /* accepted internal steps */
+    uint32_T nFailedSteps;   /* rejected internal steps */
+    uint32_T nDerivatives;   /* derivative evaluations */
+} ODEAdaptiveData;
+
+const char *RT_ODE_MIN_STEP_ERROR =
+    "Adaptive step mode: the step size fell below the minimum at the "
+    "current time; relax ODE_ADAPTIVE_RELTOL/ODE_ADAPTIVE_ABSTOL";
+
+void rt_ODEAdaptiveInit(ODEAdaptiveData *ad)
+{
+    ad->relTol       = ODE_ADAPTIVE_RELTOL;
+    ad->absTol       = ODE_ADAPTIVE_ABSTOL;
+    ad->h            = 0.0;
+    ad->nSteps       = 0;
+    ad->nFailedSteps = 0;
+    ad->nDerivatives = 0;
+}
+
+/*
+ * Weighted max norm of the local error estimate e = f[0]*c[0] + ... +
+ * f[n-1]*c[n-1] of the step from y to ynew.  A step is acceptable when the
+ * norm is at most 1, that is when no state is off by more than relTol times
+ * its size or absTol, whichever is larger.
+ */
+real_T rt_ODEErrorNorm(const real_T          *y,
+                       const real_T          *ynew,
+                       real_T                *const *f,
+                       const real_T          *c,
+                       int_T                 n,
+                       int_T                 nXc,
+                       const ODEAdaptiveData *ad)
+{
+    real_T err = 0.0;
+    int_T  i, j;
+
+    for (i = 0; i < nXc; i++) {
+        real_T e  = 0.0;
+        real_T sc = (fabs(y[i]) > fabs(ynew[i])) ? fabs(y[i]) : fabs(ynew[i]);
+
+        for (j = 0; j < n; j++) {
+            e += f[j][i]*c[j];
+        }
+        sc *= ad->relTol;
+        if (sc < ad->absTol) sc = ad->absTol;
+        e = fabs(e)/sc;
+        if (e != e) return(e);       /* NaN fails the step */
+        if (e > err) err = e;
+    }
+    return(err);
+}
+
+/*
+ * Next internal step after a step of size h at time t with error norm err,
+ * for an error estimate of order q (the lower order of the pair).  The step
+ * grows by at most 5 after an accepted step and does not grow after a
+ * rejected one.  Returns 0 when the step would be too small to advance t.
+ */
+time_T rt_ODEAdaptiveStepSize(time_T h, real_T err, int_T q, time_T t)
+{
+    real_T fac;
+
+    if (err == 0.0) {
+        fac = 5.0;
+    } else if (err != err) {
+        fac = 0.1;
+    } else {
+        fac = 0.9*pow(err, -1.0/(q+1));
+        if (fac < 0.1) fac = 0.1;
+        if (fac > ((err <= 1.0) ? 5.0 : 1.0)) fac = (err <= 1.0) ? 5.0 : 1.0;
+    }
+    h *= fac;
+    return((h < 16.0*DBL_EPSILON*fabs(t)) ? 0.0 : h);
+}
+
+void rt_ODESetTolerances(RTWSolverInfo *si,
+                         real_T        relTol,
+                         real_T        absTol);
+
+void rt_ODEGetStatistics(RTWSolverInfo *si,
+                         uint32_T      *nSteps,
+                         uint32_T      *nFailedSteps,
+                         uint32_T      *nDerivatives);
+
+#endif /* ODE_ADAPTIVE_STEP */
+
+void rt_ODE14xGetStatistics(RTWSolverInfo *si,
+                            uint32_T      *nJacobians,
+                            uint32_T      *nFactorizations);
+
+#ifdef ODE14X_SPARSE_JACOBIAN
+void rt_ODE14xSetJacobianPattern(RTWSolverInfo *si,
+                                 const int_T   *Jc,
+                                 const int_T   *Ir);
+#endif
+
+#ifdef ODE14X_PARALLEL_JACOBIAN
+typedef void (*rt_ODE14xWorkerSyncFcn)(void *copy, const void *model);
+
+void rt_ODE14xSetJacobianWorkers(RTWSolverInfo          *si,
+                                 int_T                  nWorkers,
+                                 RTWSolverInfo *const   *workers,
+                                 rt_ODE14xWorkerSyncFcn sync);
+#endif
+
 #define REDUCTION(si) if (rtsiGetNumPeriodicContStates(si) > 0)                     \
                           rt_ODEStateReduction(rtsiGetContStates(si),               \
                                                rtsiGetPeriodicContStateIndices(si), \
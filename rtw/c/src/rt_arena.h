@@ -0,0 +1,64 @@
+/*
+ * Copyright 2016 The MathWorks, Inc.
+ *
+ * File: rt_arena.h
+ *
+ * Abstract:
+ *      Workspace arena for RT_MALLOC models.  A module owning a header
+ *      struct and its work vectors lays the vectors out twice with
+ *      rtArenaTake(): first on an arena without memory, which sizes the
+ *      block, then on the block allocated with RT_ARENA_MALLOC.  The header
+ *      is at the start of the block and each vector starts on its own
+ *      RT_ARENA_ALIGN boundary, in the order taken, so the vectors used in
+ *      every step should be taken first.  One RT_ARENA_FREE of the header
+ *      releases everything, and there is nothing to undo when the
+ *      allocation fails.
+ *
+ *      RT_ARENA_MALLOC and RT_ARENA_FREE default to malloc and free.  An
+ *      application running many model instances can define both to carve
+ *      the blocks out of a per-instance pool of its own.
+ */
+
+#ifndef rt_arena_h
+#define rt_arena_h
+
+#include <stddef.h>
+#include <stdlib.h>
+
+/* Alignment of the vectors, a power of two: one cache line */
+#ifndef RT_ARENA_ALIGN
+# define RT_ARENA_ALIGN 64
+#endif
+
+#ifndef RT_ARENA_MALLOC
+# define RT_ARENA_MALLOC(n) malloc(n)
+# define RT_ARENA_FREE(p)   free(p)
+#endif
+
+typedef struct rtArena_tag {
+    char   *base;       /* start of the block, NULL while sizing */
+    size_t used;        /* bytes of the block laid out so far */
+} rtArena;
+
+/* Start laying out the block mem (NULL to size it) after a header of hdr
+ * bytes */
+#define rtArenaInit(a,mem,hdr) ((a)->base = (char *)(mem), (a)->used = (hdr))
+
+/* Bytes from the end of the layout to the next RT_ARENA_ALIGN boundary */
+#define rtArenaPad(a)                                                   \
+    ((RT_ARENA_ALIGN - ((size_t)(a)->base + (a)->used) % RT_ARENA_ALIGN) \
+     % RT_ARENA_ALIGN)
+
+/* The next n aligned bytes of the block, NULL while sizing.  n is evaluated
+ * twice. */
+#define rtArenaTake(a,n)                                                \
+    ((a)->used += rtArenaPad(a) + (size_t)(n),                          \
+     (a)->base == NULL ? NULL : (void *)((a)->base + (a)->used - (size_t)(n)))
+
+/* Size of the block for the layout sized on a, whatever the alignment of
+ * the block RT_ARENA_MALLOC returns */
+#define rtArenaSize(a) ((a)->used + RT_ARENA_ALIGN - 1)
+
+#endif /* rt_arena_h */
+
+/* [EOF] rt_arena.h */
@@ -16,18 +16,93 @@
  *         [u]int16_T    to be int32_T (logged as Matlab [u]int32)
  *         real_T        to be real32_T (logged as Matlab single)
  *
+ *      Log variables whose number of rows is not known at start grow in
+ *      blocks: a full buffer is kept as it is and logging continues in a new
+ *      buffer of twice the size (at most MAX_LOG_CHUNK_SIZE bytes), so rows
+ *      are never copied while the simulation runs.
+ *
+ *      When compiled with -DLOG_COLUMN_MAJOR, log variables that are
+ *      transposed in the MAT-file (one row of nCols elements per time step)
+ *      store each column contiguously while logging, so the data is written
+ *      to the MAT-file at the end of the simulation without a transpose.
+ *
+ *      When compiled with -DMAT_FILE_COMPRESSION, each variable is written
+ *      to the MAT-file as a zlib compressed miCOMPRESSED element, deflated
+ *      as it is written (MAT_FILE_COMPRESSION_LEVEL sets the zlib level).
+ *      This requires linking with -lz.
+ *
+ *      When compiled with -DBACKGROUND_LOGGING (POSIX threads and a GCC
+ *      compatible compiler), rt_UpdateTXYLogVars() only copies the raw
+ *      signal bytes of each row into a lock-free single-producer/single-
+ *      consumer ring per log variable.  A logging thread does the data type
+ *      conversion, decimation and storage.  Each ring starts with
+ *      BACKGROUND_LOGGING_RING_ROWS rows.  The model thread never waits for
+ *      the logging thread: when a ring is full it grows by a segment of
+ *      twice the size.  Only if that allocation fails is the time step not
+ *      logged, and the number of such steps is printed to stderr when
+ *      logging stops.  Variable-size signals and xFinal are still logged by
+ *      the model thread.
+ *
+ *      When compiled with -DSTREAM_LOGGING_TO_DISK, log variables whose
+ *      buffers would otherwise grow with the simulation length keep only
+ *      STREAM_LOGGING_BLOCK_SIZE rows in memory.  Each full block of rows is
+ *      handed to a background thread which appends it to a spool file, and
+ *      the MAT-file is assembled from the spool file at the end of the
+ *      simulation.  Define STREAM_LOGGING_NO_THREAD to write the blocks from
+ *      the model thread instead (this is the default on Windows).  The
+ *      threaded writer requires linking with -lpthread.
+ *
  */
 
+#if defined(BACKGROUND_LOGGING) && defined(_WIN32)
+# undef BACKGROUND_LOGGING              /* requires POSIX threads */
+#endif
+
+#if defined(BACKGROUND_LOGGING) && !defined(_POSIX_C_SOURCE)
+# define _POSIX_C_SOURCE 200112L        /* nanosleep() */
+#endif
+
+#if defined(STREAM_LOGGING_TO_DISK) && !defined(_WIN32)
+/* Spool files can be larger than 2GB, use a 64-bit off_t */
+# ifndef _FILE_OFFSET_BITS
+#  define _FILE_OFFSET_BITS 64
+# endif
+# ifndef _LARGEFILE_SOURCE
+#  define _LARGEFILE_SOURCE
+# endif
+#endif
+
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <limits.h>
 #include <math.h>
 
+#ifdef STREAM_LOGGING_TO_DISK
+# if defined(_WIN32)
+#  include <process.h>
+# else
+#  include <sys/types.h>
+#  include <unistd.h>
+#  ifndef STREAM_LOGGING_NO_THREAD
+#   define STREAM_LOGGING_THREADED
+#   include <pthread.h>
+#  endif
+# endif
+#endif
+
+#ifdef BACKGROUND_LOGGING
+# include <pthread.h>
+# include <time.h>
+#endif
+
 
 #if !defined(MAT_FILE) || (defined(MAT_FILE) && MAT_FILE == 1)
 
 #include <stddef.h>                     /* size_t */
+#ifdef MAT_FILE_COMPRESSION
+#include <zlib.h>
+#endif
 #include "rt_logging.h"
 #include "rt_mxclassid.h"
 #include "rtw_matlogging.h"
@@ -48,6 +123,7 @@
 #define matINT64                   12
 #define matUINT64                  13
 #define	matMATRIX                  14
+#define	matCOMPRESSED              15
 
 #define matLOGICAL_BIT          0x200
 #define matCOMPLEX_BIT          0x800
@@ -63,6 +139,31 @@
 #define DEFAULT_BUFFER_SIZE      1024  /* used if maxRows=0 and Tfinal=0.0    */
 #endif
 
+#ifdef STREAM_LOGGING_TO_DISK
+# ifndef STREAM_LOGGING_BLOCK_SIZE
+#  define STREAM_LOGGING_BLOCK_SIZE 1024 /* rows kept in memory per log var   */
+# endif
+#endif
+
+#ifdef MAT_FILE_COMPRESSION
+# ifndef MAT_FILE_COMPRESSION_LEVEL
+#  define MAT_FILE_COMPRESSION_LEVEL Z_BEST_SPEED
+# endif
+#endif
+
+#ifdef BACKGROUND_LOGGING
+# ifndef BACKGROUND_LOGGING_RING_ROWS
+#  define BACKGROUND_LOGGING_RING_ROWS 4096 /* initial rows per log variable */
+# endif
+# ifndef BACKGROUND_LOGGING_POLL_NS
+#  define BACKGROUND_LOGGING_POLL_NS  1000000 /* idle logging thread sleep */
+# endif
+#endif
+
+#ifndef MAX_LOG_CHUNK_SIZE
+#define MAX_LOG_CHUNK_SIZE  0x1000000  /* bytes, limits the growth of blocks */
+#endif
+
 #define FREE(m) if (m != NULL) free(m)
 
 /* Logical definitions */
@@ -90,6 +191,17 @@ typedef struct LogInfo_Tag {
     StructLogVar *structLogVarsList;   /* Linked list of all StructLogVars    */
 
     boolean_T   haveLogVars;           /* Are logging one or more vars?       */
+
+    LogSpool     *spool;               /* Spool file for streamed LogVars     */
+
+#ifdef BACKGROUND_LOGGING
+    LogRing      *rings;               /* Rings served by the logging thread  */
+    pthread_t    logThread;
+    boolean_T    logThreadRunning;
+    int          logThreadStop;        /* Set to stop the logging thread      */
+    size_t       nDroppedSteps;        /* Steps not logged, a ring could not  */
+                                       /* grow                                */
+#endif
 } LogInfo;
 
 typedef struct MatItem_tag {
@@ -98,6 +210,15 @@ typedef struct MatItem_tag {
   const void *data;
 } MatItem;
 
+typedef struct MatFile_tag {
+  FILE       *fp;
+#ifdef MAT_FILE_COMPRESSION
+  boolean_T  deflating;                /* writing a miCOMPRESSED element?     */
+  z_stream   zs;
+  Bytef      zbuf[16384];              /* deflated bytes to write to fp       */
+#endif
+} MatFile;
+
 typedef enum {
     DATA_ITEM,
     MATRIX_ITEM,
@@ -105,6 +226,125 @@ typedef enum {
     SIGNALS_STRUCT_ITEM
 } ItemDataKind;
 
+#ifdef BACKGROUND_LOGGING
+
+/*
+ * Rows of a log variable waiting for the logging thread, in a chain of
+ * segments.  In each segment the model thread only advances head and the
+ * logging thread only advances tail, so neither takes a lock; both count
+ * rows since the segment was created.  When its segment is full, the model
+ * thread links a new one twice the size as newer and continues there; the
+ * logging thread frees a segment once it has seen newer and logged the
+ * rest of the segment.
+ */
+typedef struct LogRingSeg_Tag LogRingSeg;
+struct LogRingSeg_Tag {
+    char_T     *buf;              /* nRows rows of rowSize bytes              */
+    size_t     nRows;
+    size_t     head;              /* rows pushed by the model thread          */
+    size_t     tail;              /* rows logged by the logging thread        */
+    LogRingSeg *newer;            /* set once the model thread moved on       */
+};
+
+struct LogRing_Tag {
+    LogVar     *var;
+    size_t     rowSize;           /* raw bytes passed to rt_UpdateLogVar()    */
+    boolean_T  discontiguous;     /* rows of rt_UpdateLogVarWith-             */
+                                  /* DiscontiguousData() (states)             */
+    LogRingSeg *pushSeg;          /* segment the model thread fills           */
+    LogRingSeg *drainSeg;         /* segment the logging thread empties       */
+    LogRing    *next;
+};
+
+#endif /* BACKGROUND_LOGGING */
+
+#ifdef STREAM_LOGGING_TO_DISK
+
+#if defined(_WIN32)
+typedef __int64 LogFileOffset;
+# define rt_SeekLogSpool(fp, offset) _fseeki64((fp), (offset), SEEK_SET)
+# define rt_GetPid()                 _getpid()
+#else
+typedef off_t   LogFileOffset;
+# define rt_SeekLogSpool(fp, offset) fseeko((fp), (offset), SEEK_SET)
+# define rt_GetPid()                 getpid()
+#endif
+
+#endif /* STREAM_LOGGING_TO_DISK */
+
+/*
+ * Rows of a log variable that outgrew its initial buffer.  The blocks of a
+ * variable are written to the MAT-file one after the other, without being
+ * copied into a single buffer first.  Blocks of log variables that are
+ * transposed in the MAT-file (nDims < 2 and nCols > 1) and blocks of
+ * valueDimensions are stored column-major when the MAT-file is written,
+ * column j of such a block starts at element j*ld.
+ */
+struct LogBlock_Tag {
+    int_T         nRows;          /* number of rows in the block              */
+    void          *re;            /* rows held in memory, NULL if the block   */
+    void          *im;            /* is in the spool file                     */
+    boolean_T     view;           /* re and im point into memory owned by a   */
+                                  /* previous block or by the log variable    */
+    int_T         ld;             /* distance between columns, in elements,   */
+                                  /* of blocks stored column-major            */
+#ifdef STREAM_LOGGING_TO_DISK
+    LogFileOffset reOffset;       /* spool file offset of the real part       */
+    LogFileOffset imOffset;       /* spool file offset of the imaginary part  */
+#endif
+    LogBlock      *next;
+};
+
+#ifdef STREAM_LOGGING_TO_DISK
+
+/*
+ * A block of rows waiting to be written to the spool file.  Each LogStream
+ * owns one job, i.e., at most one block per log variable is in flight.
+ */
+typedef struct LogSpoolJob_Tag {
+    LogVar     *var;
+    void       *re;               /* buffers holding the rows of the block    */
+    void       *im;
+    real_T     *dimsData;
+    int_T      nRows;             /* rows in the block                        */
+    int_T      maxRows;           /* rows the buffers were allocated for      */
+    LogBlock   *block;            /* spool records to fill in                 */
+    LogBlock   *dimsBlock;
+    struct LogSpoolJob_Tag *next;
+} LogSpoolJob;
+
+struct LogStream_Tag {
+    LogSpool    *spool;
+    LogBlock    *lastBlock;       /* tail of data.blocks                      */
+    LogBlock    *lastDimsBlock;   /* tail of valDims->blocks                  */
+    void        *spareRe;         /* second set of buffers, filled by the     */
+    void        *spareIm;         /* model while the previous block is being  */
+    real_T      *spareDims;       /* written to the spool file                */
+    int_T       nRows;            /* number of rows in the spool file         */
+    boolean_T   busy;             /* is job queued or being written?          */
+    LogSpoolJob job;
+};
+
+struct LogSpool_Tag {
+    FILE            *fp;
+    char_T          fileName[mxMAXNAM];
+    LogFileOffset   size;         /* current size of the spool file           */
+    boolean_T       error;        /* a write to the spool file failed         */
+    void            *scratch;     /* buffer used to transpose a block         */
+    size_t          scratchSize;
+#ifdef STREAM_LOGGING_THREADED
+    pthread_t       thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;         /* signaled when a job is queued or done    */
+    boolean_T       running;      /* is the writer thread running?            */
+    boolean_T       stopRequested;
+    LogSpoolJob     *head;        /* queue of blocks waiting to be written    */
+    LogSpoolJob     *tail;
+#endif
+};
+
+#endif /* STREAM_LOGGING_TO_DISK */
+
 /*===========*
  * Constants *
  *===========*/
@@ -331,24 +571,10 @@ static double rt_GetDblValueFromOverSizedData(
     int fixedExp, 
     double bias)
 {
-    double retValue = 0;
-
-    double *dblValue = (double *) calloc(numOfChunk, sizeof(double));
-
-    int i;    
+    double retValue;
+    double prevValue;
     double isSignedNeg;
-
-    if(isSigned) {
-        const chunk_T *pData = (const chunk_T *) (pVoid);
-        for (i = 0; i <numOfChunk; i++) {
-            dblValue[i] = (double)(pData[i]);
-        }
-    } else  {
-        const uchunk_T *pData = (const uchunk_T *) (pVoid);
-        for (i = 0; i <numOfChunk; i++) {
-            dblValue[i] = (double)(pData[i]);
-        }
-    }
+    int    i;
 
     /* 
        Assuming multi chunks b_n ... b_2 b_1 b_0, and the length of each chunk is N.
@@ -362,24 +588,202 @@ static double rt_GetDblValueFromOverSizedData(
        Together:
        retValue = 
        (b_n + isSigned * (b_(n-1)<0)) * 2^(n*N) +... + (b_1 + isSigned * (b_0<0)) * 2^N + b_0 * 2^0;
+
+       The chunks are read in place, this is called for every logged element.
     */
+#define CHUNK_VALUE(idx) (isSigned ? (double)((const chunk_T *)pVoid)[idx] : \
+                                     (double)((const uchunk_T *)pVoid)[idx])
 
-    retValue = dblValue[numOfChunk - 1];
+    retValue = CHUNK_VALUE(numOfChunk - 1);
     
     for(i = numOfChunk - 1; i > 0; i--) {
-        isSignedNeg = dblValue[i - 1] < 0 ? (double)isSigned : 0;
+        prevValue   = CHUNK_VALUE(i - 1);
+        isSignedNeg = prevValue < 0 ? (double)isSigned : 0;
         retValue = retValue + isSignedNeg;
 
-        retValue = ldexp(retValue, bitsPerChunk)+ dblValue[i-1];
+        retValue = ldexp(retValue, bitsPerChunk)+ prevValue;
     }
     retValue = ldexp( fracSlope * retValue, fixedExp ) + bias;
 
-    FREE(dblValue);
+#undef CHUNK_VALUE
+
     return (retValue);
 
 } /* end rt_GetDblValueFromOverSizedData */
 
 
+/*
+ * Element kernels
+ *
+ * rt_UpdateLogVar() stores the elements of a fixed-size row with the kernel
+ * selected by rt_CreateLogVarWithConvert(), instead of dispatching on the
+ * data types for every element.  A kernel copies or converts n elements
+ * that are srcStride bytes apart in the signal to dst, dstStep bytes apart.
+ * When both are contiguous the loops are simple enough for the compiler to
+ * vectorize.
+ */
+
+#define LOG_COPY_KERNEL(sz)                                                   \
+static void rt_LogCopy##sz(const RTWLogDataTypeConvert *convert,              \
+                           const char_T *src, size_t srcStride,               \
+                           char_T *dst, size_t dstStep, int_T n)              \
+{                                                                             \
+    int_T k;                                                                  \
+                                                                              \
+    (void)convert;                                                            \
+    if (srcStride == sz && dstStep == sz) {                                   \
+        (void)memcpy(dst, src, (size_t)n*sz);                                 \
+        return;                                                               \
+    }                                                                         \
+    for (k = 0; k < n; k++) {                                                 \
+        (void)memcpy(dst, src, sz);                                           \
+        src += srcStride;                                                     \
+        dst += dstStep;                                                       \
+    }                                                                         \
+}
+
+LOG_COPY_KERNEL(1)
+LOG_COPY_KERNEL(2)
+LOG_COPY_KERNEL(4)
+LOG_COPY_KERNEL(8)
+
+#undef LOG_COPY_KERNEL
+
+/* Storing a converted value, logical data is 0 or 1 */
+#define LOG_STORE_VALUE(DstT, v)    ((DstT)(v))
+#define LOG_STORE_LOGICAL(DstT, v)  ((DstT)((v) != 0.0))
+
+/*
+ * Convert y = fracSlope * x * 2^fixedExp + bias.  Multiplying by a power of
+ * two rounds exactly like ldexp(), and without a bias there is nothing a
+ * fused multiply-add could round differently, so the contiguous loop does
+ * not call ldexp() for every element.
+ */
+#define LOG_CONVERT_KERNEL(src, SrcT, dst, DstT, STORE)                       \
+static void rt_LogConvert_##src##_to_##dst(                                   \
+    const RTWLogDataTypeConvert *convert,                                     \
+    const char_T *src_, size_t srcStride,                                     \
+    char_T *dst_, size_t dstStep, int_T n)                                    \
+{                                                                             \
+    double slope    = convert->fracSlope;                                     \
+    int    fixedExp = convert->fixedExp;                                      \
+    double bias     = convert->bias;                                          \
+    int_T  k;                                                                 \
+                                                                              \
+    if (srcStride == sizeof(SrcT) && dstStep == sizeof(DstT) &&               \
+        bias == 0.0 && fixedExp >= -1022 && fixedExp <= 1023) {               \
+        const SrcT *x     = (const SrcT *)src_;                               \
+        DstT       *y     = (DstT *)dst_;                                     \
+        double     scale  = ldexp(1.0, fixedExp);                             \
+                                                                              \
+        for (k = 0; k < n; k++) {                                             \
+            y[k] = STORE(DstT, slope * (double)x[k] * scale + bias);          \
+        }                                                                     \
+        return;                                                               \
+    }                                                                         \
+    for (k = 0; k < n; k++) {                                                 \
+        double v = ldexp(slope * (double)*(const SrcT *)src_, fixedExp) + bias; \
+        *(DstT *)dst_ = STORE(DstT, v);                                       \
+        src_ += srcStride;                                                    \
+        dst_ += dstStep;                                                      \
+    }                                                                         \
+}
+
+#define LOG_CONVERT_KERNELS_FROM(src, SrcT)                                   \
+    LOG_CONVERT_KERNEL(src, SrcT, double,  real_T,    LOG_STORE_VALUE)        \
+    LOG_CONVERT_KERNEL(src, SrcT, single,  real32_T,  LOG_STORE_VALUE)        \
+    LOG_CONVERT_KERNEL(src, SrcT, int8,    int8_T,    LOG_STORE_VALUE)        \
+    LOG_CONVERT_KERNEL(src, SrcT, uint8,   uint8_T,   LOG_STORE_VALUE)        \
+    LOG_CONVERT_KERNEL(src, SrcT, int16,   int16_T,   LOG_STORE_VALUE)        \
+    LOG_CONVERT_KERNEL(src, SrcT, uint16,  uint16_T,  LOG_STORE_VALUE)        \
+    LOG_CONVERT_KERNEL(src, SrcT, int32,   int32_T,   LOG_STORE_VALUE)        \
+    LOG_CONVERT_KERNEL(src, SrcT, uint32,  uint32_T,  LOG_STORE_VALUE)        \
+    LOG_CONVERT_KERNEL(src, SrcT, boolean, boolean_T, LOG_STORE_LOGICAL)
+
+LOG_CONVERT_KERNELS_FROM(double,  real_T)
+LOG_CONVERT_KERNELS_FROM(single,  real32_T)
+LOG_CONVERT_KERNELS_FROM(int8,    int8_T)
+LOG_CONVERT_KERNELS_FROM(uint8,   uint8_T)
+LOG_CONVERT_KERNELS_FROM(int16,   int16_T)
+LOG_CONVERT_KERNELS_FROM(uint16,  uint16_T)
+LOG_CONVERT_KERNELS_FROM(int32,   int32_T)
+LOG_CONVERT_KERNELS_FROM(uint32,  uint32_T)
+LOG_CONVERT_KERNELS_FROM(boolean, boolean_T)
+
+#define LOG_CONVERT_KERNELS_ROW(src)                                          \
+    { rt_LogConvert_##src##_to_double, rt_LogConvert_##src##_to_single,       \
+      rt_LogConvert_##src##_to_int8,   rt_LogConvert_##src##_to_uint8,        \
+      rt_LogConvert_##src##_to_int16,  rt_LogConvert_##src##_to_uint16,       \
+      rt_LogConvert_##src##_to_int32,  rt_LogConvert_##src##_to_uint32,       \
+      rt_LogConvert_##src##_to_boolean }
+
+/* Indexed by the original and the logged BuiltInDTypeId */
+static const LogElementsFcn
+rtLogConvertKernels[SS_NUM_BUILT_IN_DTYPE][SS_NUM_BUILT_IN_DTYPE] = {
+    LOG_CONVERT_KERNELS_ROW(double),
+    LOG_CONVERT_KERNELS_ROW(single),
+    LOG_CONVERT_KERNELS_ROW(int8),
+    LOG_CONVERT_KERNELS_ROW(uint8),
+    LOG_CONVERT_KERNELS_ROW(int16),
+    LOG_CONVERT_KERNELS_ROW(uint16),
+    LOG_CONVERT_KERNELS_ROW(int32),
+    LOG_CONVERT_KERNELS_ROW(uint32),
+    LOG_CONVERT_KERNELS_ROW(boolean)
+};
+
+#undef LOG_CONVERT_KERNELS_ROW
+#undef LOG_CONVERT_KERNELS_FROM
+#undef LOG_CONVERT_KERNEL
+#undef LOG_STORE_LOGICAL
+#undef LOG_STORE_VALUE
+
+
+/* Function: rt_GetLogCopyKernel ===============================================
+ * Abstract:
+ *      Get the kernel copying elements of elSize bytes, NULL if there is none.
+ */
+static LogElementsFcn rt_GetLogCopyKernel(size_t elSize)
+{
+    switch (elSize) {
+      case 1: return(rt_LogCopy1);
+      case 2: return(rt_LogCopy2);
+      case 4: return(rt_LogCopy4);
+      case 8: return(rt_LogCopy8);
+      default: return(NULL);
+    }
+
+} /* end rt_GetLogCopyKernel */
+
+
+/* Function: rt_GetLogConvertKernel ============================================
+ * Abstract:
+ *      Get the kernel storing the elements of a fixed-size signal logged with
+ *      the given conversion.  NULL if rt_UpdateLogVar() has to use the
+ *      element-wise loop: multiword and biglong data, and complex logical
+ *      data whose imaginary part repeats the real part.
+ */
+static LogElementsFcn rt_GetLogConvertKernel(
+    const RTWLogDataTypeConvert *convert,
+    size_t                      elSize,
+    boolean_T                   complex)
+{
+    DTypeId original = convert->dataTypeIdOriginal;
+    DTypeId loggedTo = (DTypeId)convert->dataTypeIdLoggingTo;
+
+    if (!convert->conversionNeeded) {
+        return(rt_GetLogCopyKernel(elSize));
+    }
+    if (convert->numOfChunk > 1 ||
+        original < 0 || original >= SS_NUM_BUILT_IN_DTYPE ||
+        loggedTo < 0 || loggedTo >= SS_NUM_BUILT_IN_DTYPE ||
+        (complex && original == SS_BOOLEAN)) {
+        return(NULL);
+    }
+    return(rtLogConvertKernels[original][loggedTo]);
+
+} /* end rt_GetLogConvertKernel */
+
+
 /* Function: rt_GetNonBoolMxIdFromDTypeId ======================================
  * Abstract:
  *      Get the mx???_CLASS given the simulink builtin data type id.
@@ -589,8 +993,697 @@ static int_T rt_GetMatIdFromMxId(mxClassID mxID)
 } /* end rt_GetMatIdFromMxId */
 
 
+/* Function: rt_WriteToMatFile =================================================
+ * Abstract:
+ *      Write nbytes to the MAT-file, through the compressor while a
+ *      miCOMPRESSED element is being written.
+ *      Return values is
+ *          == 0 : upon success
+ *          <> 0 : upon failure
+ */
+static int_T rt_WriteToMatFile(MatFile *fp, const void *data, size_t nbytes)
+{
+#ifdef MAT_FILE_COMPRESSION
+    if (fp->deflating) {
+        z_stream *zs = &fp->zs;
+
+        zs->next_in  = (Bytef*)data;   /* not modified by deflate */
+        zs->avail_in = (uInt)nbytes;
+        do {
+            size_t n;
+
+            zs->next_out  = fp->zbuf;
+            zs->avail_out = sizeof(fp->zbuf);
+            if (deflate(zs, Z_NO_FLUSH) == Z_STREAM_ERROR) return(1);
+            n = sizeof(fp->zbuf) - zs->avail_out;
+            if (fwrite(fp->zbuf, 1, n, fp->fp) != n) return(1);
+        } while (zs->avail_out == 0);
+        return(0);
+    }
+#endif
+    return(fwrite(data, 1, nbytes, fp->fp) != nbytes);
+
+} /* end rt_WriteToMatFile */
+
+
+/*
+ * Copy one tile of the transpose, see rt_TransposeLogRows().  With a
+ * constant elSize the memcpy compiles to a single load and store.
+ */
+#define LOG_TRANSPOSE_TILE   32    /* tile edge, in elements                */
+
+#define LOG_TRANSPOSE_TILE_COPY(sz)                                         \
+    for (i = i0; i < i1; i++) {                                             \
+        const char_T *s = src + ((size_t)i*nCols + j0)*(sz);                \
+        char_T       *d = dst + ((size_t)j0*nRows + i)*(sz);                \
+        for (j = j0; j < j1; j++) {                                         \
+            (void)memcpy(d, s, (sz));                                       \
+            s += (sz);                                                      \
+            d += (size_t)nRows*(sz);                                        \
+        }                                                                   \
+    }
+
+/* Function: rt_TransposeLogRows ===============================================
+ * Abstract:
+ *      Transpose nRows rows of nCols elements each into column-major order.
+ *      The matrix is copied in square tiles so that both the rows read and
+ *      the columns written stay in the cache, with separate copy loops for
+ *      elements of 1, 2, 4 and 8 bytes.
+ */
+static void rt_TransposeLogRows(char_T       *dst,
+                                const char_T *src,
+                                int_T        nRows,
+                                int_T        nCols,
+                                size_t       elSize)
+{
+    int_T i0, j0;
+
+    for (i0 = 0; i0 < nRows; i0 += LOG_TRANSPOSE_TILE) {
+        int_T i1 = (nRows - i0 > LOG_TRANSPOSE_TILE) ?
+            i0 + LOG_TRANSPOSE_TILE : nRows;
+
+        for (j0 = 0; j0 < nCols; j0 += LOG_TRANSPOSE_TILE) {
+            int_T j1 = (nCols - j0 > LOG_TRANSPOSE_TILE) ?
+                j0 + LOG_TRANSPOSE_TILE : nCols;
+            int_T i, j;
+
+            switch (elSize) {
+              case 1:
+                LOG_TRANSPOSE_TILE_COPY(1);
+                break;
+              case 2:
+                LOG_TRANSPOSE_TILE_COPY(2);
+                break;
+              case 4:
+                LOG_TRANSPOSE_TILE_COPY(4);
+                break;
+              case 8:
+                LOG_TRANSPOSE_TILE_COPY(8);
+                break;
+              default:
+                LOG_TRANSPOSE_TILE_COPY(elSize);
+                break;
+            }
+        }
+    }
+
+} /* end rt_TransposeLogRows */
+
+
+/* Function: rt_DestroyLogBlocks ===============================================
+ * Abstract:
+ *      Free a list of blocks and the rows they hold in memory.
+ */
+static void rt_DestroyLogBlocks(LogBlock *head)
+{
+    while (head != NULL) {
+        LogBlock *block = head;
+        head = block->next;
+        if (!block->view) {
+            FREE(block->re);
+            FREE(block->im);
+        }
+        FREE(block);
+    }
+
+} /* end rt_DestroyLogBlocks */
+
+
+#ifdef STREAM_LOGGING_TO_DISK
+
+
+/* Function: rt_WriteToLogSpool ================================================
+ * Abstract:
+ *      Append nbytes to the end of the spool file and return the file offset
+ *      at which they were written.
+ */
+static LogFileOffset rt_WriteToLogSpool(LogSpool   *spool,
+                                        const void *data,
+                                        size_t     nbytes)
+{
+    LogFileOffset offset = spool->size;
+
+    if (!spool->error) {
+        if (rt_SeekLogSpool(spool->fp, offset) != 0 ||
+            fwrite(data, 1, nbytes, spool->fp) != nbytes) {
+            (void)fprintf(stderr, "*** Error writing to logging spool file "
+                          "%s\n", spool->fileName);
+            spool->error = true;
+        }
+    }
+    spool->size += (LogFileOffset)nbytes;
+    return(offset);
+
+} /* end rt_WriteToLogSpool */
+
+
+/* Function: rt_WriteLogSpoolJob ===============================================
+ * Abstract:
+ *      Write one block of rows to the spool file.  Blocks of log variables
+ *      that are transposed in the MAT-file are written in column-major order
+ *      so that each column of the block is contiguous in the spool file.
+ */
+static void rt_WriteLogSpoolJob(LogSpool *spool, LogSpoolJob *job)
+{
+    const LogVar *var       = job->var;
+    size_t       elSize     = var->data.elSize;
+    int_T        nCols      = var->data.nCols;
+    size_t       nbytes     = job->nRows*nCols*elSize;
+    boolean_T    transpose  = (var->data.nDims < 2 && nCols > 1 &&
+                               !var->colMajor);
+    const void   *re        = job->re;
+    const void   *im        = job->im;
+
+    if (transpose) {
+        size_t scratchSize = (im != NULL) ? 2*nbytes : nbytes;
+
+        if (spool->scratchSize < scratchSize) {
+            void *tmp = realloc(spool->scratch, scratchSize);
+            if (tmp == NULL) {
+                (void)fprintf(stderr, "*** Memory allocation error.\n"
+                              "    varName          = %s\n"
+                              "    Failed resize    = %.16g\n\n",
+                              var->data.name, (double)scratchSize);
+                exit(1);
+            }
+            spool->scratch     = tmp;
+            spool->scratchSize = scratchSize;
+        }
+        rt_TransposeLogRows(spool->scratch, re, job->nRows, nCols, elSize);
+        re = spool->scratch;
+        if (im != NULL) {
+            char_T *imT = (char_T*)spool->scratch + nbytes;
+            rt_TransposeLogRows(imT, im, job->nRows, nCols, elSize);
+            im = imT;
+        }
+    }
+
+    job->block->nRows = job->nRows;
+    job->block->ld    = job->nRows;
+    if (var->colMajor) {
+        /* Write the logged rows of each column of the buffers */
+        size_t colSize = job->nRows*elSize;
+        int_T  j;
+
+        job->block->reOffset = spool->size;
+        for (j = 0; j < nCols; j++) {
+            (void)rt_WriteToLogSpool(spool, (const char_T*)re +
+                                     j*job->maxRows*elSize, colSize);
+        }
+        if (im != NULL) {
+            job->block->imOffset = spool->size;
+            for (j = 0; j < nCols; j++) {
+                (void)rt_WriteToLogSpool(spool, (const char_T*)im +
+                                         j*job->maxRows*elSize, colSize);
+            }
+        }
+    } else {
+        job->block->reOffset = rt_WriteToLogSpool(spool, re, nbytes);
+        if (im != NULL) {
+            job->block->imOffset = rt_WriteToLogSpool(spool, im, nbytes);
+        }
+    }
+
+    /* valueDimensions are stored column-major with maxRows rows */
+    if (job->dimsBlock != NULL) {
+        int_T j;
+
+        job->dimsBlock->nRows    = job->nRows;
+        job->dimsBlock->ld       = job->nRows;
+        job->dimsBlock->reOffset = spool->size;
+        for (j = 0; j < var->valDims->nCols; j++) {
+            (void)rt_WriteToLogSpool(spool, job->dimsData + j*job->maxRows,
+                                     job->nRows*sizeof(real_T));
+        }
+    }
+
+} /* end rt_WriteLogSpoolJob */
+
+
+#ifdef STREAM_LOGGING_THREADED
+
+/* Function: rt_LogSpoolThread =================================================
+ * Abstract:
+ *      Background thread which writes the queued blocks to the spool file.
+ */
+static void *rt_LogSpoolThread(void *arg)
+{
+    LogSpool *spool = (LogSpool *)arg;
+
+    (void)pthread_mutex_lock(&spool->mutex);
+    for (;;) {
+        LogSpoolJob *job;
+
+        while (spool->head == NULL && !spool->stopRequested) {
+            (void)pthread_cond_wait(&spool->cond, &spool->mutex);
+        }
+        if (spool->head == NULL) break; /* stop requested, queue drained */
+
+        job         = spool->head;
+        spool->head = job->next;
+        if (spool->head == NULL) spool->tail = NULL;
+        (void)pthread_mutex_unlock(&spool->mutex);
+
+        rt_WriteLogSpoolJob(spool, job);
+
+        (void)pthread_mutex_lock(&spool->mutex);
+        job->var->stream->busy = false;
+        (void)pthread_cond_broadcast(&spool->cond);
+    }
+    (void)pthread_mutex_unlock(&spool->mutex);
+    return(NULL);
+
+} /* end rt_LogSpoolThread */
+
+#endif /* STREAM_LOGGING_THREADED */
+
+
+/* Function: rt_SubmitLogSpoolJob ==============================================
+ * Abstract:
+ *      Queue a block for the writer thread, or write it right away if there
+ *      is no writer thread.
+ */
+static void rt_SubmitLogSpoolJob(LogSpool *spool, LogStream *stream)
+{
+    LogSpoolJob *job = &stream->job;
+
+    job->next = NULL;
+#ifdef STREAM_LOGGING_THREADED
+    (void)pthread_mutex_lock(&spool->mutex);
+    if (spool->running) {
+        stream->busy = true;
+        if (spool->tail != NULL) {
+            spool->tail->next = job;
+        } else {
+            spool->head = job;
+        }
+        spool->tail = job;
+        (void)pthread_cond_broadcast(&spool->cond);
+        (void)pthread_mutex_unlock(&spool->mutex);
+        return;
+    }
+    /* Blocks may be submitted by the model and the logging thread */
+    rt_WriteLogSpoolJob(spool, job);
+    (void)pthread_mutex_unlock(&spool->mutex);
+#else
+    rt_WriteLogSpoolJob(spool, job);
+#endif
+
+} /* end rt_SubmitLogSpoolJob */
+
+
+/* Function: rt_WaitForLogStream ===============================================
+ * Abstract:
+ *      Wait until the block last submitted by this log variable is written.
+ */
+static void rt_WaitForLogStream(LogStream *stream)
+{
+#ifdef STREAM_LOGGING_THREADED
+    LogSpool *spool = stream->spool;
+
+    (void)pthread_mutex_lock(&spool->mutex);
+    while (stream->busy) {
+        (void)pthread_cond_wait(&spool->cond, &spool->mutex);
+    }
+    (void)pthread_mutex_unlock(&spool->mutex);
+#else
+    (void)stream;
+#endif
+
+} /* end rt_WaitForLogStream */
+
+
+/* Function: rt_StopLogSpoolThread =============================================
+ * Abstract:
+ *      Write all queued blocks and stop the writer thread.  Blocks submitted
+ *      afterwards are written by the calling thread.
+ */
+static void rt_StopLogSpoolThread(LogSpool *spool)
+{
+#ifdef STREAM_LOGGING_THREADED
+    boolean_T running;
+
+    (void)pthread_mutex_lock(&spool->mutex);
+    running              = spool->running;
+    spool->stopRequested = true;
+    (void)pthread_cond_broadcast(&spool->cond);
+    (void)pthread_mutex_unlock(&spool->mutex);
+
+    if (running) {
+        (void)pthread_join(spool->thread, NULL);
+        spool->running = false;
+    }
+#else
+    (void)spool;
+#endif
+
+} /* end rt_StopLogSpoolThread */
+
+
+/* Function: rt_CreateLogSpool =================================================
+ * Abstract:
+ *      Create a spool file, named after the process ID and a per-process
+ *      count, and start the writer thread.
+ *
+ * Returns:
+ *	~= NULL  => success
+ *	== NULL  => failure, log variables are kept in memory
+ */
+static LogSpool *rt_CreateLogSpool(void)
+{
+    static unsigned long nSpools = 0; /* spools created by this process */
+    LogSpool *spool = calloc(1, sizeof(LogSpool));
+
+    if (spool == NULL) return(NULL);
+
+    /*
+     * The counter keeps the spools of several LogInfo instances in one
+     * process apart, fopen "w+b" would otherwise truncate a spool in use.
+     */
+    (void)sprintf(spool->fileName, "rt_logging_%ld_%lu_rtw_tmw.tmw",
+                  (long)rt_GetPid(), nSpools++);
+    if ((spool->fp = fopen(spool->fileName, "w+b")) == NULL) {
+        (void)fprintf(stderr, "*** Error opening logging spool file %s, "
+                      "logged data is kept in memory\n", spool->fileName);
+        FREE(spool);
+        return(NULL);
+    }
+
+#ifdef STREAM_LOGGING_THREADED
+    (void)pthread_mutex_init(&spool->mutex, NULL);
+    (void)pthread_cond_init(&spool->cond, NULL);
+    spool->running = (pthread_create(&spool->thread, NULL,
+                                     rt_LogSpoolThread, spool) == 0);
+#endif
+
+    return(spool);
+
+} /* end rt_CreateLogSpool */
+
+
+/* Function: rt_DestroyLogSpool ================================================
+ * Abstract:
+ *      Stop the writer thread, then close and delete the spool file.
+ */
+static void rt_DestroyLogSpool(LogSpool *spool)
+{
+    if (spool == NULL) return;
+
+    rt_StopLogSpoolThread(spool);
+#ifdef STREAM_LOGGING_THREADED
+    (void)pthread_cond_destroy(&spool->cond);
+    (void)pthread_mutex_destroy(&spool->mutex);
+#endif
+    (void)fclose(spool->fp);
+    (void)remove(spool->fileName);
+    FREE(spool->scratch);
+    FREE(spool);
+
+} /* end rt_DestroyLogSpool */
+
+
+/* Function: rt_StreamLogVarBlock ==============================================
+ * Abstract:
+ *      Hand the rows logged in the buffers of the log variable to the spool
+ *      file and continue logging into the spare buffers.
+ */
+static void rt_StreamLogVarBlock(LogVar *var)
+{
+    LogStream   *stream  = var->stream;
+    LogSpoolJob *job     = &stream->job;
+    boolean_T   varDims  = (var->valDims != NULL &&
+                            var->valDims->dimsData != NULL);
+    size_t      nbytes   = var->data.nRows*var->data.nCols*var->data.elSize;
+    LogBlock    *block;
+    LogBlock    *dimsBlock = NULL;
+
+    if (var->rowIdx == 0) return;
+
+    /* The spare buffers are free once the previous block is written */
+    rt_WaitForLogStream(stream);
+
+    if ((block = calloc(1, sizeof(LogBlock))) == NULL ||
+        (varDims && (dimsBlock = calloc(1, sizeof(LogBlock))) == NULL)) {
+        (void)fprintf(stderr, "*** Memory allocation error.\n"
+                      "    varName          = %s\n\n", var->data.name);
+        exit(1);
+    }
+    if (stream->lastBlock != NULL) {
+        stream->lastBlock->next = block;
+    } else {
+        var->data.blocks = block;
+    }
+    stream->lastBlock = block;
+    if (varDims) {
+        if (stream->lastDimsBlock != NULL) {
+            stream->lastDimsBlock->next = dimsBlock;
+        } else {
+            var->valDims->blocks = dimsBlock;
+        }
+        stream->lastDimsBlock = dimsBlock;
+    }
+
+    job->var       = var;
+    job->re        = var->data.re;
+    job->im        = var->data.im;
+    job->dimsData  = varDims ? var->valDims->dimsData : NULL;
+    job->nRows     = var->rowIdx;
+    job->maxRows   = var->data.nRows;
+    job->block     = block;
+    job->dimsBlock = dimsBlock;
+    rt_SubmitLogSpoolJob(stream->spool, stream);
+
+    stream->nRows += var->rowIdx;
+    var->rowIdx    = 0;
+
+    /* Continue logging in the spare buffers while the block is written */
+    if (stream->spareRe == NULL) {
+        stream->spareRe = malloc(nbytes);
+        if (var->data.complex) {
+            stream->spareIm = malloc(nbytes);
+        }
+        if (varDims) {
+            stream->spareDims = malloc(var->data.nRows*var->valDims->nCols*
+                                       sizeof(real_T));
+        }
+        if (stream->spareRe == NULL ||
+            (var->data.complex && stream->spareIm == NULL) ||
+            (varDims && stream->spareDims == NULL)) {
+            /* No spare buffers, wait for the block to be written instead */
+            FREE(stream->spareRe);
+            FREE(stream->spareIm);
+            FREE(stream->spareDims);
+            stream->spareRe   = NULL;
+            stream->spareIm   = NULL;
+            stream->spareDims = NULL;
+            rt_WaitForLogStream(stream);
+            return;
+        }
+    }
+    {
+        void *tmp;
+
+        tmp = var->data.re; var->data.re = stream->spareRe; stream->spareRe = tmp;
+        tmp = var->data.im; var->data.im = stream->spareIm; stream->spareIm = tmp;
+        if (varDims) {
+            real_T *dims = var->valDims->dimsData;
+            var->valDims->dimsData = stream->spareDims;
+            stream->spareDims      = dims;
+        }
+    }
+
+} /* end rt_StreamLogVarBlock */
+
+
+/* Function: rt_DestroyLogStream ===============================================
+ * Abstract:
+ *      Free the streaming state of a log variable.
+ */
+static void rt_DestroyLogStream(LogVar *var)
+{
+    LogStream *stream = var->stream;
+
+    if (stream == NULL) return;
+
+    rt_WaitForLogStream(stream);
+    FREE(stream->spareRe);
+    FREE(stream->spareIm);
+    FREE(stream->spareDims);
+    FREE(stream);
+    var->stream = NULL;
+
+} /* end rt_DestroyLogStream */
+
+
+/* Function: rt_CopyLogSpoolToMatFile ==========================================
+ * Abstract:
+ *      Copy nbytes starting at the given offset of the spool file to the
+ *      MAT-file, or to the buffer *dst if fp is NULL.
+ *      Return values is
+ *          == 0 : upon success
+ *          <> 0 : upon failure
+ */
+static int_T rt_CopyLogSpoolToMatFile(MatFile       *fp,
+                                      char_T        **dst,
+                                      LogSpool      *spool,
+                                      LogFileOffset offset,
+                                      size_t        nbytes)
+{
+    char_T buf[8192];
+
+    if (rt_SeekLogSpool(spool->fp, offset) != 0) return(1);
+    if (fp == NULL) {
+        if (fread(*dst, 1, nbytes, spool->fp) != nbytes) return(1);
+        *dst += nbytes;
+        return(0);
+    }
+    while (nbytes > 0) {
+        size_t n = (nbytes < sizeof(buf)) ? nbytes : sizeof(buf);
+
+        if (fread(buf, 1, n, spool->fp) != n) return(1);
+        if (rt_WriteToMatFile(fp, buf, n)) return(1);
+        nbytes -= n;
+    }
+    return(0);
+
+} /* end rt_CopyLogSpoolToMatFile */
+
+
+#endif /* STREAM_LOGGING_TO_DISK */
+
+
+/* Function: rt_CopyLogBlockToMatFile ==========================================
+ * Abstract:
+ *      Copy nbytes starting at the given byte offset into the real or the
+ *      imaginary part of a block to the MAT-file, or to the buffer *dst if fp
+ *      is NULL.
+ *      Return values is
+ *          == 0 : upon success
+ *          <> 0 : upon failure
+ */
+static int_T rt_CopyLogBlockToMatFile(MatFile          *fp,
+                                      char_T           **dst,
+                                      const MatrixData *var,
+                                      const LogBlock   *block,
+                                      boolean_T        imagPart,
+                                      size_t           offset,
+                                      size_t           nbytes)
+{
+    const char_T *src;
+
+#ifdef STREAM_LOGGING_TO_DISK
+    if (var->spool != NULL) {
+        LogFileOffset start = imagPart ? block->imOffset : block->reOffset;
+        return(rt_CopyLogSpoolToMatFile(fp, dst, var->spool,
+                                        start + (LogFileOffset)offset,
+                                        nbytes));
+    }
+#else
+    (void)var;
+#endif
+
+    src = (const char_T*)(imagPart ? block->im : block->re) + offset;
+    if (fp == NULL) {
+        (void)memcpy(*dst, src, nbytes);
+        *dst += nbytes;
+        return(0);
+    }
+    return(rt_WriteToMatFile(fp, src, nbytes));
+
+} /* end rt_CopyLogBlockToMatFile */
+
+
+/* Function: rt_WriteLogBlocksToMatFile ========================================
+ * Abstract:
+ *      Write the real or imaginary part of a log variable that is stored in
+ *      blocks to the MAT-file (or to dst if fp is NULL).  The blocks of
+ *      transposed variables are stored column-major, so each column is
+ *      gathered from all blocks in turn.
+ *      Return values is
+ *          == 0 : upon success
+ *          <> 0 : upon failure
+ */
+static int_T rt_WriteLogBlocksToMatFile(MatFile          *fp,
+                                        char_T           *dst,
+                                        const MatrixData *var,
+                                        boolean_T        imagPart)
+{
+    size_t         elSize = var->elSize;
+    const LogBlock *block;
+
+    if (var->nDims < 2 && var->nCols > 1) {
+        int_T j;
+
+        for (j = 0; j < var->nCols; j++) {
+            for (block = var->blocks; block != NULL; block = block->next) {
+                size_t nbytes = block->nRows*elSize;
+
+                if (rt_CopyLogBlockToMatFile(fp, &dst, var, block, imagPart,
+                                             j*block->ld*elSize, nbytes)) {
+                    return(1);
+                }
+            }
+        }
+    } else {
+        for (block = var->blocks; block != NULL; block = block->next) {
+            size_t nbytes = block->nRows*var->nCols*elSize;
+
+            if (rt_CopyLogBlockToMatFile(fp, &dst, var, block, imagPart,
+                                         0, nbytes)) {
+                return(1);
+            }
+        }
+    }
+    return(0);
+
+} /* end rt_WriteLogBlocksToMatFile */
+
+
+/* Function: rt_WriteLogBlocksItemToMatFile ====================================
+ * Abstract:
+ *      Write the tag and the data of a log variable that is stored in blocks
+ *      to the MAT-file.
+ *      Return values is
+ *          == 0 : upon success
+ *          <> 0 : upon failure
+ */
+static int_T rt_WriteLogBlocksItemToMatFile(MatFile          *fp,
+                                            MatItem          *pItem,
+                                            const MatrixData *var,
+                                            boolean_T        imagPart)
+{
+    int32_T nAlignBytes;
+
+    if (pItem->nbytes <= 4) {
+        /* Small data element, the data is packed into the tag */
+        MatItem item = {0, 0, NULL};
+        item.type = ((uint32_T)(pItem->type))|(((uint32_T)(pItem->nbytes))<<16);
+        if (rt_WriteLogBlocksToMatFile(NULL, (char_T*)&item.nbytes,
+                                       var, imagPart)) {
+            return(1);
+        }
+        if (rt_WriteToMatFile(fp, &item, matTAG_SIZE)) return(1);
+        return(0);
+    }
+
+    if (rt_WriteToMatFile(fp, pItem, matTAG_SIZE)) return(1);
+    if (rt_WriteLogBlocksToMatFile(fp, NULL, var, imagPart)) return(1);
+
+    /* Add offset for 8-byte alignment */
+    nAlignBytes = matINT64_ALIGN(pItem->nbytes) - pItem->nbytes;
+    if (nAlignBytes > 0) {
+        int pad[2] = {0, 0};
+        if (rt_WriteToMatFile(fp, pad, (size_t) nAlignBytes)) {
+            return(1);
+        }
+    }
+    return(0);
+
+} /* end rt_WriteLogBlocksItemToMatFile */
+
+
 /* Forward declaration */
-static int_T rt_WriteItemToMatFile(FILE         *fp,
+static int_T rt_WriteItemToMatFile(MatFile      *fp,
                                    MatItem      *pItem,
                                    ItemDataKind dataKind);
 
@@ -606,7 +1699,7 @@ static int_T rt_WriteItemToMatFile(FILE         *fp,
  *            0 : upon success
  *          > 0 : upon write failure (1)
  */
-static int_T rt_ProcessMatItem(FILE         *fp,
+static int_T rt_ProcessMatItem(MatFile      *fp,
                                MatItem      *pItem,
                                ItemDataKind itemKind,
                                int_T        cmd)
@@ -732,6 +1825,12 @@ static int_T rt_ProcessMatItem(FILE         *fp,
         if (cmd) {
             item.type = matID;
             item.data = var->re;
+            if (var->blocks != NULL) {
+                if (rt_WriteLogBlocksItemToMatFile(fp, &item, var, false)) {
+                    retStat = 1;
+                    goto EXIT_POINT;
+                }
+            } else
             if (rt_WriteItemToMatFile(fp, &item, DATA_ITEM)) {
                 retStat = 1;
                 goto EXIT_POINT;
@@ -746,6 +1845,12 @@ static int_T rt_ProcessMatItem(FILE         *fp,
             if (cmd) {
                 item.type = matID;
                 item.data = var->im;
+                if (var->blocks != NULL) {
+                    if (rt_WriteLogBlocksItemToMatFile(fp, &item, var, true)) {
+                        retStat = 1;
+                        goto EXIT_POINT;
+                    }
+                } else
                 if (rt_WriteItemToMatFile(fp, &item, DATA_ITEM)) {
                     retStat = 1;
                     goto EXIT_POINT;
@@ -922,6 +2027,8 @@ static int_T rt_ProcessMatItem(FILE         *fp,
                       tempData.complex = 0;
                       tempData.frameData = 0;
                       tempData.frameSize = 1;
+                      tempData.spool  = values->data.spool;
+                      tempData.blocks = values->valDims->blocks;
 
                       item.type = matMATRIX;                    
                       item.data = &tempData; /*values->valDims;*/
@@ -1091,7 +2198,7 @@ static int_T rt_ProcessMatItem(FILE         *fp,
  *          == 0 : upon success
  *          <> 0 : upon failure
  */
-static int_T rt_WriteItemToMatFile(FILE         *fp,
+static int_T rt_WriteItemToMatFile(MatFile      *fp,
                                    MatItem      *pItem,
                                    ItemDataKind itemKind)
 {
@@ -1104,13 +2211,12 @@ static int_T rt_WriteItemToMatFile(FILE         *fp,
     if (pItem->nbytes > 4) {
         int32_T nAlignBytes;
 
-        if (fwrite(pItem, 1, matTAG_SIZE, fp) != matTAG_SIZE) return(1);
+        if (rt_WriteToMatFile(fp, pItem, matTAG_SIZE)) return(1);
 
         if (pItem->type == matMATRIX) {
             if (rt_ProcessMatItem(fp, pItem, itemKind, 1)) return(1);
         } else {
-            if ( fwrite(pItem->data, 1, pItem->nbytes, fp) !=
-                                                    ((size_t) pItem->nbytes) ) {
+            if (rt_WriteToMatFile(fp, pItem->data, (size_t) pItem->nbytes)) {
                 return(1);
             }
         }
@@ -1119,7 +2225,7 @@ static int_T rt_WriteItemToMatFile(FILE         *fp,
         nAlignBytes = matINT64_ALIGN(pItem->nbytes) - pItem->nbytes;
         if (nAlignBytes > 0) {
             int pad[2] = {0, 0};
-            if ( fwrite(pad,1,nAlignBytes,fp) != ((size_t) nAlignBytes) ) {
+            if (rt_WriteToMatFile(fp, pad, (size_t) nAlignBytes)) {
                 return(1);
             }
         }
@@ -1127,7 +2233,7 @@ static int_T rt_WriteItemToMatFile(FILE         *fp,
         MatItem item = {0, 0, NULL};
         item.type = ((uint32_T)(pItem->type))|(((uint32_T)(pItem->nbytes))<<16);
         (void)memcpy(&item.nbytes, pItem->data, pItem->nbytes);
-        if (fwrite(&item, 1, matTAG_SIZE, fp) != matTAG_SIZE) return(1);
+        if (rt_WriteToMatFile(fp, &item, matTAG_SIZE)) return(1);
     }
 
     return(0);
@@ -1135,6 +2241,83 @@ static int_T rt_WriteItemToMatFile(FILE         *fp,
 } /* end rt_WriteItemToMatFile */
 
 
+#ifdef MAT_FILE_COMPRESSION
+
+/* Function: rt_WriteCompressedItemToMatFile ===================================
+ * Abstract:
+ *      Write a mat item as a miCOMPRESSED element, i.e., the tag and the data
+ *      written by rt_WriteItemToMatFile() are deflated into a zlib stream as
+ *      they are written.  The size in the tag of the element is filled in
+ *      once the stream is complete.
+ *
+ *      Return values is
+ *          == 0 : upon success
+ *          <> 0 : upon failure
+ */
+static int_T rt_WriteCompressedItemToMatFile(MatFile      *fp,
+                                             MatItem      *pItem,
+                                             ItemDataKind itemKind)
+{
+    z_stream *zs    = &fp->zs;
+    int32_T  tag[2] = {matCOMPRESSED, 0};
+    fpos_t   tagPos;
+    int      zStat;
+    int_T    retStat = 1;
+
+    if (fgetpos(fp->fp, &tagPos) != 0) return(1);
+    if (fwrite(tag, 1, matTAG_SIZE, fp->fp) != matTAG_SIZE) return(1);
+
+    (void)memset(zs, 0, sizeof(z_stream));
+    if (deflateInit(zs, MAT_FILE_COMPRESSION_LEVEL) != Z_OK) return(1);
+    fp->deflating = true;
+
+    if (rt_WriteItemToMatFile(fp, pItem, itemKind)) goto EXIT_POINT;
+
+    /* Flush the end of the zlib stream */
+    zs->avail_in = 0;
+    do {
+        size_t n;
+
+        zs->next_out  = fp->zbuf;
+        zs->avail_out = sizeof(fp->zbuf);
+        zStat = deflate(zs, Z_FINISH);
+        if (zStat == Z_STREAM_ERROR) goto EXIT_POINT;
+        n = sizeof(fp->zbuf) - zs->avail_out;
+        if (fwrite(fp->zbuf, 1, n, fp->fp) != n) goto EXIT_POINT;
+    } while (zStat != Z_STREAM_END);
+
+    if (zs->total_out > 0xFFFFFFFFUL) {
+        (void)fprintf(stderr, "*** Compressed variable exceeds the size of "
+                      "a MAT-file variable\n");
+        goto EXIT_POINT;
+    }
+
+    /* Fill in the size of the compressed data */
+    tag[1] = (int32_T)zs->total_out;
+    if (fsetpos(fp->fp, &tagPos) != 0 ||
+        fwrite(tag, 1, matTAG_SIZE, fp->fp) != matTAG_SIZE ||
+        fseek(fp->fp, 0L, SEEK_END) != 0) {
+        goto EXIT_POINT;
+    }
+    retStat = 0;
+
+  EXIT_POINT:
+    (void)deflateEnd(zs);
+    fp->deflating = false;
+    return(retStat);
+
+} /* end rt_WriteCompressedItemToMatFile */
+
+/* Each top-level variable is a miCOMPRESSED element */
+#define rt_WriteMatVarToMatFile  rt_WriteCompressedItemToMatFile
+
+#else
+
+#define rt_WriteMatVarToMatFile  rt_WriteItemToMatFile
+
+#endif /* MAT_FILE_COMPRESSION */
+
+
 /* Function: rt_WriteMat5FileHeader ============================================
  * Abstract:
  *      Function to write the mat file header.
@@ -1170,9 +2353,143 @@ static int_T rt_WriteMat5FileHeader(FILE *fp)
         ver[1] = matKEY;
         nbytes += (int_T)fwrite(ver, 1, sizeof(ver), fp);
     }
-    return(nbytes != matVERSION_INFO_OFFSET + sizeof(ver));
+    return(nbytes != matVERSION_INFO_OFFSET + sizeof(ver));
+
+} /* end rt_WriteMat5FileHeader */
+
+
+/* Function: rt_TransposeLogBlocks ============================================
+ * Abstract:
+ *      Transpose each block of a log variable to column-major order in place,
+ *      through a scratch buffer of at most MAX_LOG_CHUNK_SIZE bytes.  Blocks
+ *      that do not fit into the scratch buffer are split first, the new
+ *      blocks are views of the memory of the split block.
+ */
+static const char_T *rt_TransposeLogBlocks(MatrixData *data)
+{
+    size_t   rowSize = data->nCols*data->elSize;
+    int_T    maxRows = (int_T)(MAX_LOG_CHUNK_SIZE/rowSize);
+    int_T    nRows   = 0;
+    char_T   *scratch;
+    LogBlock *block;
+
+    for (block = data->blocks; block != NULL; block = block->next) {
+        if (block->nRows > nRows) nRows = block->nRows;
+    }
+    if (maxRows < 1) maxRows = 1;
+    if (nRows > maxRows) nRows = maxRows;
+    if (nRows == 0) return(NULL);
+
+    /* Make do with a smaller scratch buffer if memory is short */
+    while ((scratch = malloc(nRows*rowSize)) == NULL) {
+        if (nRows == 1) return(rtMemAllocError);
+        nRows = (nRows+1)/2;
+    }
+
+    for (block = data->blocks; block != NULL; block = block->next) {
+        size_t nbytes;
+
+        if (block->nRows > nRows) {
+            LogBlock *rest = calloc(1, sizeof(LogBlock));
+
+            if (rest == NULL) {
+                FREE(scratch);
+                return(rtMemAllocError);
+            }
+            rest->nRows  = block->nRows - nRows;
+            rest->re     = (char_T*)block->re + nRows*rowSize;
+            rest->im     = (block->im != NULL) ?
+                           (char_T*)block->im + nRows*rowSize : NULL;
+            rest->view   = true;
+            rest->next   = block->next;
+            block->next  = rest;
+            block->nRows = nRows;
+        }
+
+        nbytes    = block->nRows*rowSize;
+        block->ld = block->nRows;
+        rt_TransposeLogRows(scratch, block->re, block->nRows, data->nCols,
+                            data->elSize);
+        (void)memcpy(block->re, scratch, nbytes);
+        if (block->im != NULL) {
+            rt_TransposeLogRows(scratch, block->im, block->nRows, data->nCols,
+                                data->elSize);
+            (void)memcpy(block->im, scratch, nbytes);
+        }
+    }
+    FREE(scratch);
+    return(NULL);
+
+} /* end rt_TransposeLogBlocks */
+
+
+/* Function: rt_FixupLogVarBlocks =============================================
+ * Abstract:
+ *	Make the current buffers of a log variable that outgrew its first
+ *      buffer the last of its blocks, and transpose the blocks if they are
+ *      stored row-major.  The MAT-file is then written from the blocks.
+ */
+static const char_T *rt_FixupLogVarBlocks(LogVar *var)
+{
+    int_T     nCols     = var->data.nCols;
+    size_t    elSize    = var->data.elSize;
+    int_T     nRows     = var->rowIdx;
+    boolean_T varDims   = (var->valDims != NULL &&
+                           var->valDims->blocks != NULL);
+    LogBlock  *block;
+    LogBlock  *dimsBlock = NULL;
+    LogBlock  **tail;
+
+    if ((block = calloc(1, sizeof(LogBlock))) == NULL ||
+        (varDims && (dimsBlock = calloc(1, sizeof(LogBlock))) == NULL)) {
+        FREE(block);
+        return(rtMemAllocError);
+    }
+
+    /* The rows logged in the current buffers are the last block */
+    block->nRows = nRows;
+    block->ld    = var->data.nRows;
+    block->re    = var->data.re;
+    block->im    = var->data.im;
+    var->data.re = NULL;
+    var->data.im = NULL;
+
+    var->nDataPoints = nRows;
+    for (tail = &var->data.blocks; *tail != NULL; tail = &(*tail)->next) {
+        var->nDataPoints += (*tail)->nRows;
+    }
+    *tail = block;
+
+    if (varDims) {
+        dimsBlock->nRows       = nRows;
+        dimsBlock->ld          = var->valDims->nRows;
+        dimsBlock->re          = var->valDims->dimsData;
+        var->valDims->dimsData = NULL;
+
+        tail = &var->valDims->blocks;
+        while (*tail != NULL) {
+            tail = &(*tail)->next;
+        }
+        *tail = dimsBlock;
+        var->valDims->nRows = var->nDataPoints;
+    }
+    var->data.nRows = var->nDataPoints;
+    var->rowIdx     = 0;
+
+    if (((double)var->nDataPoints)*((double)nCols)*((double)elSize) >=
+                                                                 UINT_MAX) {
+        (void)fprintf(stderr, "*** Log variable %s has %d rows, which "
+                      "exceeds the size of a MAT-file variable\n",
+                      var->data.name, var->nDataPoints);
+        return("log variable too big for MAT-file\n");
+    }
+
+    if (var->data.nDims < 2 && nCols > 1 && !var->colMajor) { /* Transpose? */
+        return(rt_TransposeLogBlocks(&var->data));
+    }
+    return(NULL);
 
-} /* end rt_WriteMat5FileHeader */
+} /* end rt_FixupLogVarBlocks */
 
 
 /* Function: rt_FixupLogVar ====================================================
@@ -1187,6 +2504,41 @@ static const char_T *rt_FixupLogVar(LogVar *var,int verbose)
     size_t elSize  = var->data.elSize;
     int_T  nRows   = (var->wrapped ?  maxRows : var->rowIdx);
 
+#ifdef STREAM_LOGGING_TO_DISK
+    if (var->stream != NULL) {
+        /*
+         * Streamed log variables never wrap. Write the last (partial) block
+         * to the spool file, the MAT-file is then written from the spool.
+         */
+        LogStream *stream = var->stream;
+
+        rt_StreamLogVarBlock(var);
+        rt_WaitForLogStream(stream);
+
+        var->nDataPoints = stream->nRows;
+        var->data.nRows  = stream->nRows;
+        if (var->valDims != NULL && var->valDims->dimsData != NULL) {
+            var->valDims->nRows = stream->nRows;
+        }
+        if (stream->spool->error) {
+            return("unable to write logging spool file\n");
+        }
+        if (((double)stream->nRows)*((double)nCols)*((double)elSize) >=
+                                                                 UINT_MAX) {
+            (void)fprintf(stderr, "*** Log variable %s has %d rows, which "
+                          "exceeds the size of a MAT-file variable\n",
+                          var->data.name, stream->nRows);
+            return("log variable too big for MAT-file\n");
+        }
+        return(NULL);
+    }
+#endif
+
+    if (var->data.blocks != NULL) {
+        /* The log variable outgrew its first buffer, it never wraps */
+        return(rt_FixupLogVarBlocks(var));
+    }
+
     var->nDataPoints = var->rowIdx + var->wrapped * maxRows;
 
     if (var->wrapped > 1 || (var->wrapped == 1 && var->rowIdx != 0)) {
@@ -1227,121 +2579,49 @@ static const char_T *rt_FixupLogVar(LogVar *var,int verbose)
         }
     }
 
-    if (nDims < 2 && nCols > 1) {  /* Transpose? */
-        /* Don't need to transpose valueDimensions */
-        int_T  nEl    = nRows*nCols;
-        char   *src   = var->data.re;
-        char   *pmT;
-        int_T  k;
-
-        /**********************************
-         * If memory cannot be allocated, *
-         * write to a temporary buffer    *
-         **********************************/
-        if ((pmT = malloc(nEl*elSize)) == NULL) {
-            FILE  *fptr;
-            char  fName[mxMAXNAM];
-
-            (void)sprintf(fName, "%s%s", var->data.name, "_rtw_tmw.tmw");
-            if ((fptr=fopen(fName,"w+b")) == NULL) {
-                (void)fprintf(stderr,"*** Error opening %s",fName);
-                return("unable to open data file\n");
-            }
-
-            /****************************
-             * Write the data to a file *
-             ****************************/
-            for (k=0; k<nEl; k++) {
-                int_T kT   = nCols*(k%nRows) + (k/nRows);
-                char  *dst = src + kT*elSize;
-                (void)fwrite(dst, elSize, 1, fptr);
-            }
-            if (var->data.complex) {
-                char *pmiT = var->data.re;
-                src  = var->data.im;
-                for (k=0; k<nEl; k++) {
-                    int_T kT   = nRows*(k%nCols) + (k/nCols);
-                    char  *dst = pmiT + kT*elSize;
-                    (void)memcpy(dst, src, elSize);
-                    src += elSize;
-                }
-                var->data.re = var->data.im;
-                var->data.im = pmiT;
-            }
-
-            /*******************************
-             * Read the data from the file *
-             *******************************/
-            (void)rewind(fptr);
-            (void)fread(var->data.re, elSize, nEl, fptr);
-            (void)fclose(fptr);
-            (void)remove(fName);
-        } else {
-            for (k=0; k<nEl; k++) {
-                int_T kT   = nRows*(k%nCols) + (k/nCols);
-                char  *dst = pmT + kT*elSize;
-                (void)memcpy(dst, src, elSize);
-                src += elSize;
-            }
-            if (var->data.complex) {
-                char *pmiT = var->data.re;
-                src  = var->data.im;
-                for (k=0; k<nEl; k++) {
-                    int_T kT   = nRows*(k%nCols) + (k/nCols);
-                    char  *dst = pmiT + kT*elSize;
-                    (void)memcpy(dst, src, elSize);
-                    src += elSize;
-                }
-                var->data.re = var->data.im;
-                var->data.im = pmiT;
-            }
-            FREE(var->data.re);
-            var->data.re = pmT;
+    if ((nDims < 2 && nCols > 1) ||                      /* Transpose? */
+        (var->wrapped > 0 && var->rowIdx != 0)) {        /* Rotate?    */
+        /*
+         * Describe the logged rows in logging order by blocks that point
+         * into the buffers of the log variable, the rows from rowIdx to the
+         * end of a wrapped circular buffer come first.  The blocks are
+         * transposed in place (unless the buffers are already column-major)
+         * and written to the MAT-file one after the other, so the buffers
+         * are neither copied nor rotated.
+         * Don't need to transpose valueDimensions.
+         */
+        int_T    nFirst  = (var->wrapped > 0) ? var->rowIdx : 0;
+        size_t   rowSize = var->colMajor ? elSize : nCols*elSize;
+        LogBlock *first;
+        LogBlock *second = NULL;
+
+        if ((first = calloc(1, sizeof(LogBlock))) == NULL ||
+            (nFirst > 0 && (second = calloc(1, sizeof(LogBlock))) == NULL)) {
+            FREE(first);
+            return(rtMemAllocError);
         }
-    } /* Transpose? */
-
-    if (var->wrapped > 0 && var->rowIdx != 0 ) {  /* Rotate? */
-        char_T *buffer    = var->data.re;
-        int_T  done       = 0; /* done: 0 (1) rotate real (imag) part. */
-
-        do {
-            char_T *col       = buffer;
-            int_T  rowOffset  = (int_T)((nDims == 1) ? (elSize) : (elSize * nCols));
-            int_T  colOffset  = (int_T)((nDims == 1)?  (nRows*elSize) : elSize);
-            int_T  zeroIdx    = var->rowIdx;
-            int_T  j;
-
-            for (j = 0 ; j < nCols; ++j, col += colOffset) {
-                int_T   swapCount;
-                int_T   srcIdx;
-                int_T   dstIdx;
-                int_T   tmpIdx;
-                MatReal tmp;
-
-                for (tmpIdx=0, swapCount=0; swapCount < nRows; tmpIdx++) {
-                    (void)memcpy(&tmp, col + tmpIdx*rowOffset, elSize);
-
-                    dstIdx=tmpIdx; 
-                    srcIdx = ((dstIdx + zeroIdx) % nRows);
-                    while (srcIdx != tmpIdx) {
-                        (void)memcpy(col + dstIdx*rowOffset,
-                                     col + srcIdx*rowOffset,
-                                     elSize);
-                        ++swapCount;
-                        dstIdx = srcIdx;
-                        srcIdx = ((dstIdx + zeroIdx) % nRows);
-                        
-                    }
-                    (void)memcpy(col + dstIdx*rowOffset, &tmp, elSize);
-                    ++swapCount;
-                }
-            }
-            done ++;
-            /* need to rotate the imaginary part */
-        } while ((done == 1) && ((buffer = var->data.im) != NULL));
+        first->nRows = nRows - nFirst;
+        first->ld    = maxRows;
+        first->re    = (char_T*)var->data.re + nFirst*rowSize;
+        first->im    = (var->data.im != NULL) ?
+                       (char_T*)var->data.im + nFirst*rowSize : NULL;
+        first->view  = true;
+        if (second != NULL) {
+            second->nRows = nFirst;
+            second->ld    = maxRows;
+            second->re    = var->data.re;
+            second->im    = var->data.im;
+            second->view  = true;
+            first->next   = second;
+        }
+        var->data.blocks = first;
+        var->rowIdx      = 0;
 
-        var->rowIdx = 0;
-    } /* Rotate? */
+        if (nDims < 2 && nCols > 1 && !var->colMajor) {
+            const char_T *errMsg = rt_TransposeLogBlocks(&var->data);
+            if (errMsg != NULL) return(errMsg);
+        }
+    }
 
     /*
      * We might have allocated more number of rows than the number of data
@@ -1463,6 +2743,21 @@ static void rt_DestroyLogVar(LogVar *head)
     while(head) {
         LogVar *var = head;
         head = var->next;
+#ifdef STREAM_LOGGING_TO_DISK
+        rt_DestroyLogStream(var);
+#endif
+#ifdef BACKGROUND_LOGGING
+        if (var->ring != NULL) {
+            LogRingSeg *seg = var->ring->drainSeg;
+            while (seg != NULL) {
+                LogRingSeg *newer = seg->newer;
+                FREE(seg);
+                seg = newer;
+            }
+            FREE(var->ring);
+        }
+#endif
+        rt_DestroyLogBlocks(var->data.blocks);
         FREE(var->data.re);
         FREE(var->data.im);
         if (var->data.dims != var->data._dims) {
@@ -1470,6 +2765,7 @@ static void rt_DestroyLogVar(LogVar *head)
         }
         /* free valDims if necessary */
         if(var->valDims != NULL) {
+            rt_DestroyLogBlocks(var->valDims->blocks);
             FREE(var->valDims->dimsData);
             FREE(var->valDims);
         }
@@ -2367,18 +3663,45 @@ static const char_T *rt_StartDataLoggingForOutput(RTWLogInfo   *li,
 
 /* Function: rt_ReallocLogVar ==================================================
  * Abstract:
- *   Allocate more memory for the data buffers in the log variable.
+ *   Allocate more memory for the data buffers in the log variable.  The full
+ *   buffers are appended to the blocks of the log variable as they are, so
+ *   rows that have already been logged are never copied, and logging
+ *   continues at row 0 of new buffers twice the size of the full ones (at
+ *   most MAX_LOG_CHUNK_SIZE bytes, at least DEFAULT_BUFFER_SIZE rows).
  *   Exit if unable to allocate more memory.
  */
 static void rt_ReallocLogVar(LogVar *var, boolean_T isVarDims)
 {
-    void *tmp;
-    int_T nCols = var->data.nCols;
-    int_T nRows = var->data.nRows + DEFAULT_BUFFER_SIZE;
-    size_t elSize = var->data.elSize;
-    
-    tmp = realloc(var->data.re, nRows*nCols*elSize);
-    if (tmp == NULL) {
+    size_t   rowSize    = var->data.nCols*var->data.elSize;
+    int_T    maxRows    = (int_T)(MAX_LOG_CHUNK_SIZE/(rowSize > 0 ? rowSize : 1));
+    int_T    nRows      = var->data.nRows;
+    double   curSize    = (double)nRows*rowSize;
+    void     *re        = NULL;
+    void     *im        = NULL;
+    real_T   *dimsData  = NULL;
+    LogBlock *block     = NULL;
+    LogBlock *dimsBlock = NULL;
+    LogBlock **tail;
+
+    if (maxRows < DEFAULT_BUFFER_SIZE) maxRows = DEFAULT_BUFFER_SIZE;
+    nRows = (nRows < maxRows/2) ? 2*nRows : maxRows;
+    if (nRows < DEFAULT_BUFFER_SIZE) nRows = DEFAULT_BUFFER_SIZE;
+
+    for (tail = &var->data.blocks; *tail != NULL; tail = &(*tail)->next) {
+        curSize += (double)(*tail)->nRows*rowSize;
+    }
+
+    re    = malloc(nRows*rowSize);
+    block = calloc(1, sizeof(LogBlock));
+    if (var->data.complex) {
+        im = malloc(nRows*rowSize);
+    }
+    if (isVarDims) {
+        dimsData  = malloc(nRows*var->valDims->nCols*sizeof(real_T));
+        dimsBlock = calloc(1, sizeof(LogBlock));
+    }
+    if (re == NULL || block == NULL || (var->data.complex && im == NULL) ||
+        (isVarDims && (dimsData == NULL || dimsBlock == NULL))) {
         (void)fprintf(stderr,
                       "*** Memory allocation error.\n");
         (void)fprintf(stderr, ""
@@ -2389,106 +3712,43 @@ static void rt_ReallocLogVar(LogVar *var, boolean_T isVarDims)
                       "    Current Size     = %.16g\n"
                       "    Failed resize    = %.16g\n\n",
                       var->data.name,
-                      var->data.complex ? " (real part)" : "",
+                      var->data.complex ? " (complex)" : "",
                       var->data.nRows,
                       var->data.nCols,
                       (long)  var->data.elSize,
-                      (double)nRows*nCols*elSize,
-                      (double)(nRows+DEFAULT_BUFFER_SIZE)*nCols*elSize);
+                      curSize,
+                      curSize + (double)nRows*rowSize);
         exit(1);
     }
-    var->data.re = tmp;
 
-    if (var->data.complex) {
-        tmp = realloc(var->data.im, nRows*nCols*elSize);
-        if (tmp == NULL) {
-            (void)fprintf(stderr,
-                          "*** Memory allocation error.\n");
-            (void)fprintf(stderr, ""
-                          "    varName          = %s (complex part)\n"
-                          "    nRows            = %d\n"
-                          "    nCols            = %d\n"
-                          "    elementSize      = %lu\n"
-                          "    Current Size     = %.16g\n"
-                          "    Failed resize    = %.16g\n\n",
-                          var->data.name,
-                          var->data.nRows,
-                          var->data.nCols,
-                          (long)  var->data.elSize,
-                          (double)nRows*nCols*elSize,
-                          (double)(nRows+DEFAULT_BUFFER_SIZE)*nCols*elSize);
-            exit(1);
-        }
-        var->data.im = tmp;
-    }
+    /* Move the full buffers to the end of the list of blocks */
+    block->nRows = var->data.nRows;
+    block->ld    = var->data.nRows;
+    block->re    = var->data.re;
+    block->im    = var->data.im;
+    *tail        = block;
+
+    var->data.re    = re;
+    var->data.im    = im;
     var->data.nRows = nRows;
+    var->rowIdx     = 0;
 
-    /* Also reallocate memory for "valueDimensions" 
-       when logging the variable-size signal
+    /* Also move the buffer of "valueDimensions" 
+       when logging the variable-size signal.  It is stored column-major
+       with one column per dimension (see also rt_FixupLogVar()).
     */
     if(isVarDims){
-        int_T k;
-        
-        nCols = var->valDims->nCols;
-        nRows = var->valDims->nRows + DEFAULT_BUFFER_SIZE;
-        elSize = sizeof(real_T);
-        tmp = realloc(var->valDims->dimsData, nRows*nCols*elSize);
-        if (tmp == NULL) {
-            (void)fprintf(stderr,
-                          "*** Memory allocation error.\n");
-            (void)fprintf(stderr, ""
-                          "    varName          = %s\n"
-                          "    nRows            = %d\n"
-                          "    nCols            = %d\n"
-                          "    elementSize      = %lu\n"
-                          "    Current Size     = %.16g\n"
-                          "    Failed resize    = %.16g\n\n",
-                          var->valDims->name,
-                          var->valDims->nRows,
-                          var->valDims->nCols,
-                          (long)  elSize,
-                          (double)nRows*nCols*elSize,
-                          (double)(nRows+DEFAULT_BUFFER_SIZE)*nCols*elSize);
-            exit(1);
-        }
-
-        /*
-         * valueDimensions data is stored in array format and must be
-         * adjusted after reallocation (see also rt_FixupLogVar())
-         *
-         * Example: maxRows = 4; nRows = 4; nDims = 3;
-         * Before realloc of the logVar, the locations of data are as below:
-         * (x, y, z -- useful data / o -- junk, don't care)
-         * a[0] = x    a[4] = y    a[8] = z
-         * a[1] = x    a[5] = y    a[9] = z
-         * a[2] = x    a[6] = y    a[10]= z
-         * a[3] = x    a[7] = y    a[11]= z
-         *
-         * After realloc of the logVar (suppose 2 extra rows are added),
-         * the locations of data are as below:
-         * a[0] = x    a[6] = y    a[12]= o
-         * a[1] = x    a[7] = y    a[13]= o
-         * a[2] = x    a[8] = z    a[14]= o
-         * a[3] = x    a[9] = z    a[15]= o
-         * a[4] = y    a[10]= z    a[16]= o
-         * a[5] = y    a[11]= z    a[17]= o
-         *
-         * The data must be adjusted as below:
-         * a[0] = x    a[6] = y    a[12]= z
-         * a[1] = x    a[7] = y    a[13]= z
-         * a[2] = x    a[8] = y    a[14]= z
-         * a[3] = x    a[9] = y    a[15]= z
-         * a[4] = o    a[10]= o    a[16]= o
-         * a[5] = o    a[11]= o    a[17]= o
-         */
-        for(k = var->data.nDims-1; k > 0; k--){
-            (void) memcpy((real_T*)tmp + k*nRows, 
-                          (real_T*)tmp + k*var->valDims->nRows,
-                          elSize * var->valDims->nRows);
+        tail = &var->valDims->blocks;
+        while (*tail != NULL) {
+            tail = &(*tail)->next;
         }
+        dimsBlock->nRows = var->valDims->nRows;
+        dimsBlock->ld    = var->valDims->nRows;
+        dimsBlock->re    = var->valDims->dimsData;
+        *tail            = dimsBlock;
 
-        var->valDims->dimsData = tmp;
-        var->valDims->nRows = nRows;
+        var->valDims->dimsData = dimsData;
+        var->valDims->nRows    = nRows;
     }
 
 } /* end rt_ReallocLogVar */
@@ -2503,9 +3763,10 @@ static void rt_UpdateLogVarWithDiscontiguousData(LogVar            *var,
                                                  const int_T       *segmentLengths,
                                                  int_T             nSegments)
 {
-    size_t elSize = 0;
-    size_t offset = 0;
-    int    segIdx = 0;
+    size_t elSize  = 0;
+    size_t offset  = 0;
+    size_t colStep = 0;
+    int    segIdx  = 0;
 
     if (++var->numHits % var->decimation) return;
     var->numHits = 0;
@@ -2514,6 +3775,11 @@ static void rt_UpdateLogVarWithDiscontiguousData(LogVar            *var,
      * Reallocate or wrap the LogVar
      */
     if (var->rowIdx == var->data.nRows) {
+#ifdef STREAM_LOGGING_TO_DISK
+        if (var->stream != NULL) {
+            rt_StreamLogVarBlock(var);
+        } else
+#endif
         if (var->okayToRealloc == 1) {
             rt_ReallocLogVar(var, false);
         } else {
@@ -2525,9 +3791,29 @@ static void rt_UpdateLogVarWithDiscontiguousData(LogVar            *var,
 
     /* This function is only used to log states, there's no var-dims issue. */
     elSize = var->data.elSize;
-    offset = (size_t)(elSize * var->rowIdx * var->data.nCols);
+    if (var->colMajor) {
+        offset  = (size_t)(elSize * var->rowIdx);
+        colStep = (size_t)(elSize * var->data.nRows);
+    } else {
+        offset  = (size_t)(elSize * var->rowIdx * var->data.nCols);
+        colStep = elSize;
+    }
 
-    if (var->data.complex) {
+    if (var->data.complex && var->copyFcn != NULL) {
+        char_T *dstRe = (char_T*)(var->data.re) + offset;
+        char_T *dstIm = (char_T*)(var->data.im) + offset;
+
+        for (segIdx = 0; segIdx < nSegments; segIdx++) {
+            int_T         nEl  = segmentLengths[segIdx];
+            const  char_T *src = (const void *)data[segIdx];
+
+            /* Split the interleaved real and imaginary parts */
+            var->copyFcn(NULL, src, 2*elSize, dstRe, colStep, nEl);
+            var->copyFcn(NULL, src + elSize, 2*elSize, dstIm, colStep, nEl);
+            dstRe += nEl*colStep;
+            dstIm += nEl*colStep;
+        }
+    } else if (var->data.complex) {
         char_T *dstRe = (char_T*)(var->data.re) + offset;
         char_T *dstIm = (char_T*)(var->data.im) + offset;
 
@@ -2538,9 +3824,27 @@ static void rt_UpdateLogVarWithDiscontiguousData(LogVar            *var,
 
             for (el = 0; el < nEl; el++) {
                 (void)memcpy(dstRe, src, elSize);
-                dstRe += elSize;   src += elSize;
+                dstRe += colStep;  src += elSize;
                 (void)memcpy(dstIm, src, elSize);
-                dstIm += elSize;   src += elSize;
+                dstIm += colStep;  src += elSize;
+            }
+        }
+    } else if (var->colMajor) {
+        char_T *dst = (char_T*)(var->data.re) + offset;
+
+        for (segIdx = 0; segIdx < nSegments; segIdx++) {
+            int_T         nEl  = segmentLengths[segIdx];
+            const  char_T *src = (const void *)data[segIdx];
+            int_T         el;
+
+            if (var->copyFcn != NULL) {
+                var->copyFcn(NULL, src, elSize, dst, colStep, nEl);
+                dst += nEl*colStep;
+                continue;
+            }
+            for (el = 0; el < nEl; el++) {
+                (void)memcpy(dst, src, elSize);
+                dst += colStep;   src += elSize;
             }
         }
     } else {
@@ -2561,6 +3865,358 @@ static void rt_UpdateLogVarWithDiscontiguousData(LogVar            *var,
 } /* end rt_UpdateLogVarWithDiscontiguousData */
 
 
+#ifdef BACKGROUND_LOGGING
+
+/* Function: rt_GetLogVarRowSize ===============================================
+ * Abstract:
+ *      Number of signal bytes read by rt_UpdateLogVar() for one call.
+ */
+static size_t rt_GetLogVarRowSize(const LogVar *var)
+{
+    const RTWLogDataTypeConvert *convert = &var->data.dataTypeConvertInfo;
+    size_t  frameSize = var->data.frameData ? (size_t)var->data.frameSize : 1;
+    size_t  nParts    = var->data.complex ? 2 : 1;
+    size_t  pointSize;
+
+    if (!convert->conversionNeeded) {
+        pointSize = var->data.complex ?
+            rt_GetSizeofComplexType(var->data.dTypeID) : var->data.elSize;
+    } else if (convert->numOfChunk > 1 ||
+               convert->dataTypeIdOriginal > SS_BOOLEAN) {
+        /* multiword and biglong */
+        pointSize = nParts*(size_t)(convert->bitsPerChunk*
+                                    convert->numOfChunk/8);
+    } else if (convert->dataTypeIdOriginal == SS_BOOLEAN) {
+        pointSize = nParts*sizeof(boolean_T);
+    } else {
+        BuiltInDTypeId dTypeID = (BuiltInDTypeId)convert->dataTypeIdOriginal;
+
+        pointSize = var->data.complex ? rt_GetSizeofComplexType(dTypeID) :
+                                        rt_GetSizeofDataType(dTypeID);
+    }
+    return(frameSize*var->data.nCols*pointSize);
+
+} /* end rt_GetLogVarRowSize */
+
+
+/* Function: rt_NewLogRingSeg ==================================================
+ * Abstract:
+ *      Allocate an empty ring segment of nRows rows of rowSize bytes, with
+ *      the rows right after the header.
+ */
+static LogRingSeg *rt_NewLogRingSeg(size_t nRows, size_t rowSize)
+{
+    LogRingSeg *seg;
+
+    if (nRows > ((size_t)-1 - sizeof(LogRingSeg))/rowSize) return(NULL);
+    if ((seg = malloc(sizeof(LogRingSeg) + nRows*rowSize)) == NULL) {
+        return(NULL);
+    }
+    seg->buf   = (char_T *)(seg + 1);
+    seg->nRows = nRows;
+    seg->head  = 0;
+    seg->tail  = 0;
+    seg->newer = NULL;
+    return(seg);
+
+} /* end rt_NewLogRingSeg */
+
+
+/* Function: rt_GetLogRing =====================================================
+ * Abstract:
+ *      Get the ring of the log variable, creating it on first use.  Only
+ *      called from the model thread.
+ *
+ * Returns:
+ *	~= NULL  => the rows are logged by the logging thread
+ *	== NULL  => the model thread logs the row
+ */
+static LogRing *rt_GetLogRing(LogInfo   *logInfo,
+                              LogVar    *var,
+                              boolean_T discontiguous)
+{
+    LogRing *ring;
+
+    if (!logInfo->logThreadRunning) return(NULL);
+    if (var->ring != NULL) return(var->ring);
+
+#if defined(STREAM_LOGGING_TO_DISK) && !defined(STREAM_LOGGING_THREADED)
+    /* Without a writer thread, only the model thread may write the spool */
+    if (var->stream != NULL) return(NULL);
+#endif
+
+    if ((ring = calloc(1, sizeof(LogRing))) == NULL) return(NULL);
+
+    ring->var           = var;
+    ring->discontiguous = discontiguous;
+    ring->rowSize       = discontiguous ?
+        var->data.nCols*var->data.elSize*(var->data.complex ? 2 : 1) :
+        rt_GetLogVarRowSize(var);
+    if (ring->rowSize == 0 ||
+        (ring->pushSeg = rt_NewLogRingSeg(BACKGROUND_LOGGING_RING_ROWS,
+                                          ring->rowSize)) == NULL) {
+        FREE(ring);
+        return(NULL);
+    }
+    ring->drainSeg = ring->pushSeg;
+
+    /* Publish the ring to the logging thread */
+    ring->next = logInfo->rings;
+    __atomic_store_n(&logInfo->rings, ring, __ATOMIC_RELEASE);
+    var->ring = ring;
+
+    return(ring);
+
+} /* end rt_GetLogRing */
+
+
+/* Function: rt_LogRingMakeRoom ================================================
+ * Abstract:
+ *      Make sure the ring has a slot for another row, moving on to a new
+ *      segment twice the size if the current one is full.  Returns false if
+ *      that segment cannot be allocated.
+ */
+static boolean_T rt_LogRingMakeRoom(LogRing *ring)
+{
+    LogRingSeg *seg = ring->pushSeg;
+    LogRingSeg *newSeg;
+
+    if (seg->head - __atomic_load_n(&seg->tail, __ATOMIC_ACQUIRE) <
+        seg->nRows) {
+        return(true);
+    }
+    if ((newSeg = rt_NewLogRingSeg(2*seg->nRows, ring->rowSize)) == NULL &&
+        (newSeg = rt_NewLogRingSeg(seg->nRows, ring->rowSize)) == NULL) {
+        return(false);
+    }
+    /* Every row of seg was published before the logging thread sees this */
+    __atomic_store_n(&seg->newer, newSeg, __ATOMIC_RELEASE);
+    ring->pushSeg = newSeg;
+    return(true);
+
+} /* end rt_LogRingMakeRoom */
+
+
+/* Function: rt_LogRingsMakeRoom ===============================================
+ * Abstract:
+ *      Make sure every ring has a slot for another row.  Returns false if a
+ *      ring could not grow; the model thread then drops the whole time step
+ *      rather than wait for the logging thread, which could stall the step
+ *      for good if the logging thread has a lower real-time priority.
+ *      Logging the step right away is no option either, since the logging
+ *      thread owns the LogVars.
+ */
+static boolean_T rt_LogRingsMakeRoom(const LogInfo *logInfo)
+{
+    LogRing *ring;
+
+    for (ring = logInfo->rings; ring != NULL; ring = ring->next) {
+        if (!rt_LogRingMakeRoom(ring)) return(false);
+    }
+    return(true);
+
+} /* end rt_LogRingsMakeRoom */
+
+
+/* Function: rt_GetLogRingSlot =================================================
+ * Abstract:
+ *      Return the slot for the next row of the ring, or NULL if there is no
+ *      room (the row is then dropped).  rt_UpdateTXXFYLogVars makes room in
+ *      the rings before it pushes a step, so this only guards against it.
+ */
+static char_T *rt_GetLogRingSlot(LogRing *ring)
+{
+    LogRingSeg *seg;
+
+    if (!rt_LogRingMakeRoom(ring)) return(NULL);
+    seg = ring->pushSeg;
+    return(seg->buf + (seg->head % seg->nRows)*ring->rowSize);
+
+} /* end rt_GetLogRingSlot */
+
+
+/* Function: rt_CommitLogRingSlot ==============================================
+ * Abstract:
+ *      Hand the row written to the slot from rt_GetLogRingSlot to the
+ *      logging thread.
+ */
+static void rt_CommitLogRingSlot(LogRing *ring)
+{
+    LogRingSeg *seg = ring->pushSeg;
+
+    __atomic_store_n(&seg->head, seg->head+1, __ATOMIC_RELEASE);
+
+} /* end rt_CommitLogRingSlot */
+
+
+/* Function: rt_PushLogVar =====================================================
+ * Abstract:
+ *      Queue one row of the LogVar for the logging thread.  Variable-size
+ *      signals and rows that cannot be queued are logged right away.
+ */
+static void rt_PushLogVar(LogInfo    *logInfo,
+                          LogVar     *var,
+                          const void *data,
+                          boolean_T  isVarDims)
+{
+    LogRing *ring = isVarDims ? NULL : rt_GetLogRing(logInfo, var, false);
+    char_T  *dst;
+
+    if (ring == NULL) {
+        rt_UpdateLogVar(var, data, isVarDims);
+        return;
+    }
+
+    if ((dst = rt_GetLogRingSlot(ring)) == NULL) return;
+    (void)memcpy(dst, data, ring->rowSize);
+    rt_CommitLogRingSlot(ring);
+
+} /* end rt_PushLogVar */
+
+
+/* Function: rt_PushLogVarWithDiscontiguousData ================================
+ * Abstract:
+ *      Gather one row of the LogVar into its ring for the logging thread.
+ */
+static void rt_PushLogVarWithDiscontiguousData(LogInfo           *logInfo,
+                                               LogVar            *var,
+                                               LogSignalPtrsType data,
+                                               const int_T       *segmentLengths,
+                                               int_T             nSegments)
+{
+    LogRing *ring = rt_GetLogRing(logInfo, var, true);
+    size_t  pointSize;
+    char_T  *dst;
+    int_T   segIdx;
+
+    if (ring == NULL) {
+        rt_UpdateLogVarWithDiscontiguousData(var, data, segmentLengths,
+                                             nSegments);
+        return;
+    }
+
+    pointSize = var->data.elSize*(var->data.complex ? 2 : 1);
+    if ((dst = rt_GetLogRingSlot(ring)) == NULL) return;
+    for (segIdx = 0; segIdx < nSegments; segIdx++) {
+        size_t segSize = pointSize*segmentLengths[segIdx];
+
+        (void)memcpy(dst, data[segIdx], segSize);
+        dst += segSize;
+    }
+    rt_CommitLogRingSlot(ring);
+
+} /* end rt_PushLogVarWithDiscontiguousData */
+
+
+/* Function: rt_DrainLogRing ===================================================
+ * Abstract:
+ *      Log the rows queued in the ring, freeing the segments the model
+ *      thread has left.  Returns true if there were any rows.
+ */
+static boolean_T rt_DrainLogRing(LogRing *ring)
+{
+    boolean_T busy = false;
+
+    for (;;) {
+        LogRingSeg *seg   = ring->drainSeg;
+        /* Load newer first: once it is set, head below is final */
+        LogRingSeg *newer = __atomic_load_n(&seg->newer, __ATOMIC_ACQUIRE);
+        size_t     tail   = seg->tail;
+        size_t     head   = __atomic_load_n(&seg->head, __ATOMIC_ACQUIRE);
+
+        for (; tail != head; tail++) {
+            const int8_T *row = (const int8_T *)seg->buf +
+                                (tail % seg->nRows)*ring->rowSize;
+
+            if (ring->discontiguous) {
+                int_T nCols = ring->var->data.nCols;
+
+                rt_UpdateLogVarWithDiscontiguousData(ring->var, &row, &nCols, 1);
+            } else {
+                rt_UpdateLogVar(ring->var, row, false);
+            }
+            /* Hand the slot back to the model thread */
+            __atomic_store_n(&seg->tail, tail+1, __ATOMIC_RELEASE);
+            busy = true;
+        }
+
+        if (newer == NULL) break;
+        ring->drainSeg = newer;
+        FREE(seg);
+    }
+    return(busy);
+
+} /* end rt_DrainLogRing */
+
+
+/* Function: rt_LoggingThread ==================================================
+ * Abstract:
+ *      Background thread which logs the rows queued in the rings until it is
+ *      asked to stop and all rings are empty.
+ */
+static void *rt_LoggingThread(void *arg)
+{
+    LogInfo         *logInfo = (LogInfo *)arg;
+    struct timespec poll;
+
+    poll.tv_sec  = 0;
+    poll.tv_nsec = BACKGROUND_LOGGING_POLL_NS;
+
+    for (;;) {
+        /* Rows pushed before the stop request are seen by this pass */
+        int       stop = __atomic_load_n(&logInfo->logThreadStop,
+                                         __ATOMIC_ACQUIRE);
+        boolean_T busy = false;
+        LogRing   *ring;
+
+        for (ring = __atomic_load_n(&logInfo->rings, __ATOMIC_ACQUIRE);
+             ring != NULL; ring = ring->next) {
+            if (rt_DrainLogRing(ring)) busy = true;
+        }
+        if (!busy) {
+            if (stop) break;
+            (void)nanosleep(&poll, NULL);
+        }
+    }
+    return(NULL);
+
+} /* end rt_LoggingThread */
+
+
+/* Function: rt_StopLoggingThread ==============================================
+ * Abstract:
+ *      Log all queued rows and stop the logging thread.  Rows logged
+ *      afterwards are logged by the model thread.
+ */
+static void rt_StopLoggingThread(LogInfo *logInfo)
+{
+    if (!logInfo->logThreadRunning) return;
+
+    __atomic_store_n(&logInfo->logThreadStop, 1, __ATOMIC_RELEASE);
+    (void)pthread_join(logInfo->logThread, NULL);
+    logInfo->logThreadRunning = false;
+
+    /* Always reported: the MAT-file has gaps */
+    if (logInfo->nDroppedSteps > 0) {
+        (void)fprintf(stderr, "*** Warning: logging dropped %lu time steps "
+                      "because the logging rings could not grow (out of "
+                      "memory)\n", (unsigned long)logInfo->nDroppedSteps);
+    }
+    /* The rings are freed with their log variables */
+    logInfo->rings = NULL;
+
+} /* end rt_StopLoggingThread */
+
+#else
+
+#define rt_PushLogVar(logInfo, var, data, isVarDims) \
+    rt_UpdateLogVar(var, data, isVarDims)
+#define rt_PushLogVarWithDiscontiguousData(logInfo, var, data, segLen, nSeg) \
+    rt_UpdateLogVarWithDiscontiguousData(var, data, segLen, nSeg)
+
+#endif /* BACKGROUND_LOGGING */
+
+
 /*==================*
  * Visible routines *
  *==================*/
@@ -2616,6 +4272,9 @@ LogVar *rt_CreateLogVarWithConvert(
     int_T          frameSize;
     int_T          nRows;
     int_T          nColumns;
+#ifdef STREAM_LOGGING_TO_DISK
+    LogSpool       *spool              = NULL;
+#endif
 
     /*===================================================================*
      * Determine the frame size if the data is frame based               *
@@ -2708,6 +4367,24 @@ LogVar *rt_CreateLogVarWithConvert(
         }
     }
 
+#ifdef STREAM_LOGGING_TO_DISK
+    /*
+     * Log variables that would grow with the simulation length keep one
+     * block of rows in memory, full blocks are streamed to the spool file.
+     */
+    if (okayToRealloc == 1 && rtliGetLogInfo(li) != NULL) {
+        LogInfo *logInfo = (LogInfo*) rtliGetLogInfo(li);
+
+        if (logInfo->spool == NULL) {
+            logInfo->spool = rt_CreateLogSpool();
+        }
+        if (logInfo->spool != NULL) {
+            spool = logInfo->spool;
+            nRows = STREAM_LOGGING_BLOCK_SIZE;
+        }
+    }
+#endif
+
     /*
      * Figure out the number of columns that the log variable should have.
      * If the data is not frame based, then number of columns should equal
@@ -2815,6 +4492,11 @@ LogVar *rt_CreateLogVarWithConvert(
     var->data.dataTypeConvertInfo = rt_GetDataTypeConvertInfo(
         pDataTypeConvertInfo, dTypeID);
 
+    /* Select the kernels used by rt_UpdateLogVar() */
+    var->copyFcn              = rt_GetLogCopyKernel(elementSize);
+    var->logFcn               = rt_GetLogConvertKernel(
+        &var->data.dataTypeConvertInfo, elementSize, (boolean_T)complex);
+
     var->data.mxID            = rt_GetMxIdFromDTypeId(dTypeID);
     /* over-ride logical bit if data type is boolean */
     logical = dTypeID == SS_BOOLEAN ? 1 : 0;
@@ -2910,6 +4592,20 @@ LogVar *rt_CreateLogVarWithConvert(
     var->okayToRealloc        = okayToRealloc;
     var->decimation           = decimation;
     var->numHits              = -1;  /* so first point gets logged */
+#ifdef LOG_COLUMN_MAJOR
+    /* Store the columns of the variables transposed by rt_FixupLogVar() */
+    var->colMajor             = (var->data.nDims < 2 && var->data.nCols > 1);
+#endif
+
+#ifdef STREAM_LOGGING_TO_DISK
+    if (spool != NULL) {
+        if ( (var->stream = calloc(1, sizeof(LogStream))) == NULL ) {
+            goto ERROR_EXIT;
+        }
+        var->stream->spool = spool;
+        var->data.spool    = spool;
+    }
+#endif
 
     /* Add this log var to list in log info, if necessary */
     if (appendToLogVarsList) {
@@ -3193,6 +4889,13 @@ const char_T *rt_StartDataLoggingWithStartTime(RTWLogInfo   *li,
                                               stepSize,errStatus);
     if (*errStatus != NULL)  goto ERROR_EXIT;
 
+#ifdef BACKGROUND_LOGGING
+    /* If the thread cannot be started, the model thread logs the data */
+    logInfo->logThreadRunning = (pthread_create(&logInfo->logThread, NULL,
+                                                rt_LoggingThread,
+                                                logInfo) == 0);
+#endif
+
     return(NULL); /* NORMAL_EXIT */
 
  ERROR_EXIT:
@@ -3205,6 +4908,10 @@ const char_T *rt_StartDataLoggingWithStartTime(RTWLogInfo   *li,
         logInfo->logVarsList = NULL;
         rt_DestroyStructLogVar(logInfo->structLogVarsList);
         logInfo->structLogVarsList = NULL;
+#ifdef STREAM_LOGGING_TO_DISK
+        rt_DestroyLogSpool(logInfo->spool);
+        logInfo->spool = NULL;
+#endif
     }
     return(*errStatus);
 
@@ -3265,9 +4972,11 @@ void rt_UpdateLogVar(LogVar *var, const void *data, boolean_T isVarDims)
     BuiltInDTypeId dTypeID  = var->data.dTypeID;
 
     size_t offset        = 0;
+    size_t colStep       = elSize;  /* distance between elements of a row */
     char_T *currRealRow  = NULL;
     char_T *currImagRow  = NULL;
     int_T  pointSize     = (int_T)((var->data.complex) ? rt_GetSizeofComplexType(dTypeID) : elSize);
+    size_t srcPointSize  = (size_t)pointSize; /* for var->logFcn */
 
     int    i, j, k;
 
@@ -3287,11 +4996,25 @@ void rt_UpdateLogVar(LogVar *var, const void *data, boolean_T isVarDims)
     int_T  nRows_valDims    = 0;
     int_T  logWidth_valDims = 0;
 
+    if (var->logFcn != NULL && var->data.dataTypeConvertInfo.conversionNeeded) {
+        BuiltInDTypeId dataTypeIdOriginal = (BuiltInDTypeId)
+            var->data.dataTypeConvertInfo.dataTypeIdOriginal;
+
+        srcPointSize = (var->data.complex) ?
+            rt_GetSizeofComplexType(dataTypeIdOriginal) :
+            rt_GetSizeofDataType(dataTypeIdOriginal);
+    }
+
     for (i = 0; i < frameSize; i++) {
         if (++var->numHits % var->decimation) continue;
         var->numHits = 0;
 
         if (var->rowIdx == var->data.nRows) {
+#ifdef STREAM_LOGGING_TO_DISK
+            if (var->stream != NULL) {
+                rt_StreamLogVarBlock(var);
+            } else
+#endif
             if (var->okayToRealloc == 1) {
                 rt_ReallocLogVar(var, isVarDims);
             } else {
@@ -3328,11 +5051,37 @@ void rt_UpdateLogVar(LogVar *var, const void *data, boolean_T isVarDims)
             }
         }
 
-        offset       = (size_t)(elSize * var->rowIdx * logWidth);
+        /*
+         * Row-major buffers hold the logWidth elements of a row next to each
+         * other, column-major buffers hold each column contiguously.
+         */
+        if (var->colMajor) {
+            offset  = (size_t)(elSize * var->rowIdx);
+            colStep = (size_t)(elSize * var->data.nRows);
+        } else {
+            offset  = (size_t)(elSize * var->rowIdx * logWidth);
+            colStep = elSize;
+        }
         currRealRow  = ((char_T*) (var->data.re)) + offset;
         currImagRow  = (var->data.complex) ?
                        ((char_T*) (var->data.im)) + offset :  NULL;
 
+        if (!isVarDims && var->logFcn != NULL) {
+            /* Fixed-size row, the elements are all in range */
+            const char_T *src       = cData + i*srcPointSize;
+            size_t       srcStride = frameSize*srcPointSize;
+
+            var->logFcn(&var->data.dataTypeConvertInfo, src, srcStride,
+                        currRealRow, colStep, logWidth);
+            if (var->data.complex) {
+                var->logFcn(&var->data.dataTypeConvertInfo,
+                            src + srcPointSize/2, srcStride,
+                            currImagRow, colStep, logWidth);
+            }
+            ++var->rowIdx;
+            continue;
+        }
+
         /* update logging data */
         for (j = 0; j < logWidth; j++) {
 
@@ -3385,10 +5134,10 @@ void rt_UpdateLogVar(LogVar *var, const void *data, boolean_T isVarDims)
                     const char *cDataPoint = cData + (i+frameSize*idx) * pointSize;
 
                     (void) memcpy(currRealRow, cDataPoint, elSize);
-                    currRealRow += elSize;
+                    currRealRow += colStep;
                     if (var->data.complex) {
                         (void) memcpy(currImagRow, cDataPoint + pointSize/2, elSize);
-                        currImagRow += elSize;
+                        currImagRow += colStep;
                     }
                 } else {
                     /* If out of range, fill in NaN or 0:
@@ -3405,11 +5154,11 @@ void rt_UpdateLogVar(LogVar *var, const void *data, boolean_T isVarDims)
                         (void) memset(currRealRow, 0, elSize);
                     }
                     
-                    currRealRow += elSize;
+                    currRealRow += colStep;
                     if (var->data.complex) {
                         /* For imaginary part, fill in 0 */
                         (void) memset(currImagRow, 0, elSize);
-                        currImagRow += elSize;
+                        currImagRow += colStep;
                     }
                 }
             }
@@ -3687,9 +5436,9 @@ void rt_UpdateLogVar(LogVar *var, const void *data, boolean_T isVarDims)
                     break;
                 } /* -- end of switch -- */
 
-                currRealRow += elSize;
+                currRealRow += colStep;
                 if (var->data.complex) {
-                    currImagRow += elSize;
+                    currImagRow += colStep;
                 }
             }
         }
@@ -3800,9 +5549,22 @@ const char_T *rt_UpdateTXXFYLogVars(RTWLogInfo *li, time_T *tPtr, boolean_T upda
     LogInfo *logInfo     = rtliGetLogInfo(li);
     int_T   matrixFormat = (rtliGetLogFormat(li) == 0);
 
+#ifdef BACKGROUND_LOGGING
+    /*
+     * If a ring cannot grow, drop the T,X,Y rows of the whole step so that
+     * all variables keep the same rows.  xFinal is logged by the model
+     * thread and is still updated.
+     */
+    if (updateTXY && logInfo->logThreadRunning &&
+        !rt_LogRingsMakeRoom(logInfo)) {
+        ++logInfo->nDroppedSteps;
+        updateTXY = false;
+    }
+#endif
+
     /* time */
     if (logInfo->t != NULL && updateTXY) {
-        rt_UpdateLogVar(logInfo->t, tPtr, false);
+        rt_PushLogVar(logInfo, logInfo->t, tPtr, false);
     }
 
     if (matrixFormat) {                                      /* MATRIX_FORMAT */
@@ -3813,7 +5575,7 @@ const char_T *rt_UpdateTXXFYLogVars(RTWLogInfo *li, time_T *tPtr, boolean_T upda
             const int_T            *segLengths = xInfo->numCols;
             int_T                  nSegments   = xInfo->numSignals;
             if (logInfo->x != NULL && updateTXY) {
-                rt_UpdateLogVarWithDiscontiguousData(logInfo->x, segAddr,
+                rt_PushLogVarWithDiscontiguousData(logInfo, logInfo->x, segAddr,
                                                      segLengths, nSegments);
             }
             if (logInfo->xFinal != NULL) {
@@ -3835,7 +5597,7 @@ const char_T *rt_UpdateTXXFYLogVars(RTWLogInfo *li, time_T *tPtr, boolean_T upda
                        When outputs are logged in Matrix format, 
                        no variable-size signal logging is allowed.
                     */
-                    rt_UpdateLogVar(var[yIdx++], data[i], false);
+                    rt_PushLogVar(logInfo, var[yIdx++], data[i], false);
                 }
             }
         }
@@ -3850,12 +5612,12 @@ const char_T *rt_UpdateTXXFYLogVars(RTWLogInfo *li, time_T *tPtr, boolean_T upda
 
             /* time */
             if (var->logTime) {
-                rt_UpdateLogVar(var->time, tPtr, false);
+                rt_PushLogVar(logInfo, var->time, tPtr, false);
             }
 
             /* signals */
             for (i = 0; i < nsig; i++) {
-                rt_UpdateLogVar(val, data[i], false);
+                rt_PushLogVar(logInfo, val, data[i], false);
                 val = val->next;
             }
         }
@@ -3875,7 +5637,7 @@ const char_T *rt_UpdateTXXFYLogVars(RTWLogInfo *li, time_T *tPtr, boolean_T upda
 
                 /* time */
                 if (var[0]->logTime) {
-                    rt_UpdateLogVar(var[0]->time, tPtr, false);
+                    rt_PushLogVar(logInfo, var[0]->time, tPtr, false);
                 }
 
                 /* signals */
@@ -3883,7 +5645,7 @@ const char_T *rt_UpdateTXXFYLogVars(RTWLogInfo *li, time_T *tPtr, boolean_T upda
                     while (data[dataIdx] == NULL) {
                         ++dataIdx;
                     }
-                    rt_UpdateLogVar(val,  data[dataIdx], isVarDims[i]);
+                    rt_PushLogVar(logInfo, val,  data[dataIdx], isVarDims[i]);
                     val = val->next;
                     ++dataIdx;
                 }
@@ -3897,14 +5659,14 @@ const char_T *rt_UpdateTXXFYLogVars(RTWLogInfo *li, time_T *tPtr, boolean_T upda
 
                     /* time */
                     if (var[i]->logTime) {
-                        rt_UpdateLogVar(var[i]->time, tPtr, false);
+                        rt_PushLogVar(logInfo, var[i]->time, tPtr, false);
                     }
 
                     /* signals */
                     while (data[dataIdx] == NULL) {
                         ++dataIdx;
                     }
-                    rt_UpdateLogVar(val,  data[dataIdx], isVarDims[0]);
+                    rt_PushLogVar(logInfo, val,  data[dataIdx], isVarDims[0]);
                     val = val->next;
                     ++dataIdx;
                 }
@@ -3954,6 +5716,7 @@ extern "C" {
 void rt_StopDataLoggingImpl(const char_T *file, RTWLogInfo *li, boolean_T isRaccel)
 {
     FILE          *fptr;
+    MatFile       *matFile     = NULL;
     LogInfo       *logInfo     = (LogInfo*) rtliGetLogInfo(li);
     LogVar        *var         = logInfo->logVarsList;
     StructLogVar  *svar        = logInfo->structLogVarsList;
@@ -3965,6 +5728,18 @@ void rt_StopDataLoggingImpl(const char_T *file, RTWLogInfo *li, boolean_T isRacc
     boolean_T     errFlag      = 0;
     const char_T  *msg;
 
+#ifdef BACKGROUND_LOGGING
+    /* Log the rows still queued in the rings */
+    rt_StopLoggingThread(logInfo);
+#endif
+
+#ifdef STREAM_LOGGING_TO_DISK
+    /* Write out the queued blocks, the spool file is read from here on */
+    if (logInfo->spool != NULL) {
+        rt_StopLogSpoolThread(logInfo->spool);
+    }
+#endif
+
     /*******************************
      * Create MAT file with header *
      *******************************/
@@ -3976,6 +5751,14 @@ void rt_StopDataLoggingImpl(const char_T *file, RTWLogInfo *li, boolean_T isRacc
         (void)fprintf(stderr,"*** Error writing to %s",file);
         goto EXIT_POINT;
     }
+    if ((matFile = calloc(1, sizeof(MatFile))) == NULL) {
+        (void)fprintf(stderr,"*** Error writing to %s: %s\n",file,
+                      rtMemAllocError);
+        (void)fclose(fptr);
+        (void)remove(file);
+        goto EXIT_POINT;
+    }
+    matFile->fp = fptr;
 
     /**************************************************
      * First log all the variables in the LogVar list *
@@ -3992,7 +5775,7 @@ void rt_StopDataLoggingImpl(const char_T *file, RTWLogInfo *li, boolean_T isRacc
             item.type   = matMATRIX;
             item.nbytes = 0; /* not yet known */
             item.data   = &(var->data);
-            if (rt_WriteItemToMatFile(fptr, &item, MATRIX_ITEM)) {
+            if (rt_WriteMatVarToMatFile(matFile, &item, MATRIX_ITEM)) {
                 (void)fprintf(stderr,"*** Error writing log variable %s to "
                               "file %s",var->data.name, file);
                 errFlag = 1;
@@ -4037,7 +5820,7 @@ void rt_StopDataLoggingImpl(const char_T *file, RTWLogInfo *li, boolean_T isRacc
         item.nbytes = 0; /* not yet known */
         item.data   = svar;
 
-        if (rt_WriteItemToMatFile(fptr, &item, STRUCT_LOG_VAR_ITEM)) {
+        if (rt_WriteMatVarToMatFile(matFile, &item, STRUCT_LOG_VAR_ITEM)) {
             (void)fprintf(stderr,"*** Error writing structure log variable "
                           "%s to file %s",svar->name, file);
             errFlag = 1;
@@ -4061,6 +5844,7 @@ void rt_StopDataLoggingImpl(const char_T *file, RTWLogInfo *li, boolean_T isRacc
     }
 
  EXIT_POINT:
+    FREE(matFile);
 
     /****************
      * free logInfo *
@@ -4069,6 +5853,10 @@ void rt_StopDataLoggingImpl(const char_T *file, RTWLogInfo *li, boolean_T isRacc
     logInfo->logVarsList = NULL;
     rt_DestroyStructLogVar(logInfo->structLogVarsList);
     logInfo->structLogVarsList = NULL;
+#ifdef STREAM_LOGGING_TO_DISK
+    rt_DestroyLogSpool(logInfo->spool);
+    logInfo->spool = NULL;
+#endif
     FREE(logInfo);
     rtliSetLogInfo(li,NULL);
 
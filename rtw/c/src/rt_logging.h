@@ -34,6 +34,18 @@
 typedef double MatReal;                /* "real" data type used in model.mat  */
 typedef struct LogVar_Tag LogVar;
 typedef struct StructLogVar_Tag StructLogVar;
+typedef struct LogSpool_Tag LogSpool;   /* spool file of streamed rows         */
+typedef struct LogBlock_Tag LogBlock;   /* block of logged rows                */
+typedef struct LogStream_Tag LogStream; /* streaming state of a log variable   */
+typedef struct LogRing_Tag LogRing;     /* rows waiting for the logging thread */
+
+/*
+ * Copies or converts n elements of a logged signal, srcStride bytes apart, to
+ * a log variable buffer, dstStep bytes apart.
+ */
+typedef void (*LogElementsFcn)(const RTWLogDataTypeConvert *convert,
+                               const char_T *src, size_t srcStride,
+                               char_T *dst, size_t dstStep, int_T n);
 
 typedef struct MatrixData_Tag {
   char_T         name[mxMAXNAM];     /* Name of the variable                  */
@@ -63,6 +75,12 @@ typedef struct MatrixData_Tag {
   uint32_T       complex;            /* is this a complex matrix?             */
   uint32_T       frameData;          /* is this data frame based?             */
   uint32_T       frameSize;          /* is this data frame based?             */
+
+  LogSpool       *spool;             /* spool file holding the rows, if the
+                                        log variable is streamed to disk     */
+  LogBlock       *blocks;            /* blocks of rows in logging order,
+                                        held in memory or in the spool file,
+                                        NULL if all rows are in re and im    */
 } MatrixData;
 
 typedef struct ValDimsData_Tag {
@@ -72,6 +90,7 @@ typedef struct ValDimsData_Tag {
   void           **currSigDims;      /* dimensions of current output          */
   int_T          *currSigDimsSize;   /* size in bytes of current sig dims     */
   real_T         *dimsData;          /* pointer to the value of dimension     */
+  LogBlock       *blocks;            /* blocks of rows, see MatrixData    */
 } ValDimsData;
 
 struct LogVar_Tag {
@@ -92,6 +111,8 @@ struct LogVar_Tag {
     int_T     nDataPoints;            /* total number of data points logged   */
     int_T     usingDefaultBufSize;    /* used to print a message at end       */
     int_T     okayToRealloc;          /* reallocate during sim?               */
+    int_T     colMajor;               /* is each column of the buffers stored
+                                         contiguously (LOG_COLUMN_MAJOR)?     */
     int_T     decimation;             /* decimation factor                    */
     int_T     numHits;                /* decimation hit count                 */
 
@@ -107,6 +128,15 @@ struct LogVar_Tag {
                                          (the size will be nDims in this case)
                                       */
 
+    LogElementsFcn copyFcn;           /* copies elements of elSize bytes     */
+    LogElementsFcn logFcn;            /* stores the elements of a fixed-size
+                                         row, NULL to convert element-wise   */
+
+    LogStream *stream;                /* non-NULL if full blocks of rows are
+                                         streamed to disk during the run     */
+    LogRing   *ring;                  /* non-NULL if the rows are logged by
+                                         the background logging thread       */
+
     LogVar    *next;
 };
 
@@ -22,6 +22,9 @@
 # include "simstruc.h"
 #endif
 #include "rt_sim.h"
+#ifdef RT_MALLOC
+# include "rt_arena.h"
+#endif
 
 /*==========*
  * Struct's *
@@ -33,7 +36,7 @@
 
 #ifdef RT_MALLOC
 
-/* dynamically allocate data */
+/* dynamically allocate data, in one block with the struct */
 typedef struct TimingData_Tag {
     real_T *period;       /* Task periods in seconds                   */
     real_T *offset;       /* Task offsets in seconds                   */
@@ -43,6 +46,18 @@ typedef struct TimingData_Tag {
     int_T  firstDiscIdx;  /* First discrete task index                 */
 } TimingData;
 
+#ifndef USE_RTMODEL
+/* Lay out the vectors of td on the arena a, the counters first */
+static void rt_SimTimingLayout(TimingData *td, rtArena *a, int_T numst)
+{
+    td->clockTick  = (real_T *) rtArenaTake(a, numst * sizeof(real_T));
+    td->taskTick   = (int_T *)  rtArenaTake(a, numst * sizeof(int_T));
+    td->nTaskTicks = (int_T *)  rtArenaTake(a, numst * sizeof(int_T));
+    td->period     = (real_T *) rtArenaTake(a, numst * sizeof(real_T));
+    td->offset     = (real_T *) rtArenaTake(a, numst * sizeof(real_T));
+}
+#endif
+
 #else
 
 /* statically allocate data */
@@ -128,40 +143,23 @@ const char *rt_SimInitTimingEngine(int_T       rtmNumSampTimes,
 
     /* In the dynamically allocated case, we allocate the data here */
     static const char_T *malloc_error;
+    TimingData layout;
     TimingData *td;
+    rtArena    a;
     malloc_error = "Memory allocation error";
-    td = (TimingData *) malloc(sizeof(TimingData));
-    if (!td) {
-        return(malloc_error);
-    }
-
-    td->period = (real_T *) malloc(numst * sizeof(real_T));
-    if (!td->period) {
-        return(malloc_error);
-    }
-
-    td->offset = (real_T *) malloc(numst * sizeof(real_T));
-    if (!td->offset) {
-        return(malloc_error);
-    }
 
-    td->clockTick = (real_T *) malloc(numst * sizeof(real_T));
-    if (!td->clockTick) {
-        return(malloc_error);
+    if (rtmTStart != 0.0) {
+        return("Start time must be zero for real-time systems.  For non-zero start times you must use the Simulink solver module");
     }
 
-    td->taskTick = (int_T *) malloc(numst * sizeof(int_T));
-    if (!td->taskTick) {
+    rtArenaInit(&a, NULL, sizeof(TimingData));
+    rt_SimTimingLayout(&layout, &a, numst);
+    td = (TimingData *) RT_ARENA_MALLOC(rtArenaSize(&a));
+    if (!td) {
         return(malloc_error);
     }
-
-    td->nTaskTicks = (int_T *) malloc(numst * sizeof(int_T));
-    if (!td->nTaskTicks) {
-        return(malloc_error);
-    }
-    if (rtmTStart != 0.0) {
-        return("Start time must be zero for real-time systems.  For non-zero start times you must use the Simulink solver module");
-    }
+    rtArenaInit(&a, td, sizeof(TimingData));
+    rt_SimTimingLayout(td, &a, numst);
 
 #else /* must be !RT_MALLOC */
 
@@ -180,7 +178,7 @@ const char *rt_SimInitTimingEngine(int_T       rtmNumSampTimes,
 
     *rtmSimTimeStepPtr = MAJOR_TIME_STEP;
 
-    *rtmTimingDataPtr = (void*)&td;
+    *rtmTimingDataPtr = (void*)td;
 
     for (i = 0; i < rtmNumSampTimes; i++) {
         tsMap[i]         = i;
@@ -223,7 +221,7 @@ const char *rt_SimInitTimingEngine(int_T       rtmNumSampTimes,
 /* Dynamically allocated data */
 /* Function: rt_SimDestroyTimingEngine ===========================================
  * Abstract:
- *      This function frees the timing engine data.
+ *      This function frees the timing engine data, which is one block.
  */
 void rt_SimDestroyTimingEngine(void *rtmTimingData)
 {
@@ -234,26 +232,7 @@ void rt_SimDestroyTimingEngine(void *rtmTimingData)
     td = (TimingData *)rtmTimingData;
 
     if (td) {
-        if (td->period) {
-            free(td->period);
-        }
-        
-        if (td->offset) {
-            free(td->offset);
-        }
-        
-        if (td->clockTick) {
-            free(td->clockTick);
-        }
-        
-        if (td->taskTick) {
-            free(td->taskTick);
-        }
-        
-        if (td->nTaskTicks) {
-            free(td->nTaskTicks);
-        }
-        free(td);
+        RT_ARENA_FREE(td);
     }
 #endif /* !USE_RTMODEL */
 } /* end rt_SimDestroyTimingEngine */
@@ -50,5 +50,46 @@ RTIOSTREAMAPI int rtIOStreamClose(
     int streamID
     );
 
+/* Optional: wait until at least one of several streams has data to receive.
+ * Only drivers that can wait on several streams at once provide it (e.g.
+ * rtiostream_tcpip.c); look it up by name when loading a driver as a
+ * shared library. */
+RTIOSTREAMAPI int rtIOStreamWait(
+    const int   streamIDs[],
+    int         nStreams,
+    int         timeoutMs,
+    int         readyIDs[],
+    int       * nReady
+    );
+
+/* Optional: send without copying.  A driver that owns memory the receiver
+ * can read directly hands out blocks of it, queues references to data in
+ * them, and reports when the receiver has read them (e.g.
+ * rtiostream_shm.c).  Drivers without such memory (rtiostream_tcpip.c,
+ * rtiostream_serial.c) hand out no blocks and send by copy, so that
+ * callers link against any driver. */
+RTIOSTREAMAPI void * rtIOStreamRegionAlloc(
+    int         streamID,
+    size_t      size
+    );
+
+RTIOSTREAMAPI int rtIOStreamRegionFree(
+    int         streamID,
+    void      * block
+    );
+
+RTIOSTREAMAPI int rtIOStreamSendRef(
+    int          streamID,
+    const void * src,
+    size_t       size,
+    size_t     * sizeSent
+    );
+
+RTIOSTREAMAPI int rtIOStreamSendRefDone(
+    int         streamID,
+    int         timeoutMs,
+    int       * isDone
+    );
+
 
 #endif /* #ifndef RTIOSTREAM_H */
@@ -1058,3 +1058,65 @@ int rtIOStreamClose(int streamID)
 
     return retVal;
 }
+
+/* Function: rtIOStreamRegionAlloc ===========================================
+ * Abstract:
+ *  The receiver cannot read this driver's memory, so there is no region to
+ *  hand out: always returns NULL and the caller allocates elsewhere.
+ */
+void * rtIOStreamRegionAlloc(
+    int streamID,
+    size_t size)
+{
+    (void)streamID;
+    (void)size;
+    return NULL;
+}
+
+/* Function: rtIOStreamRegionFree ============================================
+ * Abstract:
+ *  No block comes from rtIOStreamRegionAlloc, so any block is an error.
+ */
+int rtIOStreamRegionFree(
+    int streamID,
+    void * block)
+{
+    (void)streamID;
+    (void)block;
+    return RTIOSTREAM_ERROR;
+}
+
+/* Function: rtIOStreamSendRef ===============================================
+ * Abstract:
+ *  Data cannot be sent by reference over a serial port; it is sent by copy with
+ *  rtIOStreamSend, so it is received as soon as this returns.
+ */
+int rtIOStreamSendRef(
+    int streamID,
+    const void *src,
+    size_t size,
+    size_t *sizeSent)
+{
+    return rtIOStreamSend(streamID, src, size, sizeSent);
+}
+
+/* Function: rtIOStreamSendRefDone ===========================================
+ * Abstract:
+ *  rtIOStreamSendRef copies, so nothing is ever outstanding: *isDone is
+ *  always 1.
+ */
+int rtIOStreamSendRefDone(
+    int streamID,
+    int timeoutMs,
+    int * isDone)
+{
+    int retVal = RTIOSTREAM_NO_ERROR;
+    SerialCommsData *sd = getSerialData(streamID);
+
+    (void)timeoutMs;
+    *isDone = 1;
+    if (sd == NULL) {
+       retVal = RTIOSTREAM_ERROR;
+    }
+    return retVal;
+}
@@ -0,0 +1,1616 @@
+/*
+ * Copyright 2016 The MathWorks, Inc.
+ *
+ * File: rtiostream_shm.c
+ *
+ * Abstract: This source file implements client-side and server-side
+ *  communication over POSIX shared memory, for hosts and targets that run on
+ *  the same Linux machine (SIL and external mode against a host-based
+ *  executable).  The server creates a shared memory segment holding one byte
+ *  ring per direction; the client maps the same segment.  Each ring has a
+ *  single writer and a single reader that only touch their own index, so
+ *  data moves with one memcpy in and one memcpy out and no system call.  A
+ *  side that has to wait (nothing to receive, or no room to send) sleeps on
+ *  a futex, and the other side only makes the wake-up call when it sees the
+ *  waiter's flag set.
+ *
+ *  The arguments follow rtiostream_tcpip.c so that the same argument lists
+ *  can be passed to either driver:
+ *
+ *      -client 0|1             server (default) or client side
+ *      -port N                 selects the segment "/rtiostream_shm_N"
+ *                              (default 17725)
+ *      -name NAME              selects the segment NAME instead, which must
+ *                              start with '/'
+ *      -ringsize BYTES         bytes per direction, a power of two (server
+ *                              only, default 262144)
+ *      -blocking 0|1           as for rtiostream_tcpip.c
+ *      -recv_timeout_secs N    as for rtiostream_tcpip.c
+ *      -spin N                 polls of the peer's index before sleeping
+ *                              (default 200)
+ *      -send_region_bytes N    size of the region for data sent by reference
+ *                              (server only, default 0: none)
+ *      -verbose 0|1            trace every call
+ *
+ *  Sending by reference: a server opened with -send_region_bytes can hand
+ *  out blocks of a third area of the segment (rtIOStreamRegionAlloc) and
+ *  send data that lives in them with rtIOStreamSendRef.  Only the block's
+ *  offset goes through the ring; the client copies the data straight out of
+ *  the region when it receives it, so the server never copies it at all.
+ *  The ring to the client then carries records [length data] or
+ *  [length|SHM_REC_REF offset], which the client unpacks transparently.
+ *  The client counts the bytes it has taken out of the region in
+ *  refConsumed; rtIOStreamSendRefDone tells the server when everything it
+ *  sent by reference has been read, and a freed block is not handed out
+ *  again before then.
+ *
+ *  Link with -lrt on C libraries older than glibc 2.17.
+ */
+
+#ifndef _GNU_SOURCE
+/* syscall() and the POSIX shared memory and clock interfaces */
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "rtiostream.h"
+#include "tmwtypes.h"
+
+#ifdef USE_MEXPRINTF
+#include "mex.h"
+#define printf mexPrintf
+#endif
+
+/***************** DEFINES ****************************************************/
+
+#define SERVER_PORT_NUM  (17725U)   /* sqrt(pi)*10000 */
+
+/* segment name used for -port N */
+#define SHM_NAME_FORMAT "/rtiostream_shm_%u"
+#define SHM_NAME_MAXLEN (64U)
+
+/* bytes in each ring: a power of two, at most SHM_MAX_RING_SIZE */
+#define DEFAULT_RING_SIZE  (256U * 1024U)
+#define SHM_MIN_RING_SIZE  (64U)
+#define SHM_MAX_RING_SIZE  (1U << 30)
+
+/* polls of the peer's index before going to sleep on the futex */
+#define DEFAULT_SPIN_COUNT (200)
+
+/* "RTIO" and the layout version, checked by the client */
+#define SHM_MAGIC   (0x5254494FU)
+#define SHM_VERSION (2U)
+
+/* bytes in the region for data sent by reference */
+#define DEFAULT_REGION_SIZE (0U)
+#define SHM_MAX_REGION_SIZE (1U << 30)
+/* region blocks are aligned to, and sized in multiples of, this */
+#define SHM_REGION_ALIGN    (8U)
+/* blocks that can be allocated from the region at once */
+#define SHM_MAX_REGION_BLOCKS (64)
+
+/* record headers on the ring to the client when there is a region */
+#define SHM_REC_REF      (0x80000000U) /* the data is in the region */
+#define SHM_REC_MAXLEN   (0x7FFFFFFFU)
+#define SHM_REC_HDR_SIZE ((uint32_T)sizeof(uint32_T))
+
+/* the header and each ring index sit on their own cache line */
+#define SHM_CACHE_LINE (64U)
+
+/* EXT_BLOCKING: see rtiostream_tcpip.c */
+#ifdef VXWORKS
+# define EXT_BLOCKING (1)
+#else
+# define EXT_BLOCKING (0)
+#endif
+
+/* timeout of 0 means to return immediately */
+#define BLOCKING_RECV_TIMEOUT_NOWAIT (0)
+/* timeout of -1 means to wait indefinitely */
+#define BLOCKING_RECV_TIMEOUT_NEVER (-1)
+/* rogue value for blocking receive timeout */
+#define DEFAULT_BLOCKING_RECV_TIMEOUT (-2)
+/* timeout of -3 means to wait for 10 ms to avoid high CPU load */
+#define BLOCKING_RECV_TIMEOUT_10MS (-3)
+/* wake up from blocking every second */
+#define DEFAULT_BLOCKING_RECV_TIMEOUT_SECS_CLIENT (1)
+/* only wake up from blocking when data arrives */
+#define DEFAULT_BLOCKING_RECV_TIMEOUT_SECS_SERVER (BLOCKING_RECV_TIMEOUT_NEVER)
+
+/* longest single sleep, after which a waiter checks the peer is still alive */
+#define SHM_WAIT_SLICE_MS (1000)
+
+/* default isVerbose value */
+#define DEFAULT_IS_VERBOSE 0
+
+/* clientState values */
+#define SHM_CLIENT_NONE     (0U)   /* no client; the rings are empty */
+#define SHM_CLIENT_ATTACHED (1U)   /* a client owns the other end */
+#define SHM_CLIENT_CLOSED   (2U)   /* the client has gone; the server drains
+                                    * the rings and returns to NONE */
+
+/* ring[] indices */
+#define SHM_RING_TO_SERVER (0)
+#define SHM_RING_TO_CLIENT (1)
+
+/* MIN utility */
+#ifndef MIN
+#define MIN(a,b) ((a) < (b) ? (a) : (b))
+#endif
+
+/* Access to the words shared with the peer.  Loads of the peer's index
+ * acquire the data it copied before publishing it, stores of our own index
+ * release ours.  The full fence orders a waiter's flag store before its
+ * re-check of the index, and a writer's index store before its check of the
+ * flag, so that either the waiter sees the new index or the writer sees the
+ * flag. */
+#define SHM_LOAD(p)       __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define SHM_STORE(p,v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define SHM_FENCE()       __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define SHM_CAS(p,o,n)    __atomic_compare_exchange_n((p), (o), (n), 0, \
+                              __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+
+/***************** TYPEDEFS **************************************************/
+
+/* One direction.  head is written only by the writer and tail only by the
+ * reader; both count bytes since the ring was last reset and wrap at 2^32,
+ * so head - tail is the number of bytes in the ring. */
+typedef struct ShmRing_tag {
+    uint32_T head;           /* bytes written */
+    uint32_T readerWaiting;  /* the reader sleeps on head */
+    char     pad0[SHM_CACHE_LINE - 2U * sizeof(uint32_T)];
+    uint32_T tail;           /* bytes read */
+    uint32_T writerWaiting;  /* the writer sleeps on tail */
+    char     pad1[SHM_CACHE_LINE - 2U * sizeof(uint32_T)];
+} ShmRing;
+
+/* Start of the segment; the ring data for ring[0] and then ring[1], and
+ * then the region, follow it */
+typedef struct ShmHeader_tag {
+    uint32_T magic;          /* SHM_MAGIC once the server has set up */
+    uint32_T version;        /* SHM_VERSION */
+    uint32_T ringSize;       /* bytes in each ring */
+    uint32_T regionSize;     /* bytes in the region, 0 for none */
+    uint32_T clientState;    /* SHM_CLIENT_NONE/ATTACHED/CLOSED */
+    uint32_T serverClosed;   /* set by the server in rtIOStreamClose */
+    int32_T  serverPid;      /* to detect a peer that died without closing */
+    int32_T  clientPid;
+    uint32_T refConsumed;    /* region bytes received by the client */
+    uint32_T refWaiting;     /* the server sleeps on refConsumed */
+    char     pad[SHM_CACHE_LINE - 10U * sizeof(uint32_T)];
+    ShmRing  ring[2];
+} ShmHeader;
+
+/* A block of the region handed out by rtIOStreamRegionAlloc.  A freed block
+ * stays in the list until the client has received everything that was sent
+ * by reference before it was freed. */
+typedef struct RegionBlock_tag {
+    uint32_T offset;
+    uint32_T size;
+    int      isFreed;
+    uint32_T freedAt;        /* refSent when it was freed */
+} RegionBlock;
+
+/* Data encapsulating a single client / server connection  */
+typedef struct ConnectionData_tag {
+   int isInUse; /* is this ConnectionData instance currently in use? */
+   int isServer; /* is this ConnectionData instance a Server (or client)? */
+   int blockingRecvTimeout; /* Timeout value in seconds, with the same
+                               meaning and special values as in
+                               rtiostream_tcpip.c */
+   int isVerbose; /* flag indicating whether to display verbose output */
+   int spinCount; /* polls before sleeping */
+   char name[SHM_NAME_MAXLEN]; /* segment name */
+   ShmHeader * hdr; /* the mapped segment */
+   size_t mapSize; /* bytes mapped */
+   ShmRing * sendRing; /* ring this side writes */
+   char * sendData;
+   ShmRing * recvRing; /* ring this side reads */
+   char * recvData;
+   char * regionData; /* the region, NULL if there is none */
+   uint32_T refSent; /* region bytes sent by reference (server) */
+   RegionBlock regionBlocks[SHM_MAX_REGION_BLOCKS]; /* by offset (server) */
+   int nRegionBlocks;
+   uint32_T recvLeft; /* bytes left in the record being received (client) */
+   int recvIsRef; /* that record is in the region (client) */
+   uint32_T recvRefOffset; /* where in the region it continues (client) */
+} ConnectionData;
+
+/**************** LOCAL DATA *************************************************/
+
+/* As in rtiostream_tcpip.c, all local data resides in the per client /
+ * server instance ConnectionData structures, looked up directly by
+ * connectionID. */
+#define MAX_NUM_CONNECTIONS (50)
+static ConnectionData connectionDataArray[MAX_NUM_CONNECTIONS];
+
+/************** LOCAL FUNCTION PROTOTYPES ************************************/
+
+static int getConnectionID(void);
+
+static ConnectionData * getConnectionData(int connectionID);
+
+static void freeConnectionData(ConnectionData * connection);
+
+static size_t shmSegmentSize(uint32_T ringSize, uint32_T regionSize);
+
+static void shmSetRings(ConnectionData * connection);
+
+static void shmFutexWait(uint32_T * word, uint32_T expected, int timeoutMs);
+
+static void shmFutexWake(uint32_T * word);
+
+static int shmPeerAlive(const ConnectionData * connection);
+
+static int shmTimeoutMs(int blockingRecvTimeout);
+
+static int shmWaitChange(
+    ConnectionData * connection,
+    uint32_T * word,
+    uint32_T * waitingFlag,
+    uint32_T   expected,
+    int        timeoutMs);
+
+static void ringCopyIn(
+    char * data,
+    uint32_T ringSize,
+    uint32_T at,
+    const char * src,
+    uint32_T n);
+
+static void ringCopyOut(
+    const char * data,
+    uint32_T ringSize,
+    uint32_T at,
+    char * dst,
+    uint32_T n);
+
+static void ringPublishHead(ShmRing * ring, uint32_T head);
+
+static void ringPublishTail(ShmRing * ring, uint32_T tail);
+
+static size_t ringWrite(
+    ShmRing * ring,
+    char * data,
+    uint32_T ringSize,
+    const char * src,
+    size_t size);
+
+static void ringWriteRecord(
+    ShmRing * ring,
+    char * data,
+    uint32_T ringSize,
+    uint32_T recHdr,
+    const char * payload,
+    uint32_T payloadSize);
+
+static size_t ringRead(
+    ShmRing * ring,
+    const char * data,
+    uint32_T ringSize,
+    char * dst,
+    size_t size);
+
+static size_t ringReadRecords(
+    ConnectionData * connection,
+    char * dst,
+    size_t size);
+
+static void regionPurge(ConnectionData * connection);
+
+static int serverIsConnected(ConnectionData * connection);
+
+static void serverResetRings(ConnectionData * connection);
+
+static int peerHasClosed(ConnectionData * connection);
+
+static int serverSegmentIsStale(const char * name);
+
+static int serverOpenShm(ConnectionData * connection, uint32_T ringSize,
+                         uint32_T regionSize);
+
+static int clientOpenShm(ConnectionData * connection);
+
+static int processArgs(
+    const int       argc,
+    void         *  argv[],
+    char        *   name,
+    unsigned int *  isClient,
+    int          *  isBlocking,
+    int          *  recvTimeout,
+    unsigned int *  ringSize,
+    unsigned int *  regionSize,
+    int          *  spinCount,
+    int          *  isVerbose);
+
+/*************** LOCAL FUNCTIONS **********************************************/
+
+/* Function: getConnectionData =================================================
+ * Abstract:
+ *  Retrieves a ConnectionData instance given its connectionID
+ *
+ * NOTE: An invalid connectionID will lead to a NULL pointer being returned
+ */
+static ConnectionData * getConnectionData(int connectionID) {
+   /* return NULL for invalid or uninitialized connectionIDs */
+   ConnectionData * connection = NULL;
+   if ((connectionID >= 0) && (connectionID < MAX_NUM_CONNECTIONS)) {
+      if (connectionDataArray[connectionID].isInUse) {
+         connection = &connectionDataArray[connectionID];
+      }
+   }
+   return connection;
+}
+
+/* Function: getConnectionID =================================================
+ * Abstract:
+ *  Returns a connectionID corresponding to a ConnectionData that is not
+ *  already in use.
+ *
+ *  Returns RTIOSTREAM_ERROR if all available ConnectionData instances are
+ *  already in use.
+ */
+static int getConnectionID(void) {
+   int connectionID;
+   int foundUnusedConnectionData = 0;
+   /* linear search for an unused ConnectionData */
+   for (connectionID = 0; connectionID < MAX_NUM_CONNECTIONS; connectionID++) {
+      if (!connectionDataArray[connectionID].isInUse) {
+         foundUnusedConnectionData = 1;
+         break;
+      }
+   }
+   if (!foundUnusedConnectionData) {
+      /* all ConnectionData's are in use */
+      printf("getConnectionID: All %d available connections are in use.\n", MAX_NUM_CONNECTIONS);
+      connectionID = RTIOSTREAM_ERROR;
+   }
+   return connectionID;
+}
+
+/* Function: freeConnectionData =================================================
+ * Abstract:
+ *  Unmaps the segment of the ConnectionData and marks it as no longer in use.
+ */
+static void freeConnectionData(ConnectionData * connection) {
+   if (connection->hdr != NULL) {
+      (void)munmap((void *)connection->hdr, connection->mapSize);
+      connection->hdr = NULL;
+   }
+   connection->sendRing = NULL;
+   connection->recvRing = NULL;
+   connection->regionData = NULL;
+   connection->isInUse = 0;
+}
+
+/* Function: shmSegmentSize =====================================================
+ * Abstract:
+ *  Bytes in a segment with two rings of ringSize bytes and a region of
+ *  regionSize bytes.
+ */
+static size_t shmSegmentSize(uint32_T ringSize, uint32_T regionSize) {
+   return sizeof(ShmHeader) + 2U * (size_t)ringSize + (size_t)regionSize;
+}
+
+/* Function: shmSetRings ========================================================
+ * Abstract:
+ *  Points the send and receive rings of the connection into the mapped
+ *  segment according to its side.
+ */
+static void shmSetRings(ConnectionData * connection) {
+   ShmHeader * hdr = connection->hdr;
+   char * data = (char *)hdr + sizeof(ShmHeader);
+   uint32_T ringSize = hdr->ringSize;
+   int sendIdx = connection->isServer ? SHM_RING_TO_CLIENT : SHM_RING_TO_SERVER;
+   int recvIdx = connection->isServer ? SHM_RING_TO_SERVER : SHM_RING_TO_CLIENT;
+
+   connection->sendRing = &hdr->ring[sendIdx];
+   connection->sendData = data + (size_t)sendIdx * ringSize;
+   connection->recvRing = &hdr->ring[recvIdx];
+   connection->recvData = data + (size_t)recvIdx * ringSize;
+   connection->regionData = (hdr->regionSize != 0U) ?
+       data + 2U * (size_t)ringSize : NULL;
+}
+
+/* Function: shmFutexWait =======================================================
+ * Abstract:
+ *  Sleeps while *word == expected, for at most timeoutMs (< 0 for no limit).
+ *  The futex is process-shared, so it must not be a FUTEX_PRIVATE_FLAG
+ *  operation.  Spurious wake-ups are left to the caller to handle.
+ */
+static void shmFutexWait(uint32_T * word, uint32_T expected, int timeoutMs) {
+   struct timespec ts;
+   struct timespec * tsPtr = NULL;
+   if (timeoutMs >= 0) {
+      ts.tv_sec  = timeoutMs / 1000;
+      ts.tv_nsec = (long)(timeoutMs % 1000) * 1000000L;
+      tsPtr = &ts;
+   }
+   (void)syscall(SYS_futex, word, FUTEX_WAIT, expected, tsPtr, NULL, 0);
+}
+
+/* Function: shmFutexWake =======================================================
+ * Abstract:
+ *  Wakes every process sleeping on word.
+ */
+static void shmFutexWake(uint32_T * word) {
+   (void)syscall(SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+/* Function: shmPeerAlive =======================================================
+ * Abstract:
+ *  Returns 0 if the process at the other end has exited without closing its
+ *  stream, 1 otherwise (including when there is no peer yet).
+ */
+static int shmPeerAlive(const ConnectionData * connection) {
+   int32_T pid = connection->isServer ?
+       SHM_LOAD(&connection->hdr->clientPid) :
+       SHM_LOAD(&connection->hdr->serverPid);
+   if (pid <= 0) {
+      return 1;
+   }
+   return !((kill((pid_t)pid, 0) == -1) && (errno == ESRCH));
+}
+
+/* Function: shmTimeoutMs =======================================================
+ * Abstract:
+ *  Converts a blockingRecvTimeout to milliseconds, -1 for no limit.
+ */
+static int shmTimeoutMs(int blockingRecvTimeout) {
+   int timeoutMs;
+   switch (blockingRecvTimeout) {
+     case BLOCKING_RECV_TIMEOUT_NOWAIT:
+       timeoutMs = 0;
+       break;
+     case BLOCKING_RECV_TIMEOUT_10MS:
+       timeoutMs = 10;
+       break;
+     case BLOCKING_RECV_TIMEOUT_NEVER:
+       timeoutMs = -1;
+       break;
+     default:
+       timeoutMs = (blockingRecvTimeout > INT_MAX / 1000) ?
+           INT_MAX : blockingRecvTimeout * 1000;
+       break;
+   }
+   return timeoutMs;
+}
+
+/* Function: shmWaitChange ======================================================
+ * Abstract:
+ *  Waits until *word != expected, the peer closes or dies, or timeoutMs
+ *  expires (< 0 for no limit).  It first polls spinCount times, then sets
+ *  *waitingFlag so the peer knows to wake it, and sleeps in slices of at
+ *  most SHM_WAIT_SLICE_MS.  Returns 1 if the word changed, 0 otherwise.
+ *
+ *  A wait without a waitingFlag is the server waiting for a client, which
+ *  has no peer to watch; the client always wakes it when attaching.
+ */
+static int shmWaitChange(
+    ConnectionData * connection,
+    uint32_T * word,
+    uint32_T * waitingFlag,
+    uint32_T   expected,
+    int        timeoutMs)
+{
+   struct timespec now;
+   struct timespec deadline;
+   int i;
+
+   for (i = 0; i < connection->spinCount; i++) {
+      if (SHM_LOAD(word) != expected) {
+         return 1;
+      }
+   }
+   if (timeoutMs == 0) {
+      return SHM_LOAD(word) != expected;
+   }
+
+   (void)clock_gettime(CLOCK_MONOTONIC, &deadline);
+   deadline.tv_sec  += timeoutMs / 1000;
+   deadline.tv_nsec += (long)(timeoutMs % 1000) * 1000000L;
+   if (deadline.tv_nsec >= 1000000000L) {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000L;
+   }
+
+   for (;;) {
+      int sliceMs = SHM_WAIT_SLICE_MS;
+      if (timeoutMs > 0) {
+         long leftMs;
+         (void)clock_gettime(CLOCK_MONOTONIC, &now);
+         leftMs = (long)(deadline.tv_sec - now.tv_sec) * 1000L +
+             (deadline.tv_nsec - now.tv_nsec) / 1000000L;
+         if (leftMs <= 0) {
+            break;
+         }
+         sliceMs = (int)MIN(leftMs, (long)SHM_WAIT_SLICE_MS);
+      }
+
+      if (waitingFlag != NULL) {
+         SHM_STORE(waitingFlag, 1U);
+      }
+      SHM_FENCE();
+      if ((SHM_LOAD(word) != expected) ||
+          ((waitingFlag != NULL) && peerHasClosed(connection))) {
+         if (waitingFlag != NULL) {
+            SHM_STORE(waitingFlag, 0U);
+         }
+         break;
+      }
+      shmFutexWait(word, expected, sliceMs);
+      if (waitingFlag != NULL) {
+         SHM_STORE(waitingFlag, 0U);
+      }
+      if ((SHM_LOAD(word) != expected) ||
+          ((waitingFlag != NULL) && !shmPeerAlive(connection))) {
+         break;
+      }
+   }
+   return SHM_LOAD(word) != expected;
+}
+
+/* Function: ringCopyIn =========================================================
+ * Abstract:
+ *  Copies n bytes from src into the ring at byte count at, wrapping around
+ *  its end.
+ */
+static void ringCopyIn(
+    char * data,
+    uint32_T ringSize,
+    uint32_T at,
+    const char * src,
+    uint32_T n)
+{
+   uint32_T pos = at & (ringSize - 1U);
+   uint32_T first = MIN(n, ringSize - pos);
+   (void)memcpy(data + pos, src, first);
+   (void)memcpy(data, src + first, n - first);
+}
+
+/* Function: ringCopyOut ========================================================
+ * Abstract:
+ *  Copies n bytes out of the ring at byte count at into dst, wrapping around
+ *  its end.
+ */
+static void ringCopyOut(
+    const char * data,
+    uint32_T ringSize,
+    uint32_T at,
+    char * dst,
+    uint32_T n)
+{
+   uint32_T pos = at & (ringSize - 1U);
+   uint32_T first = MIN(n, ringSize - pos);
+   (void)memcpy(dst, data + pos, first);
+   (void)memcpy(dst + first, data, n - first);
+}
+
+/* Function: ringPublishHead ====================================================
+ * Abstract:
+ *  Publishes the bytes written up to head and wakes the reader if it is
+ *  asleep.
+ */
+static void ringPublishHead(ShmRing * ring, uint32_T head) {
+   SHM_STORE(&ring->head, head);
+   SHM_FENCE();
+   if (SHM_LOAD(&ring->readerWaiting)) {
+      shmFutexWake(&ring->head);
+   }
+}
+
+/* Function: ringPublishTail ====================================================
+ * Abstract:
+ *  Releases the space read up to tail and wakes the writer if it is asleep.
+ */
+static void ringPublishTail(ShmRing * ring, uint32_T tail) {
+   SHM_STORE(&ring->tail, tail);
+   SHM_FENCE();
+   if (SHM_LOAD(&ring->writerWaiting)) {
+      shmFutexWake(&ring->tail);
+   }
+}
+
+/* Function: ringWrite ==========================================================
+ * Abstract:
+ *  Copies as much of size bytes from src as fits into the ring, publishes
+ *  them and wakes the reader if it is asleep.  Returns the bytes copied.
+ */
+static size_t ringWrite(
+    ShmRing * ring,
+    char * data,
+    uint32_T ringSize,
+    const char * src,
+    size_t size)
+{
+   uint32_T head = ring->head;
+   uint32_T space = ringSize - (head - SHM_LOAD(&ring->tail));
+   uint32_T n = (uint32_T)MIN(size, (size_t)space);
+
+   if (n > 0U) {
+      ringCopyIn(data, ringSize, head, src, n);
+      ringPublishHead(ring, head + n);
+   }
+   return (size_t)n;
+}
+
+/* Function: ringWriteRecord ====================================================
+ * Abstract:
+ *  Writes the record header recHdr followed by payloadSize bytes of payload
+ *  and publishes them together.  The caller has checked that they fit.
+ */
+static void ringWriteRecord(
+    ShmRing * ring,
+    char * data,
+    uint32_T ringSize,
+    uint32_T recHdr,
+    const char * payload,
+    uint32_T payloadSize)
+{
+   uint32_T head = ring->head;
+   ringCopyIn(data, ringSize, head, (const char *)&recHdr, SHM_REC_HDR_SIZE);
+   ringCopyIn(data, ringSize, head + SHM_REC_HDR_SIZE, payload, payloadSize);
+   ringPublishHead(ring, head + SHM_REC_HDR_SIZE + payloadSize);
+}
+
+/* Function: ringRead ===========================================================
+ * Abstract:
+ *  Copies up to size bytes out of the ring into dst, releases their space
+ *  and wakes the writer if it is asleep.  Returns the bytes copied.
+ */
+static size_t ringRead(
+    ShmRing * ring,
+    const char * data,
+    uint32_T ringSize,
+    char * dst,
+    size_t size)
+{
+   uint32_T tail = ring->tail;
+   uint32_T avail = SHM_LOAD(&ring->head) - tail;
+   uint32_T n = (uint32_T)MIN(size, (size_t)avail);
+
+   if (n > 0U) {
+      ringCopyOut(data, ringSize, tail, dst, n);
+      ringPublishTail(ring, tail + n);
+   }
+   return (size_t)n;
+}
+
+/* Function: ringReadRecords ====================================================
+ * Abstract:
+ *  Client side of a segment with a region: unpacks up to size bytes from
+ *  the records on the receive ring into dst, copying data sent by reference
+ *  straight out of the region.  Returns the bytes copied.
+ */
+static size_t ringReadRecords(
+    ConnectionData * connection,
+    char * dst,
+    size_t size)
+{
+   ShmHeader * hdr = connection->hdr;
+   ShmRing * ring = connection->recvRing;
+   uint32_T ringSize = hdr->ringSize;
+   size_t copied = 0;
+
+   while (copied < size) {
+      uint32_T n;
+
+      if (connection->recvLeft == 0U) {
+         /* next record; its header and payload were published together */
+         uint32_T tail = ring->tail;
+         uint32_T recHdr;
+
+         if (SHM_LOAD(&ring->head) == tail) {
+            break;
+         }
+         ringCopyOut(connection->recvData, ringSize, tail,
+                     (char *)&recHdr, SHM_REC_HDR_SIZE);
+         tail += SHM_REC_HDR_SIZE;
+         connection->recvLeft = recHdr & SHM_REC_MAXLEN;
+         connection->recvIsRef = (recHdr & SHM_REC_REF) != 0U;
+         if (connection->recvIsRef) {
+            ringCopyOut(connection->recvData, ringSize, tail,
+                        (char *)&connection->recvRefOffset, sizeof(uint32_T));
+            tail += (uint32_T)sizeof(uint32_T);
+            if ((connection->recvRefOffset > hdr->regionSize) ||
+                (connection->recvLeft > hdr->regionSize - connection->recvRefOffset)) {
+               printf("rtiostream_shm: dropping a reference outside the region "
+                      "of %s\n", connection->name);
+               connection->recvLeft = 0U;
+            }
+         }
+         ringPublishTail(ring, tail);
+         continue;
+      }
+
+      n = (uint32_T)MIN((size_t)connection->recvLeft, size - copied);
+      if (connection->recvIsRef) {
+         (void)memcpy(dst + copied,
+                      connection->regionData + connection->recvRefOffset, n);
+         connection->recvRefOffset += n;
+         /* only the client writes refConsumed */
+         SHM_STORE(&hdr->refConsumed, hdr->refConsumed + n);
+         SHM_FENCE();
+         if (SHM_LOAD(&hdr->refWaiting)) {
+            shmFutexWake(&hdr->refConsumed);
+         }
+      } else {
+         ringCopyOut(connection->recvData, ringSize, ring->tail, dst + copied, n);
+         ringPublishTail(ring, ring->tail + n);
+      }
+      connection->recvLeft -= n;
+      copied += n;
+   }
+   return copied;
+}
+
+/* Function: regionPurge ========================================================
+ * Abstract:
+ *  Drops the freed blocks of the region that the client no longer needs:
+ *  all data sent by reference before they were freed has been received, or
+ *  there is no client any more.
+ */
+static void regionPurge(ConnectionData * connection) {
+   uint32_T consumed = SHM_LOAD(&connection->hdr->refConsumed);
+   int noClient = (SHM_LOAD(&connection->hdr->clientState) == SHM_CLIENT_NONE);
+   int i;
+   int j = 0;
+
+   for (i = 0; i < connection->nRegionBlocks; i++) {
+      RegionBlock * block = &connection->regionBlocks[i];
+      if (block->isFreed &&
+          (noClient || ((int32_T)(consumed - block->freedAt) >= 0))) {
+         continue;
+      }
+      connection->regionBlocks[j++] = *block;
+   }
+   connection->nRegionBlocks = j;
+}
+
+/* Function: serverResetRings ===================================================
+ * Abstract:
+ *  Empties both rings after the client has gone and makes the segment
+ *  available to the next client.
+ */
+static void serverResetRings(ConnectionData * connection) {
+   ShmHeader * hdr = connection->hdr;
+   int i;
+   for (i = 0; i < 2; i++) {
+      hdr->ring[i].head = 0U;
+      hdr->ring[i].tail = 0U;
+      hdr->ring[i].readerWaiting = 0U;
+      hdr->ring[i].writerWaiting = 0U;
+   }
+   hdr->clientPid = 0;
+   hdr->refConsumed = 0U;
+   hdr->refWaiting = 0U;
+   connection->refSent = 0U;
+   SHM_STORE(&hdr->clientState, SHM_CLIENT_NONE);
+   /* nothing is left to be read out of the freed blocks */
+   regionPurge(connection);
+   if (connection->isVerbose) {
+      printf("rtiostream_shm: client disconnected from %s\n", connection->name);
+   }
+}
+
+/* Function: serverIsConnected ==================================================
+ * Abstract:
+ *  Returns 1 while a client is attached or has closed with data still to be
+ *  received.  A client that closed (or died) with nothing left to receive
+ *  is disconnected here, so that the server accepts the next one.
+ */
+static int serverIsConnected(ConnectionData * connection) {
+   ShmHeader * hdr = connection->hdr;
+   uint32_T state = SHM_LOAD(&hdr->clientState);
+
+   if ((state == SHM_CLIENT_ATTACHED) && !shmPeerAlive(connection)) {
+      state = SHM_CLIENT_CLOSED;
+   }
+   if (state == SHM_CLIENT_CLOSED) {
+      ShmRing * ring = connection->recvRing;
+      if (SHM_LOAD(&ring->head) == ring->tail) {
+         serverResetRings(connection);
+         state = SHM_CLIENT_NONE;
+      }
+   }
+   return state != SHM_CLIENT_NONE;
+}
+
+/* Function: peerHasClosed ======================================================
+ * Abstract:
+ *  Returns 1 if the other side has closed its stream or died.
+ */
+static int peerHasClosed(ConnectionData * connection) {
+   ShmHeader * hdr = connection->hdr;
+   if (connection->isServer) {
+      return SHM_LOAD(&hdr->clientState) != SHM_CLIENT_ATTACHED;
+   }
+   return SHM_LOAD(&hdr->serverClosed) != 0U;
+}
+
+/* Function: serverSegmentIsStale ================================================
+ * Abstract:
+ *  Returns 1 if the existing segment called name was left behind by a
+ *  server that exited without closing its stream (or is not a segment of
+ *  this driver), 0 if a live server still owns it.
+ */
+static int serverSegmentIsStale(const char * name) {
+   int isStale = 1;
+   int fd = shm_open(name, O_RDONLY, 0);
+   if (fd != -1) {
+      struct stat st;
+      if ((fstat(fd, &st) == 0) && ((size_t)st.st_size >= sizeof(ShmHeader))) {
+         void * mem = mmap(NULL, sizeof(ShmHeader), PROT_READ, MAP_SHARED, fd, 0);
+         if (mem != MAP_FAILED) {
+            ShmHeader * hdr = (ShmHeader *)mem;
+            int32_T pid = SHM_LOAD(&hdr->serverPid);
+            if ((SHM_LOAD(&hdr->magic) == SHM_MAGIC) &&
+                !SHM_LOAD(&hdr->serverClosed) && (pid > 0) &&
+                !((kill((pid_t)pid, 0) == -1) && (errno == ESRCH))) {
+               isStale = 0;
+            }
+            (void)munmap(mem, sizeof(ShmHeader));
+         }
+      }
+      (void)close(fd);
+   }
+   return isStale;
+}
+
+/* Function: serverOpenShm ======================================================
+ * Abstract:
+ *  Creates and maps the segment of the connection, replacing any segment
+ *  left behind by a server that did not close its stream.
+ */
+static int serverOpenShm(ConnectionData * connection, uint32_T ringSize,
+                         uint32_T regionSize) {
+   size_t size = shmSegmentSize(ringSize, regionSize);
+   void * mem;
+   int fd;
+
+   fd = shm_open(connection->name, O_RDWR | O_CREAT | O_EXCL, 0600);
+   if ((fd == -1) && (errno == EEXIST)) {
+      if (!serverSegmentIsStale(connection->name)) {
+         printf("Shared memory %s is in use by another server.\n",
+                connection->name);
+         return RTIOSTREAM_ERROR;
+      }
+      (void)shm_unlink(connection->name);
+      fd = shm_open(connection->name, O_RDWR | O_CREAT | O_EXCL, 0600);
+   }
+   if (fd == -1) {
+      printf("shm_open() call failed: %s\n", strerror(errno));
+      return RTIOSTREAM_ERROR;
+   }
+   if (ftruncate(fd, (off_t)size) == -1) {
+      printf("ftruncate() call failed: %s\n", strerror(errno));
+      (void)close(fd);
+      (void)shm_unlink(connection->name);
+      return RTIOSTREAM_ERROR;
+   }
+   mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   (void)close(fd);
+   if (mem == MAP_FAILED) {
+      printf("mmap() call failed: %s\n", strerror(errno));
+      (void)shm_unlink(connection->name);
+      return RTIOSTREAM_ERROR;
+   }
+
+   /* ftruncate zero-fills the segment: the rings are empty and there is no
+    * client */
+   connection->hdr = (ShmHeader *)mem;
+   connection->mapSize = size;
+   connection->hdr->version = SHM_VERSION;
+   connection->hdr->ringSize = ringSize;
+   connection->hdr->regionSize = regionSize;
+   connection->hdr->serverPid = (int32_T)getpid();
+   SHM_STORE(&connection->hdr->magic, SHM_MAGIC);
+   shmSetRings(connection);
+
+   if (connection->isVerbose) {
+      printf("rtiostream_shm: server created %s (%lu byte rings, "
+             "%lu byte region)\n", connection->name,
+             (unsigned long)ringSize, (unsigned long)regionSize);
+   }
+   return RTIOSTREAM_NO_ERROR;
+}
+
+/* Function: clientOpenShm ======================================================
+ * Abstract:
+ *  Maps the segment created by the server and claims its client end.
+ */
+static int clientOpenShm(ConnectionData * connection) {
+   struct stat st;
+   ShmHeader * hdr;
+   uint32_T ringSize;
+   uint32_T state = SHM_CLIENT_NONE;
+   void * mem;
+   int fd;
+
+   fd = shm_open(connection->name, O_RDWR, 0);
+   if (fd == -1) {
+      printf("Unable to open shared memory %s: %s. Check that the server "
+             "is running.\n", connection->name, strerror(errno));
+      return RTIOSTREAM_ERROR;
+   }
+   if ((fstat(fd, &st) == -1) || ((size_t)st.st_size < sizeof(ShmHeader))) {
+      printf("Shared memory %s is not an rtiostream_shm segment.\n",
+             connection->name);
+      (void)close(fd);
+      return RTIOSTREAM_ERROR;
+   }
+   mem = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   (void)close(fd);
+   if (mem == MAP_FAILED) {
+      printf("mmap() call failed: %s\n", strerror(errno));
+      return RTIOSTREAM_ERROR;
+   }
+   connection->hdr = hdr = (ShmHeader *)mem;
+   connection->mapSize = (size_t)st.st_size;
+
+   ringSize = hdr->ringSize;
+   if ((SHM_LOAD(&hdr->magic) != SHM_MAGIC) || (hdr->version != SHM_VERSION) ||
+       (shmSegmentSize(ringSize, hdr->regionSize) != connection->mapSize)) {
+      printf("Shared memory %s is not an rtiostream_shm segment.\n",
+             connection->name);
+      return RTIOSTREAM_ERROR;
+   }
+   if (SHM_LOAD(&hdr->serverClosed) || !shmPeerAlive(connection)) {
+      printf("The server of %s has closed.\n", connection->name);
+      return RTIOSTREAM_ERROR;
+   }
+
+   if (!SHM_CAS(&hdr->clientState, &state, SHM_CLIENT_ATTACHED)) {
+      printf("Another client is connected to %s.\n", connection->name);
+      return RTIOSTREAM_ERROR;
+   }
+   SHM_STORE(&hdr->clientPid, (int32_T)getpid());
+   /* a server waiting for a client sleeps on clientState */
+   shmFutexWake(&hdr->clientState);
+   shmSetRings(connection);
+
+   if (connection->isVerbose) {
+      printf("rtiostream_shm: client attached to %s\n", connection->name);
+   }
+   return RTIOSTREAM_NO_ERROR;
+}
+
+/* Function: processArgs ====================================================
+ * Abstract:
+ *  Process the arguments specified by the user when opening the rtIOStream.
+ *
+ *  If any unrecognized options are encountered, ignore them.
+ *
+ * Returns zero if successful or RTIOSTREAM_ERROR if
+ * an error occurred.
+ *
+ *  o IMPORTANT!!!
+ *    As the arguments are processed, their strings should be NULL'd out in
+ *    the argv array.
+ */
+static int processArgs(
+    const int       argc,
+    void         *  argv[],
+    char        *   name,
+    unsigned int *  isClient,
+    int          *  isBlocking,
+    int          *  recvTimeout,
+    unsigned int *  ringSize,
+    unsigned int *  regionSize,
+    int          *  spinCount,
+    int          *  isVerbose)
+{
+    int        retVal    = RTIOSTREAM_NO_ERROR;
+    int        count           = 0;
+
+    while(count < argc) {
+        const char *option = (char *)argv[count];
+        count++;
+
+        if (option != NULL) {
+
+            if ((strcmp(option, "-port") == 0) && (count != argc)) {
+                char       tmpstr[2];
+                int itemsConverted;
+                unsigned int portNum;
+                const char *portStr = (char *)argv[count];
+
+                count++;
+
+                itemsConverted = sscanf(portStr,"%u%1s", &portNum, tmpstr);
+                if (itemsConverted != 1) {
+                    retVal = RTIOSTREAM_ERROR;
+                } else {
+                    (void)sprintf(name, SHM_NAME_FORMAT, portNum);
+                    argv[count-2] = NULL;
+                    argv[count-1] = NULL;
+                }
+
+            } else if ((strcmp(option, "-name") == 0) && (count != argc)) {
+                const char *nameStr = (char *)argv[count];
+
+                count++;
+
+                if ((nameStr[0] != '/') || (strlen(nameStr) >= SHM_NAME_MAXLEN) ||
+                    (strchr(nameStr + 1, '/') != NULL)) {
+                    retVal = RTIOSTREAM_ERROR;
+                } else {
+                    (void)strcpy(name, nameStr);
+                    argv[count-2] = NULL;
+                    argv[count-1] = NULL;
+                }
+
+            } else if ((strcmp(option, "-client") == 0) && (count != argc)) {
+
+                *isClient = ( strcmp( (char *)argv[count], "1") == 0 );
+
+                count++;
+                argv[count-2] = NULL;
+                argv[count-1] = NULL;
+
+            } else if ((strcmp(option, "-blocking") == 0) && (count != argc)) {
+
+                *isBlocking = ( strcmp( (char *)argv[count], "1") == 0 );
+
+                count++;
+                argv[count-2] = NULL;
+                argv[count-1] = NULL;
+
+            } else if ((strcmp(option, "-verbose") == 0) && (count != argc)) {
+
+                *isVerbose = ( strcmp( (char *)argv[count], "1") == 0 );
+
+                count++;
+                argv[count-2] = NULL;
+                argv[count-1] = NULL;
+
+            } else if ((strcmp(option, "-recv_timeout_secs") == 0) && (count != argc)) {
+                char       tmpstr[2];
+                int itemsConverted;
+                const char *timeoutSecsStr = (char *)argv[count];
+
+                count++;
+
+                itemsConverted = sscanf(timeoutSecsStr,"%d%1s", recvTimeout, tmpstr);
+                if ( itemsConverted != 1 ) {
+                    retVal = RTIOSTREAM_ERROR;
+                } else {
+                    argv[count-2] = NULL;
+                    argv[count-1] = NULL;
+                }
+
+            } else if ((strcmp(option, "-ringsize") == 0) && (count != argc)) {
+                char       tmpstr[2];
+                int itemsConverted;
+                const char *ringSizeStr = (char *)argv[count];
+
+                count++;
+
+                itemsConverted = sscanf(ringSizeStr,"%u%1s", ringSize, tmpstr);
+                if ( (itemsConverted != 1) ||
+                     (*ringSize < SHM_MIN_RING_SIZE) ||
+                     (*ringSize > SHM_MAX_RING_SIZE) ||
+                     ((*ringSize & (*ringSize - 1U)) != 0U) ) {
+                    retVal = RTIOSTREAM_ERROR;
+                } else {
+                    argv[count-2] = NULL;
+                    argv[count-1] = NULL;
+                }
+
+            } else if ((strcmp(option, "-send_region_bytes") == 0) && (count != argc)) {
+                char       tmpstr[2];
+                int itemsConverted;
+                const char *regionSizeStr = (char *)argv[count];
+
+                count++;
+
+                itemsConverted = sscanf(regionSizeStr,"%u%1s", regionSize, tmpstr);
+                if ( (itemsConverted != 1) ||
+                     (*regionSize > SHM_MAX_REGION_SIZE) ) {
+                    retVal = RTIOSTREAM_ERROR;
+                } else {
+                    /* keep the region blocks aligned */
+                    *regionSize = (*regionSize + SHM_CACHE_LINE - 1U) &
+                        ~(SHM_CACHE_LINE - 1U);
+                    argv[count-2] = NULL;
+                    argv[count-1] = NULL;
+                }
+
+            } else if ((strcmp(option, "-spin") == 0) && (count != argc)) {
+                char       tmpstr[2];
+                int itemsConverted;
+                const char *spinStr = (char *)argv[count];
+
+                count++;
+
+                itemsConverted = sscanf(spinStr,"%d%1s", spinCount, tmpstr);
+                if ( (itemsConverted != 1) || (*spinCount < 0) ) {
+                    retVal = RTIOSTREAM_ERROR;
+                } else {
+                    argv[count-2] = NULL;
+                    argv[count-1] = NULL;
+                }
+
+            } else {
+                /* issue a warning for the unexpected argument: exception
+                 * is first argument which might be the executable name (
+                 * SIL/PIL and extmode use-cases). */
+                if ((count!=1) || (strncmp(option, "-", 1)==0)) {
+                    printf("The argument '%s' passed to rtiostream_shm is "
+                            "not valid and will be ignored.\n", option);
+                }
+            }
+        }
+    }
+    return retVal;
+}
+
+/***************** VISIBLE FUNCTIONS ******************************************/
+
+/* Function: rtIOStreamOpen =================================================
+ * Abstract:
+ *  Open the connection with the target.
+ */
+int rtIOStreamOpen(int argc, void * argv[])
+{
+    unsigned int        isClient = 0; /* default */
+    int                 isBlockingRecv = EXT_BLOCKING; /* default */
+    int                 blockingRecvTimeout = DEFAULT_BLOCKING_RECV_TIMEOUT; /* rogue value */
+    unsigned int        ringSize = DEFAULT_RING_SIZE;
+    unsigned int        regionSize = DEFAULT_REGION_SIZE;
+    int                 spinCount = DEFAULT_SPIN_COUNT;
+    int                 isVerbose = DEFAULT_IS_VERBOSE;
+    char                name[SHM_NAME_MAXLEN];
+    int result = RTIOSTREAM_NO_ERROR;
+    int streamID;
+    ConnectionData * connection;
+
+    /* determine the streamID for this new connection */
+    streamID = getConnectionID();
+    if (streamID == RTIOSTREAM_ERROR) {
+       result = RTIOSTREAM_ERROR;
+       return result;
+    }
+
+    (void)sprintf(name, SHM_NAME_FORMAT, SERVER_PORT_NUM);
+    result = processArgs(argc, argv,
+                         name,
+                         &isClient,
+                         &isBlockingRecv,
+                         &blockingRecvTimeout,
+                         &ringSize,
+                         &regionSize,
+                         &spinCount,
+                         &isVerbose);
+
+    if (result == RTIOSTREAM_ERROR) {
+       return result;
+    }
+
+    if (isVerbose) {
+       printf("rtIOStreamOpen\n");
+    }
+
+    if (isBlockingRecv) {
+       /* blocking: if blockingRecvTimeout has not been set, initialize to the client or
+        * server specific default */
+       if ((blockingRecvTimeout == DEFAULT_BLOCKING_RECV_TIMEOUT) ||
+           (blockingRecvTimeout < BLOCKING_RECV_TIMEOUT_10MS)) {
+          if (isClient) {
+             blockingRecvTimeout = DEFAULT_BLOCKING_RECV_TIMEOUT_SECS_CLIENT;
+          }
+          else {
+             blockingRecvTimeout = DEFAULT_BLOCKING_RECV_TIMEOUT_SECS_SERVER;
+          }
+       }
+    }
+    else {
+       /* not blocking: set the timeout to return immediately */
+       blockingRecvTimeout = BLOCKING_RECV_TIMEOUT_NOWAIT;
+    }
+
+    connection = &connectionDataArray[streamID];
+    (void)memset(connection, 0, sizeof(ConnectionData));
+    connection->isServer = (isClient == 1) ? 0 : 1;
+    connection->blockingRecvTimeout = blockingRecvTimeout;
+    connection->isVerbose = isVerbose;
+    connection->spinCount = spinCount;
+    (void)strcpy(connection->name, name);
+
+    if (isClient == 1) {
+       result = clientOpenShm(connection);
+    } else {
+       result = serverOpenShm(connection, (uint32_T)ringSize,
+                              (uint32_T)regionSize);
+    }
+
+    if (result != RTIOSTREAM_ERROR) {
+       connection->isInUse = 1;
+       result = streamID;
+    }
+    else {
+       /* cleanup */
+       freeConnectionData(connection);
+    }
+    return result;
+}
+
+/* Function: rtIOStreamSend =====================================================
+ * Abstract:
+ *  Sends the specified number of bytes on the comm line. Returns the number of
+ *  bytes sent (if successful) or a negative value if an error occurred. As long
+ *  as an error does not occur, this function is guaranteed to set the requested
+ *  number of bytes; the function blocks while the ring doesn't have room for
+ *  all of the data to be sent.  A server without a client sends nothing.
+ */
+int rtIOStreamSend(
+    int streamID,
+    const void *src,
+    size_t size,
+    size_t *sizeSent)
+{
+    int retVal = RTIOSTREAM_NO_ERROR;
+    ConnectionData * connection = getConnectionData(streamID);
+    *sizeSent = 0;
+
+    if (connection == NULL) {
+       retVal = RTIOSTREAM_ERROR;
+       return retVal;
+    }
+
+    if (connection->isServer && !serverIsConnected(connection)) {
+       /* nobody to send to */
+    } else {
+       ShmRing * ring = connection->sendRing;
+       uint32_T ringSize = connection->hdr->ringSize;
+       /* with a region the ring to the client carries records */
+       int isFramed = connection->isServer && (connection->regionData != NULL);
+
+       while (*sizeSent < size) {
+          uint32_T tail = SHM_LOAD(&ring->tail);
+
+          if (isFramed) {
+             uint32_T space = ringSize - (ring->head - tail);
+             if (space > SHM_REC_HDR_SIZE) {
+                uint32_T n = (uint32_T)MIN(size - *sizeSent,
+                                           (size_t)(space - SHM_REC_HDR_SIZE));
+                n = MIN(n, SHM_REC_MAXLEN);
+                ringWriteRecord(ring, connection->sendData, ringSize, n,
+                                (const char *)src + *sizeSent, n);
+                *sizeSent += n;
+             }
+          } else {
+             *sizeSent += ringWrite(ring, connection->sendData, ringSize,
+                                    (const char *)src + *sizeSent,
+                                    size - *sizeSent);
+          }
+          if (*sizeSent == size) {
+             break;
+          }
+          if (peerHasClosed(connection) || !shmPeerAlive(connection)) {
+             retVal = RTIOSTREAM_ERROR;
+             break;
+          }
+          /* full: wait for the reader to move tail on */
+          (void)shmWaitChange(connection, &ring->tail, &ring->writerWaiting,
+                              tail, BLOCKING_RECV_TIMEOUT_NEVER);
+       }
+    }
+
+    if (connection->isVerbose) {
+       printf("rtIOStreamSend (connection id %d): size = %lu, sizeSent = %lu\n",
+              streamID,
+              (unsigned long) size,
+              (unsigned long) *sizeSent);
+    }
+
+    return retVal;
+}
+
+
+/* Function: rtIOStreamRecv ================================================
+ * Abstract: receive data
+ *
+ */
+int rtIOStreamRecv(
+    int      streamID,
+    void   * dst,
+    size_t   size,
+    size_t * sizeRecvd)
+{
+    int retVal = RTIOSTREAM_NO_ERROR;
+    ConnectionData * connection = getConnectionData(streamID);
+    int timeoutMs;
+
+    *sizeRecvd = 0;
+
+    if (connection == NULL) {
+       retVal = RTIOSTREAM_ERROR;
+       return retVal;
+    }
+
+    timeoutMs = shmTimeoutMs(connection->blockingRecvTimeout);
+
+    if (connection->isServer && !serverIsConnected(connection)) {
+       /* wait for a client to attach, as the tcpip server waits in accept */
+       (void)shmWaitChange(connection, &connection->hdr->clientState, NULL,
+                           SHM_CLIENT_NONE, timeoutMs);
+    } else if (size > 0) {
+       ShmRing * ring = connection->recvRing;
+       uint32_T ringSize = connection->hdr->ringSize;
+       /* with a region the ring to the client carries records */
+       int isFramed = !connection->isServer && (connection->regionData != NULL);
+
+       *sizeRecvd = isFramed ?
+           ringReadRecords(connection, (char *)dst, size) :
+           ringRead(ring, connection->recvData, ringSize, (char *)dst, size);
+       if (*sizeRecvd == 0) {
+          if (peerHasClosed(connection)) {
+             /* nothing left from a peer that has gone: the server returns
+              * to waiting for a client, the client reports the
+              * disconnection */
+             if (connection->isServer) {
+                (void)serverIsConnected(connection);
+             } else {
+                retVal = RTIOSTREAM_ERROR;
+             }
+          } else if (shmWaitChange(connection, &ring->head,
+                                   &ring->readerWaiting, ring->tail,
+                                   timeoutMs)) {
+             *sizeRecvd = isFramed ?
+                 ringReadRecords(connection, (char *)dst, size) :
+                 ringRead(ring, connection->recvData, ringSize, (char *)dst, size);
+          }
+       }
+    }
+
+    if (connection->isVerbose) {
+       printf("rtIOStreamRecv (connection id %d): size = %lu, sizeRecvd = %lu\n",
+               streamID, (unsigned long) size, (unsigned long) *sizeRecvd);
+    }
+
+    return retVal;
+}
+
+/* Function: rtIOStreamRegionAlloc ===========================================
+ * Abstract:
+ *  Hands out size bytes of the region of a server stream, for data that is
+ *  to be sent with rtIOStreamSendRef.  Returns NULL if the stream has no
+ *  region (or is a client), or the region has no room.
+ */
+void * rtIOStreamRegionAlloc(
+    int streamID,
+    size_t size)
+{
+    ConnectionData * connection = getConnectionData(streamID);
+    void * block = NULL;
+    uint32_T regionSize;
+    uint32_T offset = 0U;
+    int i;
+
+    if ((connection == NULL) || !connection->isServer ||
+        (connection->regionData == NULL) || (size == 0U)) {
+       return NULL;
+    }
+    regionSize = connection->hdr->regionSize;
+    if (size > (size_t)regionSize) {
+       return NULL;
+    }
+    size = (size + SHM_REGION_ALIGN - 1U) & ~(size_t)(SHM_REGION_ALIGN - 1U);
+
+    regionPurge(connection);
+    if (connection->nRegionBlocks < SHM_MAX_REGION_BLOCKS) {
+       /* first fit between the blocks, which are kept in offset order */
+       for (i = 0; i <= connection->nRegionBlocks; i++) {
+          uint32_T end = (i < connection->nRegionBlocks) ?
+              connection->regionBlocks[i].offset : regionSize;
+          if ((size_t)(end - offset) >= size) {
+             RegionBlock * newBlock = &connection->regionBlocks[i];
+             (void)memmove(newBlock + 1, newBlock,
+                           (size_t)(connection->nRegionBlocks - i) * sizeof(RegionBlock));
+             newBlock->offset = offset;
+             newBlock->size = (uint32_T)size;
+             newBlock->isFreed = 0;
+             newBlock->freedAt = 0U;
+             connection->nRegionBlocks++;
+             block = connection->regionData + offset;
+             break;
+          }
+          if (i < connection->nRegionBlocks) {
+             offset = connection->regionBlocks[i].offset +
+                 connection->regionBlocks[i].size;
+          }
+       }
+    }
+
+    if (connection->isVerbose) {
+       printf("rtIOStreamRegionAlloc (connection id %d): size = %lu, offset = %ld\n",
+              streamID, (unsigned long)size,
+              (block != NULL) ? (long)offset : -1L);
+    }
+    return block;
+}
+
+/* Function: rtIOStreamRegionFree ============================================
+ * Abstract:
+ *  Gives back a block from rtIOStreamRegionAlloc.  Its space is reused once
+ *  the client has received what was sent from it.  Returns RTIOSTREAM_ERROR
+ *  if block did not come from rtIOStreamRegionAlloc on this stream.
+ */
+int rtIOStreamRegionFree(
+    int streamID,
+    void * block)
+{
+    ConnectionData * connection = getConnectionData(streamID);
+    int i;
+
+    if ((connection == NULL) || (connection->regionData == NULL) ||
+        ((char *)block < connection->regionData) ||
+        ((char *)block >= connection->regionData + connection->hdr->regionSize)) {
+       return RTIOSTREAM_ERROR;
+    }
+    for (i = 0; i < connection->nRegionBlocks; i++) {
+       RegionBlock * regionBlock = &connection->regionBlocks[i];
+       if (!regionBlock->isFreed &&
+           (connection->regionData + regionBlock->offset == (char *)block)) {
+          regionBlock->isFreed = 1;
+          regionBlock->freedAt = connection->refSent;
+          return RTIOSTREAM_NO_ERROR;
+       }
+    }
+    return RTIOSTREAM_ERROR;
+}
+
+/* Function: rtIOStreamSendRef ===============================================
+ * Abstract:
+ *  As rtIOStreamSend, but when src lies in the region only a reference to
+ *  it is queued: the client copies the data out of the region itself.  The
+ *  caller must not change the data until rtIOStreamSendRefDone reports that
+ *  it has been received.  Anything else is sent with rtIOStreamSend.
+ */
+int rtIOStreamSendRef(
+    int streamID,
+    const void *src,
+    size_t size,
+    size_t *sizeSent)
+{
+    int retVal = RTIOSTREAM_NO_ERROR;
+    ConnectionData * connection = getConnectionData(streamID);
+    const char * srcPtr = (const char *)src;
+
+    if ((connection == NULL) || !connection->isServer ||
+        (connection->regionData == NULL) ||
+        (srcPtr < connection->regionData) ||
+        (size > (size_t)(connection->regionData + connection->hdr->regionSize - srcPtr))) {
+       return rtIOStreamSend(streamID, src, size, sizeSent);
+    }
+
+    *sizeSent = 0;
+    if ((size > 0U) && serverIsConnected(connection)) {
+       ShmRing * ring = connection->sendRing;
+       uint32_T ringSize = connection->hdr->ringSize;
+       uint32_T offset = (uint32_T)(srcPtr - connection->regionData);
+
+       for (;;) {
+          uint32_T tail = SHM_LOAD(&ring->tail);
+          if (ringSize - (ring->head - tail) >= SHM_REC_HDR_SIZE + sizeof(uint32_T)) {
+             connection->refSent += (uint32_T)size;
+             ringWriteRecord(ring, connection->sendData, ringSize,
+                             SHM_REC_REF | (uint32_T)size,
+                             (const char *)&offset, (uint32_T)sizeof(uint32_T));
+             *sizeSent = size;
+             break;
+          }
+          if (peerHasClosed(connection) || !shmPeerAlive(connection)) {
+             retVal = RTIOSTREAM_ERROR;
+             break;
+          }
+          (void)shmWaitChange(connection, &ring->tail, &ring->writerWaiting,
+                              tail, BLOCKING_RECV_TIMEOUT_NEVER);
+       }
+    }
+
+    if (connection->isVerbose) {
+       printf("rtIOStreamSendRef (connection id %d): size = %lu, sizeSent = %lu\n",
+              streamID,
+              (unsigned long) size,
+              (unsigned long) *sizeSent);
+    }
+
+    return retVal;
+}
+
+/* Function: rtIOStreamSendRefDone ===========================================
+ * Abstract:
+ *  Sets *isDone to 1 once the client has received everything sent with
+ *  rtIOStreamSendRef (or is gone, so it never will), waiting up to
+ *  timeoutMs (0 to return immediately, -1 for no limit) for that.
+ */
+int rtIOStreamSendRefDone(
+    int streamID,
+    int timeoutMs,
+    int * isDone)
+{
+    int retVal = RTIOSTREAM_NO_ERROR;
+    ConnectionData * connection = getConnectionData(streamID);
+
+    *isDone = 1;
+    if (connection == NULL) {
+       retVal = RTIOSTREAM_ERROR;
+       return retVal;
+    }
+
+    if (connection->isServer && (connection->regionData != NULL)) {
+       ShmHeader * hdr = connection->hdr;
+       for (;;) {
+          uint32_T consumed = SHM_LOAD(&hdr->refConsumed);
+          if ((consumed == connection->refSent) ||
+              peerHasClosed(connection) || !shmPeerAlive(connection)) {
+             break;
+          }
+          if (!shmWaitChange(connection, &hdr->refConsumed, &hdr->refWaiting,
+                             consumed, timeoutMs)) {
+             *isDone = (SHM_LOAD(&hdr->refConsumed) == connection->refSent) ||
+                 peerHasClosed(connection);
+             break;
+          }
+       }
+    }
+    return retVal;
+}
+
+/* Function: rtIOStreamClose ================================================
+ * Abstract: close the connection.
+ *
+ *  The server removes the segment; a connected client keeps its mapping and
+ *  can still receive what the server sent before closing.  The client
+ *  releases its end so that the server can accept another client.
+ */
+int rtIOStreamClose(int streamID)
+{
+    int retVal = RTIOSTREAM_NO_ERROR;
+    ConnectionData * connection = getConnectionData(streamID);
+    ShmHeader * hdr;
+    int i;
+
+    if (connection == NULL) {
+       retVal = RTIOSTREAM_ERROR;
+       return retVal;
+    }
+
+    if (connection->isVerbose) {
+       printf("rtIOStreamClose (connection id %d)\n", streamID);
+    }
+
+    hdr = connection->hdr;
+    if (connection->isServer) {
+       SHM_STORE(&hdr->serverClosed, 1U);
+       (void)shm_unlink(connection->name);
+    } else {
+       SHM_STORE(&hdr->clientState, SHM_CLIENT_CLOSED);
+       shmFutexWake(&hdr->clientState);
+    }
+    /* wake the peer if it is asleep on either ring so it sees the close */
+    for (i = 0; i < 2; i++) {
+       shmFutexWake(&hdr->ring[i].head);
+       shmFutexWake(&hdr->ring[i].tail);
+    }
+
+    freeConnectionData(connection);
+    return retVal;
+}
+
+/* [EOF] rtiostream_shm.c */
@@ -79,10 +79,32 @@
 # include <errno.h>
 # include <fcntl.h>  
 # include <unistd.h>
+# include <sys/uio.h>       /* struct iovec */
 
 #define RTIOSTREAM_ECONNRESET ECONNRESET
 #endif
 
+/*
+ * RTIOSTREAM_TCPIP_EPOLL
+ *
+ * On Linux, the connected TCP sockets of connections opened with
+ * "-reactor 1" are watched by one edge-triggered epoll instance (the
+ * reactor) instead of one select() per socket and call.  Readiness reported
+ * for any of them is remembered in its connection, so a wait for one stream
+ * also collects the events of the others, and a stream known to be readable
+ * is read without a wait.  Because an edge collected by one thread is only
+ * remembered, all streams using the reactor must be received from one
+ * thread (e.g. a host that serves them all with rtIOStreamWait); a thread
+ * blocked on another reactor stream would not see it.  Other streams use
+ * select() as before.  Define RTIOSTREAM_TCPIP_NO_EPOLL to build without
+ * the reactor; "-reactor 1" is then ignored.
+ */
+#if defined(__linux__) && !defined(RTIOSTREAM_TCPIP_NO_EPOLL)
+# define RTIOSTREAM_TCPIP_EPOLL
+# include <time.h>
+# include <sys/epoll.h>
+#endif
+
 #ifdef USE_MEXPRINTF
 #include "mex.h"
 #define printf mexPrintf
@@ -168,6 +190,20 @@
 
 #define DEFAULT_IS_USING_SEQ_NUM 1
 
+/* default send coalescing buffer size
+ *
+ * With "-send_coalesce_bytes N", TCP sends are collected in an N byte
+ * buffer and leave in one gather write when the buffer would overflow, when
+ * rtIOStreamSend is called with a size of 0, or before the next
+ * rtIOStreamRecv or rtIOStreamClose.  A target that sends many small
+ * packets per step (e.g. external mode upload) then makes one system call
+ * per step instead of one or two per packet.  0 disables coalescing. */
+#define DEFAULT_SEND_COALESCE_BYTES 0
+
+/* default for "-reactor": the stream is not watched by the reactor (see
+ * RTIOSTREAM_TCPIP_EPOLL) */
+#define DEFAULT_USE_REACTOR 0
+
 #ifdef WIN32
   /* WINDOWS */
 # define close closesocket
@@ -276,6 +312,16 @@ typedef struct ConnectionData_tag {
    UDPData * udpData; /* UDP specific data - NULL for TCP */
    int udpSendBufSize;
    int udpRecvBufSize;
+   char * sendBuf; /* coalesced TCP send data - NULL when not coalescing */
+   int sendBufSize; /* capacity of sendBuf */
+   int sendBufUsed; /* bytes waiting in sendBuf */
+#ifdef RTIOSTREAM_TCPIP_EPOLL
+   int useReactor; /* "-reactor 1": watch sock with the reactor */
+   SOCKET reactorSock; /* sock as registered with the reactor, INVALID_SOCKET
+                          if sock is not registered */
+   int isReadable; /* the reactor reported sock readable and a recv has not
+                      found it empty since */
+#endif
 } ConnectionData;
 
 /**************** LOCAL DATA *************************************************/
@@ -295,6 +341,15 @@ typedef struct ConnectionData_tag {
 #define MAX_NUM_CONNECTIONS (50)
 static ConnectionData connectionDataArray[MAX_NUM_CONNECTIONS];
 
+#ifdef RTIOSTREAM_TCPIP_EPOLL
+/* the reactor: created on first use and kept until the library is unloaded */
+static int reactorFd = -1;
+#endif
+
+/* longest wait of rtIOStreamWait while it polls streams that cannot be
+ * waited for (servers waiting for a client; UDP streams with the reactor) */
+#define REACTOR_POLL_MS (10)
+
 /************** LOCAL FUNCTION PROTOTYPES ************************************/
 
 static int initConnectionData(int connectionID, 
@@ -308,7 +363,9 @@ static int initConnectionData(int connectionID,
                           int isVerbose, 
                           int isUsingSeqNum,
                           int udpSendBufSize,
-                          int udpRecvBufSize); 
+                          int udpRecvBufSize,
+                          int sendCoalesceBytes,
+                          int useReactor); 
 
 static int getConnectionID(void);
 
@@ -342,6 +399,17 @@ static int socketDataGet(
     const size_t   size,
     size_t        *sizeRecvd);
 
+static int socketDataFlush(
+    ConnectionData * connection,
+    const void *src,
+    const size_t size);
+
+static int socketDataCoalesce(
+    ConnectionData * connection,
+    const void *src,
+    const size_t size,
+    size_t *sizeSent);
+
 static int socketDataPending(
     const SOCKET sock,
     ConnectionData * connection,
@@ -362,6 +430,21 @@ static SOCKET clientOpenSocket(char * hostName, unsigned int portNum, CommsProto
 
 static void serverAcceptSocket(ConnectionData * connection);
 
+#ifdef RTIOSTREAM_TCPIP_EPOLL
+static int streamTimeoutMs(int timeoutSecs);
+
+static int reactorWatch(ConnectionData * connection);
+
+static int reactorPoll(int timeoutMs);
+
+static int reactorRecv(
+    ConnectionData * connection,
+    void * dst,
+    size_t size,
+    size_t * sizeRecvd,
+    int * isClosed);
+#endif
+
 static int processArgs(
     const int       argc,
     void         *  argv[],
@@ -376,7 +459,9 @@ static int processArgs(
     int           * isVerbose, 
     int           * isUsingSeqNum,
     int           * udpSendBufSize,
-    int           * udpRecvBufSize);
+    int           * udpRecvBufSize,
+    int           * sendCoalesceBytes,
+    int           * useReactor);
 
 #if (!defined(VXWORKS))
 static unsigned long nameLookup(char * hostName);
@@ -401,7 +486,9 @@ static int initConnectionData(int connectionID,
                           int isVerbose, 
                           int isUsingSeqNum,
                           int udpSendBufSize,
-                          int udpRecvBufSize) {
+                          int udpRecvBufSize,
+                          int sendCoalesceBytes,
+                          int useReactor) {
    int retVal = RTIOSTREAM_NO_ERROR;
    ConnectionData * connection = &connectionDataArray[connectionID];
   
@@ -417,6 +504,28 @@ static int initConnectionData(int connectionID,
     * freeConnectionData on error will succeed */
    connection->udpData = NULL;
    connection->serverData = NULL;
+   connection->sendBuf = NULL;
+   connection->sendBufSize = 0;
+   connection->sendBufUsed = 0;
+#ifdef RTIOSTREAM_TCPIP_EPOLL
+   connection->useReactor = useReactor;
+   connection->reactorSock = INVALID_SOCKET;
+   connection->isReadable = 0;
+#else
+   (void) useReactor;
+#endif
+
+   if ((protocol == TCP_PROTOCOL) && (sendCoalesceBytes > 0)) {
+      /* UDP sends are datagrams and are never coalesced */
+      connection->sendBuf = (char *) malloc((size_t) sendCoalesceBytes);
+      if (connection->sendBuf == NULL) {
+         printf("initConnectionData:send buffer malloc failed.\n");
+         freeConnectionData(connection);
+         retVal = RTIOSTREAM_ERROR;
+         return retVal; 
+      }
+      connection->sendBufSize = sendCoalesceBytes;
+   }
 
    if (protocol == UDP_PROTOCOL) {      
       /* initialize the UDP data */
@@ -497,6 +606,8 @@ static int initConnectionData(int connectionID,
    if (isVerbose) {
       if (connection->protocol == TCP_PROTOCOL) {
          printf("Connection id %d, protocol: TCP/IP\n", connectionID);
+         printf("Connection id %d, sendCoalesceBytes: %d\n", connectionID, 
+                                                             connection->sendBufSize);
       }
       else {
          printf("Connection id %d, protocol: UDP/IP\n", connectionID);
@@ -598,6 +709,8 @@ static void freeConnectionData(ConnectionData * connection) {
       free(connection->serverData);
       connection->serverData = NULL;
    }
+   free(connection->sendBuf);
+   connection->sendBuf = NULL;
 }
 
 /* Function: createUDPPacketBuffer =================================================
@@ -966,6 +1079,280 @@ static int socketDataSet(
     return retVal;
 }
 
+/* Function: socketDataFlush ===================================================
+ * Abstract:
+ *  Sends the coalesced data of the connection followed by 'size' bytes from
+ *  'src' (which may be 0), blocking until all of it is sent.  Where the
+ *  platform has a gather write both buffers normally leave in a single
+ *  system call.  The coalescing buffer is empty on return, also on failure.
+ *
+ *  RTIOSTREAM_NO_ERROR is returned on success, RTIOSTREAM_ERROR on failure.
+ */
+static int socketDataFlush(
+    ConnectionData * connection,
+    const void *src,
+    const size_t size)
+{
+    int retVal = RTIOSTREAM_NO_ERROR;
+    const char *buf = connection->sendBuf;
+    size_t bufLeft = (size_t) connection->sendBufUsed;
+    const char *data = (const char *) src;
+    size_t dataLeft = size;
+
+    connection->sendBufUsed = 0;
+
+#if (!defined(_WIN32)) && (!defined(VXWORKS))
+    while ((bufLeft + dataLeft) > 0) {
+        struct iovec iov[2];
+        struct msghdr msg;
+        ssize_t nSent;
+        size_t nFromBuf;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        if (bufLeft > 0) {
+            iov[msg.msg_iovlen].iov_base = (void *) buf;
+            iov[msg.msg_iovlen].iov_len = bufLeft;
+            msg.msg_iovlen++;
+        }
+        if (dataLeft > 0) {
+            iov[msg.msg_iovlen].iov_base = (void *) data;
+            iov[msg.msg_iovlen].iov_len = dataLeft;
+            msg.msg_iovlen++;
+        }
+
+        nSent = sendmsg(connection->sock, &msg, 0);
+        if (nSent == SOCK_ERR) {
+            if (errno == EINTR) {
+                continue;
+            }
+            retVal = RTIOSTREAM_ERROR;
+            break;
+        }
+        nFromBuf = MIN((size_t) nSent, bufLeft);
+        buf += nFromBuf;
+        bufLeft -= nFromBuf;
+        data += (size_t) nSent - nFromBuf;
+        dataLeft -= (size_t) nSent - nFromBuf;
+    }
+#else
+    /* no gather write: one send per buffer */
+    while ((bufLeft > 0) && (retVal == RTIOSTREAM_NO_ERROR)) {
+        size_t nSent;
+        retVal = socketDataSet(connection, buf, bufLeft, &nSent);
+        buf += nSent;
+        bufLeft -= nSent;
+    }
+    while ((dataLeft > 0) && (retVal == RTIOSTREAM_NO_ERROR)) {
+        size_t nSent;
+        retVal = socketDataSet(connection, data, dataLeft, &nSent);
+        data += nSent;
+        dataLeft -= nSent;
+    }
+#endif
+
+    return retVal;
+}
+
+/* Function: socketDataCoalesce ================================================
+ * Abstract:
+ *  Adds 'size' bytes from 'src' to the coalescing buffer of the connection,
+ *  sending the buffer and the new data together when they do not fit.  A
+ *  size of 0 sends whatever is in the buffer.
+ */
+static int socketDataCoalesce(
+    ConnectionData * connection,
+    const void *src,
+    const size_t size,
+    size_t *sizeSent)
+{
+    int retVal = RTIOSTREAM_NO_ERROR;
+
+    if ((size > 0) &&
+        (size <= (size_t) (connection->sendBufSize - connection->sendBufUsed))) {
+        memcpy(connection->sendBuf + connection->sendBufUsed, src, size);
+        connection->sendBufUsed += (int) size;
+    } else {
+        retVal = socketDataFlush(connection, src, size);
+    }
+
+    if (retVal != RTIOSTREAM_ERROR) {
+        *sizeSent = size;
+    }
+    return retVal;
+}
+
+#ifdef RTIOSTREAM_TCPIP_EPOLL
+/* Function: streamTimeoutMs ===================================================
+ * Abstract:
+ *  Converts a blockingRecvTimeout to milliseconds, -1 meaning no limit.
+ */
+static int streamTimeoutMs(int timeoutSecs) {
+   int timeoutMs;
+   switch (timeoutSecs) {
+      case BLOCKING_RECV_TIMEOUT_NEVER:
+         timeoutMs = -1;
+         break;
+      case BLOCKING_RECV_TIMEOUT_10MS:
+         timeoutMs = 10;
+         break;
+      default:
+         timeoutMs = (timeoutSecs > INT_MAX / 1000) ? INT_MAX : timeoutSecs * 1000;
+         break;
+   }
+   return timeoutMs;
+}
+
+/* Function: reactorWatch =======================================================
+ * Abstract:
+ *  Makes sure the connected TCP socket of a connection opened with
+ *  "-reactor 1" is registered with the reactor.  Returns 1 if it is, 0 if
+ *  the connection does not use the reactor, has no such socket or the
+ *  registration failed (the caller then uses select()).
+ */
+static int reactorWatch(ConnectionData * connection) {
+   struct epoll_event ev;
+
+   if (!connection->useReactor ||
+       (connection->protocol != TCP_PROTOCOL) || 
+       (connection->sock == INVALID_SOCKET)) {
+      return 0;
+   }
+   if (connection->reactorSock == connection->sock) {
+      return 1;
+   }
+   if (reactorFd == -1) {
+      reactorFd = epoll_create1(EPOLL_CLOEXEC);
+      if (reactorFd == -1) {
+         return 0;
+      }
+   }
+   memset(&ev, 0, sizeof(ev));
+   ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+   ev.data.u32 = (uint32_t) (connection - connectionDataArray);
+   if (epoll_ctl(reactorFd, EPOLL_CTL_ADD, connection->sock, &ev) == SOCK_ERR) {
+      if ((errno != EEXIST) ||
+          (epoll_ctl(reactorFd, EPOLL_CTL_MOD, connection->sock, &ev) == SOCK_ERR)) {
+         return 0;
+      }
+   }
+   connection->reactorSock = connection->sock;
+   /* data may have arrived before the registration: find out with a recv */
+   connection->isReadable = 1;
+   return 1;
+}
+
+/* Function: reactorPoll ========================================================
+ * Abstract:
+ *  Waits up to timeoutMs (-1 for no limit) for the reactor to report
+ *  sockets as readable and marks their connections.  An interrupted wait
+ *  is not an error.
+ */
+static int reactorPoll(int timeoutMs) {
+   struct epoll_event events[MAX_NUM_CONNECTIONS];
+   int nEvents;
+   int i;
+
+   nEvents = epoll_wait(reactorFd, events, MAX_NUM_CONNECTIONS, timeoutMs);
+   if (nEvents == SOCK_ERR) {
+      return (errno == EINTR) ? RTIOSTREAM_NO_ERROR : RTIOSTREAM_ERROR;
+   }
+   for (i = 0; i < nEvents; i++) {
+      uint32_t connectionID = events[i].data.u32;
+      if ((connectionID < MAX_NUM_CONNECTIONS) && 
+          connectionDataArray[connectionID].isInUse) {
+         /* EPOLLIN, or a hang-up or error that recv will report */
+         connectionDataArray[connectionID].isReadable = 1;
+      }
+   }
+   return RTIOSTREAM_NO_ERROR;
+}
+
+/* Function: reactorRecv ========================================================
+ * Abstract:
+ *  Receives up to 'size' bytes from the connected TCP socket of a connection
+ *  watched by the reactor, waiting according to blockingRecvTimeout while
+ *  the socket has nothing to read.  The socket is only read without
+ *  blocking; a read that comes back short or empty means it has been
+ *  drained, and the next edge reported by the reactor marks it readable
+ *  again.
+ *
+ *  'isClosed' is set if the peer closed the connection.  RTIOSTREAM_ERROR
+ *  is returned on failure.
+ */
+static int reactorRecv(
+    ConnectionData * connection,
+    void * dst,
+    size_t size,
+    size_t * sizeRecvd,
+    int * isClosed)
+{
+   int timeoutMs = streamTimeoutMs(connection->blockingRecvTimeout);
+   /* Ensure size is not out of range for socket API recv function */
+   int sizeLim = (int) MIN(size, INT_MAX);
+   struct timespec deadline;
+   int hasPolled = 0;
+
+   *sizeRecvd = 0;
+   *isClosed = 0;
+   if (size == 0) {
+      return RTIOSTREAM_NO_ERROR;
+   }
+   if (timeoutMs > 0) {
+      (void) clock_gettime(CLOCK_MONOTONIC, &deadline);
+      deadline.tv_sec += timeoutMs / 1000;
+      deadline.tv_nsec += (long) (timeoutMs % 1000) * 1000000L;
+      if (deadline.tv_nsec >= 1000000000L) {
+         deadline.tv_sec++;
+         deadline.tv_nsec -= 1000000000L;
+      }
+   }
+
+   for (;;) {
+      int waitMs = timeoutMs;
+
+      if (connection->isReadable) {
+         int nRead = recv(connection->sock, dst, sizeLim, MSG_DONTWAIT);
+         if (nRead > 0) {
+            if (nRead < sizeLim) {
+               connection->isReadable = 0;
+            }
+            *sizeRecvd = (size_t) nRead;
+            return RTIOSTREAM_NO_ERROR;
+         }
+         if (nRead == 0) {
+            *isClosed = 1;
+            return RTIOSTREAM_NO_ERROR;
+         }
+         if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+            connection->isReadable = 0;
+         } else if (errno != EINTR) {
+            return RTIOSTREAM_ERROR;
+         } else {
+            continue;
+         }
+      }
+
+      if (timeoutMs > 0) {
+         struct timespec now;
+         long leftMs;
+         (void) clock_gettime(CLOCK_MONOTONIC, &now);
+         leftMs = (long) (deadline.tv_sec - now.tv_sec) * 1000L + 
+             (deadline.tv_nsec - now.tv_nsec) / 1000000L;
+         waitMs = (leftMs > 0) ? (int) leftMs : 0;
+      }
+      if (hasPolled && (waitMs == 0)) {
+         /* timed out */
+         return RTIOSTREAM_NO_ERROR;
+      }
+      if (reactorPoll(waitMs) == RTIOSTREAM_ERROR) {
+         return RTIOSTREAM_ERROR;
+      }
+      hasPolled = 1;
+   }
+}
+#endif /* RTIOSTREAM_TCPIP_EPOLL */
+
 /* Function: serverStreamRecv =================================================
  * Abstract:
  *  Send data from the server-side
@@ -984,6 +1371,23 @@ static int serverStreamRecv(
        serverAcceptSocket(connection);
     }
 
+#ifdef RTIOSTREAM_TCPIP_EPOLL
+    if (reactorWatch(connection)) {
+        int isClosed;
+        retVal = reactorRecv(connection, dst, size, sizeRecvd, &isClosed);
+        if ((retVal == RTIOSTREAM_ERROR) && (errno == RTIOSTREAM_ECONNRESET)) {
+            /* the client has already gone, see below */
+            retVal = RTIOSTREAM_NO_ERROR;
+            isClosed = 1;
+        }
+        if (isClosed || (retVal == RTIOSTREAM_ERROR)) {
+            close(connection->sock);
+            connection->sock = INVALID_SOCKET;
+        }
+        return retVal;
+    }
+#endif
+
     if (connection->sock != INVALID_SOCKET) {
         int pending;
         if (connection->blockingRecvTimeout != BLOCKING_RECV_TIMEOUT_NEVER) {
@@ -1260,8 +1664,14 @@ static void serverAcceptSocket(ConnectionData * connection)
          cFd = connection->serverData->listenSock;
       }
    }
-   /* set sock */
+   /* set sock; nothing coalesced for a previous client is sent to this one */
    connection->sock = cFd;
+   connection->sendBufUsed = 0;
+#ifdef RTIOSTREAM_TCPIP_EPOLL
+   /* the previous socket was closed, which removed it from the reactor,
+    * and the new one may have the same descriptor */
+   connection->reactorSock = INVALID_SOCKET;
+#endif
 } 
 
 
@@ -1332,7 +1742,9 @@ static int processArgs(
     int           * isVerbose, 
     int           * isUsingSeqNum,
     int           * udpSendBufSize,
-    int           * udpRecvBufSize)
+    int           * udpRecvBufSize,
+    int           * sendCoalesceBytes,
+    int           * useReactor)
 {
     int        retVal    = RTIOSTREAM_NO_ERROR;
     int        count           = 0;
@@ -1480,6 +1892,35 @@ static int processArgs(
                   argv[count-2] = NULL;
                   argv[count-1] = NULL;
                } 
+            } else if ((strcmp(option, "-send_coalesce_bytes") == 0) && (count != argc)) {
+               char       tmpstr[2];
+               int itemsConverted;
+               const char *coalesceStr = (char *)argv[count];
+
+               count++;     
+
+               itemsConverted = sscanf(coalesceStr,"%d%1s", sendCoalesceBytes, tmpstr);
+               if ( (itemsConverted != 1) || (*sendCoalesceBytes < 0) ) {
+                  retVal = RTIOSTREAM_ERROR;
+               } else {
+                  argv[count-2] = NULL;
+                  argv[count-1] = NULL;
+               } 
+            } else if ((strcmp(option, "-reactor") == 0) && (count != argc)) {
+               char       tmpstr[2];
+               int itemsConverted;
+               const char *reactorStr = (char *)argv[count];
+
+               count++;     
+
+               itemsConverted = sscanf(reactorStr,"%d%1s", useReactor, tmpstr);
+               if ( (itemsConverted != 1) || 
+                    ((*useReactor != 0) && (*useReactor != 1)) ) {
+                  retVal = RTIOSTREAM_ERROR;
+               } else {
+                  argv[count-2] = NULL;
+                  argv[count-1] = NULL;
+               } 
             } else {
                 /* issue a warning for the unexpected argument: exception 
                  * is first argument which might be the executable name (
@@ -1628,6 +2069,8 @@ int rtIOStreamOpen(int argc, void * argv[])
     int                 isUsingSeqNum = DEFAULT_IS_USING_SEQ_NUM;
     int                 udpSendBufSize = DEFAULT_UDP_SOCKET_SEND_SIZE_REQUEST;
     int                 udpRecvBufSize = DEFAULT_UDP_SOCKET_RECEIVE_SIZE_REQUEST;
+    int                 sendCoalesceBytes = DEFAULT_SEND_COALESCE_BYTES;
+    int                 useReactor = DEFAULT_USE_REACTOR;
     int result = RTIOSTREAM_NO_ERROR;
     int streamID;
     SOCKET sock = INVALID_SOCKET;
@@ -1651,7 +2094,9 @@ int rtIOStreamOpen(int argc, void * argv[])
                          &isVerbose, 
                          &isUsingSeqNum,
                          &udpSendBufSize,
-                         &udpRecvBufSize);
+                         &udpRecvBufSize,
+                         &sendCoalesceBytes,
+                         &useReactor);
 
     if (result == RTIOSTREAM_ERROR) {
        return result;
@@ -1731,7 +2176,9 @@ int rtIOStreamOpen(int argc, void * argv[])
              isVerbose, 
              isUsingSeqNum,
              udpSendBufSize,
-             udpRecvBufSize);
+             udpRecvBufSize,
+             sendCoalesceBytes,
+             useReactor);
     }
     
     if (result != RTIOSTREAM_ERROR) {
@@ -1753,6 +2200,10 @@ int rtIOStreamOpen(int argc, void * argv[])
  *  as an error does not occur, this function is guaranteed to set the requested
  *  number of bytes; the function blocks if tcpip's send buffer doesn't have
  *  room for all of the data to be sent
+ *
+ *  When coalescing (see DEFAULT_SEND_COALESCE_BYTES), the data may be held
+ *  back in the coalescing buffer; a size of 0 sends it.  Without coalescing
+ *  a size of 0 returns at once.
  */
 int rtIOStreamSend(
     int streamID,
@@ -1769,12 +2220,19 @@ int rtIOStreamSend(
        return retVal;
     }
 
+    if ((size == 0) && (connection->sendBuf == NULL)) {
+        /* nothing held back: a flush must not cost a send (or a UDP packet) */
+        return retVal;
+    }
+
     if (connection->isServer) {
         if (connection->sock == INVALID_SOCKET) {
             serverAcceptSocket(connection);
         }
 
-        if (connection->sock != INVALID_SOCKET) {
+        if ((connection->sock != INVALID_SOCKET) && (connection->sendBuf != NULL)) {
+           retVal = socketDataCoalesce(connection, src, size, sizeSent);
+        } else if (connection->sock != INVALID_SOCKET) {
 #ifndef VXWORKS
            retVal = socketDataSet(connection, src, size, sizeSent);
 #else           
@@ -1786,6 +2244,8 @@ int rtIOStreamSend(
            retVal = socketDataSet(connection, (char *)src, size, sizeSent);
 #endif
         }
+    } else if (connection->sendBuf != NULL) { /* Client stream, coalescing */
+        retVal = socketDataCoalesce(connection, src, size, sizeSent);
     } else { /* Client stream */
         retVal = socketDataSet(connection, src, size, sizeSent);
     }
@@ -1821,8 +2281,21 @@ int rtIOStreamRecv(
        return retVal;
     }
 
+    if ((connection->sendBufUsed > 0) && (connection->sock != INVALID_SOCKET)) {
+        /* a reply may depend on what was sent: let it leave first */
+        retVal = socketDataFlush(connection, NULL, 0);
+        if (retVal == RTIOSTREAM_ERROR) {
+            return retVal;
+        }
+    }
+
     if (connection->isServer) {
         retVal = serverStreamRecv(connection, dst, size, sizeRecvd); 
+#ifdef RTIOSTREAM_TCPIP_EPOLL
+    } else if (reactorWatch(connection)) { /* Client stream, reactor */
+        int isClosed;
+        retVal = reactorRecv(connection, dst, size, sizeRecvd, &isClosed);
+#endif
     } else { /* Client stream */
         int pending;
         if (connection->blockingRecvTimeout != BLOCKING_RECV_TIMEOUT_NEVER) {
@@ -1849,6 +2322,157 @@ int rtIOStreamRecv(
     return retVal;
 }
 
+/* Function: rtIOStreamWait ================================================
+ * Abstract:
+ *  Waits for at most timeoutMs milliseconds (-1 for no limit, 0 to poll)
+ *  until at least one of the nStreams streams in streamIDs has data to
+ *  receive or has been closed by its peer.  A server without a client
+ *  accepts one if a connection request is pending and is then ready.
+ *
+ *  The ready streams are returned in readyIDs, which must have room for
+ *  nStreams entries, and their number in nReady.  nReady may be 0 before
+ *  timeoutMs has passed (e.g. when only streams not in streamIDs had events,
+ *  or while a server waits for its client, which is polled every
+ *  REACTOR_POLL_MS), and a ready stream may still receive 0 bytes; callers
+ *  wait again in both cases.
+ *
+ *  Data held back in a coalescing buffer is sent before waiting.  Streams
+ *  opened with "-reactor 1" are waited for through the reactor, all others
+ *  with one select() that also watches the reactor.
+ *
+ *  Returns RTIOSTREAM_ERROR if a streamID is invalid or the wait failed.
+ */
+int rtIOStreamWait(
+    const int streamIDs[],
+    int       nStreams,
+    int       timeoutMs,
+    int       readyIDs[],
+    int     * nReady)
+{
+    int retVal = RTIOSTREAM_NO_ERROR;
+    int needsPoll = 0;
+    int pass;
+    fd_set ReadFds;
+    SOCKET maxSock = 0;
+#ifdef RTIOSTREAM_TCPIP_EPOLL
+    int usesReactor = 0;
+#endif
+    FD_ZERO(&ReadFds);
+
+    *nReady = 0;
+
+    /* pass 0 collects the streams already known to be ready and waits if
+     * there are none; pass 1 collects what the wait reported */
+    for (pass = 0; pass < 2; pass++) {
+        int i;
+        int waitMs = timeoutMs;
+
+        for (i = 0; i < nStreams; i++) {
+            ConnectionData * connection = getConnectionData(streamIDs[i]);
+            int isReady = 0;
+
+            if (connection == NULL) {
+                retVal = RTIOSTREAM_ERROR;
+                return retVal;
+            }
+
+            if (connection->isServer && (connection->sock == INVALID_SOCKET)) {
+                if (pass == 0) {
+                    /* accept a pending connection request without blocking */
+                    int savedBlockingRecvTimeout = connection->blockingRecvTimeout;
+                    connection->blockingRecvTimeout = BLOCKING_RECV_TIMEOUT_NOWAIT;
+                    serverAcceptSocket(connection);
+                    connection->blockingRecvTimeout = savedBlockingRecvTimeout;
+                }
+                if (connection->sock == INVALID_SOCKET) {
+                    needsPoll = 1;
+                    continue;
+                }
+            }
+
+            if ((pass == 0) && (connection->sendBufUsed > 0)) {
+                /* the awaited reply may depend on what was held back */
+                retVal = socketDataFlush(connection, NULL, 0);
+                if (retVal == RTIOSTREAM_ERROR) {
+                    return retVal;
+                }
+            }
+
+            if ((connection->protocol == UDP_PROTOCOL) &&
+                (connection->udpData->recvBuffer->dataAvail > 0)) {
+                isReady = 1;
+#ifdef RTIOSTREAM_TCPIP_EPOLL
+            } else if (reactorWatch(connection)) {
+                /* the reactor's events are collected after the select below */
+                isReady = connection->isReadable;
+                usesReactor = 1;
+#endif
+            } else if (pass == 0) {
+    #if defined(_WIN32) && defined(_MSC_VER)
+      /*temporarily disable warning C4127 caused by using FD_SET*/
+      #pragma warning(push)
+      #pragma warning(disable: 4127)
+    #endif 
+                FD_SET(connection->sock, &ReadFds);
+    #if defined(_WIN32) && defined(_MSC_VER)
+      /*enable the warning C4127*/
+      #pragma warning(pop)
+    #endif
+                maxSock = (connection->sock > maxSock) ? connection->sock : maxSock;
+            } else {
+                isReady = FD_ISSET(connection->sock, &ReadFds);
+            }
+            if (isReady) {
+                readyIDs[(*nReady)++] = streamIDs[i];
+            }
+        }
+
+        if ((*nReady > 0) || (pass == 1)) {
+            break;
+        }
+
+        if (needsPoll && ((waitMs < 0) || (waitMs > REACTOR_POLL_MS))) {
+            waitMs = REACTOR_POLL_MS;
+        }
+#ifdef RTIOSTREAM_TCPIP_EPOLL
+        /* the reactor is readable while it has events to report */
+        if (usesReactor) {
+            FD_SET(reactorFd, &ReadFds);
+            maxSock = (reactorFd > maxSock) ? reactorFd : maxSock;
+        }
+#endif
+        {
+            struct timeval tval;
+            struct timeval * tvalPtr = NULL;
+            if (waitMs >= 0) {
+                tval.tv_sec  = waitMs / 1000;
+                tval.tv_usec = (waitMs % 1000) * 1000;
+                tvalPtr = &tval;
+            }
+            if (select((int)(maxSock + 1), &ReadFds, NULL, NULL, tvalPtr) == SOCK_ERR) {
+#ifdef _WIN32
+                retVal = RTIOSTREAM_ERROR;
+#else
+                retVal = (errno == EINTR) ? RTIOSTREAM_NO_ERROR : RTIOSTREAM_ERROR;
+#endif
+                /* the sets are undefined after an error */
+                FD_ZERO(&ReadFds);
+            }
+        }
+#ifdef RTIOSTREAM_TCPIP_EPOLL
+        if ((retVal != RTIOSTREAM_ERROR) && usesReactor &&
+            FD_ISSET(reactorFd, &ReadFds)) {
+            retVal = reactorPoll(0);
+        }
+#endif
+        if (retVal == RTIOSTREAM_ERROR) {
+            break;
+        }
+    }
+
+    return retVal;
+}
+
 /* Function: rtIOStreamClose ================================================
  * Abstract: close the connection.
  *
@@ -1866,6 +2490,11 @@ int rtIOStreamClose(int streamID)
        printf("rtIOStreamClose (connection id %d)\n", streamID);
     }
 
+    if ((connection->sendBufUsed > 0) && (connection->sock != INVALID_SOCKET)) {
+       /* send what is still coalesced */
+       retVal = socketDataFlush(connection, NULL, 0);
+    }
+
     if (connection->isServer) {
         /* Only if the client actually made a connection */
         if (connection->sock != INVALID_SOCKET) {
@@ -1896,3 +2525,65 @@ int rtIOStreamClose(int streamID)
     return retVal;
 }
 
+
+/* Function: rtIOStreamRegionAlloc ===========================================
+ * Abstract:
+ *  The receiver cannot read this driver's memory, so there is no region to
+ *  hand out: always returns NULL and the caller allocates elsewhere.
+ */
+void * rtIOStreamRegionAlloc(
+    int streamID,
+    size_t size)
+{
+    (void)streamID;
+    (void)size;
+    return NULL;
+}
+
+/* Function: rtIOStreamRegionFree ============================================
+ * Abstract:
+ *  No block comes from rtIOStreamRegionAlloc, so any block is an error.
+ */
+int rtIOStreamRegionFree(
+    int streamID,
+    void * block)
+{
+    (void)streamID;
+    (void)block;
+    return RTIOSTREAM_ERROR;
+}
+
+/* Function: rtIOStreamSendRef ===============================================
+ * Abstract:
+ *  Data cannot be sent by reference over a socket; it is sent by copy with
+ *  rtIOStreamSend, so it is received as soon as this returns.
+ */
+int rtIOStreamSendRef(
+    int streamID,
+    const void *src,
+    size_t size,
+    size_t *sizeSent)
+{
+    return rtIOStreamSend(streamID, src, size, sizeSent);
+}
+
+/* Function: rtIOStreamSendRefDone ===========================================
+ * Abstract:
+ *  rtIOStreamSendRef copies, so nothing is ever outstanding: *isDone is
+ *  always 1.
+ */
+int rtIOStreamSendRefDone(
+    int streamID,
+    int timeoutMs,
+    int * isDone)
+{
+    int retVal = RTIOSTREAM_NO_ERROR;
+    ConnectionData * connection = getConnectionData(streamID);
+
+    (void)timeoutMs;
+    *isDone = 1;
+    if (connection == NULL) {
+       retVal = RTIOSTREAM_ERROR;
+    }
+    return retVal;
+}
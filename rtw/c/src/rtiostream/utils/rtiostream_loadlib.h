@@ -17,6 +17,8 @@ typedef int (*rtIOStreamOpen_type)(const int, void **);
 typedef int (*rtIOStreamSend_type)(const int, const void *, const size_t, size_t *);
 typedef int (*rtIOStreamRecv_type)(const int, void *, const size_t, size_t *);
 typedef int (*rtIOStreamClose_type)(const int);
+/* optional, not loaded into libH_type */
+typedef int (*rtIOStreamWait_type)(const int *, const int, const int, int *, int *);
 
 typedef struct libH_type_tag {
     rtIOStreamOpen_type openFn;